@@ -0,0 +1,42 @@
+#include <cstdio>
+#include "adderAILogic.hpp"
+#include<string>
+
+/*
+This (not too smart) AI treats the first two bytes of the percepts as unsigned chars and its action is to add them as a 16 bit unsigned integer.  It plays one round against the game on the other side of the given interface and then asks the game engine to shut down.  Should really convert to network byte order and back.
+@param inputAICom: An interface that is connected to the game and has received the first percept
+@return: 0 on success, -1 if a percept was the wrong size
+*/
+int runAdderAI(AICommunicationInterface &inputAICom)
+{
+std::string percept = inputAICom.getCurrentPerceptions();
+
+if(percept.size() != 2)
+{
+return -1;
+}
+
+printf("First percept (reward: %lu): %x %x\n", inputAICom.getCurrentReward(), percept[0], percept[1]);
+
+//Send back the action
+uint16_t actionInteger = ( (uint16_t) percept[0]) + ( (uint16_t) percept[1]);
+std::string action;
+action.push_back(((const unsigned char *) &actionInteger)[0]);
+action.push_back(((const unsigned char *) &actionInteger)[1]);
+
+inputAICom.sendActionsAndUpdatePerceptions(action);
+
+percept = inputAICom.getCurrentPerceptions();
+
+if(percept.size() != 2)
+{
+return -1;
+}
+
+printf("Second percept (reward: %lu): %x %x\n", inputAICom.getCurrentReward(), percept[0], percept[1]);
+
+//End game
+inputAICom.sendActionsAndUpdatePerceptions(action, false, true);
+
+return 0;
+}
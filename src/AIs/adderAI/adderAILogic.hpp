@@ -0,0 +1,15 @@
+#ifndef ADDERAILOGICHPP
+#define ADDERAILOGICHPP
+
+#include "AICommunicationInterface.hpp"
+
+/*
+This (not too smart) AI treats the first two bytes of the percepts as unsigned chars and its action is to add them as a 16 bit unsigned integer.  It plays one round against the game on the other side of the given interface and then asks the game engine to shut down.  Should really convert to network byte order and back.
+@param inputAICom: An interface that is connected to the game and has received the first percept
+@return: 0 on success, -1 if a percept was the wrong size
+*/
+int runAdderAI(AICommunicationInterface &inputAICom);
+
+
+
+#endif
@@ -0,0 +1,87 @@
+#include <cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<string>
+#include<vector>
+#include<memory>
+#include<exception>
+
+#include "roundTripBenchmark.hpp"
+
+/*
+This function prints how to use the program.
+*/
+static void printUsage()
+{
+fprintf(stderr, "Usage: communicationBenchmark [--csv file] [--steps N]\n");
+fprintf(stderr, "Measures steps per second and round trip latency between a game and an AI for every transport, percept sizes from 2 bytes to 4 MB and action sizes up to 64 KB, with the AI in the same process and in a separate one.  Results are written as CSV to the given file (or standard output).  --steps limits how many steps each configuration runs (default %d).\n", ROUND_TRIP_BENCHMARK_DEFAULT_MAXIMUM_STEPS);
+}
+
+/*
+This program runs the round trip benchmark sweep over the communication interfaces, so that changes to gameEngineCommunicationInterface, AICommunicationInterface or the transports can be checked for performance regressions by comparing the CSV results of two builds.  Progress goes to standard error.
+*/
+int main(int argc, char **argv)
+{
+std::string resultsFilePath;
+uint64_t maximumNumberOfSteps = ROUND_TRIP_BENCHMARK_DEFAULT_MAXIMUM_STEPS;
+for(int argumentIndex = 1; argumentIndex < argc; argumentIndex++)
+{
+if(strcmp(argv[argumentIndex], "--csv") == 0 && argumentIndex + 1 < argc)
+{
+resultsFilePath = argv[++argumentIndex];
+}
+else if(strcmp(argv[argumentIndex], "--steps") == 0 && argumentIndex + 1 < argc && atoll(argv[argumentIndex + 1]) > 0)
+{
+maximumNumberOfSteps = atoll(argv[++argumentIndex]);
+}
+else
+{
+printUsage();
+return 1;
+}
+}
+
+FILE *resultsFile = stdout;
+if(!resultsFilePath.empty())
+{
+resultsFile = fopen(resultsFilePath.c_str(), "w");
+if(resultsFile == NULL)
+{
+fprintf(stderr, "Error, unable to open %s\n", resultsFilePath.c_str());
+return 1;
+}
+}
+
+writeRoundTripBenchmarkCSVHeader(resultsFile);
+fflush(resultsFile);
+
+int returnValue = 0;
+std::unique_ptr<roundTripBenchmarkResult> result(new roundTripBenchmarkResult); //The histogram is too big to want on the stack
+for(const roundTripBenchmarkConfiguration &configuration : getStandardRoundTripBenchmarkConfigurations(maximumNumberOfSteps))
+{
+fprintf(stderr, "%s, %s process, %llu byte percepts, %llu byte actions: ", getRoundTripBenchmarkTransportName(configuration.transport), configuration.separateProcesses ? "separate" : "same", (unsigned long long) configuration.perceptSize, (unsigned long long) configuration.actionSize);
+
+try
+{
+runRoundTripBenchmark(configuration, *result);
+}
+catch(const std::exception &inputException)
+{
+//Carry on with the other configurations so one broken transport doesn't hide the rest of the results
+fprintf(stderr, "failed: %s\n", inputException.what());
+returnValue = -1;
+continue;
+}
+
+fprintf(stderr, "%.0f steps per second, p50 %.2f us, p99 %.2f us\n", result->stepsPerSecond, result->roundTripTimes.getValueAtPercentile(50.0)/1000.0, result->roundTripTimes.getValueAtPercentile(99.0)/1000.0);
+writeRoundTripBenchmarkCSVLine(resultsFile, *result);
+fflush(resultsFile);
+}
+
+if(resultsFile != stdout)
+{
+fclose(resultsFile);
+}
+
+return returnValue;
+}
@@ -0,0 +1,276 @@
+#include "roundTripBenchmark.hpp"
+
+#include<future>
+#include<exception>
+#include<algorithm>
+#include<unistd.h>
+#include<signal.h>
+#include<sys/wait.h>
+
+#include "gameEngineCommunicationInterface.hpp"
+#include "AICommunicationInterface.hpp"
+#include "sessionRegistry.hpp"
+
+/*
+This function works out how many steps to run a configuration for, so that each one moves about ROUND_TRIP_BENCHMARK_BYTES_PER_CONFIGURATION bytes.
+@param inputPerceptSize: The percept size in bytes
+@param inputActionSize: The action size in bytes
+@param inputMaximumNumberOfSteps: The most steps to run
+@return: The number of steps
+*/
+static uint64_t getNumberOfRoundTripBenchmarkSteps(uint64_t inputPerceptSize, uint64_t inputActionSize, uint64_t inputMaximumNumberOfSteps)
+{
+uint64_t numberOfSteps = ROUND_TRIP_BENCHMARK_BYTES_PER_CONFIGURATION/(inputPerceptSize + inputActionSize);
+numberOfSteps = std::max<uint64_t>(numberOfSteps, ROUND_TRIP_BENCHMARK_MINIMUM_STEPS);
+return std::min(numberOfSteps, std::max<uint64_t>(inputMaximumNumberOfSteps, ROUND_TRIP_BENCHMARK_MINIMUM_STEPS));
+}
+
+/*
+This function returns the standard sweep: percept sizes from 2 bytes to 4 MB (with 2 byte actions) and action sizes up to 64 KB (with 2 byte percepts), for every transport, with the game and the AI in the same process and in separate processes.
+@param inputMaximumNumberOfSteps: The most steps to run any configuration for
+@return: The configurations
+*/
+std::vector<roundTripBenchmarkConfiguration> getStandardRoundTripBenchmarkConfigurations(uint64_t inputMaximumNumberOfSteps)
+{
+const transportType transports[] = {PUB_SUB_TRANSPORT, LOCKSTEP_TRANSPORT, SHARED_MEMORY_TRANSPORT};
+const uint64_t perceptSizes[] = {2, 64, 1024, 16*1024, 256*1024, 1024*1024, 4*1024*1024};
+const uint64_t actionSizes[] = {64, 4*1024, 64*1024}; //2 byte actions are covered by the percept sweep
+
+std::vector<roundTripBenchmarkConfiguration> configurations;
+for(transportType transport : transports)
+{
+for(bool separateProcesses : {false, true})
+{
+roundTripBenchmarkConfiguration configuration;
+configuration.transport = transport;
+configuration.separateProcesses = separateProcesses;
+
+configuration.actionSize = 2;
+for(uint64_t perceptSize : perceptSizes)
+{
+configuration.perceptSize = perceptSize;
+configuration.numberOfSteps = getNumberOfRoundTripBenchmarkSteps(configuration.perceptSize, configuration.actionSize, inputMaximumNumberOfSteps);
+configurations.push_back(configuration);
+}
+
+configuration.perceptSize = 2;
+for(uint64_t actionSize : actionSizes)
+{
+configuration.actionSize = actionSize;
+configuration.numberOfSteps = getNumberOfRoundTripBenchmarkSteps(configuration.perceptSize, configuration.actionSize, inputMaximumNumberOfSteps);
+configurations.push_back(configuration);
+}
+}
+}
+
+return configurations;
+}
+
+/*
+This function plays the game side of a configuration, timing each step.
+@param inputContext: The ZMQ context to use
+@param inputGameEndpoint: The endpoint the game binds to
+@param inputAIEndpoint: The endpoint the AI binds to (only used by PUB_SUB_TRANSPORT)
+@param inputConfiguration: What to run
+@param outputResult: The measurements
+@exceptions: This function can throw exceptions
+*/
+static void runRoundTripBenchmarkGame(zmq::context_t &inputContext, const std::string &inputGameEndpoint, const std::string &inputAIEndpoint, const roundTripBenchmarkConfiguration &inputConfiguration, roundTripBenchmarkResult &outputResult)
+{
+gameEngineCommunicationInterface game(inputContext, inputGameEndpoint, inputConfiguration.perceptSize*8, inputConfiguration.actionSize*8, ROUND_TRIP_BENCHMARK_TIMEOUT, inputConfiguration.transport, ROUND_TRIP_BENCHMARK_TIMEOUT, inputAIEndpoint);
+
+uint64_t numberOfWarmUpSteps = std::max<uint64_t>(inputConfiguration.numberOfSteps/10, 1);
+std::string percept(inputConfiguration.perceptSize, 'p');
+uint64_t timedStartTime = 0;
+for(uint64_t step = 0; step < inputConfiguration.numberOfSteps; step++)
+{
+percept[0] = (char) step; //So that the percept isn't identical every step
+
+uint64_t stepStartTime = stepInstrumentation::getTime();
+SOM_TRY
+game.sendPerceptionsAndGetActions(percept, 0);
+SOM_CATCH("Error running benchmark step\n")
+
+if(step == numberOfWarmUpSteps)
+{
+timedStartTime = stepStartTime;
+}
+
+if(step >= numberOfWarmUpSteps)
+{
+outputResult.roundTripTimes.record(stepInstrumentation::getTime() - stepStartTime);
+}
+}
+
+outputResult.numberOfTimedSteps = outputResult.roundTripTimes.getCount();
+uint64_t timedDuration = stepInstrumentation::getTime() - timedStartTime;
+outputResult.stepsPerSecond = timedDuration == 0 ? 0.0 : outputResult.numberOfTimedSteps*1e9/timedDuration;
+}
+
+/*
+This function plays the AI side of a configuration, answering every percept and telling the game to shut down with the last action.
+@param inputContext: The ZMQ context to use
+@param inputGameEndpoint: The endpoint the game binds to
+@param inputAIEndpoint: The endpoint the AI binds to (only used by PUB_SUB_TRANSPORT)
+@param inputConfiguration: What to run
+@exceptions: This function can throw exceptions
+*/
+static void runRoundTripBenchmarkAI(zmq::context_t &inputContext, const std::string &inputGameEndpoint, const std::string &inputAIEndpoint, const roundTripBenchmarkConfiguration &inputConfiguration)
+{
+AICommunicationInterface AI(inputContext, inputGameEndpoint, inputConfiguration.transport, ROUND_TRIP_BENCHMARK_TIMEOUT, inputAIEndpoint);
+
+std::string action(inputConfiguration.actionSize, 'a');
+for(uint64_t step = 0; step < inputConfiguration.numberOfSteps; step++)
+{
+SOM_TRY
+AI.sendActionsAndUpdatePerceptions(action, false, step + 1 == inputConfiguration.numberOfSteps);
+SOM_CATCH("Error running benchmark step\n")
+}
+}
+
+/*
+This function runs one configuration: the game sends percepts of the given size and the AI answers each with an action of the given size, as fast as they can.  The first tenth of the steps (which include the connection handshake) aren't timed.
+@param inputConfiguration: What to run
+@param outputResult: The measurements
+@exceptions: This function can throw exceptions (if either side fails or times out)
+*/
+void runRoundTripBenchmark(const roundTripBenchmarkConfiguration &inputConfiguration, roundTripBenchmarkResult &outputResult)
+{
+outputResult.configuration = inputConfiguration;
+outputResult.numberOfTimedSteps = 0;
+outputResult.stepsPerSecond = 0.0;
+outputResult.roundTripTimes.reset();
+
+if(!inputConfiguration.separateProcesses)
+{
+//The ZMQ transports use inproc://, the same as a game and AI sharing a process normally would
+std::string gameEndpoint = inputConfiguration.transport == SHARED_MEMORY_TRANSPORT ? "shm://roundTripBenchmark" + std::to_string(getpid()) : "inproc://roundTripBenchmarkGame";
+std::string AIEndpoint = inputConfiguration.transport == PUB_SUB_TRANSPORT ? "inproc://roundTripBenchmarkAI" : "";
+
+zmq::context_t context;
+std::future<void> AIResult = std::async(std::launch::async, [&]()
+{
+runRoundTripBenchmarkAI(context, gameEndpoint, AIEndpoint, inputConfiguration);
+});
+
+std::exception_ptr gameException;
+try
+{
+runRoundTripBenchmarkGame(context, gameEndpoint, AIEndpoint, inputConfiguration, outputResult);
+}
+catch(...)
+{
+gameException = std::current_exception();
+}
+
+SOM_TRY
+AIResult.get();
+SOM_CATCH("Error in benchmark AI\n")
+
+if(gameException)
+{
+std::rethrow_exception(gameException);
+}
+return;
+}
+
+//Separate processes use the session's endpoints (TCP for the ZMQ transports), claimed so that nothing else on the host is using them
+sessionLease lease;
+std::string gameEndpoint;
+std::string AIEndpoint;
+SOM_TRY
+gameEndpoint = lease.getGameEndpoint(inputConfiguration.transport);
+AIEndpoint = lease.getAIEndpoint(inputConfiguration.transport);
+SOM_CATCH("Error getting endpoints for benchmark session\n")
+
+//No ZMQ context exists yet and this thread is the only one running, so the child can safely create its own
+fflush(NULL);
+pid_t AIProcessID = fork();
+if(AIProcessID < 0)
+{
+throw SOMException("Error starting benchmark AI process\n", FORK_ERROR, __FILE__, __LINE__);
+}
+
+if(AIProcessID == 0)
+{
+int exitCode = 0;
+try
+{
+zmq::context_t context;
+runRoundTripBenchmarkAI(context, gameEndpoint, AIEndpoint, inputConfiguration);
+}
+catch(const std::exception &inputException)
+{
+fprintf(stderr, "Benchmark AI error: %s\n", inputException.what());
+exitCode = 1;
+}
+fflush(NULL);
+_exit(exitCode); //Skip the parent's destructors and exit handlers
+}
+
+std::exception_ptr gameException;
+try
+{
+zmq::context_t context;
+runRoundTripBenchmarkGame(context, gameEndpoint, AIEndpoint, inputConfiguration, outputResult);
+}
+catch(...)
+{
+gameException = std::current_exception();
+kill(AIProcessID, SIGKILL); //The AI would otherwise wait out its timeout
+}
+
+int AIStatus = 0;
+waitpid(AIProcessID, &AIStatus, 0);
+
+if(gameException)
+{
+std::rethrow_exception(gameException);
+}
+
+if(!WIFEXITED(AIStatus) || WEXITSTATUS(AIStatus) != 0)
+{
+throw SOMException("Error, benchmark AI process failed\n", SYSTEM_ERROR, __FILE__, __LINE__);
+}
+}
+
+/*
+This function returns the name used for a transport in the results.
+@param inputTransportType: The transport
+@return: The name ("pubsub", "lockstep" or "shm")
+*/
+const char *getRoundTripBenchmarkTransportName(transportType inputTransportType)
+{
+switch(inputTransportType)
+{
+case PUB_SUB_TRANSPORT:
+return "pubsub";
+case LOCKSTEP_TRANSPORT:
+return "lockstep";
+case SHARED_MEMORY_TRANSPORT:
+return "shm";
+}
+
+return "unknown";
+}
+
+/*
+This function writes the header line of the CSV results.
+@param inputFile: The file to write to
+*/
+void writeRoundTripBenchmarkCSVHeader(FILE *inputFile)
+{
+fprintf(inputFile, "transport,processes,percept_bytes,action_bytes,timed_steps,steps_per_second,mean_us,p50_us,p99_us,max_us\n");
+}
+
+/*
+This function writes one result as a line of CSV (latencies in microseconds).
+@param inputFile: The file to write to
+@param inputResult: The result to write
+*/
+void writeRoundTripBenchmarkCSVLine(FILE *inputFile, const roundTripBenchmarkResult &inputResult)
+{
+const roundTripBenchmarkConfiguration &configuration = inputResult.configuration;
+const latencyHistogram &times = inputResult.roundTripTimes;
+fprintf(inputFile, "%s,%s,%llu,%llu,%llu,%.1f,%.2f,%.2f,%.2f,%.2f\n", getRoundTripBenchmarkTransportName(configuration.transport), configuration.separateProcesses ? "separate" : "same", (unsigned long long) configuration.perceptSize, (unsigned long long) configuration.actionSize, (unsigned long long) inputResult.numberOfTimedSteps, inputResult.stepsPerSecond, times.getMean()/1000.0, times.getValueAtPercentile(50.0)/1000.0, times.getValueAtPercentile(99.0)/1000.0, times.getMaximum()/1000.0);
+}
@@ -0,0 +1,87 @@
+#ifndef ROUNDTRIPBENCHMARKHPP
+#define ROUNDTRIPBENCHMARKHPP
+
+#include<string>
+#include<vector>
+#include<cstdint>
+#include<cstdio>
+
+#include "SOMException.hpp"
+#include "messageTransport.hpp"
+#include "stepInstrumentation.hpp"
+
+//The most steps a configuration is run for (small messages)
+#define ROUND_TRIP_BENCHMARK_DEFAULT_MAXIMUM_STEPS 20000
+
+//The fewest steps a configuration is run for (large messages), so that the p99 still means something
+#define ROUND_TRIP_BENCHMARK_MINIMUM_STEPS 100
+
+//Between those limits, each configuration is run for about this many bytes of percepts and actions so that the large sizes don't take minutes
+#define ROUND_TRIP_BENCHMARK_BYTES_PER_CONFIGURATION (256ULL*1024*1024)
+
+//How long either side waits for the other before the configuration fails (in milliseconds), so that a broken transport doesn't hang the suite
+#define ROUND_TRIP_BENCHMARK_TIMEOUT 60000
+
+/*
+One point of the benchmark sweep.
+*/
+struct roundTripBenchmarkConfiguration
+{
+transportType transport;
+bool separateProcesses; //True to run the AI in a forked child process, false to run it as a thread in the same process
+uint64_t perceptSize; //In bytes
+uint64_t actionSize; //In bytes
+uint64_t numberOfSteps; //Including the warm up steps, which aren't timed
+};
+
+/*
+The measurements for one configuration.
+*/
+struct roundTripBenchmarkResult
+{
+roundTripBenchmarkConfiguration configuration;
+uint64_t numberOfTimedSteps;
+double stepsPerSecond;
+latencyHistogram roundTripTimes; //Time from the game starting to send a percept to it having the AI's action, in nanoseconds
+};
+
+/*
+This function returns the standard sweep: percept sizes from 2 bytes to 4 MB (with 2 byte actions) and action sizes up to 64 KB (with 2 byte percepts), for every transport, with the game and the AI in the same process and in separate processes.
+@param inputMaximumNumberOfSteps: The most steps to run any configuration for
+@return: The configurations
+*/
+std::vector<roundTripBenchmarkConfiguration> getStandardRoundTripBenchmarkConfigurations(uint64_t inputMaximumNumberOfSteps = ROUND_TRIP_BENCHMARK_DEFAULT_MAXIMUM_STEPS);
+
+/*
+This function runs one configuration: the game sends percepts of the given size and the AI answers each with an action of the given size, as fast as they can.  The first tenth of the steps (which include the connection handshake) aren't timed.
+@param inputConfiguration: What to run
+@param outputResult: The measurements
+@exceptions: This function can throw exceptions (if either side fails or times out)
+*/
+void runRoundTripBenchmark(const roundTripBenchmarkConfiguration &inputConfiguration, roundTripBenchmarkResult &outputResult);
+
+/*
+This function returns the name used for a transport in the results.
+@param inputTransportType: The transport
+@return: The name ("pubsub", "lockstep" or "shm")
+*/
+const char *getRoundTripBenchmarkTransportName(transportType inputTransportType);
+
+/*
+This function writes the header line of the CSV results.
+@param inputFile: The file to write to
+*/
+void writeRoundTripBenchmarkCSVHeader(FILE *inputFile);
+
+/*
+This function writes one result as a line of CSV (latencies in microseconds).
+@param inputFile: The file to write to
+@param inputResult: The result to write
+*/
+void writeRoundTripBenchmarkCSVLine(FILE *inputFile, const roundTripBenchmarkResult &inputResult);
+
+
+
+
+
+#endif
@@ -0,0 +1,267 @@
+#include "coroutineGameHost.hpp"
+
+#include<thread>
+#include<algorithm>
+
+gameCoroutine gameCoroutine::promise_type::get_return_object()
+{
+return gameCoroutine(std::coroutine_handle<promise_type>::from_promise(*this));
+}
+
+std::suspend_always gameCoroutine::promise_type::initial_suspend() noexcept
+{
+return std::suspend_always(); //The host starts the game
+}
+
+std::suspend_always gameCoroutine::promise_type::final_suspend() noexcept
+{
+return std::suspend_always(); //The gameCoroutine object destroys the finished game
+}
+
+void gameCoroutine::promise_type::return_void()
+{
+}
+
+void gameCoroutine::promise_type::unhandled_exception()
+{
+exception = std::current_exception();
+}
+
+/*
+This function wraps the given coroutine.
+@param inputHandle: The coroutine
+*/
+gameCoroutine::gameCoroutine(std::coroutine_handle<promise_type> inputHandle) : handle(inputHandle)
+{
+}
+
+/*
+This function takes over the coroutine of the given object.
+@param inputGame: The object to take the coroutine from
+*/
+gameCoroutine::gameCoroutine(gameCoroutine &&inputGame) noexcept : handle(inputGame.handle)
+{
+inputGame.handle = std::coroutine_handle<promise_type>();
+}
+
+/*
+This function destroys the coroutine (if this object still owns it).
+*/
+gameCoroutine::~gameCoroutine()
+{
+if(handle)
+{
+handle.destroy();
+}
+}
+
+/*
+This function remembers the arguments of the step.
+*/
+coroutineGameEnvironment::stepAwaitable::stepAwaitable(coroutineGameEnvironment &inputEnvironment, const std::string &inputAIPerceptions, uint64_t inputReward, bool inputEndGame) : environment(inputEnvironment), perceptions(inputAIPerceptions), reward(inputReward), endGame(inputEndGame)
+{
+}
+
+/*
+This function always returns false (the AI can't have answered a percept that hasn't been sent yet).
+@return: False
+*/
+bool coroutineGameEnvironment::stepAwaitable::await_ready() noexcept
+{
+return false;
+}
+
+/*
+This function sends the percept and hands the game to the host to wait for the AI's actions.
+@param inputCoroutine: The game's coroutine
+@return: True if the game should be suspended, false if sending failed (so the game resumes straight away and await_resume throws)
+*/
+bool coroutineGameEnvironment::stepAwaitable::await_suspend(std::coroutine_handle<> inputCoroutine)
+{
+environment.stepException = std::exception_ptr();
+
+try
+{
+environment.interface.sendPerceptions(perceptions, reward, endGame);
+}
+catch(...)
+{
+environment.stepException = std::current_exception();
+return false;
+}
+
+environment.waitingCoroutine = inputCoroutine;
+environment.host.waitingEnvironments.push_back(&environment);
+return true;
+}
+
+/*
+This function returns the AI's actions once the game is resumed.
+@return: The actions (the reference stays valid until the next step)
+@exceptions: This function can throw exceptions (if the step failed)
+*/
+const std::string &coroutineGameEnvironment::stepAwaitable::await_resume()
+{
+if(environment.stepException)
+{
+std::exception_ptr exception = environment.stepException;
+environment.stepException = std::exception_ptr();
+std::rethrow_exception(exception);
+}
+
+return environment.interface.getActions();
+}
+
+/*
+This function connects a game coroutine to the given host and communication interface.
+@param inputHost: The host that runs the game
+@param inputInterface: The interface to the game's AI (which should only be used through this object while the game runs)
+*/
+coroutineGameEnvironment::coroutineGameEnvironment(coroutineGameHost &inputHost, gameEngineCommunicationInterface &inputInterface) : host(inputHost), interface(inputInterface)
+{
+}
+
+/*
+This function returns an awaitable that sends a percept to the AI and resumes the game with the AI's actions, in the same way as gameEngineCommunicationInterface::sendPerceptionsAndGetActions.
+@param inputAIPerceptions: The data to send to the agent for it to act on (it must stay alive until the co_await finishes, which a temporary in the co_await expression does)
+@param inputReward: The reward that the game decides the AI is entitled to
+@param inputEndGame: True if this is the last percept in the AI's current game and the next percept will correspond to a new game
+@return: The awaitable
+*/
+coroutineGameEnvironment::stepAwaitable coroutineGameEnvironment::step(const std::string &inputAIPerceptions, uint64_t inputReward, bool inputEndGame)
+{
+return stepAwaitable(*this, inputAIPerceptions, inputReward, inputEndGame);
+}
+
+/*
+This function returns the communication interface, so that the game can check AIWantsToRestartGame, AIWantsToEndSession and the session totals.
+@return: The interface
+*/
+gameEngineCommunicationInterface &coroutineGameEnvironment::getInterface()
+{
+return interface;
+}
+
+/*
+This function creates a host with no games.
+*/
+coroutineGameHost::coroutineGameHost()
+{
+}
+
+/*
+This function adds a game to be run by run.
+@param inputGame: The game coroutine (the host takes it over)
+*/
+void coroutineGameHost::addGame(gameCoroutine &&inputGame)
+{
+games.push_back(std::move(inputGame));
+}
+
+/*
+This function runs all of the added games until they have all finished.  If a game throws, the other games keep running and the first exception is rethrown once they are done.
+@exceptions: This function can throw exceptions
+*/
+void coroutineGameHost::run()
+{
+//Run each game until it first waits for its AI
+for(gameCoroutine &game : games)
+{
+if(!game.handle.done())
+{
+game.handle.resume();
+}
+}
+
+uint32_t numberOfIdlePolls = 0;
+while(!waitingEnvironments.empty())
+{
+bool madeProgress = false;
+for(size_t environmentIndex = 0; environmentIndex < waitingEnvironments.size(); )
+{
+coroutineGameEnvironment &environment = *waitingEnvironments[environmentIndex];
+
+bool stepFinished = false;
+try
+{
+stepFinished = environment.interface.tryGetActions();
+}
+catch(...)
+{
+environment.stepException = std::current_exception(); //Rethrown in the game by await_resume
+stepFinished = true;
+}
+
+if(!stepFinished)
+{
+environmentIndex++;
+continue;
+}
+
+//Take the game off the waiting list before resuming it, since it will usually add itself back with its next step
+waitingEnvironments[environmentIndex] = waitingEnvironments.back();
+waitingEnvironments.pop_back();
+madeProgress = true;
+
+std::coroutine_handle<> waitingCoroutine = environment.waitingCoroutine;
+environment.waitingCoroutine = std::coroutine_handle<>();
+waitingCoroutine.resume();
+}
+
+numberOfIdlePolls = madeProgress ? 0 : numberOfIdlePolls + 1;
+if(numberOfIdlePolls > 0)
+{
+waitBeforeNextPoll(numberOfIdlePolls);
+}
+}
+
+//Every game should have finished, since they can only wait on their AI
+std::exception_ptr firstException;
+for(gameCoroutine &game : games)
+{
+if(!game.handle.done())
+{
+if(!firstException)
+{
+firstException = std::make_exception_ptr(SOMException("Error, game coroutine waited on something other than coroutineGameEnvironment::step\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__));
+}
+continue;
+}
+
+if(game.handle.promise().exception && !firstException)
+{
+firstException = game.handle.promise().exception;
+}
+}
+games.clear();
+
+if(firstException)
+{
+std::rethrow_exception(firstException);
+}
+}
+
+/*
+This function blocks until one of the waiting games has something to do if none of them has made progress for a while, so that a host whose AIs are thinking doesn't keep a core busy.
+@param inputNumberOfIdlePolls: How many times in a row the waiting games have been checked without any of them making progress
+@exceptions: This function can throw exceptions
+*/
+void coroutineGameHost::waitBeforeNextPoll(uint32_t inputNumberOfIdlePolls)
+{
+if(inputNumberOfIdlePolls <= COROUTINE_GAME_HOST_IDLE_POLLS_BEFORE_WAITING)
+{
+std::this_thread::yield();
+return;
+}
+
+//The run loop checks every waiting game anyway, so which ones are ready doesn't matter
+poller.clear();
+for(coroutineGameEnvironment *environment : waitingEnvironments)
+{
+poller.addSession(environment->interface);
+}
+
+SOM_TRY
+poller.wait(-1, readySessions);
+SOM_CATCH("Error waiting for the games' AIs\n")
+}
@@ -0,0 +1,187 @@
+#ifndef COROUTINEGAMEHOSTHPP
+#define COROUTINEGAMEHOSTHPP
+
+#include<coroutine>
+#include<exception>
+#include<vector>
+#include<string>
+#include<cstdint>
+
+#include "SOMException.hpp"
+#include "gameEngineCommunicationInterface.hpp"
+#include "sessionPoller.hpp"
+
+//How many times the host checks all of its games without blocking (just yielding) before it blocks until one of them hears from its AI
+#define COROUTINE_GAME_HOST_IDLE_POLLS_BEFORE_WAITING 64
+
+class coroutineGameHost;
+
+/*
+This is the return type of a game written as a C++20 coroutine.  The game is started by coroutineGameHost::run rather than when it is called, and finishes with co_return (or by returning from the end of the function).  For example:
+
+gameCoroutine playMyGame(coroutineGameEnvironment &inputEnvironment)
+{
+const std::string &action = co_await inputEnvironment.step(percept, reward);
+...
+}
+*/
+class gameCoroutine
+{
+public:
+/*
+The promise type that the compiler uses for gameCoroutine functions.
+*/
+struct promise_type
+{
+std::exception_ptr exception; //Whatever the game threw (rethrown by coroutineGameHost::run)
+
+gameCoroutine get_return_object();
+std::suspend_always initial_suspend() noexcept;
+std::suspend_always final_suspend() noexcept;
+void return_void();
+void unhandled_exception();
+};
+
+/*
+This function takes over the coroutine of the given object.
+@param inputGame: The object to take the coroutine from
+*/
+gameCoroutine(gameCoroutine &&inputGame) noexcept;
+
+gameCoroutine(const gameCoroutine &) = delete;
+gameCoroutine &operator=(const gameCoroutine &) = delete;
+
+/*
+This function destroys the coroutine (if this object still owns it).
+*/
+~gameCoroutine();
+
+private:
+friend class coroutineGameHost;
+std::coroutine_handle<promise_type> handle;
+
+/*
+This function wraps the given coroutine.
+@param inputHandle: The coroutine
+*/
+explicit gameCoroutine(std::coroutine_handle<promise_type> inputHandle);
+};
+
+/*
+This class is a game coroutine's connection to its AI.  co_await step(...) sends a percept and suspends the game until the AI's actions arrive, so that one coroutineGameHost thread can run many games at once.  Both the host and the communication interface must outlive this object.
+*/
+class coroutineGameEnvironment
+{
+public:
+/*
+The awaitable returned by step.
+*/
+class stepAwaitable
+{
+public:
+/*
+This function always returns false (the AI can't have answered a percept that hasn't been sent yet).
+@return: False
+*/
+bool await_ready() noexcept;
+
+/*
+This function sends the percept and hands the game to the host to wait for the AI's actions.
+@param inputCoroutine: The game's coroutine
+@return: True if the game should be suspended, false if sending failed (so the game resumes straight away and await_resume throws)
+*/
+bool await_suspend(std::coroutine_handle<> inputCoroutine);
+
+/*
+This function returns the AI's actions once the game is resumed.
+@return: The actions (the reference stays valid until the next step)
+@exceptions: This function can throw exceptions (if the step failed)
+*/
+const std::string &await_resume();
+
+private:
+friend class coroutineGameEnvironment;
+coroutineGameEnvironment &environment;
+const std::string &perceptions;
+uint64_t reward;
+bool endGame;
+
+/*
+This function remembers the arguments of the step.
+*/
+stepAwaitable(coroutineGameEnvironment &inputEnvironment, const std::string &inputAIPerceptions, uint64_t inputReward, bool inputEndGame);
+};
+
+/*
+This function connects a game coroutine to the given host and communication interface.
+@param inputHost: The host that runs the game
+@param inputInterface: The interface to the game's AI (which should only be used through this object while the game runs)
+*/
+coroutineGameEnvironment(coroutineGameHost &inputHost, gameEngineCommunicationInterface &inputInterface);
+
+/*
+This function returns an awaitable that sends a percept to the AI and resumes the game with the AI's actions, in the same way as gameEngineCommunicationInterface::sendPerceptionsAndGetActions.
+@param inputAIPerceptions: The data to send to the agent for it to act on (it must stay alive until the co_await finishes, which a temporary in the co_await expression does)
+@param inputReward: The reward that the game decides the AI is entitled to
+@param inputEndGame: True if this is the last percept in the AI's current game and the next percept will correspond to a new game
+@return: The awaitable
+*/
+stepAwaitable step(const std::string &inputAIPerceptions, uint64_t inputReward, bool inputEndGame = false);
+
+/*
+This function returns the communication interface, so that the game can check AIWantsToRestartGame, AIWantsToEndSession and the session totals.
+@return: The interface
+*/
+gameEngineCommunicationInterface &getInterface();
+
+private:
+friend class coroutineGameHost;
+coroutineGameHost &host;
+gameEngineCommunicationInterface &interface;
+std::coroutine_handle<> waitingCoroutine; //The game waiting for its AI to answer
+std::exception_ptr stepException; //Whatever the last step threw (rethrown by await_resume)
+};
+
+/*
+This class runs many game coroutines on one thread.  Each game runs until it waits for its AI (co_await on coroutineGameEnvironment::step), at which point the host moves on to the other games, and is resumed once its AI's actions arrive.  The host checks the games that are waiting without blocking (and once none of them has made progress for a while, blocks in a sessionPoller until one of them hears from its AI), so a single thread can run hundreds of games (such as many copies of a cheap game) without needing a thread for each one.
+*/
+class coroutineGameHost
+{
+public:
+/*
+This function creates a host with no games.
+*/
+coroutineGameHost();
+
+/*
+This function adds a game to be run by run.
+@param inputGame: The game coroutine (the host takes it over)
+*/
+void addGame(gameCoroutine &&inputGame);
+
+/*
+This function runs all of the added games until they have all finished.  If a game throws, the other games keep running and the first exception is rethrown once they are done.
+@exceptions: This function can throw exceptions
+*/
+void run();
+
+private:
+friend class coroutineGameEnvironment::stepAwaitable;
+std::vector<gameCoroutine> games;
+std::vector<coroutineGameEnvironment *> waitingEnvironments; //Environments whose games are waiting for their AI
+sessionPoller poller; //Holds the waiting games' sessions while the host blocks on them
+std::vector<uint32_t> readySessions;
+
+/*
+This function blocks until one of the waiting games has something to do if none of them has made progress for a while, so that a host whose AIs are thinking doesn't keep a core busy.
+@param inputNumberOfIdlePolls: How many times in a row the waiting games have been checked without any of them making progress
+@exceptions: This function can throw exceptions
+*/
+void waitBeforeNextPoll(uint32_t inputNumberOfIdlePolls);
+};
+
+
+
+
+
+#endif
@@ -0,0 +1,60 @@
+#include <cstdio>
+#include "eightBitAdderGameLogic.hpp"
+
+/*
+This function plays rounds of the 8 bit adder game with the AI on the other side of the given interface until it runs out of rounds or the AI asks to end the session.  Each round, the AI is shown two integers and gets a reward of 100 if its action is their sum.
+@param inputGameCom: An interface created with EIGHT_BIT_ADDER_PERCEPT_SIZE_IN_BITS and EIGHT_BIT_ADDER_ACTION_SIZE_IN_BITS
+@return: 0 if the game finished normally, -1 otherwise
+*/
+int playEightBitAdderGame(gameEngineCommunicationInterface &inputGameCom)
+{
+std::string action;
+unsigned char additionIntegers[2];
+for(int i=1; i<256; i++)
+{
+additionIntegers[0] = i % 256;
+additionIntegers[1] = (i+5) % 256;
+
+std::string firstPercept;
+firstPercept.push_back(additionIntegers[0]);
+firstPercept.push_back(additionIntegers[1]);
+
+//Initial percept is two numbers to add, with 0 reward
+action = inputGameCom.sendPerceptionsAndGetActions( firstPercept, 0);
+
+if(action.size() < 2)
+{
+fprintf(stderr, "Error, the action was of size %ld (should be 2)\n", action.size());
+return -1;
+}
+
+//See if the action that the AI generated corresponses to the addition of the two integers
+uint16_t expectedResult = ((uint16_t) additionIntegers[0]) + ((uint16_t) additionIntegers[1]);
+uint16_t actionAsInteger = *((uint16_t *) action.c_str());
+
+
+try
+{
+if(actionAsInteger == expectedResult)
+{
+action = inputGameCom.sendPerceptionsAndGetActions( firstPercept, 100, true);
+}
+else
+{
+action = inputGameCom.sendPerceptionsAndGetActions( firstPercept, 0, true);
+}
+}
+catch(const std::exception &inputException)
+{
+fprintf(stderr, "Error: %s\n", inputException.what());
+}
+
+if(inputGameCom.AIWantsToEndSession())
+{
+break;
+}
+
+} 
+
+return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef EIGHTBITADDERGAMELOGICHPP
+#define EIGHTBITADDERGAMELOGICHPP
+
+#include "gameEngineCommunicationInterface.hpp"
+
+//The game sends two 8 bit integers and expects their 16 bit sum back
+#define EIGHT_BIT_ADDER_PERCEPT_SIZE_IN_BITS 16
+#define EIGHT_BIT_ADDER_ACTION_SIZE_IN_BITS 16
+
+/*
+This function plays rounds of the 8 bit adder game with the AI on the other side of the given interface until it runs out of rounds or the AI asks to end the session.  Each round, the AI is shown two integers and gets a reward of 100 if its action is their sum.
+@param inputGameCom: An interface created with EIGHT_BIT_ADDER_PERCEPT_SIZE_IN_BITS and EIGHT_BIT_ADDER_ACTION_SIZE_IN_BITS
+@return: 0 if the game finished normally, -1 otherwise
+*/
+int playEightBitAdderGame(gameEngineCommunicationInterface &inputGameCom);
+
+
+
+#endif
@@ -0,0 +1,103 @@
+#include <cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<string>
+#include<exception>
+
+#include "gameEngineCommunicationInterface.hpp"
+#include "trajectoryReader.hpp"
+#include "replayGameLogic.hpp"
+
+/*
+This function prints how to use the program.
+*/
+static void printUsage()
+{
+fprintf(stderr, "Usage: replayGame trajectoryFile [--check] [--passes N] [--transport pubsub|lockstep|shm]\n");
+fprintf(stderr, "Plays the game side of a recorded session (a trajectory file written with AIARENA_TRAJECTORY_FILE or startRecording) to an AI as fast as it answers.  --check compares the AI's actions with the recorded ones and fails if any differ.  --passes sends the recording N times (default 1).  The AI must use the same transport (default pubsub).\n");
+}
+
+/*
+This program stands in for a game engine by sending an AI the percepts and rewards from a trajectory file, so an AI can be trained or benchmarked on recorded sessions without running the game, or checked against a recording to see if its behavior has changed.
+*/
+int main(int argc, char **argv)
+{
+std::string trajectoryFilePath;
+bool checkActions = false;
+uint64_t numberOfPasses = 1;
+transportType transport = PUB_SUB_TRANSPORT;
+for(int argumentIndex = 1; argumentIndex < argc; argumentIndex++)
+{
+if(strcmp(argv[argumentIndex], "--check") == 0)
+{
+checkActions = true;
+}
+else if(strcmp(argv[argumentIndex], "--passes") == 0 && argumentIndex + 1 < argc && atoll(argv[argumentIndex + 1]) > 0)
+{
+numberOfPasses = atoll(argv[++argumentIndex]);
+}
+else if(strcmp(argv[argumentIndex], "--transport") == 0 && argumentIndex + 1 < argc && strcmp(argv[argumentIndex + 1], "pubsub") == 0)
+{
+transport = PUB_SUB_TRANSPORT;
+argumentIndex++;
+}
+else if(strcmp(argv[argumentIndex], "--transport") == 0 && argumentIndex + 1 < argc && strcmp(argv[argumentIndex + 1], "lockstep") == 0)
+{
+transport = LOCKSTEP_TRANSPORT;
+argumentIndex++;
+}
+else if(strcmp(argv[argumentIndex], "--transport") == 0 && argumentIndex + 1 < argc && strcmp(argv[argumentIndex + 1], "shm") == 0)
+{
+transport = SHARED_MEMORY_TRANSPORT;
+argumentIndex++;
+}
+else if(argv[argumentIndex][0] != '-' && trajectoryFilePath.empty())
+{
+trajectoryFilePath = argv[argumentIndex];
+}
+else
+{
+printUsage();
+return 1;
+}
+}
+
+if(trajectoryFilePath.empty())
+{
+printUsage();
+return 1;
+}
+
+replayGameResult result;
+try
+{
+trajectoryReader trajectory(trajectoryFilePath);
+if(!trajectory.isComplete())
+{
+fprintf(stderr, "Warning, %s wasn't finished cleanly, so only its complete steps will be replayed\n", trajectoryFilePath.c_str());
+}
+
+gameEngineCommunicationInterface gameCom(trajectory.getSizeOfPerceptInBits(), trajectory.getSizeOfActionInBits(), -1, transport);
+gameCom.setSessionDescription("replay of " + trajectoryFilePath, "The rewards recorded in the trajectory file");
+
+playReplayGame(gameCom, trajectory, checkActions, numberOfPasses, result);
+}
+catch(const std::exception &inputException)
+{
+fprintf(stderr, "Error: %s\n", inputException.what());
+return -1;
+}
+
+fprintf(stderr, "Replayed %llu steps in %.3f seconds (%.0f steps per second)%s\n", (unsigned long long) result.numberOfSteps, result.seconds, result.seconds > 0.0 ? result.numberOfSteps/result.seconds : 0.0, result.AIEndedSession ? ", the AI ended the session early" : "");
+if(checkActions)
+{
+fprintf(stderr, "%llu of %llu checked actions matched the recording\n", (unsigned long long) (result.numberOfCheckedActions - result.numberOfMismatchedActions), (unsigned long long) result.numberOfCheckedActions);
+if(result.numberOfMismatchedActions > 0)
+{
+fprintf(stderr, "The first action that didn't match was for the percept with sequence number %llu\n", (unsigned long long) result.firstMismatchSequenceNumber);
+return -1;
+}
+}
+
+return 0;
+}
@@ -0,0 +1,71 @@
+#include "replayGameLogic.hpp"
+
+#include<cstring>
+#include<chrono>
+
+/*
+This function plays the role of the game for the AI on the other side of the given interface by sending it the percepts and rewards recorded in a trajectory file, in order and as fast as the AI answers, rather than running a game engine.  Each recorded GAME_OVER percept ends a game, so the AI sees the same episodes that were recorded.  If the actions are checked, each action is compared byte for byte with the one recorded for the step (steps recorded without an answer, or where the AI missed the action deadline, are skipped), which shows whether a deterministic AI still behaves the same.  The replay stops early if the AI asks to end the session.
+@param inputGameCom: An interface created with the percept and action sizes from the trajectory file
+@param inputTrajectory: The recorded steps to send
+@param inputCheckActions: True if the AI's actions should be compared with the recorded ones
+@param inputNumberOfPasses: How many times to send the whole trajectory
+@param outputResult: What happened
+@exceptions: This function can throw exceptions (if the connection to the AI fails or the file's step records are invalid)
+*/
+void playReplayGame(gameEngineCommunicationInterface &inputGameCom, const trajectoryReader &inputTrajectory, bool inputCheckActions, uint64_t inputNumberOfPasses, replayGameResult &outputResult)
+{
+outputResult.numberOfSteps = 0;
+outputResult.numberOfCheckedActions = 0;
+outputResult.numberOfMismatchedActions = 0;
+outputResult.firstMismatchSequenceNumber = 0;
+outputResult.seconds = 0.0;
+outputResult.AIEndedSession = false;
+
+if(inputTrajectory.getNumberOfEpisodes() == 0)
+{
+return;
+}
+
+//The steps are walked straight out of the memory map, so nothing is copied before it is sent
+uint64_t firstStepOffset = inputTrajectory.getEpisode(0).offset;
+uint64_t endOfSteps = inputTrajectory.getEndOfSteps();
+trajectoryStep step;
+
+std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+for(uint64_t pass = 0; pass < inputNumberOfPasses && !outputResult.AIEndedSession; pass++)
+{
+for(uint64_t offset = firstStepOffset; offset < endOfSteps; )
+{
+SOM_TRY
+offset = inputTrajectory.readStep(offset, step);
+SOM_CATCH("Error reading recorded step\n")
+
+const std::string *action = NULL;
+SOM_TRY
+action = &inputGameCom.sendPerceptionBytesAndGetActions(step.percept, step.perceptSize, step.reward, step.state == GAME_OVER);
+SOM_CATCH("Error sending recorded percept\n")
+outputResult.numberOfSteps++;
+
+//Actions that the game filled in because the AI missed the deadline (when recording or now) aren't the AI's, so they aren't checked
+if(inputCheckActions && (step.actionFlags & (TRAJECTORY_ACTION_UNANSWERED | TRAJECTORY_ACTION_MISSED_DEADLINE)) == 0 && !inputGameCom.actionMissedDeadline())
+{
+outputResult.numberOfCheckedActions++;
+if(action->size() != step.actionSize || memcmp(action->data(), step.action, step.actionSize) != 0)
+{
+if(outputResult.numberOfMismatchedActions == 0)
+{
+outputResult.firstMismatchSequenceNumber = step.sequenceNumber;
+}
+outputResult.numberOfMismatchedActions++;
+}
+}
+
+if(inputGameCom.AIWantsToEndSession())
+{
+outputResult.AIEndedSession = true;
+break;
+}
+}
+}
+outputResult.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
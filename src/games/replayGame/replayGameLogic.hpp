@@ -0,0 +1,35 @@
+#ifndef REPLAYGAMELOGICHPP
+#define REPLAYGAMELOGICHPP
+
+#include<cstdint>
+
+#include "gameEngineCommunicationInterface.hpp"
+#include "trajectoryReader.hpp"
+
+/*
+What happened when a trajectory was replayed to an AI.
+*/
+struct replayGameResult
+{
+uint64_t numberOfSteps; //Percepts sent to the AI
+uint64_t numberOfCheckedActions; //Steps whose action was compared with the recorded one
+uint64_t numberOfMismatchedActions;
+uint64_t firstMismatchSequenceNumber; //Recorded sequence number of the first step whose action didn't match (only set if there was one)
+double seconds; //Time spent running the steps
+bool AIEndedSession; //True if the AI asked to end the session before the replay finished
+};
+
+/*
+This function plays the role of the game for the AI on the other side of the given interface by sending it the percepts and rewards recorded in a trajectory file, in order and as fast as the AI answers, rather than running a game engine.  Each recorded GAME_OVER percept ends a game, so the AI sees the same episodes that were recorded.  If the actions are checked, each action is compared byte for byte with the one recorded for the step (steps recorded without an answer, or where the AI missed the action deadline, are skipped), which shows whether a deterministic AI still behaves the same.  The replay stops early if the AI asks to end the session.
+@param inputGameCom: An interface created with the percept and action sizes from the trajectory file
+@param inputTrajectory: The recorded steps to send
+@param inputCheckActions: True if the AI's actions should be compared with the recorded ones
+@param inputNumberOfPasses: How many times to send the whole trajectory
+@param outputResult: What happened
+@exceptions: This function can throw exceptions (if the connection to the AI fails or the file's step records are invalid)
+*/
+void playReplayGame(gameEngineCommunicationInterface &inputGameCom, const trajectoryReader &inputTrajectory, bool inputCheckActions, uint64_t inputNumberOfPasses, replayGameResult &outputResult);
+
+
+
+#endif
@@ -0,0 +1,147 @@
+#include <cstdio>
+#include<cstdlib>
+#include<string>
+#include<vector>
+#include<memory>
+#include<future>
+#include<chrono>
+#include<exception>
+
+#include "coroutineGameHost.hpp"
+#include "BatchedAICommunicationInterface.hpp"
+#include "eightBitAdderGameLogic.hpp"
+
+//Endpoint prefix the games bind to (game i uses the prefix followed by i)
+#define COROUTINE_ADDER_ENDPOINT_PREFIX "inproc://8BitAdderGame"
+
+//How many games and how many rounds (percepts) are played if they aren't given on the command line
+#define COROUTINE_ADDER_DEFAULT_NUMBER_OF_GAMES 100
+#define COROUTINE_ADDER_DEFAULT_NUMBER_OF_ROUNDS 200
+
+//Each game asks for 255 sums with two percepts each, so the AI can't play more rounds than this before the games run out
+#define COROUTINE_ADDER_MAXIMUM_NUMBER_OF_ROUNDS 510
+
+/*
+This function plays the 8 bit adder game (the same rules as playEightBitAdderGame) as a coroutine, so that many copies can share one thread.  It stops as soon as the AI asks for the session to end, which can be in answer to either percept of a round.
+@param inputEnvironment: The environment connecting the game to its AI
+@return: The game coroutine
+*/
+static gameCoroutine playEightBitAdderGameCoroutine(coroutineGameEnvironment &inputEnvironment)
+{
+std::string percept(2, '\0');
+for(int i=1; i<256; i++)
+{
+percept[0] = (char) (i % 256);
+percept[1] = (char) ((i+5) % 256);
+
+//Initial percept is two numbers to add, with 0 reward
+const std::string &action = co_await inputEnvironment.step(percept, 0);
+
+if(inputEnvironment.getInterface().AIWantsToEndSession())
+{
+break;
+}
+
+if(action.size() < 2)
+{
+throw SOMException("Error, the action was the wrong size\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
+}
+
+//See if the action that the AI generated corresponds to the addition of the two integers
+uint16_t expectedResult = ((uint16_t) (unsigned char) percept[0]) + ((uint16_t) (unsigned char) percept[1]);
+uint16_t actionAsInteger = ((uint16_t) (unsigned char) action[0]) | (((uint16_t) (unsigned char) action[1]) << 8);
+
+co_await inputEnvironment.step(percept, actionAsInteger == expectedResult ? 100 : 0, true);
+
+if(inputEnvironment.getInterface().AIWantsToEndSession())
+{
+break;
+}
+}
+}
+
+/*
+This function plays the adder AI against all of the games at once through a batched interface (adding the two bytes of each percept), then tells the games to shut down.
+@param inputContext: The context the games' endpoints are in
+@param inputEndpoints: The games' endpoints
+@param inputNumberOfRounds: How many percepts to answer before shutting the games down
+*/
+static void runBatchedAdderAI(zmq::context_t &inputContext, const std::vector<std::string> &inputEndpoints, uint32_t inputNumberOfRounds)
+{
+BatchedAICommunicationInterface AIs(inputContext, inputEndpoints);
+
+std::string actions(AIs.getNumberOfGames()*2, '\0');
+for(uint32_t round = 0; round < inputNumberOfRounds; round++)
+{
+const std::string &percepts = AIs.getCurrentPerceptions();
+for(uint32_t gameIndex = 0; gameIndex < AIs.getNumberOfGames(); gameIndex++)
+{
+uint16_t sum = ((uint16_t) (unsigned char) percepts[gameIndex*2]) + ((uint16_t) (unsigned char) percepts[gameIndex*2 + 1]);
+actions[gameIndex*2] = (char) (sum & 0xFF);
+actions[gameIndex*2 + 1] = (char) (sum >> 8);
+}
+
+AIs.sendActionsAndUpdatePerceptions(actions, std::vector<bool>(), round + 1 == inputNumberOfRounds);
+}
+}
+
+/*
+This program runs many copies of the 8 bit adder game as coroutines on a single thread, against a batched adder AI on a second thread, to show how cheap games can be hosted without a thread per game.
+Usage: coroutineAdderHost [numberOfGames] [numberOfRounds] (numberOfRounds can be at most COROUTINE_ADDER_MAXIMUM_NUMBER_OF_ROUNDS)
+*/
+int main(int argc, char **argv)
+{
+uint32_t numberOfGames = argc > 1 ? strtoul(argv[1], NULL, 10) : COROUTINE_ADDER_DEFAULT_NUMBER_OF_GAMES;
+uint32_t numberOfRounds = argc > 2 ? strtoul(argv[2], NULL, 10) : COROUTINE_ADDER_DEFAULT_NUMBER_OF_ROUNDS;
+if(numberOfGames == 0 || numberOfRounds == 0 || numberOfRounds > COROUTINE_ADDER_MAXIMUM_NUMBER_OF_ROUNDS)
+{
+fprintf(stderr, "Usage: coroutineAdderHost [numberOfGames] [numberOfRounds] (numberOfRounds can be at most %d)\n", COROUTINE_ADDER_MAXIMUM_NUMBER_OF_ROUNDS);
+return 1;
+}
+
+try
+{
+zmq::context_t context;
+coroutineGameHost host;
+std::vector<std::string> endpoints;
+std::vector<std::unique_ptr<gameEngineCommunicationInterface>> interfaces;
+std::vector<std::unique_ptr<coroutineGameEnvironment>> environments;
+for(uint32_t gameIndex = 0; gameIndex < numberOfGames; gameIndex++)
+{
+endpoints.push_back(COROUTINE_ADDER_ENDPOINT_PREFIX + std::to_string(gameIndex));
+interfaces.emplace_back(new gameEngineCommunicationInterface(context, endpoints.back(), EIGHT_BIT_ADDER_PERCEPT_SIZE_IN_BITS, EIGHT_BIT_ADDER_ACTION_SIZE_IN_BITS));
+environments.emplace_back(new coroutineGameEnvironment(host, *interfaces.back()));
+host.addGame(playEightBitAdderGameCoroutine(*environments.back()));
+}
+
+std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+//The AI runs on its own thread (the future rethrows any exception it throws)
+std::future<void> AIResult = std::async(std::launch::async, [&]()
+{
+runBatchedAdderAI(context, endpoints, numberOfRounds);
+});
+
+host.run();
+AIResult.get();
+
+double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+uint64_t totalReward = 0;
+uint64_t totalRounds = 0;
+for(const std::unique_ptr<gameEngineCommunicationInterface> &interface : interfaces)
+{
+totalReward += interface->getTotalReward();
+totalRounds += interface->getNumberOfRoundsPlayed();
+}
+
+printf("%u games, %llu rounds in %.3f seconds (%.1f microseconds per round), total reward %llu\n", numberOfGames, (unsigned long long) totalRounds, seconds, seconds*1e6/std::max<uint64_t>(totalRounds, 1), (unsigned long long) totalReward);
+}
+catch(const std::exception &inputException)
+{
+fprintf(stderr, "Error: %s\n", inputException.what());
+return -1;
+}
+
+return 0;
+}
@@ -0,0 +1,56 @@
+#include <cstdio>
+#include<future>
+#include<exception>
+
+#include "gameEngineCommunicationInterface.hpp"
+#include "AICommunicationInterface.hpp"
+#include "eightBitAdderGameLogic.hpp"
+#include "adderAILogic.hpp"
+
+//Endpoint the game and AI threads share through the common ZMQ context
+#define IN_PROCESS_ADDER_ENDPOINT "inproc://8BitAdderGame"
+
+/*
+This program runs the 8 bit adder game and the adder AI as two threads in one process.  They share a single ZMQ context and talk over the inproc:// transport, which avoids the loopback TCP stack and the cost of a second process.
+*/
+int main(int argc, char **argv)
+{
+zmq::context_t context;
+
+//Run the game in its own thread (the future rethrows any exception it throws)
+std::future<int> gameResult = std::async(std::launch::async, [&context]()
+{
+gameEngineCommunicationInterface gameCom(context, IN_PROCESS_ADDER_ENDPOINT, EIGHT_BIT_ADDER_PERCEPT_SIZE_IN_BITS, EIGHT_BIT_ADDER_ACTION_SIZE_IN_BITS);
+return playEightBitAdderGame(gameCom);
+});
+
+int AIResult = 0;
+try
+{
+AICommunicationInterface AICom(context, IN_PROCESS_ADDER_ENDPOINT);
+AIResult = runAdderAI(AICom);
+}
+catch(const std::exception &inputException)
+{
+fprintf(stderr, "AI error: %s\n", inputException.what());
+AIResult = -1;
+}
+
+int gameReturnValue = 0;
+try
+{
+gameReturnValue = gameResult.get();
+}
+catch(const std::exception &inputException)
+{
+fprintf(stderr, "Game error: %s\n", inputException.what());
+gameReturnValue = -1;
+}
+
+if(AIResult != 0 || gameReturnValue != 0)
+{
+return -1;
+}
+
+return 0;
+}
@@ -0,0 +1,239 @@
+#include <cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<string>
+#include<vector>
+#include<map>
+#include<thread>
+#include<chrono>
+#include<exception>
+#include<unistd.h>
+#include<cerrno>
+#include<algorithm>
+
+#include "workStealingPool.hpp"
+#include "tournamentMatch.hpp"
+
+//How long a single match can run before it is killed (in seconds) if --timeout isn't given
+#define TOURNAMENT_DEFAULT_MATCH_TIMEOUT 300
+
+/*
+This function prints how to use the program.
+*/
+static void printUsage()
+{
+fprintf(stderr, "Usage: tournamentRunner --games game1 [game2 ...] --AIs AI1 [AI2 ...] [--repeats N] [--workers N] [--timeout seconds] [--csv file] [--verbose]\n");
+fprintf(stderr, "Plays every AI against every game N times (default 1), running matches on N worker threads (default: one per core), each on its own session so that they don't share endpoints.\n");
+}
+
+/*
+This function turns a command line argument into a positive number.
+@param inputArgument: The argument
+@param outputValue: The number
+@return: True if the argument was a valid number
+*/
+static bool parseCount(const char *inputArgument, uint32_t &outputValue)
+{
+char *end = NULL;
+unsigned long value = strtoul(inputArgument, &end, 10);
+if(end == inputArgument || *end != '\0' || value > UINT32_MAX)
+{
+return false;
+}
+
+outputValue = value;
+return true;
+}
+
+/*
+This program runs a tournament: every given AI plays every given game (as separate processes, like running them by hand) the requested number of times.  The matches are spread over a work stealing pool of worker threads, so all of the cores stay busy even though matches take different amounts of time, and the rewards the games report are collected into a results table.
+*/
+int main(int argc, char **argv)
+{
+std::vector<std::string> games;
+std::vector<std::string> AIs;
+uint32_t numberOfRepeats = 1;
+uint32_t numberOfWorkers = std::max(std::thread::hardware_concurrency(), 1U);
+uint32_t matchTimeout = TOURNAMENT_DEFAULT_MATCH_TIMEOUT;
+std::string CSVFilePath;
+bool showOutput = false;
+
+std::vector<std::string> *currentList = NULL;
+for(int i=1; i<argc; i++)
+{
+std::string argument = argv[i];
+bool needsValue = argument == "--repeats" || argument == "--workers" || argument == "--timeout" || argument == "--csv";
+if(needsValue && i+1 >= argc)
+{
+printUsage();
+return 1;
+}
+
+if(argument == "--games")
+{
+currentList = &games;
+}
+else if(argument == "--AIs")
+{
+currentList = &AIs;
+}
+else if(argument == "--verbose")
+{
+showOutput = true;
+currentList = NULL;
+}
+else if(argument == "--csv")
+{
+CSVFilePath = argv[++i];
+currentList = NULL;
+}
+else if(needsValue)
+{
+uint32_t &value = argument == "--repeats" ? numberOfRepeats : argument == "--workers" ? numberOfWorkers : matchTimeout;
+if(!parseCount(argv[++i], value))
+{
+printUsage();
+return 1;
+}
+currentList = NULL;
+}
+else if(currentList != NULL && argument.compare(0, 2, "--") != 0)
+{
+currentList->push_back(argument);
+}
+else
+{
+printUsage();
+return 1;
+}
+}
+
+if(games.size() == 0 || AIs.size() == 0 || numberOfRepeats == 0 || numberOfWorkers == 0)
+{
+printUsage();
+return 1;
+}
+
+//The games write their results to files in a private directory
+char resultsDirectoryTemplate[] = "/tmp/AIArenaTournamentXXXXXX";
+if(mkdtemp(resultsDirectoryTemplate) == NULL)
+{
+fprintf(stderr, "Error creating results directory: %s\n", strerror(errno));
+return 1;
+}
+std::string resultsDirectory = resultsDirectoryTemplate;
+
+//One task per match, each writing only its own result slot
+struct matchDescription
+{
+uint64_t gameIndex;
+uint64_t AIIndex;
+uint32_t repeatIndex;
+};
+std::vector<matchDescription> matches;
+for(uint32_t repeatIndex = 0; repeatIndex < numberOfRepeats; repeatIndex++)
+{
+for(uint64_t gameIndex = 0; gameIndex < games.size(); gameIndex++)
+{
+for(uint64_t AIIndex = 0; AIIndex < AIs.size(); AIIndex++)
+{
+matches.push_back({gameIndex, AIIndex, repeatIndex});
+}
+}
+}
+
+std::vector<tournamentMatchResult> results(matches.size());
+workStealingPool pool(numberOfWorkers);
+for(uint64_t matchIndex = 0; matchIndex < matches.size(); matchIndex++)
+{
+pool.addTask([&, matchIndex](uint32_t inputWorkerIndex)
+{
+const matchDescription &match = matches[matchIndex];
+try
+{
+results[matchIndex] = runTournamentMatch(games[match.gameIndex], AIs[match.AIIndex], resultsDirectory, matchTimeout, showOutput);
+}
+catch(const std::exception &inputException)
+{
+results[matchIndex].succeeded = false;
+results[matchIndex].errorMessage = inputException.what();
+}
+});
+}
+
+std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+pool.run();
+double tournamentTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+rmdir(resultsDirectory.c_str());
+
+//Report failures as they happened, then summarize each game/AI pairing
+int numberOfFailures = 0;
+for(uint64_t matchIndex = 0; matchIndex < matches.size(); matchIndex++)
+{
+if(!results[matchIndex].succeeded)
+{
+numberOfFailures++;
+fprintf(stderr, "Match %s vs %s (repeat %u) failed: %s\n", games[matches[matchIndex].gameIndex].c_str(), AIs[matches[matchIndex].AIIndex].c_str(), matches[matchIndex].repeatIndex, results[matchIndex].errorMessage.c_str());
+}
+}
+
+printf("%-30s %-30s %6s %6s %14s %12s %10s %12s\n", "Game", "AI", "Runs", "Failed", "Mean reward", "Mean rounds", "Games", "Mean time(s)");
+for(uint64_t gameIndex = 0; gameIndex < games.size(); gameIndex++)
+{
+for(uint64_t AIIndex = 0; AIIndex < AIs.size(); AIIndex++)
+{
+uint32_t numberOfSuccesses = 0;
+uint32_t numberOfFailedRuns = 0;
+double rewardSum = 0.0;
+double roundsSum = 0.0;
+uint64_t gamesFinished = 0;
+double timeSum = 0.0;
+for(uint64_t matchIndex = 0; matchIndex < matches.size(); matchIndex++)
+{
+if(matches[matchIndex].gameIndex != gameIndex || matches[matchIndex].AIIndex != AIIndex)
+{
+continue;
+}
+
+const tournamentMatchResult &result = results[matchIndex];
+if(!result.succeeded)
+{
+numberOfFailedRuns++;
+continue;
+}
+
+numberOfSuccesses++;
+rewardSum += result.totalReward;
+roundsSum += result.numberOfRoundsPlayed;
+gamesFinished += result.numberOfGamesFinished;
+timeSum += result.wallTimeInSeconds;
+}
+
+double divisor = std::max(numberOfSuccesses, 1U);
+printf("%-30s %-30s %6u %6u %14.2f %12.2f %10llu %12.4f\n", games[gameIndex].c_str(), AIs[AIIndex].c_str(), numberOfSuccesses + numberOfFailedRuns, numberOfFailedRuns, rewardSum/divisor, roundsSum/divisor, (unsigned long long) gamesFinished, timeSum/divisor);
+}
+}
+printf("%lu matches on %u workers in %.3f seconds\n", matches.size(), numberOfWorkers, tournamentTime);
+
+//Every match as a row, for further analysis
+if(CSVFilePath.size() != 0)
+{
+FILE *CSVFile = fopen(CSVFilePath.c_str(), "w");
+if(CSVFile == NULL)
+{
+fprintf(stderr, "Error opening %s: %s\n", CSVFilePath.c_str(), strerror(errno));
+return 1;
+}
+
+fprintf(CSVFile, "game,AI,repeat,succeeded,total_reward,rounds_played,games_finished,wall_time_seconds\n");
+for(uint64_t matchIndex = 0; matchIndex < matches.size(); matchIndex++)
+{
+const tournamentMatchResult &result = results[matchIndex];
+fprintf(CSVFile, "%s,%s,%u,%d,%llu,%llu,%llu,%.6f\n", games[matches[matchIndex].gameIndex].c_str(), AIs[matches[matchIndex].AIIndex].c_str(), matches[matchIndex].repeatIndex, result.succeeded ? 1 : 0, (unsigned long long) result.totalReward, (unsigned long long) result.numberOfRoundsPlayed, (unsigned long long) result.numberOfGamesFinished, result.wallTimeInSeconds);
+}
+fclose(CSVFile);
+}
+
+return numberOfFailures == 0 ? 0 : 2;
+}
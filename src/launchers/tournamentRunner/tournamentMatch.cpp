@@ -0,0 +1,270 @@
+#include "tournamentMatch.hpp"
+#include "sessionRegistry.hpp"
+#include "gameEngineCommunicationInterface.hpp"
+
+#include<vector>
+#include<chrono>
+#include<algorithm>
+#include<thread>
+#include<cstdio>
+#include<cstring>
+#include<csignal>
+#include<unistd.h>
+#include<spawn.h>
+#include<fcntl.h>
+#include<sys/wait.h>
+
+extern char **environ;
+
+/*
+This function makes the environment for a child process: the runner's own environment without any AIArena endpoint settings, plus the given variables.
+@param inputExtraVariables: The "NAME=value" strings to add
+@return: The environment strings
+*/
+static std::vector<std::string> makeChildEnvironment(const std::vector<std::string> &inputExtraVariables)
+{
+const char *removedPrefixes[] = {GAME_ENDPOINT_ENVIRONMENT_VARIABLE "=", AI_ENDPOINT_ENVIRONMENT_VARIABLE "=", SESSION_ID_ENVIRONMENT_VARIABLE "=", RESULTS_FILE_ENVIRONMENT_VARIABLE "="};
+
+std::vector<std::string> environment;
+for(char **variable = environ; *variable != NULL; variable++)
+{
+bool removeVariable = false;
+for(const char *prefix : removedPrefixes)
+{
+if(strncmp(*variable, prefix, strlen(prefix)) == 0)
+{
+removeVariable = true;
+}
+}
+
+if(!removeVariable)
+{
+environment.push_back(*variable);
+}
+}
+
+environment.insert(environment.end(), inputExtraVariables.begin(), inputExtraVariables.end());
+return environment;
+}
+
+/*
+This function starts the given executable with the given environment.  posix_spawn is used rather than fork so that it is safe to call from several threads at once.
+@param inputExecutable: The executable to run (searched for in PATH if it has no '/')
+@param inputEnvironment: The environment strings for the process
+@param inputShowOutput: False if the process's standard output should go to /dev/null
+@return: The process ID
+@exceptions: This function can throw exceptions
+*/
+static pid_t startProcess(const std::string &inputExecutable, const std::vector<std::string> &inputEnvironment, bool inputShowOutput)
+{
+std::vector<char *> environmentPointers;
+for(const std::string &variable : inputEnvironment)
+{
+environmentPointers.push_back((char *) variable.c_str());
+}
+environmentPointers.push_back(NULL);
+
+char *arguments[] = {(char *) inputExecutable.c_str(), NULL};
+
+posix_spawn_file_actions_t fileActions;
+posix_spawn_file_actions_init(&fileActions);
+if(!inputShowOutput)
+{
+posix_spawn_file_actions_addopen(&fileActions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+}
+
+pid_t processID;
+int spawnError = posix_spawnp(&processID, inputExecutable.c_str(), &fileActions, NULL, arguments, environmentPointers.data());
+posix_spawn_file_actions_destroy(&fileActions);
+
+if(spawnError != 0)
+{
+throw SOMException("Error starting " + inputExecutable + ": " + strerror(spawnError) + "\n", FORK_ERROR, __FILE__, __LINE__);
+}
+
+return processID;
+}
+
+/*
+This function describes how a process ended, if it didn't exit normally with status 0.
+@param inputName: What to call the process in the description
+@param inputStatus: The status from waitpid
+@return: The description (empty if the process exited normally with status 0)
+*/
+static std::string describeFailure(const std::string &inputName, int inputStatus)
+{
+if(WIFEXITED(inputStatus))
+{
+if(WEXITSTATUS(inputStatus) == 0)
+{
+return "";
+}
+
+return inputName + " exited with status " + std::to_string(WEXITSTATUS(inputStatus));
+}
+
+if(WIFSIGNALED(inputStatus))
+{
+return inputName + " was killed by signal " + std::to_string(WTERMSIG(inputStatus));
+}
+
+return inputName + " ended abnormally";
+}
+
+/*
+This function plays one match by starting the game and the AI as child processes on a session claimed from the session registry (so matches running at the same time never share endpoints), waiting for both to exit and then reading the results the game wrote to AIARENA_RESULTS_FILE.
+@param inputGameExecutable: The game to run (searched for in PATH if it has no '/')
+@param inputAIExecutable: The AI to run (searched for in PATH if it has no '/')
+@param inputResultsDirectory: A directory to put the game's results file in
+@param inputTimeoutInSeconds: How long to let the match run before killing both processes (0 waits forever)
+@param inputShowOutput: True if the processes' standard output should be shown rather than discarded
+@return: The outcome of the match
+@exceptions: This function can throw exceptions (if no session is free or the processes can't be started)
+*/
+tournamentMatchResult runTournamentMatch(const std::string &inputGameExecutable, const std::string &inputAIExecutable, const std::string &inputResultsDirectory, uint32_t inputTimeoutInSeconds, bool inputShowOutput)
+{
+tournamentMatchResult result;
+result.succeeded = false;
+result.totalReward = 0;
+result.numberOfRoundsPlayed = 0;
+result.numberOfGamesFinished = 0;
+result.wallTimeInSeconds = 0.0;
+
+std::unique_ptr<sessionLease> lease;
+SOM_TRY
+lease.reset(new sessionLease);
+SOM_CATCH("Error claiming a session for the match\n")
+
+std::string sessionVariable = std::string(SESSION_ID_ENVIRONMENT_VARIABLE) + "=" + std::to_string(lease->getSessionID());
+std::string resultsFilePath = inputResultsDirectory + "/session" + std::to_string(lease->getSessionID()) + ".results";
+unlink(resultsFilePath.c_str()); //Don't pick up a previous match's results
+
+std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+pid_t gameProcessID;
+SOM_TRY
+gameProcessID = startProcess(inputGameExecutable, makeChildEnvironment({sessionVariable, std::string(RESULTS_FILE_ENVIRONMENT_VARIABLE) + "=" + resultsFilePath}), inputShowOutput);
+SOM_CATCH("Error starting game\n")
+
+pid_t AIProcessID;
+try
+{
+AIProcessID = startProcess(inputAIExecutable, makeChildEnvironment({sessionVariable}), inputShowOutput);
+}
+catch(const std::exception &inputException)
+{
+kill(gameProcessID, SIGKILL);
+waitpid(gameProcessID, NULL, 0);
+throw SOMException("Error starting AI\n", FORK_ERROR, inputException, __FILE__, __LINE__);
+}
+
+//Wait for both processes, polling so that the match can be cut off at the timeout
+std::chrono::steady_clock::time_point deadline = startTime + std::chrono::seconds(inputTimeoutInSeconds);
+bool gameRunning = true;
+bool AIRunning = true;
+int gameStatus = 0;
+int AIStatus = 0;
+bool timedOut = false;
+std::string firstFailure; //How the first process to fail ended (the other one is killed)
+std::chrono::microseconds pollInterval(50);
+while(gameRunning || AIRunning)
+{
+if(gameRunning && waitpid(gameProcessID, &gameStatus, WNOHANG) == gameProcessID)
+{
+gameRunning = false;
+}
+
+if(AIRunning && waitpid(AIProcessID, &AIStatus, WNOHANG) == AIProcessID)
+{
+AIRunning = false;
+}
+
+if(!gameRunning && !AIRunning)
+{
+break;
+}
+
+//The other side can't finish once one has failed, so don't wait for the timeout
+if(firstFailure.size() == 0)
+{
+if(!gameRunning)
+{
+firstFailure = describeFailure("game", gameStatus);
+}
+if(firstFailure.size() == 0 && !AIRunning)
+{
+firstFailure = describeFailure("AI", AIStatus);
+}
+if(firstFailure.size() != 0)
+{
+kill(gameRunning ? gameProcessID : AIProcessID, SIGKILL);
+}
+}
+
+if(inputTimeoutInSeconds > 0 && std::chrono::steady_clock::now() > deadline)
+{
+timedOut = true;
+if(gameRunning)
+{
+kill(gameProcessID, SIGKILL);
+waitpid(gameProcessID, &gameStatus, 0);
+}
+if(AIRunning)
+{
+kill(AIProcessID, SIGKILL);
+waitpid(AIProcessID, &AIStatus, 0);
+}
+break;
+}
+
+std::this_thread::sleep_for(pollInterval);
+pollInterval = std::min(pollInterval*2, std::chrono::microseconds(5000));
+}
+
+result.wallTimeInSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+if(timedOut)
+{
+result.errorMessage = "match timed out after " + std::to_string(inputTimeoutInSeconds) + " seconds";
+return result;
+}
+
+std::string failure = firstFailure;
+if(failure.size() == 0)
+{
+failure = describeFailure("game", gameStatus);
+}
+if(failure.size() == 0)
+{
+failure = describeFailure("AI", AIStatus);
+}
+if(failure.size() != 0)
+{
+result.errorMessage = failure;
+return result;
+}
+
+FILE *resultsFile = fopen(resultsFilePath.c_str(), "r");
+if(resultsFile == NULL)
+{
+result.errorMessage = "game didn't write its results";
+return result;
+}
+
+unsigned long long totalReward, numberOfRoundsPlayed, numberOfGamesFinished;
+int numberOfFieldsRead = fscanf(resultsFile, "%llu %llu %llu", &totalReward, &numberOfRoundsPlayed, &numberOfGamesFinished);
+fclose(resultsFile);
+unlink(resultsFilePath.c_str());
+
+if(numberOfFieldsRead != 3)
+{
+result.errorMessage = "game's results file couldn't be read";
+return result;
+}
+
+result.totalReward = totalReward;
+result.numberOfRoundsPlayed = numberOfRoundsPlayed;
+result.numberOfGamesFinished = numberOfGamesFinished;
+result.succeeded = true;
+return result;
+}
@@ -0,0 +1,38 @@
+#ifndef TOURNAMENTMATCHHPP
+#define TOURNAMENTMATCHHPP
+
+#include<string>
+#include<cstdint>
+
+#include "SOMException.hpp"
+
+/*
+The outcome of running one game executable against one AI executable.
+*/
+struct tournamentMatchResult
+{
+bool succeeded; //True if both processes exited normally and the game reported its results
+uint64_t totalReward;
+uint64_t numberOfRoundsPlayed;
+uint64_t numberOfGamesFinished;
+double wallTimeInSeconds;
+std::string errorMessage; //Why the match failed (empty if it succeeded)
+};
+
+/*
+This function plays one match by starting the game and the AI as child processes on a session claimed from the session registry (so matches running at the same time never share endpoints), waiting for both to exit and then reading the results the game wrote to AIARENA_RESULTS_FILE.
+@param inputGameExecutable: The game to run (searched for in PATH if it has no '/')
+@param inputAIExecutable: The AI to run (searched for in PATH if it has no '/')
+@param inputResultsDirectory: A directory to put the game's results file in
+@param inputTimeoutInSeconds: How long to let the match run before killing both processes (0 waits forever)
+@param inputShowOutput: True if the processes' standard output should be shown rather than discarded
+@return: The outcome of the match
+@exceptions: This function can throw exceptions (if no session is free or the processes can't be started)
+*/
+tournamentMatchResult runTournamentMatch(const std::string &inputGameExecutable, const std::string &inputAIExecutable, const std::string &inputResultsDirectory, uint32_t inputTimeoutInSeconds, bool inputShowOutput);
+
+
+
+
+
+#endif
@@ -0,0 +1,116 @@
+#include "workStealingPool.hpp"
+
+#include<thread>
+#include<exception>
+
+/*
+This function creates the (empty) pool.
+@param inputNumberOfWorkers: How many threads to run the tasks on (at least 1)
+*/
+workStealingPool::workStealingPool(uint32_t inputNumberOfWorkers)
+{
+if(inputNumberOfWorkers == 0)
+{
+inputNumberOfWorkers = 1;
+}
+
+for(uint32_t i=0; i<inputNumberOfWorkers; i++)
+{
+workerQueues.emplace_back(new workerQueue);
+}
+
+nextQueueIndex = 0;
+}
+
+/*
+This function adds a task to be run by the next call to run.
+@param inputTask: The task, which is given the index of the worker running it
+*/
+void workStealingPool::addTask(const std::function<void(uint32_t)> &inputTask)
+{
+workerQueue &queue = *workerQueues[nextQueueIndex];
+nextQueueIndex = (nextQueueIndex + 1) % workerQueues.size();
+
+std::lock_guard<std::mutex> lock(queue.mutex);
+queue.tasks.push_back(inputTask);
+}
+
+/*
+This function runs all of the added tasks and waits for them to finish.  If any task throws, the remaining tasks still run and the first exception is rethrown once they are done.
+@exceptions: This function can throw exceptions
+*/
+void workStealingPool::run()
+{
+std::mutex exceptionMutex;
+std::exception_ptr firstException;
+
+std::vector<std::thread> workers;
+for(uint32_t workerIndex = 0; workerIndex < workerQueues.size(); workerIndex++)
+{
+workers.emplace_back([&, workerIndex]()
+{
+std::function<void(uint32_t)> task;
+while(takeTask(workerIndex, task))
+{
+try
+{
+task(workerIndex);
+}
+catch(...)
+{
+std::lock_guard<std::mutex> lock(exceptionMutex);
+if(!firstException)
+{
+firstException = std::current_exception();
+}
+}
+}
+});
+}
+
+for(std::thread &worker : workers)
+{
+worker.join();
+}
+
+if(firstException)
+{
+std::rethrow_exception(firstException);
+}
+}
+
+/*
+This function gets the next task for the given worker, stealing one from another worker if its own queue is empty.
+@param inputWorkerIndex: The worker looking for a task
+@param outputTask: The task to run
+@return: True if a task was found, false if every queue is empty
+*/
+bool workStealingPool::takeTask(uint32_t inputWorkerIndex, std::function<void(uint32_t)> &outputTask)
+{
+//Newest task from our own queue first
+{
+workerQueue &ownQueue = *workerQueues[inputWorkerIndex];
+std::lock_guard<std::mutex> lock(ownQueue.mutex);
+if(ownQueue.tasks.size() > 0)
+{
+outputTask = std::move(ownQueue.tasks.back());
+ownQueue.tasks.pop_back();
+return true;
+}
+}
+
+//Then the oldest task from the other queues, starting with our neighbor (tasks are never added while the pool is running, so empty queues stay empty)
+for(uint32_t offset = 1; offset < workerQueues.size(); offset++)
+{
+workerQueue &victimQueue = *workerQueues[(inputWorkerIndex + offset) % workerQueues.size()];
+std::lock_guard<std::mutex> lock(victimQueue.mutex);
+if(victimQueue.tasks.size() > 0)
+{
+outputTask = std::move(victimQueue.tasks.front());
+victimQueue.tasks.pop_front();
+return true;
+}
+}
+
+return false;
+}
@@ -0,0 +1,61 @@
+#ifndef WORKSTEALINGPOOLHPP
+#define WORKSTEALINGPOOLHPP
+
+#include<functional>
+#include<deque>
+#include<vector>
+#include<memory>
+#include<mutex>
+#include<cstdint>
+
+/*
+This class runs a set of tasks on a fixed number of worker threads.  Tasks are dealt out round robin to a queue per worker and each worker takes tasks from the back of its own queue, so workers rarely touch the same lock.  A worker whose queue runs dry steals from the front of the other workers' queues, which keeps every worker busy until the last task has started even if the tasks take very different amounts of time.
+*/
+class workStealingPool
+{
+public:
+/*
+This function creates the (empty) pool.
+@param inputNumberOfWorkers: How many threads to run the tasks on (at least 1)
+*/
+workStealingPool(uint32_t inputNumberOfWorkers);
+
+/*
+This function adds a task to be run by the next call to run.
+@param inputTask: The task, which is given the index of the worker running it
+*/
+void addTask(const std::function<void(uint32_t)> &inputTask);
+
+/*
+This function runs all of the added tasks and waits for them to finish.  If any task throws, the remaining tasks still run and the first exception is rethrown once they are done.
+@exceptions: This function can throw exceptions
+*/
+void run();
+
+private:
+/*
+The tasks waiting to be run by one worker.
+*/
+struct workerQueue
+{
+std::mutex mutex;
+std::deque<std::function<void(uint32_t)>> tasks;
+};
+
+std::vector<std::unique_ptr<workerQueue>> workerQueues;
+uint32_t nextQueueIndex; //Queue that the next added task goes to
+
+/*
+This function gets the next task for the given worker, stealing one from another worker if its own queue is empty.
+@param inputWorkerIndex: The worker looking for a task
+@param outputTask: The task to run
+@return: True if a task was found, false if every queue is empty
+*/
+bool takeTask(uint32_t inputWorkerIndex, std::function<void(uint32_t)> &outputTask);
+};
+
+
+
+
+
+#endif
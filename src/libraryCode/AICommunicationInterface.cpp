@@ -1,45 +1,42 @@
 #include "AICommunicationInterface.hpp"
 
+#include<cstring>
+#include<climits>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
 /*
-This function establishes the connections used to run the AI/game interaction.
+This function establishes the connections used to run the AI/game interaction.  If AIARENA_AGENT_INDEX is set, the AI plays that agent of a multi-agent game.
+@param inputTransportType: How to connect to the game (the game must use the same transport)
+@param inputConnectionTimeoutInterval: The number of milliseconds to wait for the game to connect and send the first percept before throwing an exception (it defaults to infinite wait)
 @exceptions: This function can throw exceptions (especially if starting the connection to the game times out)
 */
-AICommunicationInterface::AICommunicationInterface()
+AICommunicationInterface::AICommunicationInterface(transportType inputTransportType, int inputConnectionTimeoutInterval)
 {
-//Remember size of AI perceptions in bits and size of expected actions in bits
-perceptSequenceCounter = 0;
-
 SOM_TRY
 context.reset(new zmq::context_t);
 SOM_CATCH("Error initializing ZMQ context\n")
 
-//Initialize sockets associated with this object
-SOM_TRY
-actionPublishingSocket.reset(new zmq::socket_t(*context, ZMQ_PUB));
-SOM_CATCH("Error initializing actions publishing socket\n")
-
-//Now bind the socket
-SOM_TRY
-actionPublishingSocket->bind(("tcp://127.0.0.1:" + std::to_string(AIPORT)).c_str());
-SOM_CATCH("Error binding socket\n")
-
-SOM_TRY
-perceptReceptionSocket.reset(new zmq::socket_t(*context, ZMQ_SUB));
-SOM_CATCH("Error initializing percept subscription socket\n")
-
-SOM_TRY
-perceptReceptionSocket->connect(("tcp://localhost:" + std::to_string(GAMEPORT)).c_str());
-SOM_CATCH("Error connecting to percept publisher\n")
-
 SOM_TRY
-perceptReceptionSocket->setsockopt(ZMQ_SUBSCRIBE, "", 0);
-SOM_CATCH("Error setting filter for percepts subscription\n")
-
+initialize(*context, getDefaultGameEndpoint(inputTransportType), getDefaultAIEndpoint(inputTransportType), inputTransportType, inputConnectionTimeoutInterval, getDefaultAgentIndex());
+SOM_CATCH("Error initializing AI communication interface\n")
+}
 
-//Get initial percept
+/*
+This function establishes the connections used to run the AI/game interaction using an existing ZMQ context and the given endpoint (such as "inproc://myGame" to run the game and the AI as threads sharing the context).  The context must outlive this object.
+@param inputContext: The ZMQ context to create the sockets with
+@param inputGameEndpoint: The endpoint that the game binds to
+@param inputTransportType: How to connect to the game (the game must use the same transport)
+@param inputConnectionTimeoutInterval: The number of milliseconds to wait for the game to connect and send the first percept before throwing an exception (it defaults to infinite wait)
+@param inputAIEndpoint: The endpoint that the AI binds to, which is only used (and required) by transports with a connection in each direction such as PUB_SUB_TRANSPORT
+@param inputAgentIndex: Which agent the AI plays if the game is a multi-agent game (see multiAgentGameCommunicationInterface), which requires LOCKSTEP_TRANSPORT (-1 for an ordinary game)
+@exceptions: This function can throw exceptions (especially if starting the connection to the game times out)
+*/
+AICommunicationInterface::AICommunicationInterface(zmq::context_t &inputContext, const std::string &inputGameEndpoint, transportType inputTransportType, int inputConnectionTimeoutInterval, const std::string &inputAIEndpoint, int inputAgentIndex)
+{
 SOM_TRY
-updateCurrentPerceptCache();
-SOM_CATCH("Error getting the first percept\n")
+initialize(inputContext, inputGameEndpoint, inputAIEndpoint, inputTransportType, inputConnectionTimeoutInterval, inputAgentIndex);
+SOM_CATCH("Error initializing AI communication interface\n")
 }
 
 /*
@@ -49,7 +46,25 @@ This function retrieves the most recent perceptions.
 */
 std::string AICommunicationInterface::getCurrentPerceptions()
 {
-return currentPercept;
+return std::string(currentPerceptData, currentPerceptSize);
+}
+
+/*
+This function returns the most recent perceptions without copying them.  The bytes are read straight from the received message, so they are only valid until the next call to sendActionsAndUpdatePerceptions/updatePerceptions.
+@return: The perception bytes
+*/
+const char *AICommunicationInterface::getCurrentPerceptionsData()
+{
+return currentPerceptData;
+}
+
+/*
+This function returns the size of the most recent perceptions.
+@return: The number of perception bytes
+*/
+uint64_t AICommunicationInterface::getCurrentPerceptionsSize()
+{
+return currentPerceptSize;
 }
 
 /*
@@ -81,6 +96,42 @@ uint64_t AICommunicationInterface::getSizeOfActionSpecificationInBits()
 return sizeOfExpectedActionInBits;
 }
 
+/*
+Get the name of the game, as given in the session description.
+@return: The name of the game (empty if the game didn't give one or follows version 1 of the protocol)
+*/
+const std::string &AICommunicationInterface::getGameName()
+{
+return gameName;
+}
+
+/*
+Get the description of what the game's rewards mean, as given in the session description.
+@return: The reward description (empty if the game didn't give one or follows version 1 of the protocol)
+*/
+const std::string &AICommunicationInterface::getRewardDescription()
+{
+return rewardDescription;
+}
+
+/*
+Get the encoding the game is sending the percepts in, as agreed during the connection handshake (the percepts returned by the interface are always decoded).
+@return: The percept encoding
+*/
+perceptEncoding AICommunicationInterface::getPerceptEncoding()
+{
+return usingDeltaPerceptEncoding ? DELTA_PERCEPT_ENCODING : RAW_PERCEPT_ENCODING;
+}
+
+/*
+Get the state of the game in the last game round (GAME_START for the first percept of a game, GAME_OVER if the game has ended and GAME_CONTINUE otherwise).
+@return: The state of the game
+*/
+gameState AICommunicationInterface::getCurrentGameState()
+{
+return currentGameState;
+}
+
 /*
 This function sends what the AI decides to do.  The class takes care of all of the details associated with sending AI actions.  When the function returns, it is safe to retrieve percept and game related information.
 @param inputAIActions: The data to send to the agent for it to act on (must have at least as many bits as sizeOfExpectedActionsInBits)
@@ -91,128 +142,715 @@ This function sends what the AI decides to do.  The class takes care of all of t
 */
 void AICommunicationInterface::sendActionsAndUpdatePerceptions(const std::string &inputAIActions, bool inputResetGame, bool inputShutdownGameEngine)
 {
-//Send the action
+SOM_TRY
+sendActions(inputAIActions.c_str(), inputAIActions.size(), inputResetGame, inputShutdownGameEngine);
+SOM_CATCH("Error sending action\n")
+
+//Update from the next percept message if we didn't tell the game engine to shut down
+if(!inputShutdownGameEngine)
+{
+SOM_TRY
+updatePerceptions();
+SOM_CATCH("Error getting next percept\n")
+}
+}
+
+/*
+This function sends what the AI decides to do without waiting for the game's answer, so that actions for several games can be sent before waiting for any of them.  updatePerceptions must be called before the next action is sent (unless the game engine was told to shut down).
+@param inputAIActions: The action bytes to send
+@param inputAIActionsSize: The number of action bytes (must match the expected action size)
+@param inputResetGame: Set this true to signal to the game that the AI would like to end the game prematurely
+@param inputShutdownGameEngine: Set this true to signal that the game engine should shut down
+@exceptions: This function can throw exceptions
+*/
+void AICommunicationInterface::sendActions(const char *inputAIActions, uint64_t inputAIActionsSize, bool inputResetGame, bool inputShutdownGameEngine)
+{
 //Check the input
-if(inputAIActions.size() != sizeOfExpectedActionInBytes)
+if(inputAIActionsSize != sizeOfExpectedActionInBytes)
 {
 throw SOMException("Error, action is not the expect size\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
 }
 
-//Create message to send
-perceptOrActionMessage action;
+if(usingFixedLayoutWireFormat)
+{
+uint32_t flags = 0;
+if(inputResetGame)
+{
+flags |= FIXED_LAYOUT_ACTION_RESET_GAME;
+}
+if(inputShutdownGameEngine)
+{
+flags |= FIXED_LAYOUT_ACTION_TERMINATE_GAME_SESSION;
+}
+
+SOM_TRY
+sendFixedLayoutAction(*transport, inputAIActions, inputAIActionsSize, flags, -1);
+SOM_CATCH("Error sending message\n")
+
+if(instrumentation != NULL)
+{
+actionSentTime = stepInstrumentation::getTime();
+}
+return;
+}
 
-action.set_action(inputAIActions);
+//Fill in the reused action message (so the action buffer is only allocated once)
+outgoingActionMessage.mutable_action()->assign(inputAIActions, inputAIActionsSize); //set_action(pointer, size) would build a new string each time
 
 if(inputResetGame)
 {
-action.set_game_state(GAME_OVER);
+outgoingActionMessage.set_game_state(GAME_OVER);
+}
+else
+{
+outgoingActionMessage.clear_game_state();
 }
 
 if(inputShutdownGameEngine)
 {
-action.set_terminate_game_session(true);
+outgoingActionMessage.set_terminate_game_session(true);
+}
+else
+{
+outgoingActionMessage.clear_terminate_game_session();
 }
-//Serialize action message
-std::string serializedAction;
-action.SerializeToString(&serializedAction);
 
 //Send message
 SOM_TRY
-actionPublishingSocket->send(serializedAction.c_str(), serializedAction.size());
+transport->sendProtobufMessage(outgoingActionMessage, -1);
 SOM_CATCH("Error sending message\n")
 
-//Update from the next percept message if we didn't tell the game engine to shut down
-if(!inputShutdownGameEngine)
+if(instrumentation != NULL)
 {
-updateCurrentPerceptCache();
+actionSentTime = stepInstrumentation::getTime();
 }
 }
 
 /*
-Update the catch of the current percept.
+This function waits for the percept the game sends in answer to the last action and makes it the current percept.
+@param inputTimeoutInMilliseconds: How long to wait for the percept before throwing a TIME_OUT exception (-1 waits forever)
+@exceptions: This function can throw exceptions
 */
-void AICommunicationInterface::updateCurrentPerceptCache()
+void AICommunicationInterface::updatePerceptions(int inputTimeoutInMilliseconds)
 {
-while(true) //Repeat until we get a valid update
+bool perceptReceived = false;
+SOM_TRY
+perceptReceived = updateCurrentPerceptCache(inputTimeoutInMilliseconds);
+SOM_CATCH("Error updating percept\n")
+
+if(!perceptReceived)
+{
+throw SOMException("Error updating percept, percept message retrieval timed out\n", TIME_OUT, __FILE__, __LINE__);
+}
+}
+
+/*
+This function waits for the percept the game sends in answer to the last action and makes it the current percept, like updatePerceptions, but returns false instead of throwing if it doesn't arrive in time.  AIs that poll the game with short timeouts can use this so that waiting doesn't create an exception (or allocate) each time.  The percept can be waited for again by calling this (or updatePerceptions) again.
+@param inputTimeoutInMilliseconds: How long to wait for the percept (0 just checks if it has arrived, -1 waits forever)
+@return: True if the percept arrived and is now the current percept
+@exceptions: This function can throw exceptions (for errors other than timing out)
+*/
+bool AICommunicationInterface::tryUpdatePerceptions(int inputTimeoutInMilliseconds)
+{
+SOM_TRY
+return updateCurrentPerceptCache(inputTimeoutInMilliseconds);
+SOM_CATCH("Error updating percept\n")
+}
+
+/*
+This function fills in a zmq_poll item that becomes readable when a message from the game arrives, so that one thread can wait on many sessions at once (see sessionPoller).
+@param outputPollItem: The poll item
+@return: False if the transport can't be polled (such as SHARED_MEMORY_TRANSPORT), in which case isMessageWaiting has to be checked instead
+*/
+bool AICommunicationInterface::getPollItem(zmq_pollitem_t &outputPollItem)
+{
+return transport->getPollItem(outputPollItem);
+}
+
+/*
+This function returns a file descriptor that becomes readable when a message from the game arrives, for event loops built on select/poll/epoll.  For the ZMQ transports this is ZMQ_FD, which is edge triggered, so tryUpdatePerceptions has to be called until it returns false (or isMessageWaiting checked) before waiting on the descriptor again.
+@return: The file descriptor (-1 if the transport doesn't have one)
+@exceptions: This function can throw exceptions
+*/
+int AICommunicationInterface::getFileDescriptor()
 {
-//Get the serialized percept message
-//Allocate a buffer for the reply message
-std::unique_ptr<zmq::message_t> messageBuffer;
 SOM_TRY
-messageBuffer.reset(new zmq::message_t);  //This can throw a zmq::error_t
-SOM_CATCH("Error constructing ZMQ message buffer\n")
+return transport->getFileDescriptor();
+SOM_CATCH("Error checking transport\n")
+}
 
+/*
+This function checks, without waiting or receiving anything, whether a message from the game may have arrived.
+@return: True if a message may be waiting
+@exceptions: This function can throw exceptions
+*/
+bool AICommunicationInterface::isMessageWaiting()
+{
 SOM_TRY
-if(perceptReceptionSocket->recv(messageBuffer.get(), 0) == false)
+return transport->isMessageWaiting();
+SOM_CATCH("Error checking transport\n")
+}
+
+/*
+This function sends what the AI decides to do and waits for the game's answer on a background I/O thread, so that the AI can keep computing (such as looking ahead or preparing its next decision) while the game simulates the action.  If the last asynchronous step is still in flight, this waits for it to finish first.  The other functions of the interface (including the synchronous step functions and the getters) must not be used until the returned future is ready, after which the getters also return the new percept.  Destroying the interface while the step is in flight abandons it.
+@param inputAIActions: The action bytes to send (copied, so the string can be changed as soon as this returns)
+@param inputResetGame: Set this true to signal to the game that the AI would like to end the game prematurely
+@param inputShutdownGameEngine: Set this true to signal that the game engine should shut down (the future then holds the last percept again)
+@return: A future that becomes ready with a copy of the game's next percept, or holds the exception if the step failed
+@exceptions: This function can throw exceptions (if the action is the wrong size)
+*/
+std::future<AIPercept> AICommunicationInterface::sendActionsAsync(const std::string &inputAIActions, bool inputResetGame, bool inputShutdownGameEngine)
+{
+//The promise is fulfilled at the end of the task, so the worker can still be finishing up the last step even if its future is ready
+SOM_TRY
+asyncWorker.wait();
+SOM_CATCH("Error finishing the last step\n")
+
+if(inputAIActions.size() != sizeOfExpectedActionInBytes)
 {
-throw SOMException("Error, percept message retrieval timed out\n", TIME_OUT, __FILE__, __LINE__);
+throw SOMException("Error, action is not the expect size\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+pendingAction.assign(inputAIActions); //Reuses the buffer
+pendingResetGame = inputResetGame;
+pendingShutdownGameEngine = inputShutdownGameEngine;
+asyncPerceptPromise = std::promise<AIPercept>();
+std::future<AIPercept> perceptFuture = asyncPerceptPromise.get_future();
+
+SOM_TRY
+asyncWorker.start([this]() { runAsyncStep(); });
+SOM_CATCH("Error starting step\n")
+
+return perceptFuture;
+}
+
+/*
+This function runs the step started by sendActionsAsync on the I/O thread and fulfills its promise.
+*/
+void AICommunicationInterface::runAsyncStep()
+{
+try
+{
+sendActionsAndUpdatePerceptions(pendingAction, pendingResetGame, pendingShutdownGameEngine);
+
+AIPercept percept;
+percept.perceptions.assign(currentPerceptData, currentPerceptSize);
+percept.reward = currentReward;
+percept.state = currentGameState;
+asyncPerceptPromise.set_value(std::move(percept));
+}
+catch(...)
+{
+asyncPerceptPromise.set_exception(std::current_exception());
+}
+}
+
+/*
+The fields of a percept message that the AI uses, as found in the serialized message.
+*/
+struct receivedPerceptFields
+{
+const char *perceptData; //Points into the serialized message
+uint64_t perceptSize;
+bool hasPercept;
+uint64_t reward;
+bool hasReward;
+uint64_t sizeOfPerceptInBits;
+bool hasSizeOfPerceptInBits;
+uint64_t sizeOfExpectedAction;
+bool hasSizeOfExpectedAction;
+uint64_t sequenceNumber;
+bool hasSequenceNumber;
+gameState state;
+bool hasGameState;
+connectionHandshake handshake;
+bool hasHandshake;
+};
+
+/*
+This function reads the fields of a serialized perceptOrActionMessage in place (rather than parsing it into a message object), so that the percept bytes can be used straight from the received message without being copied.  Fields that the AI doesn't use are skipped.
+@param inputMessage: The serialized message
+@param inputMessageSize: The size of the serialized message
+@param outputFields: The fields found in the message
+@return: True if the message could be read
+*/
+static bool readPerceptFields(const char *inputMessage, uint64_t inputMessageSize, receivedPerceptFields &outputFields)
+{
+outputFields = receivedPerceptFields();
+
+if(inputMessageSize > INT_MAX)
+{
+return false;
+}
+
+google::protobuf::io::CodedInputStream stream((const uint8_t *) inputMessage, inputMessageSize);
+while(true)
+{
+uint32_t tag = stream.ReadTag();
+if(tag == 0)
+{
+return stream.ConsumedEntireMessage(); //False if a zero tag was found before the end
+}
+
+int fieldNumber = google::protobuf::internal::WireFormatLite::GetTagFieldNumber(tag);
+google::protobuf::internal::WireFormatLite::WireType wireType = google::protobuf::internal::WireFormatLite::GetTagWireType(tag);
+
+if(fieldNumber == perceptOrActionMessage::kPerceptFieldNumber && wireType == google::protobuf::internal::WireFormatLite::WIRETYPE_LENGTH_DELIMITED)
+{
+uint32_t perceptSize = 0;
+if(!stream.ReadVarint32(&perceptSize))
+{
+return false;
+}
+outputFields.perceptData = inputMessage + stream.CurrentPosition();
+outputFields.perceptSize = perceptSize;
+outputFields.hasPercept = true;
+if(!stream.Skip(perceptSize))
+{
+return false;
+}
+continue;
+}
+
+if(wireType != google::protobuf::internal::WireFormatLite::WIRETYPE_VARINT)
+{
+if(!google::protobuf::internal::WireFormatLite::SkipField(&stream, tag))
+{
+return false;
+}
+continue;
 }
+
+uint64_t value = 0;
+if(!stream.ReadVarint64(&value))
+{
+return false;
+}
+
+switch(fieldNumber)
+{
+case perceptOrActionMessage::kRewardFieldNumber:
+outputFields.reward = value;
+outputFields.hasReward = true;
+break;
+
+case perceptOrActionMessage::kSizeOfPerceptInBitsFieldNumber:
+outputFields.sizeOfPerceptInBits = value;
+outputFields.hasSizeOfPerceptInBits = true;
+break;
+
+case perceptOrActionMessage::kSizeOfExpectedActionFieldNumber:
+outputFields.sizeOfExpectedAction = value;
+outputFields.hasSizeOfExpectedAction = true;
+break;
+
+case perceptOrActionMessage::kSequenceNumberFieldNumber:
+outputFields.sequenceNumber = value;
+outputFields.hasSequenceNumber = true;
+break;
+
+case perceptOrActionMessage::kGameStateFieldNumber:
+if(gameState_IsValid((int) value)) //Unknown enum values are ignored, like the generated parser does
+{
+outputFields.state = (gameState) value;
+outputFields.hasGameState = true;
+}
+break;
+
+case perceptOrActionMessage::kHandshakeFieldNumber:
+if(connectionHandshake_IsValid((int) value))
+{
+outputFields.handshake = (connectionHandshake) value;
+outputFields.hasHandshake = true;
+}
+break;
+
+default:
+break;
+}
+}
+}
+
+/*
+Update the catch of the current percept.  Any connection handshake (HELLO) messages that arrive first are answered with READY.  The percept is left in the received message rather than copied out of it, so it stays valid until the next call.
+@param inputTimeoutInMilliseconds: How long to wait for the percept (-1 waits forever)
+@return: False if no percept arrived in time (timing out doesn't throw, so callers that expect it don't pay for an exception)
+@exceptions: This function can throw exceptions
+*/
+bool AICommunicationInterface::updateCurrentPerceptCache(int inputTimeoutInMilliseconds)
+{
+std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+while(true) //Repeat until we get a valid update
+{
+//Work out how much of the timeout is left
+int timeRemaining = -1;
+if(inputTimeoutInMilliseconds >= 0)
+{
+int timeElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+timeRemaining = std::max(inputTimeoutInMilliseconds - timeElapsed, 0);
+}
+
+//Get the serialized percept message (this releases the message the current percept was in).  On the I/O thread the wait is cut short now and then to check whether the step has been abandoned.
+currentPerceptData = NULL;
+currentPerceptSize = 0;
+int waitTime = asyncWorker.limitWaitTime(timeRemaining);
+bool messageReceived = false;
+SOM_TRY
+messageReceived = transport->receiveMessage(waitTime);
 SOM_CATCH("Error receiving the reply message\n")
 
-//Deserialize the percept
-perceptOrActionMessage deserializedPerceptMessage;
-deserializedPerceptMessage.ParseFromArray(messageBuffer->data(), messageBuffer->size());
-if(!deserializedPerceptMessage.IsInitialized())
+if(!messageReceived)
 {
-//Message can't be read, so throw an exception
-throw SOMException("Error, percept message is invalid\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
+if(asyncWorker.isAbandoned())
+{
+throw SOMException("Error, the step was abandoned\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
 }
 
-if(!deserializedPerceptMessage.has_sequence_number())
+if(waitTime != timeRemaining)
 {
-//Message can't be read, so throw an exception
-throw SOMException("Error, percept message is invalid\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
+continue;
+}
+return false;
+}
+
+const char *receivedMessage = transport->getReceivedMessageData();
+uint64_t receivedMessageSize = transport->getReceivedMessageSize();
+
+uint64_t receiveTime = 0;
+if(instrumentation != NULL)
+{
+receiveTime = stepInstrumentation::getTime();
+instrumentation->countReceivedMessage(receivedMessageSize);
 }
 
-//Make sure the sequence number matches
-if(perceptSequenceCounter != deserializedPerceptMessage.sequence_number())
+//A restarted AI can be handed percepts meant for the one before it (such as ones left in shared memory), which are skipped until the game's next HELLO says where the session is up to
+if(!helloReceived && isFixedLayoutMessage(receivedMessage, receivedMessageSize))
 {
+if(instrumentation != NULL)
+{
+instrumentation->countStaleMessage();
+}
 continue;
 }
-perceptSequenceCounter++;
 
-if(!deserializedPerceptMessage.has_percept())
+//Fixed layout percepts only need their header checked
+if(usingFixedLayoutWireFormat && isFixedLayoutMessage(receivedMessage, receivedMessageSize))
+{
+fixedLayoutPerceptHeader header;
+if(!readFixedLayoutPercept(receivedMessage, receivedMessageSize, header))
 {
-//Message can't be read, so throw an exception
 throw SOMException("Error, percept message is invalid\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
 }
 
-currentPercept = deserializedPerceptMessage.percept();
+//A game with an action deadline carries on without a restarted AI until it answers a heartbeat, so the AI carries on from the first percept after the HELLO it took the sequence number from
+if(sequenceNumberFromHello && header.sequenceNumber > perceptSequenceCounter)
+{
+perceptSequenceCounter = header.sequenceNumber;
+}
 
-if(!deserializedPerceptMessage.has_reward())
+if(perceptSequenceCounter != header.sequenceNumber)
+{
+if(transport->canDropMessages())
+{
+if(instrumentation != NULL)
+{
+instrumentation->countStaleMessage();
+}
+continue;
+}
+
+throw SOMException("Error, percept message is out of sequence\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
+}
+perceptSequenceCounter++;
+sequenceNumberFromHello = false;
+
+SOM_TRY
+setCurrentPercept(receivedMessage + sizeof(header), header.perceptSize);
+SOM_CATCH("Error reading percept\n")
+currentReward = header.reward;
+currentGameState = (gameState) header.gameState;
+recordReceivedPercept(receiveTime);
+return true;
+}
+
+//Read the percept fields in place
+receivedPerceptFields perceptMessage;
+if(!readPerceptFields(receivedMessage, receivedMessageSize, perceptMessage))
 {
 //Message can't be read, so throw an exception
 throw SOMException("Error, percept message is invalid\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
 }
 
-currentReward = deserializedPerceptMessage.reward();
+//Answer connection handshakes (the game keeps sending HELLO until it sees a READY if the transport can drop messages)
+if(perceptMessage.hasHandshake)
+{
+if(perceptMessage.handshake == HELLO)
+{
+if(helloReceived && instrumentation != NULL)
+{
+instrumentation->countHandshakeRetry();
+}
 
-if(!deserializedPerceptMessage.has_size_of_percept_in_bits())
+SOM_TRY
+readHelloMessage(receivedMessage, receivedMessageSize);
+sendReadyMessage();
+SOM_CATCH("Error answering connection handshake\n")
+helloReceived = true;
+}
+continue;
+}
+
+if(!perceptMessage.hasSequenceNumber)
 {
 //Message can't be read, so throw an exception
 throw SOMException("Error, percept message is invalid\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
 }
 
-sizeOfPerceptionInBits = deserializedPerceptMessage.size_of_percept_in_bits();
+//The first percept after the HELLO the sequence number was taken from can be ahead of it (see the fixed layout case above)
+if(sequenceNumberFromHello && perceptMessage.sequenceNumber > perceptSequenceCounter)
+{
+perceptSequenceCounter = perceptMessage.sequenceNumber;
+}
+
+//Make sure the sequence number matches (transports that can drop messages may also deliver stale percepts, which are skipped, as are percepts meant for an AI this one replaced)
+if(perceptSequenceCounter != perceptMessage.sequenceNumber)
+{
+if(transport->canDropMessages() || !helloReceived)
+{
+if(instrumentation != NULL)
+{
+instrumentation->countStaleMessage();
+}
+continue;
+}
 
+throw SOMException("Error, percept message is out of sequence\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
+}
+perceptSequenceCounter++;
+sequenceNumberFromHello = false;
 
-if(!deserializedPerceptMessage.has_size_of_expected_action())
+if(!perceptMessage.hasPercept || !perceptMessage.hasReward || !perceptMessage.hasGameState)
 {
 //Message can't be read, so throw an exception
 throw SOMException("Error, percept message is invalid\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
 }
 
-sizeOfExpectedActionInBits = deserializedPerceptMessage.size_of_expected_action();
+//Games that follow version 1 of the protocol send the sizes in every percept instead of in the session description
+if(perceptMessage.hasSizeOfPerceptInBits && perceptMessage.hasSizeOfExpectedAction)
+{
+sizeOfPerceptionInBits = perceptMessage.sizeOfPerceptInBits;
+sizeOfExpectedActionInBits = perceptMessage.sizeOfExpectedAction;
 sizeOfExpectedActionInBytes = (sizeOfExpectedActionInBits + 7)/8; //Round up
-
-if(!deserializedPerceptMessage.has_game_state())
+}
+else if(!sessionDescriptionReceived)
 {
 //Message can't be read, so throw an exception
 throw SOMException("Error, percept message is invalid\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
 }
 
-currentGameState = deserializedPerceptMessage.game_state();
-return; //Everything was updated successfully, so exit
+SOM_TRY
+setCurrentPercept(perceptMessage.perceptData, perceptMessage.perceptSize);
+SOM_CATCH("Error reading percept\n")
+currentReward = perceptMessage.reward;
+currentGameState = perceptMessage.state;
+recordReceivedPercept(receiveTime);
+return true; //Everything was updated successfully, so exit
+}
+}
+
+/*
+This function records the time the game took to answer and the time taken to read its percept, and counts the step (if instrumentation is on).
+@param inputReceiveTime: When the percept message was received
+*/
+void AICommunicationInterface::recordReceivedPercept(uint64_t inputReceiveTime)
+{
+if(instrumentation == NULL)
+{
+return;
+}
+
+instrumentation->recordParseTime(stepInstrumentation::getTime() - inputReceiveTime);
+if(actionSentTime != 0)
+{
+instrumentation->recordPeerWaitTime(inputReceiveTime - actionSentTime); //The first percept doesn't answer an action
+}
+instrumentation->countStep();
+}
+
+/*
+This function makes the percept bytes of a received percept message the current percept, decoding them first if DELTA_PERCEPT_ENCODING is being used.
+@param inputPerceptData: The percept bytes in the received message
+@param inputPerceptSize: The number of percept bytes
+@exceptions: This function can throw exceptions (if the encoded percept is invalid)
+*/
+void AICommunicationInterface::setCurrentPercept(const char *inputPerceptData, uint64_t inputPerceptSize)
+{
+if(!usingDeltaPerceptEncoding)
+{
+currentPerceptData = inputPerceptData;
+currentPerceptSize = inputPerceptSize;
+return;
+}
+
+//Only the bytes that changed since the last percept are written
+if(!decodeDeltaPercept(inputPerceptData, inputPerceptSize, decodedPercept, (sizeOfPerceptionInBits + 7)/8))
+{
+throw SOMException("Error, encoded percept is invalid\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
+}
+
+currentPerceptData = decodedPercept.data();
+currentPerceptSize = decodedPercept.size();
+}
+
+/*
+This function turns on the per-step instrumentation of the interface (it is turned on automatically if the AIARENA_INSTRUMENTATION_FILE environment variable is set).  Once it is on, the time spent serializing, sending, waiting for the game and parsing its percepts is recorded each step, along with counts of steps, bytes, stale messages and handshake retries.
+*/
+void AICommunicationInterface::enableInstrumentation()
+{
+if(instrumentation == NULL)
+{
+instrumentation.reset(new stepInstrumentation("AI"));
+}
+
+transport->setInstrumentation(instrumentation.get());
+}
+
+/*
+This function returns the per-step instrumentation of the interface, so the measurements can be queried or written out.
+@return: The instrumentation or NULL if it hasn't been turned on
+*/
+stepInstrumentation *AICommunicationInterface::getInstrumentation()
+{
+return instrumentation.get();
+}
+
+/*
+This function takes the session description (and the requested wire format and percept encoding) from a HELLO message, along with where the session is up to if the HELLO is from a game the AI hasn't heard from before.  HELLO messages are rare, so unlike percepts they are just parsed into a message object.
+@param inputMessage: The serialized HELLO message
+@param inputMessageSize: The size of the serialized message
+@exceptions: This function can throw exceptions (if the message is invalid)
+*/
+void AICommunicationInterface::readHelloMessage(const char *inputMessage, uint64_t inputMessageSize)
+{
+perceptOrActionMessage helloMessage;
+if(!helloMessage.ParseFromArray(inputMessage, inputMessageSize))
+{
+throw SOMException("Error, HELLO message is invalid\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
+}
+
+//Games that follow version 1 of the protocol don't send a session description
+sessionDescriptionReceived = helloMessage.protocol_version() >= 2 && helloMessage.has_session_description() && helloMessage.session_description().has_size_of_percept_in_bits() && helloMessage.session_description().has_size_of_expected_action();
+if(sessionDescriptionReceived)
+{
+const sessionDescription &description = helloMessage.session_description();
+sizeOfPerceptionInBits = description.size_of_percept_in_bits();
+sizeOfExpectedActionInBits = description.size_of_expected_action();
+sizeOfExpectedActionInBytes = (sizeOfExpectedActionInBits + 7)/8; //Round up
+gameName = description.game_name();
+rewardDescription = description.reward_description();
+}
+
+//Agree to the fixed layout format if the game asks for it (its headers don't carry the sizes, so the session description is needed as well)
+usingFixedLayoutWireFormat = sessionDescriptionReceived && helloMessage.wire_format() == FIXED_LAYOUT_WIRE_FORMAT && hostSupportsFixedLayoutWireFormat();
+
+//Agree to the percept encoding the game asks for (the game's first encoded percept doesn't depend on an earlier one, so a HELLO resent after it doesn't matter).  The session description is needed as well, since decoded percepts are limited to its percept size.
+usingDeltaPerceptEncoding = sessionDescriptionReceived && helloMessage.percept_encoding() == DELTA_PERCEPT_ENCODING;
+
+//The first HELLO (or one from a restarted game) says which percept comes next, so a restarted AI carries on from where the one before it stopped.  HELLOs that the same game resends, such as its heartbeats, don't move the sequence number back.
+if(!helloReceived || (helloMessage.has_instance_id() && helloMessage.instance_id() != gameInstanceID))
+{
+perceptSequenceCounter = helloMessage.sequence_number();
+sequenceNumberFromHello = true;
+}
+gameInstanceID = helloMessage.instance_id();
+}
+
+/*
+This function tells the game that the AI is connected and ready for the next percept (and whether the AI agrees to use the fixed layout wire format and the percept encoding it asked for).  It carries the AI's instance ID, so the game can tell a restarted AI from the same one answering again.
+@exceptions: This function can throw exceptions
+*/
+void AICommunicationInterface::sendReadyMessage()
+{
+perceptOrActionMessage readyMessage;
+readyMessage.set_handshake(READY);
+readyMessage.set_protocol_version(AIARENA_PROTOCOL_VERSION);
+readyMessage.set_sequence_number(perceptSequenceCounter);
+readyMessage.set_instance_id(instanceID);
+if(usingFixedLayoutWireFormat)
+{
+readyMessage.set_wire_format(FIXED_LAYOUT_WIRE_FORMAT);
+}
+if(usingDeltaPerceptEncoding)
+{
+readyMessage.set_percept_encoding(DELTA_PERCEPT_ENCODING);
+}
+
+SOM_TRY
+transport->sendProtobufMessage(readyMessage, -1);
+SOM_CATCH("Error sending READY message\n")
+}
+
+/*
+This function does the setup shared by the constructors and waits for the first percept.
+@param inputContext: The ZMQ context to create the sockets with
+@param inputGameEndpoint: The endpoint that the game binds to
+@param inputAIEndpoint: The endpoint that the AI binds to (only used by transports with a connection in each direction)
+@param inputTransportType: How to connect to the game
+@param inputConnectionTimeoutInterval: The number of milliseconds to wait for the first percept (negative values wait forever)
+@param inputAgentIndex: Which agent the AI plays in a multi-agent game (-1 for an ordinary game)
+@exceptions: This function can throw exceptions
+*/
+void AICommunicationInterface::initialize(zmq::context_t &inputContext, const std::string &inputGameEndpoint, const std::string &inputAIEndpoint, transportType inputTransportType, int inputConnectionTimeoutInterval, int inputAgentIndex)
+{
+perceptSequenceCounter = 0;
+currentPerceptData = NULL;
+currentPerceptSize = 0;
+usingFixedLayoutWireFormat = false;
+usingDeltaPerceptEncoding = false;
+pendingResetGame = false;
+pendingShutdownGameEngine = false;
+sessionDescriptionReceived = false;
+sizeOfPerceptionInBits = 0;
+sizeOfExpectedActionInBits = 0;
+sizeOfExpectedActionInBytes = 0;
+helloReceived = false;
+actionSentTime = 0;
+instanceID = createInstanceID();
+gameInstanceID = 0;
+sequenceNumberFromHello = false;
+
+//Multi-agent games tell their agents apart by the routing IDs they connect with
+std::string routingID;
+if(inputAgentIndex >= 0)
+{
+if(inputTransportType != LOCKSTEP_TRANSPORT)
+{
+throw SOMException("Error, multi-agent games require LOCKSTEP_TRANSPORT\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+routingID = getAgentRoutingID(inputAgentIndex);
+}
+
+//Initialize the connection to the game
+SOM_TRY
+transport = createMessageTransport(inputTransportType, AI_ROLE, inputContext, inputGameEndpoint, inputAIEndpoint, routingID);
+SOM_CATCH("Error initializing transport\n")
+
+//Instrumentation can be turned on for a whole run without changing the AI
+SOM_TRY
+instrumentation.reset(createInstrumentationFromEnvironment("AI"));
+SOM_CATCH("Error setting up instrumentation\n")
+transport->setInstrumentation(instrumentation.get());
+
+//Get initial percept
+bool perceptReceived = false;
+SOM_TRY
+perceptReceived = updateCurrentPerceptCache(inputConnectionTimeoutInterval);
+SOM_CATCH("Error getting the first percept\n")
+
+if(!perceptReceived)
+{
+throw SOMException("Error getting the first percept, percept message retrieval timed out\n", TIME_OUT, __FILE__, __LINE__);
 }
 }
 
@@ -6,13 +6,30 @@
 #include<thread>
 #include<exception>
 #include<string>
+#include<chrono>
+#include<algorithm>
 #include<unistd.h> //For delay
 #include "zmq.hpp"
 
 #include "SOMException.hpp"
 #include "portLocations.hpp"
+#include "messageTransport.hpp"
+#include "fixedLayoutWireFormat.hpp"
+#include "deltaPerceptEncoding.hpp"
+#include "asyncStepWorker.hpp"
+#include "stepInstrumentation.hpp"
 #include "perceptOrActionMessage.pb.h"
 
+/*
+A copy of the parts of a percept that change from step to step, as returned by sendActionsAsync.
+*/
+struct AIPercept
+{
+std::string perceptions;
+uint64_t reward;
+gameState state;
+};
+
 /*
 This class makes it easier to write a game for AI Arena by abstracting away all of the communication details so that the programmer can just call a few simple functions.
 */
@@ -20,10 +37,24 @@ class AICommunicationInterface
 {
 public:
 /*
-This function establishes the connections used to run the AI/game interaction.
+This function establishes the connections used to run the AI/game interaction.  If AIARENA_AGENT_INDEX is set, the AI plays that agent of a multi-agent game.
+@param inputTransportType: How to connect to the game (the game must use the same transport)
+@param inputConnectionTimeoutInterval: The number of milliseconds to wait for the game to connect and send the first percept before throwing an exception (it defaults to infinite wait)
 @exceptions: This function can throw exceptions (especially if starting the connection to the game times out)
 */
-AICommunicationInterface();
+AICommunicationInterface(transportType inputTransportType = PUB_SUB_TRANSPORT, int inputConnectionTimeoutInterval = -1);
+
+/*
+This function establishes the connections used to run the AI/game interaction using an existing ZMQ context and the given endpoint (such as "inproc://myGame" to run the game and the AI as threads sharing the context).  The context must outlive this object.
+@param inputContext: The ZMQ context to create the sockets with
+@param inputGameEndpoint: The endpoint that the game binds to
+@param inputTransportType: How to connect to the game (the game must use the same transport)
+@param inputConnectionTimeoutInterval: The number of milliseconds to wait for the game to connect and send the first percept before throwing an exception (it defaults to infinite wait)
+@param inputAIEndpoint: The endpoint that the AI binds to, which is only used (and required) by transports with a connection in each direction such as PUB_SUB_TRANSPORT
+@param inputAgentIndex: Which agent the AI plays if the game is a multi-agent game (see multiAgentGameCommunicationInterface), which requires LOCKSTEP_TRANSPORT (-1 for an ordinary game)
+@exceptions: This function can throw exceptions (especially if starting the connection to the game times out)
+*/
+AICommunicationInterface(zmq::context_t &inputContext, const std::string &inputGameEndpoint, transportType inputTransportType = LOCKSTEP_TRANSPORT, int inputConnectionTimeoutInterval = -1, const std::string &inputAIEndpoint = "", int inputAgentIndex = -1);
 
 /*
 This function retrieves the most recent perceptions.
@@ -32,12 +63,48 @@ This function retrieves the most recent perceptions.
 */
 std::string getCurrentPerceptions();
 
+/*
+This function returns the most recent perceptions without copying them.  The bytes are read straight from the received message, so they are only valid until the next call to sendActionsAndUpdatePerceptions/updatePerceptions.
+@return: The perception bytes
+*/
+const char *getCurrentPerceptionsData();
+
+/*
+This function returns the size of the most recent perceptions.
+@return: The number of perception bytes
+*/
+uint64_t getCurrentPerceptionsSize();
+
 /*
 Get the reward associated with the last game round.
 @return: The reward associated with the last game round
 */
 uint64_t getCurrentReward();
 
+/*
+Get the state of the game in the last game round (GAME_START for the first percept of a game, GAME_OVER if the game has ended and GAME_CONTINUE otherwise).
+@return: The state of the game
+*/
+gameState getCurrentGameState();
+
+/*
+Get the name of the game, as given in the session description.
+@return: The name of the game (empty if the game didn't give one or follows version 1 of the protocol)
+*/
+const std::string &getGameName();
+
+/*
+Get the description of what the game's rewards mean, as given in the session description.
+@return: The reward description (empty if the game didn't give one or follows version 1 of the protocol)
+*/
+const std::string &getRewardDescription();
+
+/*
+Get the encoding the game is sending the percepts in, as agreed during the connection handshake (the percepts returned by the interface are always decoded).
+@return: The percept encoding
+*/
+perceptEncoding getPerceptEncoding();
+
 /*
 Get the size of the perception in bits.
 @return: The size of the perception in bits
@@ -62,25 +129,159 @@ This function sends what the AI decides to do.  The class takes care of all of t
 */
 void sendActionsAndUpdatePerceptions(const std::string &inputAIActions, bool inputResetGame = false, bool inputShutdownGameEngine = false);
 
+/*
+This function sends what the AI decides to do without waiting for the game's answer, so that actions for several games can be sent before waiting for any of them.  updatePerceptions must be called before the next action is sent (unless the game engine was told to shut down).
+@param inputAIActions: The action bytes to send
+@param inputAIActionsSize: The number of action bytes (must match the expected action size)
+@param inputResetGame: Set this true to signal to the game that the AI would like to end the game prematurely
+@param inputShutdownGameEngine: Set this true to signal that the game engine should shut down
+@exceptions: This function can throw exceptions
+*/
+void sendActions(const char *inputAIActions, uint64_t inputAIActionsSize, bool inputResetGame = false, bool inputShutdownGameEngine = false);
+
+/*
+This function waits for the percept the game sends in answer to the last action and makes it the current percept.
+@param inputTimeoutInMilliseconds: How long to wait for the percept before throwing a TIME_OUT exception (-1 waits forever)
+@exceptions: This function can throw exceptions
+*/
+void updatePerceptions(int inputTimeoutInMilliseconds = -1);
+
+/*
+This function waits for the percept the game sends in answer to the last action and makes it the current percept, like updatePerceptions, but returns false instead of throwing if it doesn't arrive in time.  AIs that poll the game with short timeouts can use this so that waiting doesn't create an exception (or allocate) each time.  The percept can be waited for again by calling this (or updatePerceptions) again.
+@param inputTimeoutInMilliseconds: How long to wait for the percept (0 just checks if it has arrived, -1 waits forever)
+@return: True if the percept arrived and is now the current percept
+@exceptions: This function can throw exceptions (for errors other than timing out)
+*/
+bool tryUpdatePerceptions(int inputTimeoutInMilliseconds);
+
+/*
+This function fills in a zmq_poll item that becomes readable when a message from the game arrives, so that one thread can wait on many sessions at once (see sessionPoller).
+@param outputPollItem: The poll item
+@return: False if the transport can't be polled (such as SHARED_MEMORY_TRANSPORT), in which case isMessageWaiting has to be checked instead
+*/
+bool getPollItem(zmq_pollitem_t &outputPollItem);
+
+/*
+This function returns a file descriptor that becomes readable when a message from the game arrives, for event loops built on select/poll/epoll.  For the ZMQ transports this is ZMQ_FD, which is edge triggered, so tryUpdatePerceptions has to be called until it returns false (or isMessageWaiting checked) before waiting on the descriptor again.
+@return: The file descriptor (-1 if the transport doesn't have one)
+@exceptions: This function can throw exceptions
+*/
+int getFileDescriptor();
+
+/*
+This function checks, without waiting or receiving anything, whether a message from the game may have arrived.
+@return: True if a message may be waiting
+@exceptions: This function can throw exceptions
+*/
+bool isMessageWaiting();
+
+/*
+This function sends what the AI decides to do and waits for the game's answer on a background I/O thread, so that the AI can keep computing (such as looking ahead or preparing its next decision) while the game simulates the action.  If the last asynchronous step is still in flight, this waits for it to finish first.  The other functions of the interface (including the synchronous step functions and the getters) must not be used until the returned future is ready, after which the getters also return the new percept.  Destroying the interface while the step is in flight abandons it.
+@param inputAIActions: The action bytes to send (copied, so the string can be changed as soon as this returns)
+@param inputResetGame: Set this true to signal to the game that the AI would like to end the game prematurely
+@param inputShutdownGameEngine: Set this true to signal that the game engine should shut down (the future then holds the last percept again)
+@return: A future that becomes ready with a copy of the game's next percept, or holds the exception if the step failed
+@exceptions: This function can throw exceptions (if the action is the wrong size)
+*/
+std::future<AIPercept> sendActionsAsync(const std::string &inputAIActions, bool inputResetGame = false, bool inputShutdownGameEngine = false);
+
+/*
+This function turns on the per-step instrumentation of the interface (it is turned on automatically if the AIARENA_INSTRUMENTATION_FILE environment variable is set).  Once it is on, the time spent serializing, sending, waiting for the game and parsing its percepts is recorded each step, along with counts of steps, bytes, stale messages and handshake retries.
+*/
+void enableInstrumentation();
+
+/*
+This function returns the per-step instrumentation of the interface, so the measurements can be queried or written out.
+@return: The instrumentation or NULL if it hasn't been turned on
+*/
+stepInstrumentation *getInstrumentation();
+
 private:
-std::unique_ptr<zmq::context_t> context;
-std::unique_ptr<zmq::socket_t> actionPublishingSocket;
-std::unique_ptr<zmq::socket_t> perceptReceptionSocket;
+std::unique_ptr<stepInstrumentation> instrumentation; //NULL unless instrumentation is turned on (declared before the transport, which records to it)
+std::unique_ptr<zmq::context_t> context; //Only used if the interface wasn't given a context to share
+std::unique_ptr<messageTransport> transport;
 
 uint64_t perceptSequenceCounter;  //The expected value of the next percept sequence number
+perceptOrActionMessage outgoingActionMessage; //Reused for every action so that its buffers are only allocated once
+bool usingFixedLayoutWireFormat; //True if the game asked for the fixed layout wire format (and this host supports it)
+bool usingDeltaPerceptEncoding; //True if the game asked for DELTA_PERCEPT_ENCODING
+std::string decodedPercept; //The current percept, decoded in place from each encoded percept (only used if usingDeltaPerceptEncoding)
+bool sessionDescriptionReceived; //True if the game sent the sizes in HELLO, so percepts don't need to carry them
+std::string gameName;
+std::string rewardDescription;
+bool helloReceived; //True once a HELLO message has been answered (any more are the game resending it)
+uint64_t instanceID; //Sent in the READY messages, so the game can tell a restarted AI from the same one
+uint64_t gameInstanceID; //From the game's last HELLO message (0 if it didn't send one)
+bool sequenceNumberFromHello; //True from taking the sequence number from a HELLO message until the next percept arrives, which can be ahead of it if the game has an action deadline
+uint64_t actionSentTime; //When the last action was sent (only kept if instrumentation is on, 0 before the first action)
 
 
-std::string currentPercept;
+const char *currentPerceptData; //Points into the transport's last received message (or decodedPercept)
+uint64_t currentPerceptSize;
 uint64_t currentReward;
 uint64_t sizeOfPerceptionInBits;
 uint64_t sizeOfExpectedActionInBits;
 uint64_t sizeOfExpectedActionInBytes;
 gameState currentGameState; //Start at the first percept of the new game, game over if the game is terminated, continue at any other time
 
+std::string pendingAction; //The action for the step running on the I/O thread
+bool pendingResetGame;
+bool pendingShutdownGameEngine;
+std::promise<AIPercept> asyncPerceptPromise;
+asyncStepWorker asyncWorker; //Declared last so the I/O thread is stopped (abandoning any step still in flight) before anything it uses is destroyed
+
 /*
-Update the catch of the current percept.
+This function does the setup shared by the constructors and waits for the first percept.
+@param inputContext: The ZMQ context to create the sockets with
+@param inputGameEndpoint: The endpoint that the game binds to
+@param inputAIEndpoint: The endpoint that the AI binds to (only used by transports with a connection in each direction)
+@param inputTransportType: How to connect to the game
+@param inputConnectionTimeoutInterval: The number of milliseconds to wait for the first percept (negative values wait forever)
+@param inputAgentIndex: Which agent the AI plays in a multi-agent game (-1 for an ordinary game)
+@exceptions: This function can throw exceptions
+*/
+void initialize(zmq::context_t &inputContext, const std::string &inputGameEndpoint, const std::string &inputAIEndpoint, transportType inputTransportType, int inputConnectionTimeoutInterval, int inputAgentIndex);
+
+/*
+Update the catch of the current percept.  Any connection handshake (HELLO) messages that arrive first are answered with READY.  The percept is left in the received message rather than copied out of it, so it stays valid until the next call.
+@param inputTimeoutInMilliseconds: How long to wait for the percept (-1 waits forever)
+@return: False if no percept arrived in time (timing out doesn't throw, so callers that expect it don't pay for an exception)
+@exceptions: This function can throw exceptions
+*/
+bool updateCurrentPerceptCache(int inputTimeoutInMilliseconds = -1);
+
+/*
+This function records the time the game took to answer and the time taken to read its percept, and counts the step (if instrumentation is on).
+@param inputReceiveTime: When the percept message was received
+*/
+void recordReceivedPercept(uint64_t inputReceiveTime);
+
+/*
+This function makes the percept bytes of a received percept message the current percept, decoding them first if DELTA_PERCEPT_ENCODING is being used.
+@param inputPerceptData: The percept bytes in the received message
+@param inputPerceptSize: The number of percept bytes
+@exceptions: This function can throw exceptions (if the encoded percept is invalid)
+*/
+void setCurrentPercept(const char *inputPerceptData, uint64_t inputPerceptSize);
+
+/*
+This function runs the step started by sendActionsAsync on the I/O thread and fulfills its promise.
+*/
+void runAsyncStep();
+
+/*
+This function takes the session description (and the requested wire format and percept encoding) from a HELLO message, along with where the session is up to if the HELLO is from a game the AI hasn't heard from before.  HELLO messages are rare, so unlike percepts they are just parsed into a message object.
+@param inputMessage: The serialized HELLO message
+@param inputMessageSize: The size of the serialized message
+@exceptions: This function can throw exceptions (if the message is invalid)
+*/
+void readHelloMessage(const char *inputMessage, uint64_t inputMessageSize);
+
+/*
+This function tells the game that the AI is connected and ready for the next percept (and whether the AI agrees to use the fixed layout wire format and the percept encoding it asked for).  It carries the AI's instance ID, so the game can tell a restarted AI from the same one answering again.
+@exceptions: This function can throw exceptions
 */
-void updateCurrentPerceptCache();
+void sendReadyMessage();
 };
 
 
@@ -0,0 +1,237 @@
+#include "BatchedAICommunicationInterface.hpp"
+
+#include<cstring>
+
+/*
+This function connects to a group of games running in consecutive sessions (see getSessionGameEndpoint), waiting for the first percept from each of them.
+@param inputNumberOfGames: How many games to connect to
+@param inputFirstSessionID: The session ID of the first game (game i uses session inputFirstSessionID + i)
+@param inputTransportType: How to connect to the games (the games must use the same transport)
+@param inputConnectionTimeoutInterval: The number of milliseconds to wait for each game to connect and send the first percept before throwing an exception (it defaults to infinite wait)
+@exceptions: This function can throw exceptions (especially if starting the connection to a game times out)
+*/
+BatchedAICommunicationInterface::BatchedAICommunicationInterface(uint32_t inputNumberOfGames, uint32_t inputFirstSessionID, transportType inputTransportType, int inputConnectionTimeoutInterval)
+{
+SOM_TRY
+context.reset(new zmq::context_t);
+SOM_CATCH("Error initializing ZMQ context\n")
+
+std::vector<std::string> gameEndpoints;
+std::vector<std::string> AIEndpoints;
+for(uint32_t i=0; i<inputNumberOfGames; i++)
+{
+SOM_TRY
+gameEndpoints.push_back(getSessionGameEndpoint(inputTransportType, inputFirstSessionID + i));
+AIEndpoints.push_back(getSessionAIEndpoint(inputTransportType, inputFirstSessionID + i));
+SOM_CATCH("Error getting endpoints for session\n")
+}
+
+SOM_TRY
+initialize(*context, gameEndpoints, AIEndpoints, inputTransportType, inputConnectionTimeoutInterval);
+SOM_CATCH("Error initializing batched AI communication interface\n")
+}
+
+/*
+This function connects to the games bound to the given endpoints using an existing ZMQ context, waiting for the first percept from each of them.  The context must outlive this object.
+@param inputContext: The ZMQ context to create the sockets with
+@param inputGameEndpoints: The endpoint that each game binds to
+@param inputTransportType: How to connect to the games (the games must use the same transport)
+@param inputConnectionTimeoutInterval: The number of milliseconds to wait for each game to connect and send the first percept before throwing an exception (it defaults to infinite wait)
+@param inputAIEndpoints: The endpoint to bind for each game, which is only used (and required) by transports with a connection in each direction such as PUB_SUB_TRANSPORT
+@exceptions: This function can throw exceptions (especially if starting the connection to a game times out)
+*/
+BatchedAICommunicationInterface::BatchedAICommunicationInterface(zmq::context_t &inputContext, const std::vector<std::string> &inputGameEndpoints, transportType inputTransportType, int inputConnectionTimeoutInterval, const std::vector<std::string> &inputAIEndpoints)
+{
+SOM_TRY
+initialize(inputContext, inputGameEndpoints, inputAIEndpoints, inputTransportType, inputConnectionTimeoutInterval);
+SOM_CATCH("Error initializing batched AI communication interface\n")
+}
+
+/*
+This function returns how many games are being played.
+@return: The number of games
+*/
+uint32_t BatchedAICommunicationInterface::getNumberOfGames()
+{
+return games.size();
+}
+
+/*
+This function returns the most recent percepts of all of the games, back to back (game i's percept starts at byte i*getSizeOfPerceptionInBytes()).  The buffer stays valid until the next call to sendActionsAndUpdatePerceptions.
+@return: The percepts of all the games
+*/
+const std::string &BatchedAICommunicationInterface::getCurrentPerceptions()
+{
+return currentPercepts;
+}
+
+/*
+Get the rewards associated with the last round of each game.
+@return: The reward for each game
+*/
+const std::vector<uint64_t> &BatchedAICommunicationInterface::getCurrentRewards()
+{
+return currentRewards;
+}
+
+/*
+Get the state of each game in the last round (GAME_START for the first percept of a game, GAME_OVER if the game has ended and GAME_CONTINUE otherwise).
+@return: The state of each game
+*/
+const std::vector<gameState> &BatchedAICommunicationInterface::getCurrentGameStates()
+{
+return currentGameStates;
+}
+
+/*
+Get the size of the perception in bits.
+@return: The size of each game's perception in bits
+*/
+uint64_t BatchedAICommunicationInterface::getSizeOfPerceptionInBits()
+{
+return sizeOfPerceptionInBits;
+}
+
+/*
+Get the number of bytes each game's percept takes up in the percept buffer.
+@return: The size of each game's perception in bytes
+*/
+uint64_t BatchedAICommunicationInterface::getSizeOfPerceptionInBytes()
+{
+return sizeOfPerceptionInBytes;
+}
+
+/*
+Get the size of an action specification in bits.
+@return: The size of each game's action specification in bits
+*/
+uint64_t BatchedAICommunicationInterface::getSizeOfActionSpecificationInBits()
+{
+return sizeOfExpectedActionInBits;
+}
+
+/*
+Get the number of bytes each game's action takes up in the action buffer.
+@return: The size of each game's action in bytes
+*/
+uint64_t BatchedAICommunicationInterface::getSizeOfActionSpecificationInBytes()
+{
+return sizeOfExpectedActionInBytes;
+}
+
+/*
+This function sends the actions for all of the games and then waits for the next percept from each of them.
+@param inputAIActions: The actions for all of the games, back to back (must be getNumberOfGames()*getSizeOfActionSpecificationInBytes() bytes long)
+@param inputResetGames: Which games the AI would like to end prematurely (empty to reset none of them, otherwise one entry per game)
+@param inputShutdownGameEngines: Set this true to signal that all of the game engines should shut down (no percepts are waited for in that case)
+@exceptions: This function can throw exceptions
+*/
+void BatchedAICommunicationInterface::sendActionsAndUpdatePerceptions(const std::string &inputAIActions, const std::vector<bool> &inputResetGames, bool inputShutdownGameEngines)
+{
+//Check the input
+if(inputAIActions.size() != games.size()*sizeOfExpectedActionInBytes)
+{
+throw SOMException("Error, action buffer is not the expected size\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+if(inputResetGames.size() != 0 && inputResetGames.size() != games.size())
+{
+throw SOMException("Error, reset flags don't match the number of games\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+//Send every action before waiting for any percepts, so the games all step at the same time
+for(uint64_t gameIndex = 0; gameIndex < games.size(); gameIndex++)
+{
+bool resetGame = inputResetGames.size() != 0 && inputResetGames[gameIndex];
+
+SOM_TRY
+games[gameIndex]->sendActions(inputAIActions.c_str() + gameIndex*sizeOfExpectedActionInBytes, sizeOfExpectedActionInBytes, resetGame, inputShutdownGameEngines);
+SOM_CATCH("Error sending action to game " + std::to_string(gameIndex) + "\n")
+}
+
+if(inputShutdownGameEngines)
+{
+return;
+}
+
+for(uint64_t gameIndex = 0; gameIndex < games.size(); gameIndex++)
+{
+SOM_TRY
+games[gameIndex]->updatePerceptions();
+SOM_CATCH("Error getting percept from game " + std::to_string(gameIndex) + "\n")
+}
+
+SOM_TRY
+updateBatchFromGames();
+SOM_CATCH("Error updating batch\n")
+}
+
+/*
+This function does the setup shared by the constructors, connecting to each game in turn and waiting for its first percept.
+@param inputContext: The ZMQ context to create the sockets with
+@param inputGameEndpoints: The endpoint that each game binds to
+@param inputAIEndpoints: The endpoint to bind for each game (empty if the transport doesn't use them)
+@param inputTransportType: How to connect to the games
+@param inputConnectionTimeoutInterval: The number of milliseconds to wait for each game's first percept (negative values wait forever)
+@exceptions: This function can throw exceptions
+*/
+void BatchedAICommunicationInterface::initialize(zmq::context_t &inputContext, const std::vector<std::string> &inputGameEndpoints, const std::vector<std::string> &inputAIEndpoints, transportType inputTransportType, int inputConnectionTimeoutInterval)
+{
+if(inputGameEndpoints.size() == 0)
+{
+throw SOMException("Error, no games given\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+if(inputAIEndpoints.size() != 0 && inputAIEndpoints.size() != inputGameEndpoints.size())
+{
+throw SOMException("Error, AI endpoints don't match the number of games\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+for(uint64_t gameIndex = 0; gameIndex < inputGameEndpoints.size(); gameIndex++)
+{
+std::string AIEndpoint;
+if(inputAIEndpoints.size() != 0)
+{
+AIEndpoint = inputAIEndpoints[gameIndex];
+}
+
+SOM_TRY
+games.emplace_back(new AICommunicationInterface(inputContext, inputGameEndpoints[gameIndex], inputTransportType, inputConnectionTimeoutInterval, AIEndpoint));
+SOM_CATCH("Error connecting to game " + std::to_string(gameIndex) + "\n")
+}
+
+//All of the games have to match the first one
+sizeOfPerceptionInBits = games[0]->getSizeOfPerceptionInBits();
+sizeOfPerceptionInBytes = games[0]->getCurrentPerceptionsSize();
+sizeOfExpectedActionInBits = games[0]->getSizeOfActionSpecificationInBits();
+sizeOfExpectedActionInBytes = (sizeOfExpectedActionInBits + 7)/8; //Round up
+
+currentPercepts.resize(games.size()*sizeOfPerceptionInBytes);
+currentRewards.resize(games.size());
+currentGameStates.resize(games.size());
+
+SOM_TRY
+updateBatchFromGames();
+SOM_CATCH("Error updating batch\n")
+}
+
+/*
+This function copies the current percept, reward and game state of each game into the batch buffers, checking that the games agree on the percept and action sizes.
+@exceptions: This function can throw exceptions
+*/
+void BatchedAICommunicationInterface::updateBatchFromGames()
+{
+for(uint64_t gameIndex = 0; gameIndex < games.size(); gameIndex++)
+{
+AICommunicationInterface &game = *games[gameIndex];
+
+if(game.getCurrentPerceptionsSize() != sizeOfPerceptionInBytes || game.getSizeOfPerceptionInBits() != sizeOfPerceptionInBits || game.getSizeOfActionSpecificationInBits() != sizeOfExpectedActionInBits)
+{
+throw SOMException("Error, game " + std::to_string(gameIndex) + " doesn't use the same percept/action sizes as the other games\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
+}
+
+memcpy(&currentPercepts[gameIndex*sizeOfPerceptionInBytes], game.getCurrentPerceptionsData(), sizeOfPerceptionInBytes);
+currentRewards[gameIndex] = game.getCurrentReward();
+currentGameStates[gameIndex] = game.getCurrentGameState();
+}
+}
@@ -0,0 +1,135 @@
+#ifndef BATCHEDAICOMMUNICATIONINTERFACEHPP
+#define BATCHEDAICOMMUNICATIONINTERFACEHPP
+
+#include<memory>
+#include<vector>
+#include<string>
+#include<cstdint>
+#include "zmq.hpp"
+
+#include "SOMException.hpp"
+#include "messageTransport.hpp"
+#include "AICommunicationInterface.hpp"
+
+/*
+This class lets one AI play several instances of a game at once, so that it can pick the actions for all of them with one batched computation instead of one small computation per game.  The percepts of all the games are kept back to back in a single buffer (game i's percept starts at byte i*getSizeOfPerceptionInBytes()) and the actions for all of the games are given the same way.  Actions are sent to every game before waiting for any answers, so the games all work on their next percept at the same time.
+
+All of the games must use the same percept and action sizes.  Each game starts, ends and restarts on its own, so the AI should check getCurrentGameStates to see which games have just started a new game.
+*/
+class BatchedAICommunicationInterface
+{
+public:
+/*
+This function connects to a group of games running in consecutive sessions (see getSessionGameEndpoint), waiting for the first percept from each of them.
+@param inputNumberOfGames: How many games to connect to
+@param inputFirstSessionID: The session ID of the first game (game i uses session inputFirstSessionID + i)
+@param inputTransportType: How to connect to the games (the games must use the same transport)
+@param inputConnectionTimeoutInterval: The number of milliseconds to wait for each game to connect and send the first percept before throwing an exception (it defaults to infinite wait)
+@exceptions: This function can throw exceptions (especially if starting the connection to a game times out)
+*/
+BatchedAICommunicationInterface(uint32_t inputNumberOfGames, uint32_t inputFirstSessionID, transportType inputTransportType = PUB_SUB_TRANSPORT, int inputConnectionTimeoutInterval = -1);
+
+/*
+This function connects to the games bound to the given endpoints using an existing ZMQ context, waiting for the first percept from each of them.  The context must outlive this object.
+@param inputContext: The ZMQ context to create the sockets with
+@param inputGameEndpoints: The endpoint that each game binds to
+@param inputTransportType: How to connect to the games (the games must use the same transport)
+@param inputConnectionTimeoutInterval: The number of milliseconds to wait for each game to connect and send the first percept before throwing an exception (it defaults to infinite wait)
+@param inputAIEndpoints: The endpoint to bind for each game, which is only used (and required) by transports with a connection in each direction such as PUB_SUB_TRANSPORT
+@exceptions: This function can throw exceptions (especially if starting the connection to a game times out)
+*/
+BatchedAICommunicationInterface(zmq::context_t &inputContext, const std::vector<std::string> &inputGameEndpoints, transportType inputTransportType = LOCKSTEP_TRANSPORT, int inputConnectionTimeoutInterval = -1, const std::vector<std::string> &inputAIEndpoints = std::vector<std::string>());
+
+/*
+This function returns how many games are being played.
+@return: The number of games
+*/
+uint32_t getNumberOfGames();
+
+/*
+This function returns the most recent percepts of all of the games, back to back (game i's percept starts at byte i*getSizeOfPerceptionInBytes()).  The buffer stays valid until the next call to sendActionsAndUpdatePerceptions.
+@return: The percepts of all the games
+*/
+const std::string &getCurrentPerceptions();
+
+/*
+Get the rewards associated with the last round of each game.
+@return: The reward for each game
+*/
+const std::vector<uint64_t> &getCurrentRewards();
+
+/*
+Get the state of each game in the last round (GAME_START for the first percept of a game, GAME_OVER if the game has ended and GAME_CONTINUE otherwise).
+@return: The state of each game
+*/
+const std::vector<gameState> &getCurrentGameStates();
+
+/*
+Get the size of the perception in bits.
+@return: The size of each game's perception in bits
+*/
+uint64_t getSizeOfPerceptionInBits();
+
+/*
+Get the number of bytes each game's percept takes up in the percept buffer.
+@return: The size of each game's perception in bytes
+*/
+uint64_t getSizeOfPerceptionInBytes();
+
+/*
+Get the size of an action specification in bits.
+@return: The size of each game's action specification in bits
+*/
+uint64_t getSizeOfActionSpecificationInBits();
+
+/*
+Get the number of bytes each game's action takes up in the action buffer.
+@return: The size of each game's action in bytes
+*/
+uint64_t getSizeOfActionSpecificationInBytes();
+
+/*
+This function sends the actions for all of the games and then waits for the next percept from each of them.
+@param inputAIActions: The actions for all of the games, back to back (must be getNumberOfGames()*getSizeOfActionSpecificationInBytes() bytes long)
+@param inputResetGames: Which games the AI would like to end prematurely (empty to reset none of them, otherwise one entry per game)
+@param inputShutdownGameEngines: Set this true to signal that all of the game engines should shut down (no percepts are waited for in that case)
+@exceptions: This function can throw exceptions
+*/
+void sendActionsAndUpdatePerceptions(const std::string &inputAIActions, const std::vector<bool> &inputResetGames = std::vector<bool>(), bool inputShutdownGameEngines = false);
+
+private:
+std::unique_ptr<zmq::context_t> context; //Only used if the interface wasn't given a context to share
+std::vector<std::unique_ptr<AICommunicationInterface>> games;
+
+std::string currentPercepts;
+std::vector<uint64_t> currentRewards;
+std::vector<gameState> currentGameStates;
+uint64_t sizeOfPerceptionInBits;
+uint64_t sizeOfPerceptionInBytes;
+uint64_t sizeOfExpectedActionInBits;
+uint64_t sizeOfExpectedActionInBytes;
+
+/*
+This function does the setup shared by the constructors, connecting to each game in turn and waiting for its first percept.
+@param inputContext: The ZMQ context to create the sockets with
+@param inputGameEndpoints: The endpoint that each game binds to
+@param inputAIEndpoints: The endpoint to bind for each game (empty if the transport doesn't use them)
+@param inputTransportType: How to connect to the games
+@param inputConnectionTimeoutInterval: The number of milliseconds to wait for each game's first percept (negative values wait forever)
+@exceptions: This function can throw exceptions
+*/
+void initialize(zmq::context_t &inputContext, const std::vector<std::string> &inputGameEndpoints, const std::vector<std::string> &inputAIEndpoints, transportType inputTransportType, int inputConnectionTimeoutInterval);
+
+/*
+This function copies the current percept, reward and game state of each game into the batch buffers, checking that the games agree on the percept and action sizes.
+@exceptions: This function can throw exceptions
+*/
+void updateBatchFromGames();
+};
+
+
+
+
+
+
+#endif
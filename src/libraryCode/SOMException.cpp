@@ -1,190 +1,386 @@
 #include "SOMException.hpp"
 
+#include<cstring>
+
 /*
 This function initializes the exception object with the required information.
-@param inputErrorMessage: A message specific to this error instance
+@param inputErrorMessage: A message specific to this error instance, which isn't copied so it must last as long as the exception (see SOMLiteral)
 @param inputExceptionClass: What class of error this is (so different types of processing can be done)
 @param inputSourceFileName: The name of the source file this exception originated in (hopefully provided by the __FILE__ macro)
 @param inputSourceLineNumber: The line that the exception originated (hopefully provided by the __LINE__ macro)
 */
-SOMException::SOMException(const std::string &inputErrorMessage, exceptionClass inputExceptionClass, const char *inputSourceFileName, int inputSourceLineNumber) : errorMessage(inputErrorMessage)
-{
-
-exceptionType = inputExceptionClass;
-
-if(inputSourceFileName != NULL)
+SOMException::SOMException(SOMLiteral inputErrorMessage, exceptionClass inputExceptionClass, const char *inputSourceFileName, int inputSourceLineNumber)
 {
-sourceFileName = std::string(inputSourceFileName);
+initialize(inputExceptionClass);
+addContext(inputErrorMessage.errorMessage, inputExceptionClass, inputSourceFileName, inputSourceLineNumber);
 }
 
-sourceLineNumber = std::to_string(inputSourceLineNumber);
-
+/*
+This function does the same as the constructor above, but copies the error message (for messages put together when the error happens).
+@param inputErrorMessage: A message specific to this error instance
+@param inputExceptionClass: What class of error this is (so different types of processing can be done)
+@param inputSourceFileName: The name of the source file this exception originated in (hopefully provided by the __FILE__ macro)
+@param inputSourceLineNumber: The line that the exception originated (hopefully provided by the __LINE__ macro)
+*/
+SOMException::SOMException(const std::string &inputErrorMessage, exceptionClass inputExceptionClass, const char *inputSourceFileName, int inputSourceLineNumber)
+{
+initialize(inputExceptionClass);
+addOwnedContext(inputErrorMessage.data(), inputErrorMessage.size(), inputExceptionClass, inputSourceFileName, inputSourceLineNumber);
 }
 
 /*
 This function initializes the exception object with an error message that is the concatenation of the given error message and the given exception.
-@param inputErrorMessage: A message specific to this error instance
+@param inputErrorMessage: A message specific to this error instance, which isn't copied so it must last as long as the exception (see SOMLiteral)
 @param inputExceptionClass: What class of error this is (so different types of processing can be done)
 @param inputException: The exception received from a lower level that we are rethrowing as a SOMException with more detail
 @param inputSourceFileName: The name of the source file this exception originated in (hopefully provided by the __FILE__ macro)
 @param inputSourceLineNumber: The line that the exception originated (hopefully provided by the __LINE__ macro)
 */
-SOMException::SOMException(const std::string &inputErrorMessage, exceptionClass inputExceptionClass, const std::exception &inputException, const char *inputSourceFileName, int inputSourceLineNumber) : errorMessage(inputErrorMessage + inputException.what())
+SOMException::SOMException(SOMLiteral inputErrorMessage, exceptionClass inputExceptionClass, const std::exception &inputException, const char *inputSourceFileName, int inputSourceLineNumber)
 {
-exceptionType = inputExceptionClass;
-
-if(inputSourceFileName != NULL)
-{
-sourceFileName = std::string(inputSourceFileName);
-}
-
-sourceLineNumber = std::to_string(inputSourceLineNumber);
+initialize(inputExceptionClass);
+copyContexts(inputException);
+addContext(inputErrorMessage.errorMessage, inputExceptionClass, inputSourceFileName, inputSourceLineNumber);
 }
 
 /*
-This function initializes the exception object with an error message that is the concatenation of the given error message and the given exception with an unknown exception class.
+This function does the same as the constructor above, but copies the error message (for messages put together when the error happens).
 @param inputErrorMessage: A message specific to this error instance
+@param inputExceptionClass: What class of error this is (so different types of processing can be done)
 @param inputException: The exception received from a lower level that we are rethrowing as a SOMException with more detail
 @param inputSourceFileName: The name of the source file this exception originated in (hopefully provided by the __FILE__ macro)
 @param inputSourceLineNumber: The line that the exception originated (hopefully provided by the __LINE__ macro)
 */
-SOMException::SOMException(const std::string &inputErrorMessage, const std::exception &inputException, const char *inputSourceFileName, int inputSourceLineNumber) : errorMessage(inputErrorMessage + inputException.what())
+SOMException::SOMException(const std::string &inputErrorMessage, exceptionClass inputExceptionClass, const std::exception &inputException, const char *inputSourceFileName, int inputSourceLineNumber)
 {
-exceptionType = UNKNOWN;
+initialize(inputExceptionClass);
+copyContexts(inputException);
+addOwnedContext(inputErrorMessage.data(), inputErrorMessage.size(), inputExceptionClass, inputSourceFileName, inputSourceLineNumber);
+}
 
-if(inputSourceFileName != NULL)
+/*
+This function initializes the exception object with an error message that is the concatenation of the given error message and the given exception with an unknown exception class.
+@param inputErrorMessage: A message specific to this error instance, which isn't copied so it must last as long as the exception (see SOMLiteral)
+@param inputException: The exception received from a lower level that we are rethrowing as a SOMException with more detail
+@param inputSourceFileName: The name of the source file this exception originated in (hopefully provided by the __FILE__ macro)
+@param inputSourceLineNumber: The line that the exception originated (hopefully provided by the __LINE__ macro)
+*/
+SOMException::SOMException(SOMLiteral inputErrorMessage, const std::exception &inputException, const char *inputSourceFileName, int inputSourceLineNumber)
 {
-sourceFileName = std::string(inputSourceFileName);
+initialize(UNKNOWN);
+copyContexts(inputException);
+addContext(inputErrorMessage.errorMessage, UNKNOWN, inputSourceFileName, inputSourceLineNumber);
 }
 
-sourceLineNumber = std::to_string(inputSourceLineNumber);
+/*
+This function does the same as the constructor above, but copies the error message (for messages put together when the error happens).
+@param inputErrorMessage: A message specific to this error instance
+@param inputException: The exception received from a lower level that we are rethrowing as a SOMException with more detail
+@param inputSourceFileName: The name of the source file this exception originated in (hopefully provided by the __FILE__ macro)
+@param inputSourceLineNumber: The line that the exception originated (hopefully provided by the __LINE__ macro)
+*/
+SOMException::SOMException(const std::string &inputErrorMessage, const std::exception &inputException, const char *inputSourceFileName, int inputSourceLineNumber)
+{
+initialize(UNKNOWN);
+copyContexts(inputException);
+addOwnedContext(inputErrorMessage.data(), inputErrorMessage.size(), UNKNOWN, inputSourceFileName, inputSourceLineNumber);
 }
 
 /*
 This function initializes the exception object with an error message that is the concatenation of the given error message and the given SOMException with the given SOMException's error class.
-@param inputErrorMessage: A message specific to this error instance
+@param inputErrorMessage: A message specific to this error instance, which isn't copied so it must last as long as the exception (see SOMLiteral)
+@param inputExceptionClass: What class of error this is (so different types of processing can be done)
 @param inputSOMException: The SOMException received from a lower level that we are rethrowing as a SOMException with more detail
 @param inputSourceFileName: The name of the source file this exception originated in (hopefully provided by the __FILE__ macro)
 @param inputSourceLineNumber: The line that the exception originated (hopefully provided by the __LINE__ macro)
 */
-SOMException::SOMException(const std::string &inputErrorMessage, const SOMException &inputSOMException, const char *inputSourceFileName, int inputSourceLineNumber) : errorMessage(inputErrorMessage + inputSOMException.toString())
+SOMException::SOMException(SOMLiteral inputErrorMessage, exceptionClass inputExceptionClass, const SOMException &inputSOMException, const char *inputSourceFileName, int inputSourceLineNumber)
 {
-exceptionType = inputSOMException.exceptionType;
-
-if(inputSourceFileName != NULL)
-{
-sourceFileName = std::string(inputSourceFileName);
-}
-
-sourceLineNumber = std::to_string(inputSourceLineNumber);
+initialize(inputExceptionClass);
+copyContexts(inputSOMException);
+addContext(inputErrorMessage.errorMessage, inputExceptionClass, inputSourceFileName, inputSourceLineNumber);
 }
 
 /*
-This function initializes the exception object with an error message that is the concatenation of the given error message and the given SOMException with the given SOMException's error class.
+This function does the same as the constructor above, but copies the error message (for messages put together when the error happens).
 @param inputErrorMessage: A message specific to this error instance
 @param inputExceptionClass: What class of error this is (so different types of processing can be done)
 @param inputSOMException: The SOMException received from a lower level that we are rethrowing as a SOMException with more detail
 @param inputSourceFileName: The name of the source file this exception originated in (hopefully provided by the __FILE__ macro)
 @param inputSourceLineNumber: The line that the exception originated (hopefully provided by the __LINE__ macro)
 */
-SOMException::SOMException(const std::string &inputErrorMessage, exceptionClass inputExceptionClass, const SOMException &inputSOMException, const char *inputSourceFileName, int inputSourceLineNumber) : errorMessage(inputErrorMessage + inputSOMException.toString())
+SOMException::SOMException(const std::string &inputErrorMessage, exceptionClass inputExceptionClass, const SOMException &inputSOMException, const char *inputSourceFileName, int inputSourceLineNumber)
 {
-exceptionType = inputExceptionClass;
+initialize(inputExceptionClass);
+copyContexts(inputSOMException);
+addOwnedContext(inputErrorMessage.data(), inputErrorMessage.size(), inputExceptionClass, inputSourceFileName, inputSourceLineNumber);
+}
 
-if(inputSourceFileName != NULL)
+/*
+This function initializes the exception object with an error message that is the concatenation of the given error message and the given SOMException with the given SOMException's error class.
+@param inputErrorMessage: A message specific to this error instance, which isn't copied so it must last as long as the exception (see SOMLiteral)
+@param inputSOMException: The SOMException received from a lower level that we are rethrowing as a SOMException with more detail
+@param inputSourceFileName: The name of the source file this exception originated in (hopefully provided by the __FILE__ macro)
+@param inputSourceLineNumber: The line that the exception originated (hopefully provided by the __LINE__ macro)
+*/
+SOMException::SOMException(SOMLiteral inputErrorMessage, const SOMException &inputSOMException, const char *inputSourceFileName, int inputSourceLineNumber)
 {
-sourceFileName = std::string(inputSourceFileName);
+initialize(inputSOMException.exceptionType);
+copyContexts(inputSOMException);
+addContext(inputErrorMessage.errorMessage, inputSOMException.exceptionType, inputSourceFileName, inputSourceLineNumber);
 }
 
-sourceLineNumber = std::to_string(inputSourceLineNumber);
+/*
+This function does the same as the constructor above, but copies the error message (for messages put together when the error happens).
+@param inputErrorMessage: A message specific to this error instance
+@param inputSOMException: The SOMException received from a lower level that we are rethrowing as a SOMException with more detail
+@param inputSourceFileName: The name of the source file this exception originated in (hopefully provided by the __FILE__ macro)
+@param inputSourceLineNumber: The line that the exception originated (hopefully provided by the __LINE__ macro)
+*/
+SOMException::SOMException(const std::string &inputErrorMessage, const SOMException &inputSOMException, const char *inputSourceFileName, int inputSourceLineNumber)
+{
+initialize(inputSOMException.exceptionType);
+copyContexts(inputSOMException);
+addOwnedContext(inputErrorMessage.data(), inputErrorMessage.size(), inputSOMException.exceptionType, inputSourceFileName, inputSourceLineNumber);
 }
 
-
-
 /*
 This function returns a string that is a summary of the error that caused the exception
 @return: The string summary of the error
 */
 std::string SOMException::toString() const
 {
-return "Error of type " + exceptionClassToString(exceptionType) + " occurred in file " + sourceFileName + " at line " + sourceLineNumber + ": " + errorMessage;
+std::string result;
+
+//The outermost layer comes first, as each layer used to add the summary of the one it caught to the end of its message
+for(uint32_t contextIndex = numberOfContexts; contextIndex > 0; contextIndex--)
+{
+appendContextSummary(contexts[contextIndex - 1], result);
+
+if(contextIndex == numberOfContexts && numberOfDroppedContexts > 0)
+{
+result += "(" + std::to_string(numberOfDroppedContexts) + " more layers not shown) ";
+}
+}
+
+return result;
 }
 
 /*
-This function overrides the virtual function that was defined in std::exception and returns the result of toString() as a const string
+This function overrides the virtual function that was defined in std::exception and returns the result of toString().  The summary is put together the first time this is called and kept with the exception, so the pointer stays valid for as long as the exception does.
 @return: The string summary of the error
 */
 const char *SOMException::what() const throw()
 {
-return toString().c_str();
+try
+{
+if(summary.empty())
+{
+summary = toString();
+}
+}
+catch(const std::exception &inputException)
+{
+return "Error, unable to put together the summary of a SOMException (out of memory)";
 }
 
+return summary.c_str();
+}
 
 /*
-This function converts the exceptionClass enum into a string
-@param inputExceptionType: The type of exception
-@return: The string equivalent
+This function returns the message given where the exception was first thrown (without the messages added as it was rethrown).
+@return: The message
 */
-std::string exceptionClassToString(exceptionClass inputExceptionType)
+std::string SOMException::getOriginalErrorMessage() const
 {
-switch(inputExceptionType)
+if(numberOfContexts == 0)
 {
-case ZMQ_ERROR:
-return std::string("ZMQ_ERROR");
-break;
+return "";
+}
 
-case SQLITE3_ERROR:
-return std::string("ZMQ_ERROR");
-break;
+const SOMExceptionContext &context = contexts[0];
+if(context.errorMessage != NULL)
+{
+return std::string(context.errorMessage);
+}
 
-case FILE_SYSTEM_ERROR:
-return std::string("FILE_SYSTEM_ERROR");
-break;
+return ownedErrorMessages.substr(context.ownedErrorMessageOffset, context.ownedErrorMessageSize);
+}
 
-case AN_ASSUMPTION_WAS_VIOLATED_ERROR:
-return std::string("AN_ASSUMPTION_WAS_VIOLATED_ERROR");
-break;
+/*
+This function returns the name of the source file the exception was first thrown in.
+@return: The file name (empty if it wasn't given)
+*/
+const char *SOMException::getSourceFileName() const
+{
+if(numberOfContexts == 0 || contexts[0].sourceFileName == NULL)
+{
+return "";
+}
 
-case SINGLETON_ALREADY_EXISTS:
-return std::string("SINGLETON_ALREADY_EXISTS");
-break;
+return contexts[0].sourceFileName;
+}
 
-case SINGLETON_CREATION_FAILED:
-return std::string("SINGLETON_CREATION_FAILED");
-break;
+/*
+This function returns the line the exception was first thrown at.
+@return: The line number
+*/
+int SOMException::getSourceLineNumber() const
+{
+if(numberOfContexts == 0)
+{
+return 0;
+}
+
+return contexts[0].sourceLineNumber;
+}
 
-case FORK_ERROR:
-return std::string("FORK_ERROR");
-break;
+/*
+This function sets the exception up with no contexts.
+@param inputExceptionClass: What class of error this is
+*/
+void SOMException::initialize(exceptionClass inputExceptionClass)
+{
+exceptionType = inputExceptionClass;
+numberOfContexts = 0;
+numberOfDroppedContexts = 0;
+}
 
-case SYSTEM_ERROR:
-return std::string("SYSTEM_ERROR");
-break;
+/*
+This function adds where the exception is being thrown (or rethrown) from, replacing the last context if there is no room left.
+@param inputErrorMessage: The message for this layer, which must last as long as the exception
+@param inputExceptionClass: The class of error for this layer
+@param inputSourceFileName: The name of the source file
+@param inputSourceLineNumber: The line in the source file
+@return: The context that was added
+*/
+SOMExceptionContext &SOMException::addContext(const char *inputErrorMessage, exceptionClass inputExceptionClass, const char *inputSourceFileName, int inputSourceLineNumber)
+{
+//Where the exception came from is usually the most useful part, so the outermost layers are the ones given up
+if(numberOfContexts == SOM_EXCEPTION_MAXIMUM_CONTEXTS)
+{
+numberOfContexts--;
+numberOfDroppedContexts++;
+}
 
-case INVALID_FUNCTION_INPUT:
-return std::string("INVALID_FUNCTION_INPUT");
-break;
+SOMExceptionContext &context = contexts[numberOfContexts];
+numberOfContexts++;
 
-case INCORRECT_SERVER_RESPONSE:
-return std::string("INCORRECT_SERVER_RESPONSE");
-break;
+context.errorMessage = inputErrorMessage != NULL ? inputErrorMessage : "";
+context.ownedErrorMessageOffset = 0;
+context.ownedErrorMessageSize = 0;
+context.exceptionType = inputExceptionClass;
+context.sourceFileName = inputSourceFileName;
+context.sourceLineNumber = inputSourceLineNumber;
+context.isStandardException = false;
 
-case SERVER_REQUEST_FAILED:
-return std::string("SERVER_REQUEST_FAILED");
-break;
+return context;
+}
 
-case TIME_OUT:
-return std::string("TIME_OUT");
-break;
+/*
+This function adds a context whose message is copied into the exception.
+@param inputErrorMessage: The message for this layer
+@param inputErrorMessageSize: The size of the message
+@param inputExceptionClass: The class of error for this layer
+@param inputSourceFileName: The name of the source file
+@param inputSourceLineNumber: The line in the source file
+@return: The context that was added
+*/
+SOMExceptionContext &SOMException::addOwnedContext(const char *inputErrorMessage, uint64_t inputErrorMessageSize, exceptionClass inputExceptionClass, const char *inputSourceFileName, int inputSourceLineNumber)
+{
+SOMExceptionContext &context = addContext(NULL, inputExceptionClass, inputSourceFileName, inputSourceLineNumber);
+context.errorMessage = NULL;
+context.ownedErrorMessageOffset = ownedErrorMessages.size();
+context.ownedErrorMessageSize = inputErrorMessageSize;
+ownedErrorMessages.append(inputErrorMessage, inputErrorMessageSize);
 
-case UNKNOWN:
-return std::string("UNKNOWN");
-break;
+return context;
+}
 
-default:
-return "";
+/*
+This function takes the contexts of an exception that is being rethrown (so their summaries don't need to be put together until what() is called).
+@param inputSOMException: The exception being rethrown
+*/
+void SOMException::copyContexts(const SOMException &inputSOMException)
+{
+for(uint32_t contextIndex = 0; contextIndex < inputSOMException.numberOfContexts; contextIndex++)
+{
+contexts[contextIndex] = inputSOMException.contexts[contextIndex];
+}
+numberOfContexts = inputSOMException.numberOfContexts;
+numberOfDroppedContexts = inputSOMException.numberOfDroppedContexts;
+ownedErrorMessages = inputSOMException.ownedErrorMessages;
+}
+
+/*
+This function takes the contexts of an exception that is being rethrown, or copies its what() if it isn't a SOMException.
+@param inputException: The exception being rethrown
+*/
+void SOMException::copyContexts(const std::exception &inputException)
+{
+const SOMException *inputSOMException = dynamic_cast<const SOMException *>(&inputException);
+if(inputSOMException != NULL)
+{
+copyContexts(*inputSOMException);
+return;
+}
+
+const char *message = inputException.what();
+SOMExceptionContext &context = addOwnedContext(message, strlen(message), UNKNOWN, NULL, 0);
+context.isStandardException = true;
+}
+
+/*
+This function adds the summary of one context to a string.
+@param inputContext: The context
+@param inputOutputSummary: The string to add to
+*/
+void SOMException::appendContextSummary(const SOMExceptionContext &inputContext, std::string &inputOutputSummary) const
+{
+if(!inputContext.isStandardException)
+{
+inputOutputSummary += "Error of type ";
+inputOutputSummary += getExceptionClassName(inputContext.exceptionType);
+inputOutputSummary += " occurred in file ";
+inputOutputSummary += inputContext.sourceFileName != NULL ? inputContext.sourceFileName : "";
+inputOutputSummary += " at line ";
+inputOutputSummary += std::to_string(inputContext.sourceLineNumber);
+inputOutputSummary += ": ";
+}
+
+if(inputContext.errorMessage != NULL)
+{
+inputOutputSummary += inputContext.errorMessage;
+}
+else
+{
+inputOutputSummary.append(ownedErrorMessages, inputContext.ownedErrorMessageOffset, inputContext.ownedErrorMessageSize);
 }
 }
 
+/*
+This function converts the exceptionClass enum into a string
+@param inputExceptionType: The type of exception
+@return: The string equivalent
+*/
+std::string exceptionClassToString(exceptionClass inputExceptionType)
+{
+return std::string(getExceptionClassName(inputExceptionType));
+}
 
+/*
+This function returns the name of an exceptionClass value without creating a string.
+@param inputExceptionType: The type of exception
+@return: The name (a string literal, empty for values that aren't in the enum)
+*/
+const char *getExceptionClassName(exceptionClass inputExceptionType)
+{
+static const char *const exceptionClassNames[] = {"ZMQ_ERROR", "SQLITE3_ERROR", "FILE_SYSTEM_ERROR", "AN_ASSUMPTION_WAS_VIOLATED_ERROR", "SINGLETON_ALREADY_EXISTS", "SINGLETON_CREATION_FAILED", "FORK_ERROR", "SYSTEM_ERROR", "INVALID_FUNCTION_INPUT", "INCORRECT_SERVER_RESPONSE", "SERVER_REQUEST_FAILED", "TIME_OUT", "UNKNOWN"};
 
+if(inputExceptionType < ZMQ_ERROR || inputExceptionType > UNKNOWN)
+{
+return "";
+}
+
+return exceptionClassNames[inputExceptionType];
+}
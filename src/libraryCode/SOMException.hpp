@@ -16,6 +16,10 @@
 #endif
 
 #include<string>
+#include<exception>
+#include<cstdint>
+#include<cstddef>
+#include<type_traits>
 
 enum exceptionClass
 {
@@ -34,14 +38,79 @@ TIME_OUT,
 UNKNOWN
 };
 
+//How many layers (where the exception was thrown and each SOM_CATCH it passed through) an exception keeps the details of (the ones in the middle are dropped after that)
+#define SOM_EXCEPTION_MAXIMUM_CONTEXTS 8
+
+/*
+Where an exception was thrown or rethrown and what was said about it there.
+*/
+struct SOMExceptionContext
+{
+const char *errorMessage; //NULL if the message was copied into the exception's ownedErrorMessages
+uint64_t ownedErrorMessageOffset;
+uint64_t ownedErrorMessageSize;
+exceptionClass exceptionType;
+const char *sourceFileName;
+int sourceLineNumber;
+bool isStandardException; //True if this is the what() of an exception that wasn't a SOMException (which is shown without the type, file and line)
+};
+
+/*
+An error message that a SOMException keeps as a pointer instead of copying, so it must last as long as the exception.  String literals are turned into one automatically (see the SOMException constructors that take a const char array); anything else has to be wrapped explicitly, and only if it will outlive the exception (such as a static string).
+*/
+struct SOMLiteral
+{
+explicit SOMLiteral(const char *inputErrorMessage) : errorMessage(inputErrorMessage)
+{
+}
+
+const char *errorMessage;
+};
+
 /*
-This class is used to throw an informative exception.
+This class is used to throw an informative exception.  Exceptions are thrown for things that happen during normal running (such as timeouts), and each SOM_CATCH rethrows them with another layer of detail, so creating and rethrowing them is kept cheap: error messages that are string literals and the file names from __FILE__ are kept as pointers rather than copied (messages in arrays that can change or behind plain pointers are copied, since they may not outlive the exception), and the summary returned by what() is only put together if something asks for it.
 */
 class SOMException : public std::exception
 {
 public:
+/*
+This function initializes the exception with an error message that is a string literal (or another array that can't change), which is kept as a pointer rather than copied.  The other arguments are the same as for the constructors that take a SOMLiteral.
+@param inputErrorMessage: A message specific to this error instance
+@param inputOtherArguments: The rest of the arguments
+*/
+template<size_t messageSize, typename... otherArgumentTypes> SOMException(const char (&inputErrorMessage)[messageSize], const otherArgumentTypes &... inputOtherArguments) : SOMException(SOMLiteral(inputErrorMessage), inputOtherArguments...)
+{
+}
+
+/*
+This function initializes the exception with an error message in an array that can change (such as a buffer on the stack), which is copied.  The other arguments are the same as for the constructors that take a std::string.
+@param inputErrorMessage: A message specific to this error instance
+@param inputOtherArguments: The rest of the arguments
+*/
+template<size_t messageSize, typename... otherArgumentTypes> SOMException(char (&inputErrorMessage)[messageSize], const otherArgumentTypes &... inputOtherArguments) : SOMException(std::string(inputErrorMessage), inputOtherArguments...)
+{
+}
+
+/*
+This function initializes the exception with an error message given as a pointer (such as from std::string::c_str()), which is copied since nothing says it will outlive the exception.  The other arguments are the same as for the constructors that take a std::string.
+@param inputErrorMessage: A message specific to this error instance
+@param inputOtherArguments: The rest of the arguments
+*/
+template<typename messagePointerType, typename std::enable_if<std::is_same<messagePointerType, const char *>::value || std::is_same<messagePointerType, char *>::value, int>::type = 0, typename... otherArgumentTypes> SOMException(messagePointerType inputErrorMessage, const otherArgumentTypes &... inputOtherArguments) : SOMException(std::string(inputErrorMessage), inputOtherArguments...)
+{
+}
+
 /*
 This function initializes the exception object with the required information.
+@param inputErrorMessage: A message specific to this error instance, which isn't copied so it must last as long as the exception (see SOMLiteral)
+@param inputExceptionClass: What class of error this is (so different types of processing can be done)
+@param inputSourceFileName: The name of the source file this exception originated in (hopefully provided by the __FILE__ macro)
+@param inputSourceLineNumber: The line that the exception originated (hopefully provided by the __LINE__ macro)
+*/
+SOMException(SOMLiteral inputErrorMessage, exceptionClass inputExceptionClass, const char *inputSourceFileName, int inputSourceLineNumber);
+
+/*
+This function does the same as the constructor above, but copies the error message (for messages put together when the error happens).
 @param inputErrorMessage: A message specific to this error instance
 @param inputExceptionClass: What class of error this is (so different types of processing can be done)
 @param inputSourceFileName: The name of the source file this exception originated in (hopefully provided by the __FILE__ macro)
@@ -51,6 +120,16 @@ SOMException(const std::string &inputErrorMessage, exceptionClass inputException
 
 /*
 This function initializes the exception object with an error message that is the concatenation of the given error message and the given exception.
+@param inputErrorMessage: A message specific to this error instance, which isn't copied so it must last as long as the exception (see SOMLiteral)
+@param inputExceptionClass: What class of error this is (so different types of processing can be done)
+@param inputException: The exception received from a lower level that we are rethrowing as a SOMException with more detail
+@param inputSourceFileName: The name of the source file this exception originated in (hopefully provided by the __FILE__ macro)
+@param inputSourceLineNumber: The line that the exception originated (hopefully provided by the __LINE__ macro)
+*/
+SOMException(SOMLiteral inputErrorMessage, exceptionClass inputExceptionClass, const std::exception &inputException, const char *inputSourceFileName, int inputSourceLineNumber);
+
+/*
+This function does the same as the constructor above, but copies the error message (for messages put together when the error happens).
 @param inputErrorMessage: A message specific to this error instance
 @param inputExceptionClass: What class of error this is (so different types of processing can be done)
 @param inputException: The exception received from a lower level that we are rethrowing as a SOMException with more detail
@@ -61,6 +140,15 @@ SOMException(const std::string &inputErrorMessage, exceptionClass inputException
 
 /*
 This function initializes the exception object with an error message that is the concatenation of the given error message and the given exception with an unknown exception class.
+@param inputErrorMessage: A message specific to this error instance, which isn't copied so it must last as long as the exception (see SOMLiteral)
+@param inputException: The exception received from a lower level that we are rethrowing as a SOMException with more detail
+@param inputSourceFileName: The name of the source file this exception originated in (hopefully provided by the __FILE__ macro)
+@param inputSourceLineNumber: The line that the exception originated (hopefully provided by the __LINE__ macro)
+*/
+SOMException(SOMLiteral inputErrorMessage, const std::exception &inputException, const char *inputSourceFileName, int inputSourceLineNumber);
+
+/*
+This function does the same as the constructor above, but copies the error message (for messages put together when the error happens).
 @param inputErrorMessage: A message specific to this error instance
 @param inputException: The exception received from a lower level that we are rethrowing as a SOMException with more detail
 @param inputSourceFileName: The name of the source file this exception originated in (hopefully provided by the __FILE__ macro)
@@ -70,6 +158,16 @@ SOMException(const std::string &inputErrorMessage, const std::exception &inputEx
 
 /*
 This function initializes the exception object with an error message that is the concatenation of the given error message and the given SOMException with the given SOMException's error class.
+@param inputErrorMessage: A message specific to this error instance, which isn't copied so it must last as long as the exception (see SOMLiteral)
+@param inputExceptionClass: What class of error this is (so different types of processing can be done)
+@param inputSOMException: The SOMException received from a lower level that we are rethrowing as a SOMException with more detail
+@param inputSourceFileName: The name of the source file this exception originated in (hopefully provided by the __FILE__ macro)
+@param inputSourceLineNumber: The line that the exception originated (hopefully provided by the __LINE__ macro)
+*/
+SOMException(SOMLiteral inputErrorMessage, exceptionClass inputExceptionClass, const SOMException &inputSOMException, const char *inputSourceFileName, int inputSourceLineNumber);
+
+/*
+This function does the same as the constructor above, but copies the error message (for messages put together when the error happens).
 @param inputErrorMessage: A message specific to this error instance
 @param inputExceptionClass: What class of error this is (so different types of processing can be done)
 @param inputSOMException: The SOMException received from a lower level that we are rethrowing as a SOMException with more detail
@@ -80,6 +178,15 @@ SOMException(const std::string &inputErrorMessage, exceptionClass inputException
 
 /*
 This function initializes the exception object with an error message that is the concatenation of the given error message and the given SOMException with the given SOMException's error class.
+@param inputErrorMessage: A message specific to this error instance, which isn't copied so it must last as long as the exception (see SOMLiteral)
+@param inputSOMException: The SOMException received from a lower level that we are rethrowing as a SOMException with more detail
+@param inputSourceFileName: The name of the source file this exception originated in (hopefully provided by the __FILE__ macro)
+@param inputSourceLineNumber: The line that the exception originated (hopefully provided by the __LINE__ macro)
+*/
+SOMException(SOMLiteral inputErrorMessage, const SOMException &inputSOMException, const char *inputSourceFileName, int inputSourceLineNumber);
+
+/*
+This function does the same as the constructor above, but copies the error message (for messages put together when the error happens).
 @param inputErrorMessage: A message specific to this error instance
 @param inputSOMException: The SOMException received from a lower level that we are rethrowing as a SOMException with more detail
 @param inputSourceFileName: The name of the source file this exception originated in (hopefully provided by the __FILE__ macro)
@@ -94,15 +201,83 @@ This function returns a string that is a summary of the error that caused the ex
 std::string toString() const;
 
 /*
-This function overrides the virtual function that was defined in std::exception and returns the result of toString() as a const string
+This function overrides the virtual function that was defined in std::exception and returns the result of toString().  The summary is put together the first time this is called and kept with the exception, so the pointer stays valid for as long as the exception does.
 @return: The string summary of the error
 */
 virtual const char *what() const throw();
 
-std::string errorMessage;
+/*
+This function returns the message given where the exception was first thrown (without the messages added as it was rethrown).
+@return: The message
+*/
+std::string getOriginalErrorMessage() const;
+
+/*
+This function returns the name of the source file the exception was first thrown in.
+@return: The file name (empty if it wasn't given)
+*/
+const char *getSourceFileName() const;
+
+/*
+This function returns the line the exception was first thrown at.
+@return: The line number
+*/
+int getSourceLineNumber() const;
+
 exceptionClass exceptionType;
-std::string sourceFileName;
-std::string sourceLineNumber;
+
+private:
+SOMExceptionContext contexts[SOM_EXCEPTION_MAXIMUM_CONTEXTS]; //contexts[0] is where the exception was thrown, followed by each layer that rethrew it
+uint32_t numberOfContexts;
+uint32_t numberOfDroppedContexts; //Layers between the last two contexts that there wasn't room to keep
+std::string ownedErrorMessages; //The messages that had to be copied, one after the other (empty unless there were any)
+mutable std::string summary; //Put together by what() the first time it is called
+
+/*
+This function sets the exception up with no contexts.
+@param inputExceptionClass: What class of error this is
+*/
+void initialize(exceptionClass inputExceptionClass);
+
+/*
+This function adds where the exception is being thrown (or rethrown) from, replacing the last context if there is no room left.
+@param inputErrorMessage: The message for this layer, which must last as long as the exception
+@param inputExceptionClass: The class of error for this layer
+@param inputSourceFileName: The name of the source file
+@param inputSourceLineNumber: The line in the source file
+@return: The context that was added
+*/
+SOMExceptionContext &addContext(const char *inputErrorMessage, exceptionClass inputExceptionClass, const char *inputSourceFileName, int inputSourceLineNumber);
+
+/*
+This function adds a context whose message is copied into the exception.
+@param inputErrorMessage: The message for this layer
+@param inputErrorMessageSize: The size of the message
+@param inputExceptionClass: The class of error for this layer
+@param inputSourceFileName: The name of the source file
+@param inputSourceLineNumber: The line in the source file
+@return: The context that was added
+*/
+SOMExceptionContext &addOwnedContext(const char *inputErrorMessage, uint64_t inputErrorMessageSize, exceptionClass inputExceptionClass, const char *inputSourceFileName, int inputSourceLineNumber);
+
+/*
+This function takes the contexts of an exception that is being rethrown (so their summaries don't need to be put together until what() is called).
+@param inputSOMException: The exception being rethrown
+*/
+void copyContexts(const SOMException &inputSOMException);
+
+/*
+This function takes the contexts of an exception that is being rethrown, or copies its what() if it isn't a SOMException.
+@param inputException: The exception being rethrown
+*/
+void copyContexts(const std::exception &inputException);
+
+/*
+This function adds the summary of one context to a string.
+@param inputContext: The context
+@param inputOutputSummary: The string to add to
+*/
+void appendContextSummary(const SOMExceptionContext &inputContext, std::string &inputOutputSummary) const;
 };
 
 /*
@@ -112,6 +287,13 @@ This function converts the exceptionClass enum into a string
 */
 std::string exceptionClassToString(exceptionClass inputExceptionType);
 
+/*
+This function returns the name of an exceptionClass value without creating a string.
+@param inputExceptionType: The type of exception
+@return: The name (a string literal, empty for values that aren't in the enum)
+*/
+const char *getExceptionClassName(exceptionClass inputExceptionType);
+
 /*
 It turns out that this functionality is possible but fairly complex, so it is being left for a later release.  A useful resource on how to implement it can be found at these places: 
 
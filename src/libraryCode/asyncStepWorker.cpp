@@ -0,0 +1,155 @@
+#include "asyncStepWorker.hpp"
+
+/*
+This function creates the worker (without starting its thread).
+*/
+asyncStepWorker::asyncStepWorker() : taskIsPending(false), stopping(false), abandoned(false)
+{
+}
+
+/*
+This function abandons the current task (if any), waits for it to finish and stops the thread.
+*/
+asyncStepWorker::~asyncStepWorker()
+{
+if(!thread.joinable())
+{
+return;
+}
+
+abandon();
+
+{
+std::unique_lock<std::mutex> lock(mutex);
+stopping = true;
+}
+taskStartedOrStopping.notify_one();
+thread.join();
+}
+
+/*
+This function starts running the given task on the worker thread.
+@param inputTask: The task to run (tasks that only capture a pointer don't cause an allocation)
+@exceptions: This function can throw exceptions (if the last task hasn't finished or the thread can't be started)
+*/
+void asyncStepWorker::start(const std::function<void()> &inputTask)
+{
+if(!thread.joinable())
+{
+SOM_TRY
+thread = std::thread(&asyncStepWorker::run, this);
+SOM_CATCH("Error starting I/O thread\n")
+}
+
+{
+std::unique_lock<std::mutex> lock(mutex);
+if(taskIsPending)
+{
+throw SOMException("Error, the last step hasn't finished yet\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+task = inputTask;
+taskException = std::exception_ptr();
+taskIsPending = true;
+}
+
+taskStartedOrStopping.notify_one();
+}
+
+/*
+This function waits for the task to finish and rethrows any exception it threw.
+@exceptions: This function can throw exceptions (whatever the task threw)
+*/
+void asyncStepWorker::wait()
+{
+std::exception_ptr exception;
+
+{
+std::unique_lock<std::mutex> lock(mutex);
+taskFinished.wait(lock, [this]() { return !taskIsPending; });
+std::swap(exception, taskException); //Only rethrown once
+}
+
+if(exception)
+{
+std::rethrow_exception(exception);
+}
+}
+
+/*
+This function returns true if a task has been started and hasn't finished yet.
+@return: True if the worker is busy
+*/
+bool asyncStepWorker::isBusy()
+{
+std::unique_lock<std::mutex> lock(mutex);
+return taskIsPending;
+}
+
+/*
+This function tells the current task to give up, which it does the next time it checks isAbandoned.  The worker stays abandoned, so this is only for when its owner is being destroyed and a task could otherwise be left waiting forever for a peer that has gone away.
+*/
+void asyncStepWorker::abandon()
+{
+abandoned = true;
+}
+
+/*
+This function returns true once abandon has been called.  Tasks check it whenever a wait shortened by limitWaitTime ends without anything arriving.
+@return: True if the worker has been abandoned
+*/
+bool asyncStepWorker::isAbandoned()
+{
+return abandoned;
+}
+
+/*
+This function shortens a wait made on the worker thread to at most ASYNC_STEP_ABANDON_CHECK_INTERVAL milliseconds, so that the task can check isAbandoned between waits.  Waits made on any other thread are left as they are.
+@param inputTimeoutInMilliseconds: How long the caller wants to wait (-1 waits forever)
+@return: How long to wait
+*/
+int asyncStepWorker::limitWaitTime(int inputTimeoutInMilliseconds)
+{
+if(std::this_thread::get_id() != thread.get_id())
+{
+return inputTimeoutInMilliseconds;
+}
+
+return inputTimeoutInMilliseconds < 0 ? ASYNC_STEP_ABANDON_CHECK_INTERVAL : std::min(inputTimeoutInMilliseconds, ASYNC_STEP_ABANDON_CHECK_INTERVAL);
+}
+
+/*
+This function is run by the worker thread, running each task as it is started until the worker is destroyed.
+*/
+void asyncStepWorker::run()
+{
+std::unique_lock<std::mutex> lock(mutex);
+while(true)
+{
+taskStartedOrStopping.wait(lock, [this]() { return taskIsPending || stopping; });
+if(taskIsPending)
+{
+lock.unlock();
+std::exception_ptr exception;
+try
+{
+task();
+}
+catch(...)
+{
+exception = std::current_exception();
+}
+lock.lock();
+
+taskException = exception;
+taskIsPending = false;
+taskFinished.notify_all();
+continue; //Finish the task before stopping
+}
+
+if(stopping)
+{
+return;
+}
+}
+}
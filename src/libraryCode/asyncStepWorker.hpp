@@ -0,0 +1,91 @@
+#ifndef ASYNCSTEPWORKERHPP
+#define ASYNCSTEPWORKERHPP
+
+#include<functional>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<exception>
+#include<atomic>
+#include<algorithm>
+
+#include "SOMException.hpp"
+
+//The longest a task running on an asyncStepWorker waits at a time (see limitWaitTime), so that it notices it has been abandoned within this many milliseconds
+#define ASYNC_STEP_ABANDON_CHECK_INTERVAL 50
+
+/*
+This class runs one task at a time on a thread of its own, so that a communication interface can do a step's I/O in the background while its user gets on with something else.  The protocol only allows one step to be in flight per session, so there is no queue: a new task can only be started once the last one has finished.  The thread is started with the first task (so interfaces that are only used synchronously never create it) and is reused for every later task.
+*/
+class asyncStepWorker
+{
+public:
+/*
+This function creates the worker (without starting its thread).
+*/
+asyncStepWorker();
+
+/*
+This function abandons the current task (if any), waits for it to finish and stops the thread.
+*/
+~asyncStepWorker();
+
+/*
+This function starts running the given task on the worker thread.
+@param inputTask: The task to run (tasks that only capture a pointer don't cause an allocation)
+@exceptions: This function can throw exceptions (if the last task hasn't finished or the thread can't be started)
+*/
+void start(const std::function<void()> &inputTask);
+
+/*
+This function waits for the task to finish and rethrows any exception it threw.
+@exceptions: This function can throw exceptions (whatever the task threw)
+*/
+void wait();
+
+/*
+This function returns true if a task has been started and hasn't finished yet.
+@return: True if the worker is busy
+*/
+bool isBusy();
+
+/*
+This function tells the current task to give up, which it does the next time it checks isAbandoned.  The worker stays abandoned, so this is only for when its owner is being destroyed and a task could otherwise be left waiting forever for a peer that has gone away.
+*/
+void abandon();
+
+/*
+This function returns true once abandon has been called.  Tasks check it whenever a wait shortened by limitWaitTime ends without anything arriving.
+@return: True if the worker has been abandoned
+*/
+bool isAbandoned();
+
+/*
+This function shortens a wait made on the worker thread to at most ASYNC_STEP_ABANDON_CHECK_INTERVAL milliseconds, so that the task can check isAbandoned between waits.  Waits made on any other thread are left as they are.
+@param inputTimeoutInMilliseconds: How long the caller wants to wait (-1 waits forever)
+@return: How long to wait
+*/
+int limitWaitTime(int inputTimeoutInMilliseconds);
+
+private:
+std::mutex mutex;
+std::condition_variable taskStartedOrStopping;
+std::condition_variable taskFinished;
+std::function<void()> task;
+bool taskIsPending; //True from start until the task finishes
+bool stopping;
+std::atomic<bool> abandoned;
+std::exception_ptr taskException; //Whatever the last task threw (rethrown by wait)
+std::thread thread;
+
+/*
+This function is run by the worker thread, running each task as it is started until the worker is destroyed.
+*/
+void run();
+};
+
+
+
+
+
+#endif
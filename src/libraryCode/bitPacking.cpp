@@ -0,0 +1,395 @@
+#include "bitPacking.hpp"
+
+#include<cstring>
+
+//The AVX2 functions are compiled for AVX2 on their own (with the target attribute) so the rest of the library still runs on any x86 processor, and are only called if the processor has it
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BIT_PACKING_HAS_AVX2
+#include<immintrin.h>
+#endif
+
+//SSE2 is always there on x86-64, so it is the fallback when AVX2 isn't
+#if defined(__SSE2__)
+#define BIT_PACKING_HAS_SSE2
+#include<emmintrin.h>
+#endif
+
+/*
+This function checks (once) if the processor running the program has AVX2.
+@return: True if it does
+*/
+static bool processorHasAVX2()
+{
+#ifdef BIT_PACKING_HAS_AVX2
+static const bool hasAVX2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2") != 0);
+return hasAVX2;
+#else
+return false;
+#endif
+}
+
+#ifdef BIT_PACKING_HAS_AVX2
+/*
+This function unpacks whole bytes of bits into floats, 8 bits at a time.
+@param inputPackedBits: The packed bits
+@param inputNumberOfBits: How many bits there are
+@param outputValues: Where to put the values
+@return: How many bits were unpacked (the rest are left for the scalar loop)
+*/
+__attribute__((target("avx2"))) static uint64_t unpackBitsToFloatsAVX2(const char *inputPackedBits, uint64_t inputNumberOfBits, float *outputValues)
+{
+const __m256i bitMasks = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+const __m256 ones = _mm256_set1_ps(1.0f);
+
+uint64_t numberOfBytes = inputNumberOfBits/8;
+for(uint64_t byteIndex = 0; byteIndex < numberOfBytes; byteIndex++)
+{
+//Each 32 bit lane tests one bit, and the all ones compare result is masked down to the bits of 1.0f
+__m256i byte = _mm256_set1_epi32((uint8_t) inputPackedBits[byteIndex]);
+__m256i bitIsSet = _mm256_cmpeq_epi32(_mm256_and_si256(byte, bitMasks), bitMasks);
+_mm256_storeu_ps(outputValues + byteIndex*8, _mm256_and_ps(_mm256_castsi256_ps(bitIsSet), ones));
+}
+
+return numberOfBytes*8;
+}
+
+/*
+This function unpacks bits into bytes, 32 bits at a time.
+@param inputPackedBits: The packed bits
+@param inputNumberOfBits: How many bits there are
+@param outputValues: Where to put the values
+@return: How many bits were unpacked (the rest are left for the scalar loop)
+*/
+__attribute__((target("avx2"))) static uint64_t unpackBitsToBytesAVX2(const char *inputPackedBits, uint64_t inputNumberOfBits, uint8_t *outputValues)
+{
+//Byte j of the output is tested against bit j % 8 of input byte j/8 (the shuffle works within each 16 byte half, which both hold all four input bytes)
+const __m256i spreadBytes = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+const __m256i bitMasks = _mm256_set1_epi64x(0x8040201008040201LL);
+const __m256i ones = _mm256_set1_epi8(1);
+
+uint64_t numberOfGroups = inputNumberOfBits/32;
+for(uint64_t groupIndex = 0; groupIndex < numberOfGroups; groupIndex++)
+{
+int32_t fourBytes;
+memcpy(&fourBytes, inputPackedBits + groupIndex*4, sizeof(fourBytes));
+
+__m256i bytes = _mm256_shuffle_epi8(_mm256_set1_epi32(fourBytes), spreadBytes);
+__m256i bitIsSet = _mm256_cmpeq_epi8(_mm256_and_si256(bytes, bitMasks), bitMasks);
+_mm256_storeu_si256((__m256i *) (outputValues + groupIndex*32), _mm256_and_si256(bitIsSet, ones));
+}
+
+return numberOfGroups*32;
+}
+
+/*
+This function packs floats into whole bytes of bits, 8 values at a time.
+@param inputValues: The values
+@param inputNumberOfBits: How many values there are
+@param outputPackedBits: Where to put the bytes
+@return: How many values were packed (the rest are left for the scalar loop)
+*/
+__attribute__((target("avx2"))) static uint64_t packBitsFromFloatsAVX2(const float *inputValues, uint64_t inputNumberOfBits, char *outputPackedBits)
+{
+const __m256 threshold = _mm256_set1_ps(0.5f);
+
+uint64_t numberOfBytes = inputNumberOfBits/8;
+for(uint64_t byteIndex = 0; byteIndex < numberOfBytes; byteIndex++)
+{
+__m256 values = _mm256_loadu_ps(inputValues + byteIndex*8);
+outputPackedBits[byteIndex] = (char) _mm256_movemask_ps(_mm256_cmp_ps(values, threshold, _CMP_GE_OQ));
+}
+
+return numberOfBytes*8;
+}
+
+/*
+This function packs bytes into bits, 32 values at a time.
+@param inputValues: The values
+@param inputNumberOfBits: How many values there are
+@param outputPackedBits: Where to put the bytes
+@return: How many values were packed (the rest are left for the scalar loop)
+*/
+__attribute__((target("avx2"))) static uint64_t packBitsFromBytesAVX2(const uint8_t *inputValues, uint64_t inputNumberOfBits, char *outputPackedBits)
+{
+const __m256i zero = _mm256_setzero_si256();
+
+uint64_t numberOfGroups = inputNumberOfBits/32;
+for(uint64_t groupIndex = 0; groupIndex < numberOfGroups; groupIndex++)
+{
+__m256i values = _mm256_loadu_si256((const __m256i *) (inputValues + groupIndex*32));
+uint32_t fourBytes = ~((uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(values, zero)));
+memcpy(outputPackedBits + groupIndex*4, &fourBytes, sizeof(fourBytes));
+}
+
+return numberOfGroups*32;
+}
+#endif
+
+#ifdef BIT_PACKING_HAS_SSE2
+/*
+This function unpacks whole bytes of bits into floats, 4 bits at a time.
+@param inputPackedBits: The packed bits
+@param inputNumberOfBits: How many bits there are
+@param outputValues: Where to put the values
+@return: How many bits were unpacked (the rest are left for the scalar loop)
+*/
+static uint64_t unpackBitsToFloatsSSE2(const char *inputPackedBits, uint64_t inputNumberOfBits, float *outputValues)
+{
+const __m128i lowBitMasks = _mm_setr_epi32(1, 2, 4, 8);
+const __m128i highBitMasks = _mm_setr_epi32(16, 32, 64, 128);
+const __m128 ones = _mm_set1_ps(1.0f);
+
+uint64_t numberOfBytes = inputNumberOfBits/8;
+for(uint64_t byteIndex = 0; byteIndex < numberOfBytes; byteIndex++)
+{
+__m128i byte = _mm_set1_epi32((uint8_t) inputPackedBits[byteIndex]);
+__m128i lowBitIsSet = _mm_cmpeq_epi32(_mm_and_si128(byte, lowBitMasks), lowBitMasks);
+__m128i highBitIsSet = _mm_cmpeq_epi32(_mm_and_si128(byte, highBitMasks), highBitMasks);
+_mm_storeu_ps(outputValues + byteIndex*8, _mm_and_ps(_mm_castsi128_ps(lowBitIsSet), ones));
+_mm_storeu_ps(outputValues + byteIndex*8 + 4, _mm_and_ps(_mm_castsi128_ps(highBitIsSet), ones));
+}
+
+return numberOfBytes*8;
+}
+
+/*
+This function unpacks bits into bytes, 16 bits at a time.
+@param inputPackedBits: The packed bits
+@param inputNumberOfBits: How many bits there are
+@param outputValues: Where to put the values
+@return: How many bits were unpacked (the rest are left for the scalar loop)
+*/
+static uint64_t unpackBitsToBytesSSE2(const char *inputPackedBits, uint64_t inputNumberOfBits, uint8_t *outputValues)
+{
+const __m128i bitMasks = _mm_set1_epi64x(0x8040201008040201LL);
+const __m128i ones = _mm_set1_epi8(1);
+
+uint64_t numberOfGroups = inputNumberOfBits/16;
+for(uint64_t groupIndex = 0; groupIndex < numberOfGroups; groupIndex++)
+{
+//SSE2 has no byte shuffle, so each input byte is copied across its half with a multiply
+uint64_t lowByte = (uint8_t) inputPackedBits[groupIndex*2];
+uint64_t highByte = (uint8_t) inputPackedBits[groupIndex*2 + 1];
+__m128i bytes = _mm_set_epi64x(highByte*0x0101010101010101ULL, lowByte*0x0101010101010101ULL);
+__m128i bitIsSet = _mm_cmpeq_epi8(_mm_and_si128(bytes, bitMasks), bitMasks);
+_mm_storeu_si128((__m128i *) (outputValues + groupIndex*16), _mm_and_si128(bitIsSet, ones));
+}
+
+return numberOfGroups*16;
+}
+
+/*
+This function packs floats into whole bytes of bits, 8 values at a time.
+@param inputValues: The values
+@param inputNumberOfBits: How many values there are
+@param outputPackedBits: Where to put the bytes
+@return: How many values were packed (the rest are left for the scalar loop)
+*/
+static uint64_t packBitsFromFloatsSSE2(const float *inputValues, uint64_t inputNumberOfBits, char *outputPackedBits)
+{
+const __m128 threshold = _mm_set1_ps(0.5f);
+
+uint64_t numberOfBytes = inputNumberOfBits/8;
+for(uint64_t byteIndex = 0; byteIndex < numberOfBytes; byteIndex++)
+{
+int lowBits = _mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(inputValues + byteIndex*8), threshold));
+int highBits = _mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(inputValues + byteIndex*8 + 4), threshold));
+outputPackedBits[byteIndex] = (char) (lowBits | (highBits << 4));
+}
+
+return numberOfBytes*8;
+}
+
+/*
+This function packs bytes into bits, 16 values at a time.
+@param inputValues: The values
+@param inputNumberOfBits: How many values there are
+@param outputPackedBits: Where to put the bytes
+@return: How many values were packed (the rest are left for the scalar loop)
+*/
+static uint64_t packBitsFromBytesSSE2(const uint8_t *inputValues, uint64_t inputNumberOfBits, char *outputPackedBits)
+{
+const __m128i zero = _mm_setzero_si128();
+
+uint64_t numberOfGroups = inputNumberOfBits/16;
+for(uint64_t groupIndex = 0; groupIndex < numberOfGroups; groupIndex++)
+{
+__m128i values = _mm_loadu_si128((const __m128i *) (inputValues + groupIndex*16));
+uint16_t twoBytes = ~((uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(values, zero)));
+memcpy(outputPackedBits + groupIndex*2, &twoBytes, sizeof(twoBytes));
+}
+
+return numberOfGroups*16;
+}
+#endif
+
+/*
+This function unpacks bits into floats (1.0 for a set bit, 0.0 otherwise), such as for a percept that is going to be used as a float tensor.
+@param inputPackedBits: The packed bits, which must hold at least (inputNumberOfBits + 7)/8 bytes
+@param inputNumberOfBits: How many bits to unpack (normally the size of the percept in bits)
+@param outputValues: Where to put the values, which must have room for inputNumberOfBits of them
+*/
+void unpackBitsToFloats(const char *inputPackedBits, uint64_t inputNumberOfBits, float *outputValues)
+{
+uint64_t bitIndex = 0;
+#ifdef BIT_PACKING_HAS_AVX2
+if(processorHasAVX2())
+{
+bitIndex = unpackBitsToFloatsAVX2(inputPackedBits, inputNumberOfBits, outputValues);
+}
+#endif
+#ifdef BIT_PACKING_HAS_SSE2
+if(bitIndex == 0)
+{
+bitIndex = unpackBitsToFloatsSSE2(inputPackedBits, inputNumberOfBits, outputValues);
+}
+#endif
+
+for(; bitIndex < inputNumberOfBits; bitIndex++)
+{
+outputValues[bitIndex] = ((inputPackedBits[bitIndex/8] >> (bitIndex % 8)) & 1) ? 1.0f : 0.0f;
+}
+}
+
+/*
+This function unpacks the bits of a percept into floats (1.0 for a set bit, 0.0 otherwise).
+@param inputPackedBits: The packed bits
+@param inputNumberOfBits: How many bits to unpack (normally the size of the percept in bits)
+@param outputValues: Where to put the values, which must have room for inputNumberOfBits of them
+@exceptions: This function can throw exceptions (if the string is too short to hold that many bits)
+*/
+void unpackBitsToFloats(const std::string &inputPackedBits, uint64_t inputNumberOfBits, float *outputValues)
+{
+if(inputPackedBits.size() < (inputNumberOfBits + 7)/8)
+{
+throw SOMException("Error, " + std::to_string(inputPackedBits.size()) + " bytes can't hold " + std::to_string(inputNumberOfBits) + " bits\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+unpackBitsToFloats(inputPackedBits.data(), inputNumberOfBits, outputValues);
+}
+
+/*
+This function unpacks bits into bytes (1 for a set bit, 0 otherwise).
+@param inputPackedBits: The packed bits, which must hold at least (inputNumberOfBits + 7)/8 bytes
+@param inputNumberOfBits: How many bits to unpack (normally the size of the percept in bits)
+@param outputValues: Where to put the values, which must have room for inputNumberOfBits of them
+*/
+void unpackBitsToBytes(const char *inputPackedBits, uint64_t inputNumberOfBits, uint8_t *outputValues)
+{
+uint64_t bitIndex = 0;
+#ifdef BIT_PACKING_HAS_AVX2
+if(processorHasAVX2())
+{
+bitIndex = unpackBitsToBytesAVX2(inputPackedBits, inputNumberOfBits, outputValues);
+}
+#endif
+#ifdef BIT_PACKING_HAS_SSE2
+//Also picks up a 16 bit group that the AVX2 loop left over
+bitIndex += unpackBitsToBytesSSE2(inputPackedBits + bitIndex/8, inputNumberOfBits - bitIndex, outputValues + bitIndex);
+#endif
+
+for(; bitIndex < inputNumberOfBits; bitIndex++)
+{
+outputValues[bitIndex] = (inputPackedBits[bitIndex/8] >> (bitIndex % 8)) & 1;
+}
+}
+
+/*
+This function unpacks the bits of a percept into bytes (1 for a set bit, 0 otherwise).
+@param inputPackedBits: The packed bits
+@param inputNumberOfBits: How many bits to unpack (normally the size of the percept in bits)
+@param outputValues: Where to put the values, which must have room for inputNumberOfBits of them
+@exceptions: This function can throw exceptions (if the string is too short to hold that many bits)
+*/
+void unpackBitsToBytes(const std::string &inputPackedBits, uint64_t inputNumberOfBits, uint8_t *outputValues)
+{
+if(inputPackedBits.size() < (inputNumberOfBits + 7)/8)
+{
+throw SOMException("Error, " + std::to_string(inputPackedBits.size()) + " bytes can't hold " + std::to_string(inputNumberOfBits) + " bits\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+unpackBitsToBytes(inputPackedBits.data(), inputNumberOfBits, outputValues);
+}
+
+/*
+This function packs floats into bits (set if the value is at least 0.5, so the outputs of a sigmoid can be passed straight in), such as to turn a model's output into an action.
+@param inputValues: One value per bit
+@param inputNumberOfBits: How many values there are (normally the size of the action in bits)
+@param outputPackedBits: The packed bits, resized to (inputNumberOfBits + 7)/8 bytes with the unused bits of the last byte cleared (the string's memory is reused, so passing the same string each step doesn't allocate)
+*/
+void packBitsFromFloats(const float *inputValues, uint64_t inputNumberOfBits, std::string &outputPackedBits)
+{
+outputPackedBits.assign((inputNumberOfBits + 7)/8, '\0');
+if(inputNumberOfBits == 0)
+{
+return;
+}
+char *packedBits = &outputPackedBits[0];
+
+uint64_t bitIndex = 0;
+#ifdef BIT_PACKING_HAS_AVX2
+if(processorHasAVX2())
+{
+bitIndex = packBitsFromFloatsAVX2(inputValues, inputNumberOfBits, packedBits);
+}
+#endif
+#ifdef BIT_PACKING_HAS_SSE2
+if(bitIndex == 0)
+{
+bitIndex = packBitsFromFloatsSSE2(inputValues, inputNumberOfBits, packedBits);
+}
+#endif
+
+for(; bitIndex < inputNumberOfBits; bitIndex++)
+{
+if(inputValues[bitIndex] >= 0.5f)
+{
+packedBits[bitIndex/8] |= (char) (1 << (bitIndex % 8));
+}
+}
+}
+
+/*
+This function packs bytes into bits (set if the byte isn't 0).
+@param inputValues: One value per bit
+@param inputNumberOfBits: How many values there are (normally the size of the action in bits)
+@param outputPackedBits: The packed bits, resized to (inputNumberOfBits + 7)/8 bytes with the unused bits of the last byte cleared (the string's memory is reused, so passing the same string each step doesn't allocate)
+*/
+void packBitsFromBytes(const uint8_t *inputValues, uint64_t inputNumberOfBits, std::string &outputPackedBits)
+{
+outputPackedBits.assign((inputNumberOfBits + 7)/8, '\0');
+if(inputNumberOfBits == 0)
+{
+return;
+}
+char *packedBits = &outputPackedBits[0];
+
+uint64_t bitIndex = 0;
+#ifdef BIT_PACKING_HAS_AVX2
+if(processorHasAVX2())
+{
+bitIndex = packBitsFromBytesAVX2(inputValues, inputNumberOfBits, packedBits);
+}
+#endif
+#ifdef BIT_PACKING_HAS_SSE2
+//Also picks up a 16 value group that the AVX2 loop left over
+bitIndex += packBitsFromBytesSSE2(inputValues + bitIndex, inputNumberOfBits - bitIndex, packedBits + bitIndex/8);
+#endif
+
+for(; bitIndex < inputNumberOfBits; bitIndex++)
+{
+if(inputValues[bitIndex] != 0)
+{
+packedBits[bitIndex/8] |= (char) (1 << (bitIndex % 8));
+}
+}
+}
+
+/*
+This function returns true if the functions above are using AVX2 on this processor (otherwise they use SSE2 or plain C++).
+@return: True if AVX2 is being used
+*/
+bool bitPackingUsesAVX2()
+{
+return processorHasAVX2();
+}
@@ -0,0 +1,71 @@
+#ifndef BITPACKINGHPP
+#define BITPACKINGHPP
+
+#include<cstdint>
+#include<string>
+
+#include "SOMException.hpp"
+
+/*
+These functions convert between the packed bits that percepts and actions are sent as and one value per bit, which is what neural network based AIs feed to (and get from) their models.  Bit i of a packed string is bit (i % 8) of byte i/8, counting from the least significant bit, so integers written in the host's (little endian) byte order keep their usual bit numbering.  The bulk of the work is done 32 (AVX2) or 16 (SSE2) bits at a time when the processor supports it, with the instruction set picked when the program runs, and a scalar loop for the rest.
+*/
+
+/*
+This function unpacks bits into floats (1.0 for a set bit, 0.0 otherwise), such as for a percept that is going to be used as a float tensor.
+@param inputPackedBits: The packed bits, which must hold at least (inputNumberOfBits + 7)/8 bytes
+@param inputNumberOfBits: How many bits to unpack (normally the size of the percept in bits)
+@param outputValues: Where to put the values, which must have room for inputNumberOfBits of them
+*/
+void unpackBitsToFloats(const char *inputPackedBits, uint64_t inputNumberOfBits, float *outputValues);
+
+/*
+This function unpacks the bits of a percept into floats (1.0 for a set bit, 0.0 otherwise).
+@param inputPackedBits: The packed bits
+@param inputNumberOfBits: How many bits to unpack (normally the size of the percept in bits)
+@param outputValues: Where to put the values, which must have room for inputNumberOfBits of them
+@exceptions: This function can throw exceptions (if the string is too short to hold that many bits)
+*/
+void unpackBitsToFloats(const std::string &inputPackedBits, uint64_t inputNumberOfBits, float *outputValues);
+
+/*
+This function unpacks bits into bytes (1 for a set bit, 0 otherwise).
+@param inputPackedBits: The packed bits, which must hold at least (inputNumberOfBits + 7)/8 bytes
+@param inputNumberOfBits: How many bits to unpack (normally the size of the percept in bits)
+@param outputValues: Where to put the values, which must have room for inputNumberOfBits of them
+*/
+void unpackBitsToBytes(const char *inputPackedBits, uint64_t inputNumberOfBits, uint8_t *outputValues);
+
+/*
+This function unpacks the bits of a percept into bytes (1 for a set bit, 0 otherwise).
+@param inputPackedBits: The packed bits
+@param inputNumberOfBits: How many bits to unpack (normally the size of the percept in bits)
+@param outputValues: Where to put the values, which must have room for inputNumberOfBits of them
+@exceptions: This function can throw exceptions (if the string is too short to hold that many bits)
+*/
+void unpackBitsToBytes(const std::string &inputPackedBits, uint64_t inputNumberOfBits, uint8_t *outputValues);
+
+/*
+This function packs floats into bits (set if the value is at least 0.5, so the outputs of a sigmoid can be passed straight in), such as to turn a model's output into an action.
+@param inputValues: One value per bit
+@param inputNumberOfBits: How many values there are (normally the size of the action in bits)
+@param outputPackedBits: The packed bits, resized to (inputNumberOfBits + 7)/8 bytes with the unused bits of the last byte cleared (the string's memory is reused, so passing the same string each step doesn't allocate)
+*/
+void packBitsFromFloats(const float *inputValues, uint64_t inputNumberOfBits, std::string &outputPackedBits);
+
+/*
+This function packs bytes into bits (set if the byte isn't 0).
+@param inputValues: One value per bit
+@param inputNumberOfBits: How many values there are (normally the size of the action in bits)
+@param outputPackedBits: The packed bits, resized to (inputNumberOfBits + 7)/8 bytes with the unused bits of the last byte cleared (the string's memory is reused, so passing the same string each step doesn't allocate)
+*/
+void packBitsFromBytes(const uint8_t *inputValues, uint64_t inputNumberOfBits, std::string &outputPackedBits);
+
+/*
+This function returns true if the functions above are using AVX2 on this processor (otherwise they use SSE2 or plain C++).
+@return: True if AVX2 is being used
+*/
+bool bitPackingUsesAVX2();
+
+
+
+#endif
@@ -0,0 +1,271 @@
+#include "deltaPerceptEncoding.hpp"
+
+#include<cstring>
+
+/*
+This function adds a varint (7 bits per byte, least significant first, like protobuf) to the end of a string.
+@param inputOutputString: The string to add to
+@param inputValue: The value to add
+*/
+static void appendVarint(std::string &inputOutputString, uint64_t inputValue)
+{
+while(inputValue >= 0x80)
+{
+inputOutputString.push_back((char) ((inputValue & 0x7f) | 0x80));
+inputValue >>= 7;
+}
+inputOutputString.push_back((char) inputValue);
+}
+
+/*
+This function reads a varint written by appendVarint.
+@param inputOutputPosition: Where the varint starts, which is moved past it
+@param inputEnd: The end of the buffer
+@param outputValue: The value
+@return: True if a valid varint was read
+*/
+static bool readVarint(const char *&inputOutputPosition, const char *inputEnd, uint64_t &outputValue)
+{
+outputValue = 0;
+for(int shift = 0; shift < 64 && inputOutputPosition < inputEnd; shift += 7)
+{
+uint8_t byte = (uint8_t) *(inputOutputPosition++);
+outputValue |= ((uint64_t) (byte & 0x7f)) << shift;
+if((byte & 0x80) == 0)
+{
+return true;
+}
+}
+
+return false;
+}
+
+/*
+This function finds the end of a run of bytes that are the same in the percept and the base, comparing 8 bytes at a time where it can.
+@param inputPercept: The percept bytes
+@param inputBase: The bytes to compare with (NULL compares with zeros)
+@param inputPosition: Where the run starts
+@param inputPerceptSize: The number of percept bytes
+@return: The position of the first byte that differs (inputPerceptSize if none do)
+*/
+static uint64_t findEndOfUnchangedBytes(const char *inputPercept, const char *inputBase, uint64_t inputPosition, uint64_t inputPerceptSize)
+{
+uint64_t position = inputPosition;
+
+//Most of a percept is usually unchanged, so skip it in blocks with memcmp (which is vectorized) first
+if(inputBase != NULL)
+{
+while(position + 256 <= inputPerceptSize && memcmp(inputPercept + position, inputBase + position, 256) == 0)
+{
+position += 256;
+}
+}
+
+for(; position + 8 <= inputPerceptSize; position += 8)
+{
+uint64_t perceptWord = 0;
+uint64_t baseWord = 0;
+memcpy(&perceptWord, inputPercept + position, sizeof(perceptWord));
+if(inputBase != NULL)
+{
+memcpy(&baseWord, inputBase + position, sizeof(baseWord));
+}
+if(perceptWord != baseWord)
+{
+break;
+}
+}
+
+for(; position < inputPerceptSize; position++)
+{
+if(inputPercept[position] != (inputBase != NULL ? inputBase[position] : 0))
+{
+break;
+}
+}
+
+return position;
+}
+
+/*
+This function finds the end of a run of bytes that differ between the percept and the base.
+@param inputPercept: The percept bytes
+@param inputBase: The bytes to compare with (NULL compares with zeros)
+@param inputPosition: Where the run starts
+@param inputPerceptSize: The number of percept bytes
+@return: The position of the first byte that is the same (inputPerceptSize if none are)
+*/
+static uint64_t findEndOfChangedBytes(const char *inputPercept, const char *inputBase, uint64_t inputPosition, uint64_t inputPerceptSize)
+{
+uint64_t position = inputPosition;
+for(; position < inputPerceptSize; position++)
+{
+if(inputPercept[position] == (inputBase != NULL ? inputBase[position] : 0))
+{
+break;
+}
+}
+
+return position;
+}
+
+/*
+This function encodes a percept as the spans of bytes that differ from the base.
+@param inputPercept: The percept bytes
+@param inputPerceptSize: The number of percept bytes
+@param inputBase: The bytes the spans are applied to (NULL for zeros)
+@param inputEncoding: The DELTA_ENCODED_PERCEPT_* value to start the encoded percept with
+@param outputEncodedPercept: The encoded percept
+@param inputMaximumSize: The encoding is abandoned once it gets to this size
+@return: True if the encoded percept is smaller than inputMaximumSize
+*/
+static bool encodeChangedSpans(const char *inputPercept, uint64_t inputPerceptSize, const char *inputBase, uint8_t inputEncoding, std::string &outputEncodedPercept, uint64_t inputMaximumSize)
+{
+outputEncodedPercept.clear();
+outputEncodedPercept.push_back((char) inputEncoding);
+appendVarint(outputEncodedPercept, inputPerceptSize);
+
+uint64_t position = 0;
+while(true)
+{
+uint64_t unchangedStart = position;
+position = findEndOfUnchangedBytes(inputPercept, inputBase, position, inputPerceptSize);
+if(position == inputPerceptSize)
+{
+break; //The rest is unchanged, which doesn't need to be sent
+}
+
+//Short runs of unchanged bytes are folded into the span, since starting a new span would cost as much as sending them
+uint64_t changedStart = position;
+while(true)
+{
+position = findEndOfChangedBytes(inputPercept, inputBase, position, inputPerceptSize);
+uint64_t unchangedEnd = findEndOfUnchangedBytes(inputPercept, inputBase, position, inputPerceptSize);
+if(unchangedEnd == inputPerceptSize || unchangedEnd - position >= DELTA_PERCEPT_ENCODING_MINIMUM_UNCHANGED_RUN)
+{
+break;
+}
+position = unchangedEnd;
+}
+
+uint64_t changedSize = position - changedStart;
+if(outputEncodedPercept.size() + changedSize + 20 >= inputMaximumSize)
+{
+return false; //The two varints take at most 20 bytes
+}
+
+appendVarint(outputEncodedPercept, changedStart - unchangedStart);
+appendVarint(outputEncodedPercept, changedSize);
+outputEncodedPercept.append(inputPercept + changedStart, changedSize);
+}
+
+return outputEncodedPercept.size() < inputMaximumSize;
+}
+
+/*
+This function encodes a percept against the previous one, picking whichever of the encodings is smallest, and makes the percept the new previous one.
+@param inputPercept: The percept bytes
+@param inputPerceptSize: The number of percept bytes
+@param inputOutputPreviousPercept: The previous percept sent to the AI (empty if there wasn't one), which is changed to the new percept
+@param outputEncodedPercept: The encoded percept (the string's memory is reused, so passing the same string each step doesn't allocate)
+*/
+void encodeDeltaPercept(const char *inputPercept, uint64_t inputPerceptSize, std::string &inputOutputPreviousPercept, std::string &outputEncodedPercept)
+{
+//Percepts that change size (or the first one) are encoded against zeros instead
+bool previousPerceptUsable = inputPerceptSize > 0 && inputOutputPreviousPercept.size() == inputPerceptSize;
+uint64_t rawSize = inputPerceptSize + 1;
+
+if(previousPerceptUsable && encodeChangedSpans(inputPercept, inputPerceptSize, inputOutputPreviousPercept.data(), DELTA_ENCODED_PERCEPT_CHANGES, outputEncodedPercept, rawSize))
+{
+//Only the changed bytes need to be copied to bring the previous percept up to date
+decodeDeltaPercept(outputEncodedPercept.data(), outputEncodedPercept.size(), inputOutputPreviousPercept, inputPerceptSize);
+return;
+}
+
+if(!previousPerceptUsable && inputPerceptSize > 0 && encodeChangedSpans(inputPercept, inputPerceptSize, NULL, DELTA_ENCODED_PERCEPT_NONZERO, outputEncodedPercept, rawSize))
+{
+inputOutputPreviousPercept.assign(inputPercept, inputPerceptSize);
+return;
+}
+
+outputEncodedPercept.clear();
+outputEncodedPercept.push_back((char) DELTA_ENCODED_PERCEPT_RAW);
+outputEncodedPercept.append(inputPercept, inputPerceptSize);
+inputOutputPreviousPercept.assign(inputPercept, inputPerceptSize);
+}
+
+/*
+This function decodes a percept in place, so only the bytes that changed are written.
+@param inputEncodedPercept: The encoded percept
+@param inputEncodedPerceptSize: The number of encoded bytes
+@param inputOutputPercept: The previous percept received from the game (empty if there wasn't one), which is changed to the decoded percept
+@param inputMaximumPerceptSize: The largest percept (in bytes) to accept, so a corrupt size can't make the percept huge
+@return: True if the encoded percept was valid (the percept is left in an unknown state otherwise)
+*/
+bool decodeDeltaPercept(const char *inputEncodedPercept, uint64_t inputEncodedPerceptSize, std::string &inputOutputPercept, uint64_t inputMaximumPerceptSize)
+{
+if(inputEncodedPerceptSize == 0)
+{
+return false;
+}
+
+const char *position = inputEncodedPercept + 1;
+const char *end = inputEncodedPercept + inputEncodedPerceptSize;
+uint8_t encoding = (uint8_t) inputEncodedPercept[0];
+if(encoding == DELTA_ENCODED_PERCEPT_RAW)
+{
+if((uint64_t) (end - position) > inputMaximumPerceptSize)
+{
+return false;
+}
+
+inputOutputPercept.assign(position, end - position);
+return true;
+}
+
+uint64_t perceptSize = 0;
+if(!readVarint(position, end, perceptSize) || perceptSize > inputMaximumPerceptSize)
+{
+return false;
+}
+
+if(encoding == DELTA_ENCODED_PERCEPT_CHANGES)
+{
+if(inputOutputPercept.size() != perceptSize)
+{
+return false; //Not against the percept we have
+}
+}
+else if(encoding == DELTA_ENCODED_PERCEPT_NONZERO)
+{
+inputOutputPercept.assign(perceptSize, '\0');
+}
+else
+{
+return false;
+}
+
+uint64_t perceptPosition = 0;
+while(position < end)
+{
+uint64_t unchangedSize = 0;
+uint64_t changedSize = 0;
+if(!readVarint(position, end, unchangedSize) || !readVarint(position, end, changedSize))
+{
+return false;
+}
+
+//Checked one at a time so corrupt sizes can't overflow
+if(unchangedSize > perceptSize - perceptPosition || changedSize > perceptSize - perceptPosition - unchangedSize || changedSize > (uint64_t) (end - position))
+{
+return false;
+}
+
+perceptPosition += unchangedSize;
+memcpy(&inputOutputPercept[perceptPosition], position, changedSize);
+perceptPosition += changedSize;
+position += changedSize;
+}
+
+return true;
+}
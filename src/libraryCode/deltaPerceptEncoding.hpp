@@ -0,0 +1,43 @@
+#ifndef DELTAPERCEPTENCODINGHPP
+#define DELTAPERCEPTENCODINGHPP
+
+#include<cstdint>
+#include<string>
+
+#include "SOMException.hpp"
+
+/*
+With DELTA_PERCEPT_ENCODING (which the game asks for in its HELLO message and only uses if the AI agrees in its READY message), the percept bytes of each percept message are replaced by an encoded percept, which works with either wire format.  Since successive percepts of most games only differ in a few bytes, most percepts are sent as just the bytes that changed since the previous percept.  The game only sends a percept once the previous one has been answered (or, with an action deadline, missed, in which case the AI still gets and decodes every percept in order), so the AI always has the percept the changes are against.  That relies on every percept arriving, so games can't ask for it with a transport that can drop messages (PUB_SUB_TRANSPORT).
+
+An encoded percept starts with one of the DELTA_ENCODED_PERCEPT_* values (as a byte).  For DELTA_ENCODED_PERCEPT_RAW, the rest of it is the percept bytes.  Otherwise, it is followed by the size of the percept (as a varint) and then any number of spans, each of which is the number of bytes to leave as they are (a varint), the number of bytes that changed (a varint) and the changed bytes.  Bytes after the last span are left as they are.  For DELTA_ENCODED_PERCEPT_CHANGES, the spans are applied to the previous percept (which must be the same size), and for DELTA_ENCODED_PERCEPT_NONZERO they are applied to a percept of zeros (which is how the first percept is sent, so runs of zeros in it aren't sent).  This is the same as run length encoding the runs of zeros in the XOR of the percept with the previous one (or with zeros), but the changed bytes can just be copied into place.
+*/
+
+#define DELTA_ENCODED_PERCEPT_RAW 0
+#define DELTA_ENCODED_PERCEPT_CHANGES 1
+#define DELTA_ENCODED_PERCEPT_NONZERO 2
+
+//How many unchanged bytes in a row end a span (shorter runs are sent as changed bytes, since a new span takes at least two bytes to start)
+#define DELTA_PERCEPT_ENCODING_MINIMUM_UNCHANGED_RUN 8
+
+/*
+This function encodes a percept against the previous one, picking whichever of the encodings is smallest, and makes the percept the new previous one.
+@param inputPercept: The percept bytes
+@param inputPerceptSize: The number of percept bytes
+@param inputOutputPreviousPercept: The previous percept sent to the AI (empty if there wasn't one), which is changed to the new percept
+@param outputEncodedPercept: The encoded percept (the string's memory is reused, so passing the same string each step doesn't allocate)
+*/
+void encodeDeltaPercept(const char *inputPercept, uint64_t inputPerceptSize, std::string &inputOutputPreviousPercept, std::string &outputEncodedPercept);
+
+/*
+This function decodes a percept in place, so only the bytes that changed are written.
+@param inputEncodedPercept: The encoded percept
+@param inputEncodedPerceptSize: The number of encoded bytes
+@param inputOutputPercept: The previous percept received from the game (empty if there wasn't one), which is changed to the decoded percept
+@param inputMaximumPerceptSize: The largest percept (in bytes) to accept, so a corrupt size can't make the percept huge
+@return: True if the encoded percept was valid (the percept is left in an unknown state otherwise)
+*/
+bool decodeDeltaPercept(const char *inputEncodedPercept, uint64_t inputEncodedPerceptSize, std::string &inputOutputPercept, uint64_t inputMaximumPerceptSize);
+
+
+
+#endif
@@ -0,0 +1,168 @@
+#include "fixedLayoutWireFormat.hpp"
+
+#include<cstring>
+
+/*
+This function returns true if this host can use the fixed layout wire format (which is sent in little endian byte order).
+@return: True if the host is little endian
+*/
+bool hostSupportsFixedLayoutWireFormat()
+{
+uint32_t testValue = 1;
+unsigned char firstByte = 0;
+memcpy(&firstByte, &testValue, 1);
+return firstByte == 1;
+}
+
+/*
+This function returns true if the given message is in the fixed layout format rather than a protobuf message.
+@param inputMessage: The received message
+@param inputMessageSize: The size of the message
+@return: True if the message starts with a 0 byte
+*/
+bool isFixedLayoutMessage(const char *inputMessage, uint64_t inputMessageSize)
+{
+return inputMessageSize > 0 && inputMessage[0] == 0;
+}
+
+/*
+This function writes a percept in the fixed layout format straight into the transport's outgoing buffer and sends it.
+@param inputTransport: The transport to send with
+@param inputHeader: The header to send (magic and perceptSize are filled in)
+@param inputPercept: The percept bytes
+@param inputPerceptSize: The number of percept bytes
+@param inputTimeoutInMilliseconds: How long to wait for the message to be sent (-1 waits forever, 0 doesn't wait)
+@return: True if the message was sent, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+bool sendFixedLayoutPercept(messageTransport &inputTransport, fixedLayoutPerceptHeader inputHeader, const char *inputPercept, uint64_t inputPerceptSize, int inputTimeoutInMilliseconds)
+{
+inputHeader.magic = FIXED_LAYOUT_PERCEPT_MAGIC;
+inputHeader.perceptSize = inputPerceptSize;
+
+stepInstrumentation *instrumentation = inputTransport.getInstrumentation();
+uint64_t startTime = instrumentation != NULL ? stepInstrumentation::getTime() : 0;
+
+char *messageBuffer = NULL;
+SOM_TRY
+messageBuffer = inputTransport.reserveMessage(sizeof(inputHeader) + inputPerceptSize, inputTimeoutInMilliseconds);
+SOM_CATCH("Error reserving space for percept\n")
+
+if(messageBuffer == NULL)
+{
+return false;
+}
+
+uint64_t serializeStartTime = instrumentation != NULL ? stepInstrumentation::getTime() : 0;
+memcpy(messageBuffer, &inputHeader, sizeof(inputHeader));
+memcpy(messageBuffer + sizeof(inputHeader), inputPercept, inputPerceptSize);
+uint64_t serializeEndTime = instrumentation != NULL ? stepInstrumentation::getTime() : 0;
+
+bool messageSent = false;
+SOM_TRY
+messageSent = inputTransport.commitMessage();
+SOM_CATCH("Error sending percept\n")
+
+if(instrumentation != NULL)
+{
+instrumentation->recordSerializeTime(serializeEndTime - serializeStartTime);
+instrumentation->recordSendTime((serializeStartTime - startTime) + (stepInstrumentation::getTime() - serializeEndTime));
+if(messageSent)
+{
+instrumentation->countSentMessage(sizeof(inputHeader) + inputPerceptSize);
+}
+}
+
+return messageSent;
+}
+
+/*
+This function checks a received fixed layout percept and gets its header.
+@param inputMessage: The received message
+@param inputMessageSize: The size of the message
+@param outputHeader: The header of the message (the percept bytes start at inputMessage + sizeof(fixedLayoutPerceptHeader))
+@return: True if the message is a valid fixed layout percept
+*/
+bool readFixedLayoutPercept(const char *inputMessage, uint64_t inputMessageSize, fixedLayoutPerceptHeader &outputHeader)
+{
+if(inputMessageSize < sizeof(outputHeader))
+{
+return false;
+}
+
+memcpy(&outputHeader, inputMessage, sizeof(outputHeader)); //Fixed size, so this is just a few loads (and doesn't assume the message is aligned)
+
+return outputHeader.magic == FIXED_LAYOUT_PERCEPT_MAGIC && outputHeader.perceptSize == inputMessageSize - sizeof(outputHeader) && gameState_IsValid(outputHeader.gameState);
+}
+
+/*
+This function writes an action in the fixed layout format straight into the transport's outgoing buffer and sends it.
+@param inputTransport: The transport to send with
+@param inputAction: The action bytes
+@param inputActionSize: The number of action bytes
+@param inputFlags: The FIXED_LAYOUT_ACTION_* bits to send
+@param inputTimeoutInMilliseconds: How long to wait for the message to be sent (-1 waits forever, 0 doesn't wait)
+@return: True if the message was sent, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+bool sendFixedLayoutAction(messageTransport &inputTransport, const char *inputAction, uint64_t inputActionSize, uint32_t inputFlags, int inputTimeoutInMilliseconds)
+{
+fixedLayoutActionHeader header;
+header.magic = FIXED_LAYOUT_ACTION_MAGIC;
+header.flags = inputFlags;
+header.actionSize = inputActionSize;
+
+stepInstrumentation *instrumentation = inputTransport.getInstrumentation();
+uint64_t startTime = instrumentation != NULL ? stepInstrumentation::getTime() : 0;
+
+char *messageBuffer = NULL;
+SOM_TRY
+messageBuffer = inputTransport.reserveMessage(sizeof(header) + inputActionSize, inputTimeoutInMilliseconds);
+SOM_CATCH("Error reserving space for action\n")
+
+if(messageBuffer == NULL)
+{
+return false;
+}
+
+uint64_t serializeStartTime = instrumentation != NULL ? stepInstrumentation::getTime() : 0;
+memcpy(messageBuffer, &header, sizeof(header));
+memcpy(messageBuffer + sizeof(header), inputAction, inputActionSize);
+uint64_t serializeEndTime = instrumentation != NULL ? stepInstrumentation::getTime() : 0;
+
+bool messageSent = false;
+SOM_TRY
+messageSent = inputTransport.commitMessage();
+SOM_CATCH("Error sending action\n")
+
+if(instrumentation != NULL)
+{
+instrumentation->recordSerializeTime(serializeEndTime - serializeStartTime);
+instrumentation->recordSendTime((serializeStartTime - startTime) + (stepInstrumentation::getTime() - serializeEndTime));
+if(messageSent)
+{
+instrumentation->countSentMessage(sizeof(header) + inputActionSize);
+}
+}
+
+return messageSent;
+}
+
+/*
+This function checks a received fixed layout action and gets its header.
+@param inputMessage: The received message
+@param inputMessageSize: The size of the message
+@param outputHeader: The header of the message (the action bytes start at inputMessage + sizeof(fixedLayoutActionHeader))
+@return: True if the message is a valid fixed layout action
+*/
+bool readFixedLayoutAction(const char *inputMessage, uint64_t inputMessageSize, fixedLayoutActionHeader &outputHeader)
+{
+if(inputMessageSize < sizeof(outputHeader))
+{
+return false;
+}
+
+memcpy(&outputHeader, inputMessage, sizeof(outputHeader)); //Fixed size, so this is just a few loads (and doesn't assume the message is aligned)
+
+return outputHeader.magic == FIXED_LAYOUT_ACTION_MAGIC && outputHeader.actionSize == inputMessageSize - sizeof(outputHeader);
+}
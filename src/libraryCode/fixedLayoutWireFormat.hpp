@@ -0,0 +1,108 @@
+#ifndef FIXEDLAYOUTWIREFORMATHPP
+#define FIXEDLAYOUTWIREFORMATHPP
+
+#include<cstdint>
+
+#include "SOMException.hpp"
+#include "messageTransport.hpp"
+#include "perceptOrActionMessage.pb.h"
+
+/*
+The fixed layout wire format is an alternative to sending each step as a perceptOrActionMessage.  Each percept or action is a fixed size header (in the byte order of the hosts, so it is only used between little endian hosts) followed directly by the raw percept or action bytes, so the receiver can check the header and use the bytes in place without parsing anything.  The game asks for it in its HELLO message and only switches to it if the AI agrees in its READY message (and follows AIARENA_PROTOCOL_VERSION 2 or later, so it has the session description), so protobuf stays the default and AIs that don't support it keep working.  Handshake messages are always protobuf messages.
+
+The first byte of both headers is 0, which can't start a protobuf message (it would be a tag for field 0), so the two kinds of message can be told apart.
+*/
+
+#define FIXED_LAYOUT_PERCEPT_MAGIC 0x50414900U //"\0IAP" in memory
+#define FIXED_LAYOUT_ACTION_MAGIC 0x41414900U //"\0IAA" in memory
+
+//Bits in fixedLayoutActionHeader::flags
+#define FIXED_LAYOUT_ACTION_RESET_GAME 1U
+#define FIXED_LAYOUT_ACTION_TERMINATE_GAME_SESSION 2U
+
+/*
+The header in front of each percept.  The percept and action sizes aren't repeated here since the game sends them once in the session description during the handshake.
+*/
+struct fixedLayoutPerceptHeader
+{
+uint32_t magic; //FIXED_LAYOUT_PERCEPT_MAGIC
+uint32_t gameState; //A gameState value
+uint64_t sequenceNumber;
+uint64_t reward;
+uint64_t perceptSize; //Number of percept bytes following the header
+};
+
+/*
+The header in front of each action.
+*/
+struct fixedLayoutActionHeader
+{
+uint32_t magic; //FIXED_LAYOUT_ACTION_MAGIC
+uint32_t flags; //FIXED_LAYOUT_ACTION_* bits
+uint64_t actionSize; //Number of action bytes following the header
+};
+
+static_assert(sizeof(fixedLayoutPerceptHeader) == 32, "Fixed layout percept header must not contain padding");
+static_assert(sizeof(fixedLayoutActionHeader) == 16, "Fixed layout action header must not contain padding");
+
+/*
+This function returns true if this host can use the fixed layout wire format (which is sent in little endian byte order).
+@return: True if the host is little endian
+*/
+bool hostSupportsFixedLayoutWireFormat();
+
+/*
+This function returns true if the given message is in the fixed layout format rather than a protobuf message.
+@param inputMessage: The received message
+@param inputMessageSize: The size of the message
+@return: True if the message starts with a 0 byte
+*/
+bool isFixedLayoutMessage(const char *inputMessage, uint64_t inputMessageSize);
+
+/*
+This function writes a percept in the fixed layout format straight into the transport's outgoing buffer and sends it.
+@param inputTransport: The transport to send with
+@param inputHeader: The header to send (magic and perceptSize are filled in)
+@param inputPercept: The percept bytes
+@param inputPerceptSize: The number of percept bytes
+@param inputTimeoutInMilliseconds: How long to wait for the message to be sent (-1 waits forever, 0 doesn't wait)
+@return: True if the message was sent, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+bool sendFixedLayoutPercept(messageTransport &inputTransport, fixedLayoutPerceptHeader inputHeader, const char *inputPercept, uint64_t inputPerceptSize, int inputTimeoutInMilliseconds);
+
+/*
+This function checks a received fixed layout percept and gets its header.
+@param inputMessage: The received message
+@param inputMessageSize: The size of the message
+@param outputHeader: The header of the message (the percept bytes start at inputMessage + sizeof(fixedLayoutPerceptHeader))
+@return: True if the message is a valid fixed layout percept
+*/
+bool readFixedLayoutPercept(const char *inputMessage, uint64_t inputMessageSize, fixedLayoutPerceptHeader &outputHeader);
+
+/*
+This function writes an action in the fixed layout format straight into the transport's outgoing buffer and sends it.
+@param inputTransport: The transport to send with
+@param inputAction: The action bytes
+@param inputActionSize: The number of action bytes
+@param inputFlags: The FIXED_LAYOUT_ACTION_* bits to send
+@param inputTimeoutInMilliseconds: How long to wait for the message to be sent (-1 waits forever, 0 doesn't wait)
+@return: True if the message was sent, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+bool sendFixedLayoutAction(messageTransport &inputTransport, const char *inputAction, uint64_t inputActionSize, uint32_t inputFlags, int inputTimeoutInMilliseconds);
+
+/*
+This function checks a received fixed layout action and gets its header.
+@param inputMessage: The received message
+@param inputMessageSize: The size of the message
+@param outputHeader: The header of the message (the action bytes start at inputMessage + sizeof(fixedLayoutActionHeader))
+@return: True if the message is a valid fixed layout action
+*/
+bool readFixedLayoutAction(const char *inputMessage, uint64_t inputMessageSize, fixedLayoutActionHeader &outputHeader);
+
+
+
+
+
+#endif
@@ -1,242 +1,1418 @@
 #include "gameEngineCommunicationInterface.hpp"
 
+#include<cstdio>
+#include<cstdlib>
+
 /*
 This function establishes the connections used to run the game interaction.
 @param inputSizeOfAIPerceptionInBits:  The number of bits (starting at offset 0) that the agent should use (since the data is spaced out to the nearest byte)
 @param inputSizeOfExpectedActionsInBits: The number of action bits that the game will accept from the agent (future versions may at some point allow this to change dynamically, but most AI architectures would have trouble supporting that).
 @param inputActionTimeoutInterval:  The number of milliseconds that the game will wait before throwing an exception (it defaults to infinite wait)
+@param inputTransportType: How to connect to the AI (the AI must use the same transport)
+@param inputConnectionTimeoutInterval: The number of milliseconds that the game will wait for the AI to answer the connection handshake (started by the first percept) before throwing an exception (negative values wait forever)
 @exceptions: This function can throw exceptions (especially if starting the connection to the AI times out)
 */
-gameEngineCommunicationInterface::gameEngineCommunicationInterface(uint64_t inputSizeOfAIPerceptionsInBits, uint64_t inputSizeOfExpectedActionsInBits, int inputActionTimeoutInterval)
+gameEngineCommunicationInterface::gameEngineCommunicationInterface(uint64_t inputSizeOfAIPerceptionsInBits, uint64_t inputSizeOfExpectedActionsInBits, int inputActionTimeoutInterval, transportType inputTransportType, int inputConnectionTimeoutInterval)
 {
-//Remember size of AI perceptions in bits and size of expected actions in bits
-sizeOfAIPerceptionsInBits = inputSizeOfAIPerceptionsInBits;
-sizeOfExpectedActionsInBits = inputSizeOfExpectedActionsInBits;
-sizeOfExpectedActionsInBytes = ((sizeOfExpectedActionsInBits+7)/8);
-perceptionSequenceCounter = 0;
-currentGameState = GAME_START;
-aiWantsToRestartGameFlag = false;
-aiWantsToEndSessionFlag = false;
-
 SOM_TRY
 context.reset(new zmq::context_t);
 SOM_CATCH("Error initializing ZMQ context\n")
 
-//Initialize sockets associated with this object
 SOM_TRY
-perceptionsPublishingSocket.reset(new zmq::socket_t(*context, ZMQ_PUB));
-SOM_CATCH("Error initializing perceptions publishing socket\n")
+initialize(*context, getDefaultGameEndpoint(inputTransportType), getDefaultAIEndpoint(inputTransportType), inputSizeOfAIPerceptionsInBits, inputSizeOfExpectedActionsInBits, inputActionTimeoutInterval, inputTransportType, inputConnectionTimeoutInterval);
+SOM_CATCH("Error initializing game engine communication interface\n")
+}
+
+/*
+This function establishes the connections used to run the game interaction using an existing ZMQ context and the given endpoint (such as "inproc://myGame" to run the game and the AI as threads sharing the context, or "ipc:///tmp/myGame").  The context must outlive this object.
+@param inputContext: The ZMQ context to create the sockets with
+@param inputGameEndpoint: The endpoint that the game binds to (and that the AI must connect to)
+@param inputSizeOfAIPerceptionInBits:  The number of bits (starting at offset 0) that the agent should use (since the data is spaced out to the nearest byte)
+@param inputSizeOfExpectedActionsInBits: The number of action bits that the game will accept from the agent
+@param inputActionTimeoutInterval:  The number of milliseconds that the game will wait before throwing an exception (it defaults to infinite wait)
+@param inputTransportType: How to connect to the AI (the AI must use the same transport)
+@param inputConnectionTimeoutInterval: The number of milliseconds that the game will wait for the AI to answer the connection handshake (started by the first percept) before throwing an exception (negative values wait forever)
+@param inputAIEndpoint: The endpoint that the AI binds to, which is only used (and required) by transports with a connection in each direction such as PUB_SUB_TRANSPORT
+@exceptions: This function can throw exceptions
+*/
+gameEngineCommunicationInterface::gameEngineCommunicationInterface(zmq::context_t &inputContext, const std::string &inputGameEndpoint, uint64_t inputSizeOfAIPerceptionsInBits, uint64_t inputSizeOfExpectedActionsInBits, int inputActionTimeoutInterval, transportType inputTransportType, int inputConnectionTimeoutInterval, const std::string &inputAIEndpoint)
+{
+SOM_TRY
+initialize(inputContext, inputGameEndpoint, inputAIEndpoint, inputSizeOfAIPerceptionsInBits, inputSizeOfExpectedActionsInBits, inputActionTimeoutInterval, inputTransportType, inputConnectionTimeoutInterval);
+SOM_CATCH("Error initializing game engine communication interface\n")
+}
 
-//Now bind the socket
+/*
+This function sends what the game decides the AI sees after its actions or initial starting state.  The class takes care of all of the details associated with sending AI perceptions and getting back the AI's actions.
+@param inputAIPerceptions: The data to send to the agent for it to act on (must have more bits than the sizeOfExpectedActionsInBits.
+@param inputReward: The reward that the game decides the AI is entitled to
+@return: The actions submitted by the AI for the next round of the game
+@exceptions: This function can throw some exceptions (especially if the connection to the other side times out or the AI chooses to terminate the game session).
+*/
+const std::string &gameEngineCommunicationInterface::sendPerceptionsAndGetActions(const std::string &inputAIPerceptions, uint64_t inputReward, bool inputEndGame)
+{
 SOM_TRY
-perceptionsPublishingSocket->bind(("tcp://127.0.0.1:" + std::to_string(GAMEPORT)).c_str());
-SOM_CATCH("Error binding socket\n")
+return sendPerceptionBytesAndGetActions(inputAIPerceptions.c_str(), inputAIPerceptions.size(), inputReward, inputEndGame);
+SOM_CATCH("Error running step\n")
+}
+
+/*
+This function does the same as sendPerceptionsAndGetActions, but takes the percept as a pointer and size so that percepts that aren't in a std::string (such as ones read from a memory mapped trajectory file) don't have to be copied into one first.
+@param inputAIPerceptions: The percept bytes
+@param inputAIPerceptionsSize: The number of percept bytes
+@param inputReward: The reward that the game decides the AI is entitled to
+@param inputEndGame: True if this is the last percept in the AI's current game and the next percept will correspond to a new game
+@return: The actions submitted by the AI (the reference stays valid until the next call)
+@exceptions: This function can throw some exceptions (especially if the connection to the other side times out)
+*/
+const std::string &gameEngineCommunicationInterface::sendPerceptionBytesAndGetActions(const char *inputAIPerceptions, uint64_t inputAIPerceptionsSize, uint64_t inputReward, bool inputEndGame)
+{
+gameState perceptGameState = getNextPerceptGameState(inputEndGame);
 
+//Make sure the AI is listening before the first percept is sent
+if(!connectedToAI)
+{
 SOM_TRY
-actionReceptionSocket.reset(new zmq::socket_t(*context, ZMQ_SUB));
-SOM_CATCH("Error initializing actions subscription socket\n")
+waitForAIToConnect();
+SOM_CATCH("Error connecting to the AI\n")
+}
 
+bool perceptSent = false;
 SOM_TRY
-actionReceptionSocket->connect(("tcp://localhost:" + std::to_string(AIPORT)).c_str());
-SOM_CATCH("Error connecting to action publisher\n")
+perceptSent = sendPercept(inputAIPerceptions, inputAIPerceptionsSize, inputReward, perceptGameState);
+SOM_CATCH("Error sending percept\n")
+
+//A percept that couldn't be sent before its deadline misses the step straight away
+if(!perceptSent)
+{
+useActionForMissedDeadline();
+}
+
+while(perceptSent)
+{
+//Wait for the reply, waking up to send heartbeats if reconnection is on
+int waitTime = getTimeUntilActionCheck();
 
+bool replyReceived = false;
 SOM_TRY
-actionReceptionSocket->setsockopt(ZMQ_SUBSCRIBE, "", 0);
-SOM_CATCH("Error setting filter for actions subscription\n")
+replyReceived = getNextMessage(waitTime);
+SOM_CATCH("Error getting reply\n")
+
+if(!replyReceived)
+{
+if(actionTimeoutInterval >= 0 && std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - stepStartTime).count() >= actionTimeoutInterval)
+{
+throw SOMException("Error, action message timed out\n", TIME_OUT, __FILE__, __LINE__);
+}
 
-if(inputActionTimeoutInterval >= 0)
+if(actionDeadline >= 0 && std::chrono::steady_clock::now() >= actionDeadlineTime)
 {
+useActionForMissedDeadline();
+break;
+}
+
 SOM_TRY
-actionReceptionSocket->setsockopt(ZMQ_RCVTIMEO, &inputActionTimeoutInterval, sizeof(inputActionTimeoutInterval));
-SOM_CATCH("Error setting timeout interval for action reception socket\n")
+sendHeartbeatIfDue();
+SOM_CATCH("Error sending heartbeat\n")
+continue;
 }
 
+bool messageContainedAction = false;
+SOM_TRY
+messageContainedAction = readReceivedAction();
+SOM_CATCH("Error getting action from message\n")
+
+if(messageContainedAction)
+{
+break;
+}
+
+//Extra READY messages can arrive if some of the HELLO messages were answered after the handshake finished, so they are skipped (unless they are from a restarted AI, which readReceivedAction deals with)
+}
+
+recordFinishedStep(inputReward, inputEndGame);
+
+return currentAction;
 }
 
 /*
-This function sends what the game decides the AI sees after its actions or initial starting state.  The class takes care of all of the details associated with sending AI perceptions and getting back the AI's actions.
-@param inputAIPerceptions: The data to send to the agent for it to act on (must have more bits than the sizeOfExpectedActionsInBits.
+This function sends a percept without waiting for the AI's answer, so that one thread can run many games by polling each of them with tryGetActions (which must return true before the next percept is sent).  If the AI hasn't connected yet, the handshake is started and the percept is sent once it finishes.
+@param inputAIPerceptions: The data to send to the agent for it to act on
 @param inputReward: The reward that the game decides the AI is entitled to
-@return: The actions submitted by the AI for the next round of the game
-@exceptions: This function can throw some exceptions (especially if the connection to the other side times out or the AI chooses to terminate the game session).
+@param inputEndGame: True if this is the last percept in the AI's current game and the next percept will correspond to a new game
+@exceptions: This function can throw exceptions (if the last step hasn't finished)
 */
-std::string gameEngineCommunicationInterface::sendPerceptionsAndGetActions(const std::string &inputAIPerceptions, uint64_t inputReward, bool inputEndGame)
+void gameEngineCommunicationInterface::sendPerceptions(const std::string &inputAIPerceptions, uint64_t inputReward, bool inputEndGame)
+{
+if(stepInProgress)
+{
+throw SOMException("Error, the action for the last percept hasn't been received yet\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+pendingPerceptGameState = getNextPerceptGameState(inputEndGame);
+pendingReward = inputReward;
+pendingEndGame = inputEndGame;
+stepInProgress = true;
+
+if(!connectedToAI)
 {
-//Create serialized version of the perception
-perceptOrActionMessage percept;
+//Keep the percept until the AI answers the handshake
+stepStartTime = std::chrono::steady_clock::now();
+pendingPercept.assign(inputAIPerceptions);
+buildHelloMessage();
+helloSent = false;
+helloResendInterval = 1;
+return;
+}
 
-percept.set_size_of_percept_in_bits(sizeOfAIPerceptionsInBits);
-percept.set_size_of_expected_action(sizeOfExpectedActionsInBits);
-percept.set_percept(inputAIPerceptions);
-percept.set_reward(inputReward);
-percept.set_sequence_number(perceptionSequenceCounter);
+bool perceptSent = false;
+SOM_TRY
+perceptSent = sendPercept(inputAIPerceptions.c_str(), inputAIPerceptions.size(), pendingReward, pendingPerceptGameState);
+SOM_CATCH("Error sending percept\n")
 
-percept.set_game_state(currentGameState);
+//A percept that couldn't be sent before its deadline misses the step, which tryGetActions finishes
+if(!perceptSent)
+{
+useActionForMissedDeadline();
+}
+}
 
-if(currentGameState == GAME_START)  //Set the game state for the next percept
+/*
+This function checks (without waiting) whether the AI has answered the percept given to sendPerceptions, continuing the connection handshake first if needed.  Once it returns true, getActions returns the AI's actions (or the ones the game used if the AI missed the action deadline) and AIWantsToRestartGame/AIWantsToEndSession reflect them.
+@return: True if the actions have arrived, false if the AI hasn't answered yet
+@exceptions: This function can throw exceptions (a TIME_OUT exception if the connection or action timeout has passed)
+*/
+bool gameEngineCommunicationInterface::tryGetActions()
 {
-currentGameState = GAME_CONTINUE;
+if(!stepInProgress)
+{
+throw SOMException("Error, no percept has been sent\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
 }
 
-//If the game has end, set this percept to GAME_OVER and make the next GAME_START
-if(inputEndGame) 
+if(!connectedToAI)
 {
-percept.set_game_state(GAME_OVER);
-currentGameState = GAME_START;
-aiWantsToRestartGameFlag = false;
+bool connected = false;
+SOM_TRY
+connected = pollForAIToConnect();
+SOM_CATCH("Error connecting to the AI\n")
+
+if(!connected)
+{
+return false;
 }
 
-//Serialize
-std::string serializedPercept;
-percept.SerializeToString(&serializedPercept);
+bool perceptSent = false;
+SOM_TRY
+perceptSent = sendPercept(pendingPercept.c_str(), pendingPercept.size(), pendingReward, pendingPerceptGameState);
+SOM_CATCH("Error sending percept\n")
+
+if(!perceptSent)
+{
+useActionForMissedDeadline();
+}
+}
 
-//Check if this is the initial perception, so it can be sent multiple times until the AI on the other side picks up
-if(perceptionSequenceCounter == 0)
+if(!currentPerceptSent)
 {
-std::string replyMessage;
+stepInProgress = false;
+recordFinishedStep(pendingReward, pendingEndGame);
+return true;
+}
 
-for(int i=0; i<100; i++) //Publish the initial perception 100 times before giving up
+while(true)
 {
-//Send percept and try to get reply
+bool messageReceived = false;
 SOM_TRY
-replyMessage = sendMessageAndGetBackResponse(serializedPercept, false);
-SOM_CATCH("Error sending percept/getting reply\n")
+messageReceived = getNextMessage(0);
+SOM_CATCH("Error getting reply\n")
 
-if(replyMessage.size() == 0)
+if(!messageReceived)
 {
-sleep(1); //Delay 1 second before sending the percept again (TODO: decrease delay duration)
-continue; //Message timed out, so try again
+break;
 }
 
+bool messageContainedAction = false;
 SOM_TRY
-updateValuesFromMessage(replyMessage);
+messageContainedAction = readReceivedAction();
 SOM_CATCH("Error getting action from message\n")
-perceptionSequenceCounter++;
-return currentAction;
+
+if(messageContainedAction)
+{
+stepInProgress = false;
+recordFinishedStep(pendingReward, pendingEndGame);
+return true;
+}
 }
 
-//Never got an action, so the other side probably had a problem
-throw SOMException("Error, action message is invalid\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
+if(actionTimeoutInterval >= 0 && std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - stepStartTime).count() >= actionTimeoutInterval)
+{
+throw SOMException("Error, action message timed out\n", TIME_OUT, __FILE__, __LINE__);
 }
 
-std::string replyMessage;
+if(actionDeadline >= 0 && std::chrono::steady_clock::now() >= actionDeadlineTime)
+{
+useActionForMissedDeadline();
+stepInProgress = false;
+recordFinishedStep(pendingReward, pendingEndGame);
+return true;
+}
 
-//Send percept and try to get reply
 SOM_TRY
-replyMessage = sendMessageAndGetBackResponse(serializedPercept);
-SOM_CATCH("Error sending percept/getting reply\n")
+sendHeartbeatIfDue();
+SOM_CATCH("Error sending heartbeat\n")
+
+return false;
+}
+
+/*
+This function returns the actions the AI sent in answer to the last percept.
+@return: The actions (the reference stays valid until the next percept is sent)
+*/
+const std::string &gameEngineCommunicationInterface::getActions()
+{
+return currentAction;
+}
 
-if(replyMessage.size() == 0)
+/*
+This function fills in a zmq_poll item that becomes readable when a message from the AI arrives, so that one thread can wait on many sessions at once (see sessionPoller).
+@param outputPollItem: The poll item
+@return: False if the transport can't be polled (such as SHARED_MEMORY_TRANSPORT), in which case isMessageWaiting has to be checked instead
+*/
+bool gameEngineCommunicationInterface::getPollItem(zmq_pollitem_t &outputPollItem)
 {
-throw SOMException("Error, action message timed out\n", TIME_OUT, __FILE__, __LINE__);
+return transport->getPollItem(outputPollItem);
+}
+
+/*
+This function returns a file descriptor that becomes readable when a message from the AI arrives, for event loops built on select/poll/epoll.  For the ZMQ transports this is ZMQ_FD, which is edge triggered, so tryGetActions has to be called until it returns false (or isMessageWaiting checked) before waiting on the descriptor again.
+@return: The file descriptor (-1 if the transport doesn't have one)
+@exceptions: This function can throw exceptions
+*/
+int gameEngineCommunicationInterface::getFileDescriptor()
+{
+SOM_TRY
+return transport->getFileDescriptor();
+SOM_CATCH("Error checking transport\n")
 }
 
+/*
+This function checks, without waiting or receiving anything, whether a message from the AI may have arrived.
+@return: True if a message may be waiting
+@exceptions: This function can throw exceptions
+*/
+bool gameEngineCommunicationInterface::isMessageWaiting()
+{
 SOM_TRY
-updateValuesFromMessage(replyMessage);
-SOM_CATCH("Error getting action from message\n")
+return transport->isMessageWaiting();
+SOM_CATCH("Error checking transport\n")
+}
 
-perceptionSequenceCounter++;
-return currentAction;
+/*
+This function returns how long the game can wait for a message from the AI before tryGetActions has to be called anyway, such as to resend the connection handshake, to send a heartbeat or to notice that the action timeout or deadline has passed.
+@return: The number of milliseconds (-1 if tryGetActions only needs to be called once a message arrives)
+*/
+int gameEngineCommunicationInterface::getTimeUntilNextPoll()
+{
+if(!stepInProgress)
+{
+return -1;
+}
+
+if(connectedToAI)
+{
+return getTimeUntilActionCheck();
+}
+
+std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+int64_t timeUntilNextPoll = -1;
+if(connectionTimeoutInterval >= 0)
+{
+timeUntilNextPoll = std::max<int64_t>(connectionTimeoutInterval - std::chrono::duration_cast<std::chrono::milliseconds>(now - stepStartTime).count(), 0);
+}
+
+if(!helloSent || transport->canDropMessages())
+{
+int64_t timeUntilHello = helloSent ? std::max<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(nextHelloTime - now).count() + 1, 0) : 0; //Rounded up so that the resend is due by then
+timeUntilNextPoll = timeUntilNextPoll < 0 ? timeUntilHello : std::min(timeUntilNextPoll, timeUntilHello);
+}
+
+return (int) timeUntilNextPoll;
+}
+
+/*
+This function returns how long the game can wait for the AI's action before it has to check whether the action timeout or deadline has passed or send a heartbeat.
+@return: The number of milliseconds (-1 if it can wait until the action arrives)
+*/
+int gameEngineCommunicationInterface::getTimeUntilActionCheck()
+{
+std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+int64_t timeUntilCheck = -1;
+if(actionTimeoutInterval >= 0)
+{
+timeUntilCheck = std::max<int64_t>(actionTimeoutInterval - std::chrono::duration_cast<std::chrono::milliseconds>(now - stepStartTime).count(), 0);
+}
+
+if(actionDeadline >= 0)
+{
+int64_t timeUntilDeadline = std::max<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(actionDeadlineTime - now).count() + 1, 0); //Rounded up so that the deadline has passed by then
+timeUntilCheck = timeUntilCheck < 0 ? timeUntilDeadline : std::min(timeUntilCheck, timeUntilDeadline);
+}
+
+if(heartbeatInterval >= 0)
+{
+int64_t timeUntilHeartbeat = std::max<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(nextHeartbeatTime - now).count() + 1, 0); //Rounded up so that the heartbeat is due by then
+timeUntilCheck = timeUntilCheck < 0 ? timeUntilHeartbeat : std::min(timeUntilCheck, timeUntilHeartbeat);
+}
+
+return (int) timeUntilCheck;
+}
+
+/*
+This function works out the game state to send with the next percept and the state the percept after it will have.
+@param inputEndGame: True if the percept ends the current game
+@return: The game state for the percept
+*/
+gameState gameEngineCommunicationInterface::getNextPerceptGameState(bool inputEndGame)
+{
+gameState perceptGameState = currentGameState;
+
+if(currentGameState == GAME_START)  //Set the game state for the next percept
+{
+currentGameState = GAME_CONTINUE;
 }
 
+//If the game has end, set this percept to GAME_OVER and make the next GAME_START
+if(inputEndGame) 
+{
+perceptGameState = GAME_OVER;
+currentGameState = GAME_START;
+aiWantsToRestartGameFlag = false;
+}
 
+return perceptGameState;
+}
 
 /*
-This function publishes the given message on the perceptionsPublishingSocket and then tries to recieve a message from actionReceptionSocket.
-@param inputMessage: The message to send
-@param inputBlock: True if the function should block until the recv function times out
-@return: The message received from actionReceptionSocket (or zero length on timeout)
+This function sends a percept to the AI in whichever wire format was agreed on.  With an action deadline, the percept has to be accepted for sending before the deadline passes, so an AI that has stopped reading (leaving the transport full) costs the game the step rather than blocking it.
+@param inputPercept: The percept bytes
+@param inputPerceptSize: The number of percept bytes
+@param inputReward: The reward to send with the percept
+@param inputGameState: The game state to send with the percept
+@return: False if the deadline passed before the percept could be sent (so the step has been missed)
 @exceptions: This function can throw exceptions
 */
-std::string gameEngineCommunicationInterface::sendMessageAndGetBackResponse(const std::string &inputMessage, bool inputBlock)
+bool gameEngineCommunicationInterface::sendPercept(const char *inputPercept, uint64_t inputPerceptSize, uint64_t inputReward, gameState inputGameState)
+{
+if(recorder != NULL)
 {
-//Send message
 SOM_TRY
-perceptionsPublishingSocket->send(inputMessage.c_str(), inputMessage.size());
-SOM_CATCH("Error sending message\n")
+recorder->beginStep(perceptionSequenceCounter, inputGameState, inputReward, inputPercept, inputPerceptSize);
+SOM_CATCH("Error recording percept\n")
+}
+
+if(heartbeatInterval >= 0)
+{
+lastPercept.assign(inputPercept, inputPerceptSize);
+lastPerceptReward = inputReward;
+lastPerceptGameState = inputGameState;
+}
 
-//Allocate a buffer for the reply message
-std::unique_ptr<zmq::message_t> messageBuffer;
+//The time taken to send the percept comes out of the step's deadline
+std::chrono::steady_clock::time_point sendStartTime = std::chrono::steady_clock::now();
 SOM_TRY
-messageBuffer.reset(new zmq::message_t);  //This can throw a zmq::error_t
-SOM_CATCH("Error constructing ZMQ message buffer\n")
+currentPerceptSent = sendPerceptMessage(inputPercept, inputPerceptSize, inputReward, inputGameState, actionDeadline);
+SOM_CATCH("Error sending percept\n")
+
+if(!currentPerceptSent)
+{
+return false;
+}
+
+//The action timeout counts from the oldest percept the AI hasn't answered, which is this one unless the AI has fallen behind by missing deadlines (and the heartbeats keep going while it is behind, since it may have been restarted)
+std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+if(numberOfUnansweredPercepts == 0)
+{
+stepStartTime = now;
+nextHeartbeatTime = now + std::chrono::milliseconds(std::max(heartbeatInterval, 0));
+}
+numberOfUnansweredPercepts++;
+lastActionMissedDeadline = false;
+
+if(actionDeadline >= 0)
+{
+actionDeadlineTime = sendStartTime + std::chrono::milliseconds(actionDeadline);
+}
+return true;
+}
+
+/*
+This function does the sending for sendPercept, without recording the percept or keeping it for reconnection (so it is also used to resend the percept to a restarted AI).
+@param inputPercept: The percept bytes
+@param inputPerceptSize: The number of percept bytes
+@param inputReward: The reward to send with the percept
+@param inputGameState: The game state to send with the percept
+@param inputTimeoutInMilliseconds: How long to wait for the percept to be accepted for sending (-1 waits forever)
+@return: False if the percept couldn't be sent in time
+@exceptions: This function can throw exceptions
+*/
+bool gameEngineCommunicationInterface::sendPerceptMessage(const char *inputPercept, uint64_t inputPerceptSize, uint64_t inputReward, gameState inputGameState, int inputTimeoutInMilliseconds)
+{
+//The percept is replaced by its encoding from here on (the recording keeps the percept itself)
+if(usingDeltaPerceptEncoding)
+{
+if(inputPerceptSize > (sizeOfAIPerceptionsInBits + 7)/8)
+{
+throw SOMException("Error, delta encoded percepts can't be longer than the percept size\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
 
+encodeDeltaPercept(inputPercept, inputPerceptSize, previousPercept, encodedPercept);
+inputPercept = encodedPercept.data();
+inputPerceptSize = encodedPercept.size();
+}
 
-//Receive reply
-int flags = 0;
-if(!inputBlock)
+if(usingFixedLayoutWireFormat)
 {
-flags = ZMQ_DONTWAIT;  //Set nonblocking if we are not suppose to wait
+fixedLayoutPerceptHeader header;
+header.gameState = inputGameState;
+header.sequenceNumber = perceptionSequenceCounter;
+header.reward = inputReward;
+
+bool perceptSent = false;
+SOM_TRY
+perceptSent = sendFixedLayoutPercept(*transport, header, inputPercept, inputPerceptSize, inputTimeoutInMilliseconds);
+SOM_CATCH("Error sending percept\n")
+
+return finishSendingPercept(perceptSent);
 }
 
+//Fill in the reused percept message (the size fields are only set, once, if the AI needs them in every percept)
+outgoingPerceptMessage.mutable_percept()->assign(inputPercept, inputPerceptSize);
+outgoingPerceptMessage.set_reward(inputReward);
+outgoingPerceptMessage.set_sequence_number(perceptionSequenceCounter);
+outgoingPerceptMessage.set_game_state(inputGameState);
+
+bool perceptSent = false;
 SOM_TRY
-if(actionReceptionSocket->recv(messageBuffer.get(), flags) == false)
+perceptSent = transport->sendProtobufMessage(outgoingPerceptMessage, inputTimeoutInMilliseconds);
+SOM_CATCH("Error sending percept\n")
+
+return finishSendingPercept(perceptSent);
+}
+
+/*
+This function does what sendPerceptMessage needs to once a percept has been sent (or has failed to be).
+@param inputPerceptSent: True if the percept was sent
+@return: inputPerceptSent
+*/
+bool gameEngineCommunicationInterface::finishSendingPercept(bool inputPerceptSent)
 {
-return std::string();
+//The AI never got the percept, so the next one can't be encoded against it
+if(!inputPerceptSent)
+{
+previousPercept.clear();
+return false;
 }
-SOM_CATCH("Error receiving the reply message\n")
 
-return std::string((const char *) messageBuffer->data(), messageBuffer->size());
+if(instrumentation != NULL)
+{
+perceptSentTime = stepInstrumentation::getTime();
+}
+return true;
 }
 
 /*
-This function deserializes the action message and updates the cached action values from it.
-@param inputMessage: The message to extract the action bytes from
-@exceptions: This function can throw exceptions, especially if the message in invalid
+This function finishes the current step without the AI's action once the action deadline has passed, using the action picked by the missed deadline policy.
 */
-void gameEngineCommunicationInterface::updateValuesFromMessage(const std::string &inputMessage)
+void gameEngineCommunicationInterface::useActionForMissedDeadline()
 {
-perceptOrActionMessage deserializedActionMessage;
-deserializedActionMessage.ParseFromString(inputMessage);
-if(!deserializedActionMessage.IsInitialized())
+//Late actions from earlier steps have been kept in currentAction, so the last one the AI sent is already there to repeat
+if(deadlinePolicy == DEFAULT_ACTION_ON_MISSED_DEADLINE || currentAction.size() < sizeOfExpectedActionsInBytes)
 {
-//Message can't be read, so throw an exception
-throw SOMException("Error, action message is invalid\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
+currentAction.assign(defaultAction);
 }
 
-if(!deserializedActionMessage.has_action())
+currentActionFlags = TRAJECTORY_ACTION_MISSED_DEADLINE;
+lastActionMissedDeadline = true;
+numberOfMissedDeadlines++;
+
+//The AI may have been restarted, and a new one picks the session up at the next percept, so it can't be encoded against this one
+if(heartbeatInterval >= 0)
 {
-//Message can't be read, so throw an exception
-throw SOMException("Error, action message is invalid\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
+previousPercept.clear();
 }
 
-currentAction = deserializedActionMessage.action();
-if(currentAction.size() < sizeOfExpectedActionsInBytes)
+if(instrumentation != NULL)
 {
-//Message can't be read, so throw an exception
-throw SOMException("Error, action message is invalid\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
+instrumentation->countMissedDeadline();
+}
 }
 
-//TODO: Need to refactor this function and have it cache values
-//Check if the agent wants to reset the game
-if(deserializedActionMessage.has_game_state())
+/*
+This function updates the sequence number and the session totals once the AI has answered a percept (or missed the deadline for it, or it couldn't be sent).
+@param inputReward: The reward that was sent with the percept
+@param inputEndGame: True if the percept ended a game
+*/
+void gameEngineCommunicationInterface::recordFinishedStep(uint64_t inputReward, bool inputEndGame)
 {
-aiWantsToRestartGameFlag = true;
+if(recorder != NULL)
+{
+recorder->finishStep(currentAction.c_str(), currentAction.size(), currentActionFlags);
 }
 
-if(deserializedActionMessage.has_terminate_game_session())
+//A percept that was never sent leaves its sequence number to the next one, so the AI doesn't see a gap
+if(currentPerceptSent)
 {
-aiWantsToEndSessionFlag = deserializedActionMessage.terminate_game_session();
+perceptionSequenceCounter++;
+}
+totalReward += inputReward;
+numberOfRoundsPlayed++;
+if(inputEndGame)
+{
+numberOfGamesFinished++;
 }
 
+if(instrumentation != NULL)
+{
+instrumentation->countStep();
+}
 }
 
+
+
 /*
-This function returns true if the AI has decided it would like to prematurely abort this game (with it being clear to all observers that it did) and start a new one.
-@return: True if the AI has indicated a desire to start a new game prematurely
+This function starts sending a percept and waiting for the AI's answer on a background I/O thread, so that the game can get on with other work (such as rendering or logging) while the AI decides what to do.  awaitAction must be called before the next percept is submitted, and the other functions of the interface must not be used in between.
+@param inputAIPerceptions: The data to send to the agent for it to act on (copied, so the string can be changed as soon as this returns)
+@param inputReward: The reward that the game decides the AI is entitled to
+@param inputEndGame: True if this is the last percept in the AI's current game and the next percept will correspond to a new game
+@exceptions: This function can throw exceptions (if the last percept's action hasn't been collected with awaitAction)
 */
-bool gameEngineCommunicationInterface::AIWantsToRestartGame()
+void gameEngineCommunicationInterface::submitPercept(const std::string &inputAIPerceptions, uint64_t inputReward, bool inputEndGame)
 {
-return aiWantsToRestartGameFlag;
+if(perceptSubmitted)
+{
+throw SOMException("Error, the action for the last percept hasn't been collected with awaitAction\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+pendingPercept.assign(inputAIPerceptions); //Reuses the buffer
+pendingReward = inputReward;
+pendingEndGame = inputEndGame;
+
+SOM_TRY
+asyncWorker.start([this]() { sendPerceptionsAndGetActions(pendingPercept, pendingReward, pendingEndGame); });
+SOM_CATCH("Error starting step\n")
+perceptSubmitted = true;
 }
 
 /*
-This function returns true if the AI has indicated that it would like the game engine to shut down (terminating the process).
-@return: True if the AI has indicated a desire to start a new game prematurely
+This function waits for the AI's answer to the percept given to submitPercept.  Once it returns, AIWantsToRestartGame and AIWantsToEndSession reflect the new action.
+@return: The actions submitted by the AI (the reference stays valid until the next percept is sent)
+@exceptions: This function can throw exceptions (anything sendPerceptionsAndGetActions could throw, or if no percept was submitted)
 */
-bool gameEngineCommunicationInterface::AIWantsToEndSession()
+const std::string &gameEngineCommunicationInterface::awaitAction()
 {
-return aiWantsToEndSessionFlag;
+if(!perceptSubmitted)
+{
+throw SOMException("Error, no percept has been submitted\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+perceptSubmitted = false;
+
+SOM_TRY
+asyncWorker.wait();
+SOM_CATCH("Error getting action\n")
+
+return currentAction;
 }
 
+/*
+This function waits for the next message from the AI, which is left in the transport (getReceivedMessageData/getReceivedMessageSize).  On the I/O thread the wait is cut into short pieces (returning false early, which the callers treat like any other timeout and wait again), so a step abandoned by the destructor gives up instead of waiting forever.
+@param inputTimeoutInMilliseconds: How long to wait for the message (-1 waits forever, 0 doesn't wait)
+@return: True if a message was received, false on timeout
+@exceptions: This function can throw exceptions (if the step has been abandoned)
+*/
+bool gameEngineCommunicationInterface::getNextMessage(int inputTimeoutInMilliseconds)
+{
+bool messageReceived = false;
+SOM_TRY
+messageReceived = transport->receiveMessage(asyncWorker.limitWaitTime(inputTimeoutInMilliseconds));
+SOM_CATCH("Error receiving message\n")
+
+if(!messageReceived && asyncWorker.isAbandoned())
+{
+throw SOMException("Error, the step was abandoned\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+return messageReceived;
+}
+
+/*
+This function sends HELLO messages to the AI until it answers with READY, so that both directions of the connection are known to work before the first percept is sent.  HELLO is only resent if the transport can drop messages, with the interval between resends growing from 1 millisecond so that a quick AI is picked up within a few milliseconds.
+@exceptions: This function can throw exceptions (a TIME_OUT exception if the AI doesn't answer within the connection timeout)
+*/
+void gameEngineCommunicationInterface::waitForAIToConnect()
+{
+buildHelloMessage();
+
+std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+int resendInterval = 1;
+bool helloMessageSent = false;
+
+while(true)
+{
+//Work out how much of the connection timeout is left
+int timeRemaining = -1;
+if(connectionTimeoutInterval >= 0)
+{
+int timeElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+timeRemaining = std::max(connectionTimeoutInterval - timeElapsed, 0);
+}
+
+if(!helloMessageSent || transport->canDropMessages())
+{
+if(helloMessageSent && instrumentation != NULL)
+{
+instrumentation->countHandshakeRetry();
+}
+
+SOM_TRY
+helloMessageSent = transport->sendProtobufMessage(helloMessage, asyncWorker.limitWaitTime(timeRemaining));
+SOM_CATCH("Error sending HELLO message\n")
+
+if(!helloMessageSent && asyncWorker.isAbandoned())
+{
+throw SOMException("Error, the step was abandoned\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+}
+
+int waitTime = timeRemaining;
+if(transport->canDropMessages() && (waitTime < 0 || waitTime > resendInterval))
+{
+waitTime = resendInterval;
+resendInterval = std::min(resendInterval*2, 100);
+}
+
+if(helloMessageSent)
+{
+bool replyReceived = false;
+SOM_TRY
+replyReceived = getNextMessage(waitTime);
+SOM_CATCH("Error waiting for READY message\n")
+
+if(replyReceived && readReadyMessage(transport->getReceivedMessageData(), transport->getReceivedMessageSize()))
+{
+return;
+}
+}
+
+if(timeRemaining == 0)
+{
+throw SOMException("Error, AI did not answer the connection handshake\n", TIME_OUT, __FILE__, __LINE__);
+}
+}
+}
+
+/*
+This function does one round of the connection handshake without waiting: it sends (or resends, at the same growing intervals as waitForAIToConnect) the HELLO message and checks for the AI's READY.  The connection timeout is counted from when sendPerceptions started the step.
+@return: True if the AI has answered the handshake
+@exceptions: This function can throw exceptions (a TIME_OUT exception if the AI doesn't answer within the connection timeout)
+*/
+bool gameEngineCommunicationInterface::pollForAIToConnect()
+{
+std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+if(!helloSent || (transport->canDropMessages() && now >= nextHelloTime))
+{
+if(helloSent && instrumentation != NULL)
+{
+instrumentation->countHandshakeRetry();
+}
+
+bool messageSent = false;
+SOM_TRY
+messageSent = transport->sendProtobufMessage(helloMessage, 0);
+SOM_CATCH("Error sending HELLO message\n")
+
+helloSent = helloSent || messageSent;
+nextHelloTime = now + std::chrono::milliseconds(helloResendInterval);
+helloResendInterval = std::min(helloResendInterval*2, 100);
+}
+
+while(helloSent)
+{
+bool replyReceived = false;
+SOM_TRY
+replyReceived = getNextMessage(0);
+SOM_CATCH("Error waiting for READY message\n")
+
+if(!replyReceived)
+{
+break;
+}
+
+if(readReadyMessage(transport->getReceivedMessageData(), transport->getReceivedMessageSize()))
+{
+return true;
+}
+}
+
+if(connectionTimeoutInterval >= 0 && std::chrono::duration_cast<std::chrono::milliseconds>(now - stepStartTime).count() >= connectionTimeoutInterval)
+{
+throw SOMException("Error, AI did not answer the connection handshake\n", TIME_OUT, __FILE__, __LINE__);
+}
+
+return false;
+}
+
+/*
+This function fills in the HELLO message with the session description, the preferred wire format, the preferred percept encoding and where the session is up to (the sequence number of the next percept and the game's instance ID).
+*/
+void gameEngineCommunicationInterface::buildHelloMessage()
+{
+helloMessage.Clear();
+helloMessage.set_handshake(HELLO);
+helloMessage.set_protocol_version(AIARENA_PROTOCOL_VERSION);
+helloMessage.set_sequence_number(perceptionSequenceCounter);
+helloMessage.set_instance_id(instanceID);
+
+sessionDescription &description = *helloMessage.mutable_session_description();
+description.set_size_of_percept_in_bits(sizeOfAIPerceptionsInBits);
+description.set_size_of_expected_action(sizeOfExpectedActionsInBits);
+description.set_game_name(gameName);
+description.set_reward_description(rewardDescription);
+
+if(preferredWireFormat == FIXED_LAYOUT_WIRE_FORMAT && hostSupportsFixedLayoutWireFormat())
+{
+helloMessage.set_wire_format(FIXED_LAYOUT_WIRE_FORMAT);
+}
+
+if(preferredPerceptEncoding == DELTA_PERCEPT_ENCODING)
+{
+helloMessage.set_percept_encoding(DELTA_PERCEPT_ENCODING);
+}
+}
+
+/*
+This function checks if a message from the AI is the READY answer to the HELLO message and, if it is, finishes the handshake (picking the wire format, the percept encoding and whether percepts carry the sizes).
+@param inputMessage: The serialized message
+@param inputMessageSize: The size of the serialized message
+@return: True if the message was READY
+*/
+bool gameEngineCommunicationInterface::readReadyMessage(const char *inputMessage, uint64_t inputMessageSize)
+{
+perceptOrActionMessage deserializedReplyMessage;
+if(!deserializedReplyMessage.ParseFromArray(inputMessage, inputMessageSize) || !deserializedReplyMessage.has_handshake() || deserializedReplyMessage.handshake() != READY)
+{
+return false;
+}
+
+//AIs that only follow version 1 of the protocol don't look at the session description, so they still need the sizes in every percept
+AIProtocolVersion = deserializedReplyMessage.protocol_version();
+if(AIProtocolVersion < 2)
+{
+outgoingPerceptMessage.set_size_of_percept_in_bits(sizeOfAIPerceptionsInBits);
+outgoingPerceptMessage.set_size_of_expected_action(sizeOfExpectedActionsInBits);
+}
+
+//Only switch formats if the AI agreed to the one we asked for (the fixed layout headers leave out the sizes, so it also needs the session description)
+usingFixedLayoutWireFormat = helloMessage.has_wire_format() && AIProtocolVersion >= 2 && deserializedReplyMessage.has_wire_format() && deserializedReplyMessage.wire_format() == FIXED_LAYOUT_WIRE_FORMAT;
+//The first encoded percept isn't against anything
+usingDeltaPerceptEncoding = helloMessage.has_percept_encoding() && deserializedReplyMessage.has_percept_encoding() && deserializedReplyMessage.percept_encoding() == DELTA_PERCEPT_ENCODING;
+previousPercept.clear();
+AIInstanceID = deserializedReplyMessage.instance_id();
+
+connectedToAI = true;
+return true;
+}
+
+/*
+This function deserializes the action message (into a message object that is reused from step to step, so its buffers don't need to be reallocated) and updates the cached action values from it.
+@param inputMessage: The serialized message to extract the action bytes from
+@param inputMessageSize: The size of the serialized message
+@return: True if the message held an action, false if it was a leftover handshake message (which is ignored)
+@exceptions: This function can throw exceptions, especially if the message in invalid
+*/
+bool gameEngineCommunicationInterface::updateValuesFromMessage(const char *inputMessage, uint64_t inputMessageSize)
+{
+if(usingFixedLayoutWireFormat && isFixedLayoutMessage(inputMessage, inputMessageSize))
+{
+fixedLayoutActionHeader header;
+if(!readFixedLayoutAction(inputMessage, inputMessageSize, header) || header.actionSize < sizeOfExpectedActionsInBytes)
+{
+//Message can't be read, so throw an exception
+throw SOMException("Error, action message is invalid\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
+}
+
+currentAction.assign(inputMessage + sizeof(header), header.actionSize); //Reuses the action buffer
+currentActionFlags = header.flags & (TRAJECTORY_ACTION_RESET_GAME | TRAJECTORY_ACTION_TERMINATE_GAME_SESSION); //The bits are the same
+
+if((header.flags & FIXED_LAYOUT_ACTION_RESET_GAME) != 0)
+{
+aiWantsToRestartGameFlag = true;
+}
+
+//Like terminate_game_session in a protobuf action, each action says whether the AI wants the session to end
+aiWantsToEndSessionFlag = (header.flags & FIXED_LAYOUT_ACTION_TERMINATE_GAME_SESSION) != 0;
+
+return true;
+}
+
+perceptOrActionMessage &deserializedActionMessage = incomingActionMessage;
+if(!deserializedActionMessage.ParseFromArray(inputMessage, inputMessageSize) || !deserializedActionMessage.IsInitialized())
+{
+//Message can't be read, so throw an exception
+throw SOMException("Error, action message is invalid\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
+}
+
+if(deserializedActionMessage.has_handshake())
+{
+return false;
+}
+
+if(!deserializedActionMessage.has_action())
+{
+//Message can't be read, so throw an exception
+throw SOMException("Error, action message is invalid\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
+}
+
+currentAction.assign(deserializedActionMessage.action()); //Reuses the action buffer
+if(currentAction.size() < sizeOfExpectedActionsInBytes)
+{
+//Message can't be read, so throw an exception
+throw SOMException("Error, action message is invalid\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
+}
+
+//TODO: Need to refactor this function and have it cache values
+//Check if the agent wants to reset the game
+currentActionFlags = 0;
+if(deserializedActionMessage.has_game_state())
+{
+aiWantsToRestartGameFlag = true;
+currentActionFlags |= TRAJECTORY_ACTION_RESET_GAME;
+}
+
+if(deserializedActionMessage.has_terminate_game_session())
+{
+aiWantsToEndSessionFlag = deserializedActionMessage.terminate_game_session();
+if(aiWantsToEndSessionFlag)
+{
+currentActionFlags |= TRAJECTORY_ACTION_TERMINATE_GAME_SESSION;
+}
+}
+
+return true;
+}
+
+/*
+This function reads the action from the message left in the transport (with updateValuesFromMessage), recording the time the AI took to answer and the time taken to parse its message if instrumentation is on.  When the game polls with tryGetActions, the time the AI took includes however long the game took to poll again.  A handshake message from a restarted AI is handed to resumeWithRestartedAI.
+@return: True if the message held an action, false if it was a handshake message (which is ignored unless it came from a restarted AI)
+@exceptions: This function can throw exceptions, especially if the message in invalid
+*/
+bool gameEngineCommunicationInterface::readReceivedAction()
+{
+uint64_t parseStartTime = 0;
+if(instrumentation != NULL)
+{
+parseStartTime = stepInstrumentation::getTime();
+instrumentation->countReceivedMessage(transport->getReceivedMessageSize());
+}
+
+//A late action mustn't change what the AI has asked for in the current step
+bool previousRestartGameFlag = aiWantsToRestartGameFlag;
+bool previousEndSessionFlag = aiWantsToEndSessionFlag;
+uint32_t previousActionFlags = currentActionFlags;
+
+if(!updateValuesFromMessage(transport->getReceivedMessageData(), transport->getReceivedMessageSize()))
+{
+//Leftover handshake messages are ignored, unless one is from a restarted AI answering a heartbeat
+bool AIRestarted = false;
+SOM_TRY
+AIRestarted = resumeWithRestartedAI(transport->getReceivedMessageData(), transport->getReceivedMessageSize());
+SOM_CATCH("Error resuming the session with a restarted AI\n")
+
+if(!AIRestarted && instrumentation != NULL)
+{
+instrumentation->countStaleMessage();
+}
+return false;
+}
+
+//An AI that has missed deadlines answers the percepts in order, so only the action for the newest one answers the current step (the late ones still count as the last action the AI sent, but their requests to restart the game or end the session were for steps the game has moved past, so they are dropped)
+if(numberOfUnansweredPercepts > 0)
+{
+numberOfUnansweredPercepts--;
+}
+
+if(numberOfUnansweredPercepts > 0)
+{
+aiWantsToRestartGameFlag = previousRestartGameFlag;
+aiWantsToEndSessionFlag = previousEndSessionFlag;
+currentActionFlags = previousActionFlags;
+if(instrumentation != NULL)
+{
+instrumentation->countStaleMessage();
+}
+return false;
+}
+
+if(instrumentation == NULL)
+{
+return true;
+}
+
+instrumentation->recordParseTime(stepInstrumentation::getTime() - parseStartTime);
+instrumentation->recordPeerWaitTime(parseStartTime - perceptSentTime);
+return true;
+}
+
+/*
+This function sends a heartbeat to the AI if reconnection is on and one is due.  Heartbeats are sent without waiting, so one that doesn't fit in the transport is just skipped.
+@exceptions: This function can throw exceptions
+*/
+void gameEngineCommunicationInterface::sendHeartbeatIfDue()
+{
+std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+if(heartbeatInterval < 0 || now < nextHeartbeatTime)
+{
+return;
+}
+
+//The heartbeat is the HELLO message, so an AI that has just started answers it like the one that started the session
+buildHelloMessage();
+SOM_TRY
+transport->sendProtobufMessage(helloMessage, 0);
+SOM_CATCH("Error sending heartbeat\n")
+
+nextHeartbeatTime = now + std::chrono::milliseconds(heartbeatInterval);
+}
+
+/*
+This function checks if a message from the AI that wasn't an action is the READY answer of a restarted AI to a heartbeat and, if it is, redoes the handshake with the new AI and sends it the percept the game is waiting on again.
+@param inputMessage: The serialized message
+@param inputMessageSize: The size of the serialized message
+@return: True if a restarted AI took over the session
+@exceptions: This function can throw exceptions
+*/
+bool gameEngineCommunicationInterface::resumeWithRestartedAI(const char *inputMessage, uint64_t inputMessageSize)
+{
+if(heartbeatInterval < 0)
+{
+return false;
+}
+
+//READY messages from the AI the game is already talking to are just late answers, and the new AI has to be waiting for the percept the game is waiting on (or, with an action deadline, one the game has moved past since the heartbeat it answered)
+perceptOrActionMessage readyMessage;
+if(!readyMessage.ParseFromArray(inputMessage, inputMessageSize) || !readyMessage.has_handshake() || readyMessage.handshake() != READY || !readyMessage.has_instance_id() || readyMessage.instance_id() == AIInstanceID || readyMessage.sequence_number() > perceptionSequenceCounter || (readyMessage.sequence_number() < perceptionSequenceCounter && actionDeadline < 0))
+{
+return false;
+}
+
+//The new AI may have picked different formats, and doesn't have the percept the next one would be encoded against
+readReadyMessage(inputMessage, inputMessageSize);
+numberOfReconnections++;
+
+if(readyMessage.sequence_number() == perceptionSequenceCounter)
+{
+bool perceptSent = false;
+SOM_TRY
+perceptSent = sendPerceptMessage(lastPercept.c_str(), lastPercept.size(), lastPerceptReward, lastPerceptGameState, actionDeadline);
+SOM_CATCH("Error resending percept\n")
+numberOfUnansweredPercepts = perceptSent ? 1 : 0; //If it couldn't be sent, the deadline has passed and the step is missed
+}
+else
+{
+//The percepts sent since the heartbeat reach the new AI after it, so it answers those instead (they were sent after missed deadlines, so they aren't encoded against a percept it doesn't have)
+numberOfUnansweredPercepts = perceptionSequenceCounter - readyMessage.sequence_number();
+}
+
+//The new AI gets the whole action timeout (but not a new deadline)
+stepStartTime = std::chrono::steady_clock::now();
+nextHeartbeatTime = stepStartTime + std::chrono::milliseconds(heartbeatInterval);
+return true;
+}
+
+/*
+This function returns true if the AI has decided it would like to prematurely abort this game (with it being clear to all observers that it did) and start a new one.
+@return: True if the AI has indicated a desire to start a new game prematurely
+*/
+bool gameEngineCommunicationInterface::AIWantsToRestartGame()
+{
+return aiWantsToRestartGameFlag;
+}
+
+/*
+This function returns true if the AI has indicated that it would like the game engine to shut down (terminating the process).
+@return: True if the AI has indicated a desire to start a new game prematurely
+*/
+bool gameEngineCommunicationInterface::AIWantsToEndSession()
+{
+return aiWantsToEndSessionFlag;
+}
+
+/*
+This function sets which wire format the game asks the AI to use for percepts and actions.  The AI only switches to FIXED_LAYOUT_WIRE_FORMAT if it agrees during the connection handshake (AIs built with older versions of the library keep using PROTOBUF_WIRE_FORMAT, the default).  It must be called before the first percept is sent.
+@param inputWireFormat: The format to ask for
+@exceptions: This function can throw exceptions (if the handshake has already happened)
+*/
+void gameEngineCommunicationInterface::setPreferredWireFormat(wireFormat inputWireFormat)
+{
+if(connectedToAI)
+{
+throw SOMException("Error, the wire format can only be changed before the first percept is sent\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+preferredWireFormat = inputWireFormat;
+}
+
+/*
+This function sets which percept encoding the game asks the AI to agree to.  With DELTA_PERCEPT_ENCODING, most percepts are sent as just the bytes that changed since the previous percept (see deltaPerceptEncoding.hpp), which cuts the bandwidth a lot for games whose percepts change a little at a time.  The AI only switches to it if it agrees during the connection handshake (AIs built with older versions of the library keep getting RAW_PERCEPT_ENCODING, the default).  The AI rejects decoded percepts longer than the percept size in the session description, so percepts sent with it can't be longer than the percept size given to the constructor.  Each encoded percept is decoded against the one before it, so DELTA_PERCEPT_ENCODING can't be used with a transport that can drop messages (such as PUB_SUB_TRANSPORT), where a lost percept would have the next one applied to the wrong percept.  It must be called before the first percept is sent.
+@param inputPerceptEncoding: The encoding to ask for
+@exceptions: This function can throw exceptions (if the handshake has already happened, or DELTA_PERCEPT_ENCODING is asked for with a transport that can drop messages)
+*/
+void gameEngineCommunicationInterface::setPreferredPerceptEncoding(perceptEncoding inputPerceptEncoding)
+{
+if(connectedToAI)
+{
+throw SOMException("Error, the percept encoding can only be changed before the first percept is sent\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+if(inputPerceptEncoding == DELTA_PERCEPT_ENCODING && transport->canDropMessages())
+{
+throw SOMException("Error, delta percept encoding can't be used with a transport that can drop messages\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+preferredPerceptEncoding = inputPerceptEncoding;
+}
+
+/*
+This function sets the name of the game and a description of what its rewards mean, which are sent to the AI once in the session description during the connection handshake (along with the percept and action sizes).  It must be called before the first percept is sent.
+@param inputGameName: The name of the game
+@param inputRewardDescription: What the rewards mean (such as their range and when they are given)
+@exceptions: This function can throw exceptions (if the handshake has already happened)
+*/
+void gameEngineCommunicationInterface::setSessionDescription(const std::string &inputGameName, const std::string &inputRewardDescription)
+{
+if(connectedToAI)
+{
+throw SOMException("Error, the session description can only be changed before the first percept is sent\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+gameName = inputGameName;
+rewardDescription = inputRewardDescription;
+}
+
+/*
+This function lets the session survive the AI process being restarted.  While the game waits for an action, it sends a heartbeat (the HELLO message again, carrying the sequence number of the percept it is waiting on) every inputHeartbeatIntervalInMilliseconds.  A restarted AI answers it with a READY message carrying a new instance ID, and the game then redoes the handshake with it and sends it the percept it is waiting on again, so the session carries on from the last step the old AI answered (the action timeout starts again for the new AI).  The last percept is kept for this, which costs a copy of it each step.  Reconnection can also be turned on for every game in a process with the AIARENA_HEARTBEAT_INTERVAL environment variable.  It must be called before the first percept is sent.
+@param inputHeartbeatIntervalInMilliseconds: How often to send a heartbeat while waiting for an action (negative values turn reconnection off)
+@exceptions: This function can throw exceptions (if the handshake has already happened)
+*/
+void gameEngineCommunicationInterface::enableReconnection(int inputHeartbeatIntervalInMilliseconds)
+{
+if(connectedToAI)
+{
+throw SOMException("Error, reconnection can only be turned on before the first percept is sent\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+heartbeatInterval = inputHeartbeatIntervalInMilliseconds < 0 ? -1 : inputHeartbeatIntervalInMilliseconds;
+}
+
+/*
+This function returns how many times a restarted AI has taken over the session.
+@return: The number of reconnections
+*/
+uint64_t gameEngineCommunicationInterface::getNumberOfReconnections()
+{
+return numberOfReconnections;
+}
+
+/*
+This function gives each step a deadline, so that a slow AI costs the game a step rather than the session.  If the AI's action hasn't arrived inputDeadlineInMilliseconds after the percept was sent, the step finishes with an action the game picks (see missedDeadlinePolicy), the miss is counted and the game carries on.  The AI's action for that step is thrown away when it arrives (apart from being the last action the AI sent, for REPEAT_LAST_ACTION_ON_MISSED_DEADLINE), as is any request in it to restart the game or end the session, and the AI keeps getting the new percepts in the meantime, so it catches up by answering them in order.  Percepts are only waited on to be sent until the deadline too, so an AI that stops reading can't block the game once the transport is full: the step is missed, and the next percept takes the sequence number of the one that wasn't sent.  The action timeout still ends the session, but it is counted from the oldest percept the AI hasn't answered, so it only goes off if the AI stops answering altogether.  The deadline can also be set for every game in a process with the AIARENA_ACTION_DEADLINE environment variable.  Since actions don't carry a sequence number, late actions are told apart by counting the percepts that haven't been answered, so deadlines can't be used with a transport that can drop messages (such as PUB_SUB_TRANSPORT), where one lost percept or action would leave every later action counted as late (and a delta encoded percept applied to the wrong one).
+@param inputDeadlineInMilliseconds: How long to wait for each action (negative values wait until it arrives or the action timeout passes, which is the default)
+@param inputPolicy: What to use in place of the action when the AI misses the deadline
+@exceptions: This function can throw exceptions (if the transport can drop messages)
+*/
+void gameEngineCommunicationInterface::setActionDeadline(int inputDeadlineInMilliseconds, missedDeadlinePolicy inputPolicy)
+{
+if(inputDeadlineInMilliseconds >= 0 && transport->canDropMessages())
+{
+throw SOMException("Error, action deadlines can't be used with a transport that can drop messages\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+actionDeadline = inputDeadlineInMilliseconds < 0 ? -1 : inputDeadlineInMilliseconds;
+deadlinePolicy = inputPolicy;
+}
+
+/*
+This function sets the action that DEFAULT_ACTION_ON_MISSED_DEADLINE uses (all zeros unless this is called), which should be one that does nothing in the game.
+@param inputDefaultAction: The action, which must hold at least the expected number of action bits
+@exceptions: This function can throw exceptions (if the action is too short)
+*/
+void gameEngineCommunicationInterface::setDefaultAction(const std::string &inputDefaultAction)
+{
+if(inputDefaultAction.size() < sizeOfExpectedActionsInBytes)
+{
+throw SOMException("Error, the default action is shorter than the expected actions\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+defaultAction = inputDefaultAction;
+}
+
+/*
+This function returns true if the AI didn't answer the last percept before the action deadline, so the actions returned for it are the ones the game picked.
+@return: True if the AI missed the last deadline
+*/
+bool gameEngineCommunicationInterface::actionMissedDeadline()
+{
+return lastActionMissedDeadline;
+}
+
+/*
+This function returns how many steps the AI has missed the action deadline in.
+@return: The number of missed deadlines
+*/
+uint64_t gameEngineCommunicationInterface::getNumberOfMissedDeadlines()
+{
+return numberOfMissedDeadlines;
+}
+
+/*
+This function returns the version of the protocol that the AI follows (which is only known once the first percept has been sent).
+@return: The AI's protocol version (0 if the AI hasn't connected yet)
+*/
+uint32_t gameEngineCommunicationInterface::getAIProtocolVersion()
+{
+return AIProtocolVersion;
+}
+
+/*
+This function returns the wire format that the percepts and actions are being sent in (which is only known once the first percept has been sent).
+@return: The wire format in use
+*/
+wireFormat gameEngineCommunicationInterface::getWireFormat()
+{
+return usingFixedLayoutWireFormat ? FIXED_LAYOUT_WIRE_FORMAT : PROTOBUF_WIRE_FORMAT;
+}
+
+/*
+This function returns the encoding that the percepts are being sent in (which is only known once the first percept has been sent).
+@return: The percept encoding in use
+*/
+perceptEncoding gameEngineCommunicationInterface::getPerceptEncoding()
+{
+return usingDeltaPerceptEncoding ? DELTA_PERCEPT_ENCODING : RAW_PERCEPT_ENCODING;
+}
+
+/*
+This function returns the sum of the rewards in all of the percepts the AI has answered so far.
+@return: The total reward
+*/
+uint64_t gameEngineCommunicationInterface::getTotalReward()
+{
+return totalReward;
+}
+
+/*
+This function returns how many percepts the AI has answered so far.
+@return: The number of rounds played
+*/
+uint64_t gameEngineCommunicationInterface::getNumberOfRoundsPlayed()
+{
+return numberOfRoundsPlayed;
+}
+
+/*
+This function returns how many games have been ended (by percepts sent with inputEndGame set) so far.
+@return: The number of games finished
+*/
+uint64_t gameEngineCommunicationInterface::getNumberOfGamesFinished()
+{
+return numberOfGamesFinished;
+}
+
+/*
+This function starts recording every step (percept, reward, game state, sequence number and the AI's action) to a trajectory file, which trajectoryReader can read.  The file is written by a background thread so recording doesn't slow the steps down.  Recording can also be turned on for every game in a process with the AIARENA_TRAJECTORY_FILE environment variable.  If the interface was already recording, that file is finished first.
+@param inputFilePath: The file to write (replaced if it exists)
+@exceptions: This function can throw exceptions (if the file can't be created or the previous file couldn't be finished)
+*/
+void gameEngineCommunicationInterface::startRecording(const std::string &inputFilePath)
+{
+SOM_TRY
+stopRecording();
+SOM_CATCH("Error finishing the previous recording\n")
+
+SOM_TRY
+recorder.reset(new trajectoryRecorder(inputFilePath, sizeOfAIPerceptionsInBits, sizeOfExpectedActionsInBits));
+SOM_CATCH("Error starting recording\n")
+}
+
+/*
+This function stops recording and finishes the trajectory file (writing its episode index).  It is done automatically when the interface is destroyed.
+@exceptions: This function can throw exceptions (if the file couldn't be written)
+*/
+void gameEngineCommunicationInterface::stopRecording()
+{
+if(recorder == NULL)
+{
+return;
+}
+
+std::unique_ptr<trajectoryRecorder> finishedRecorder(std::move(recorder)); //Recording stops even if finishing the file fails
+SOM_TRY
+finishedRecorder->stop();
+SOM_CATCH("Error finishing trajectory file\n")
+}
+
+/*
+This function turns on the per-step instrumentation of the interface (it is turned on automatically if the AIARENA_INSTRUMENTATION_FILE environment variable is set).  Once it is on, the time spent serializing, sending, waiting for the AI and parsing its actions is recorded each step, along with counts of steps, bytes, stale messages and handshake retries.
+*/
+void gameEngineCommunicationInterface::enableInstrumentation()
+{
+if(instrumentation == NULL)
+{
+instrumentation.reset(new stepInstrumentation("game"));
+}
+
+transport->setInstrumentation(instrumentation.get());
+}
+
+/*
+This function returns the per-step instrumentation of the interface, so the measurements can be queried or written out.
+@return: The instrumentation or NULL if it hasn't been turned on
+*/
+stepInstrumentation *gameEngineCommunicationInterface::getInstrumentation()
+{
+return instrumentation.get();
+}
+
+/*
+This function writes the session results to the file named in AIARENA_RESULTS_FILE (if it is set), so that whoever started the game can collect them.  The file holds a single line with the total reward, the number of rounds played and the number of games finished.  A step submitted with submitPercept that is still waiting for the AI is abandoned first.
+*/
+gameEngineCommunicationInterface::~gameEngineCommunicationInterface()
+{
+//Stop a step running on the I/O thread (which could otherwise wait forever for an AI that has gone away) so the totals are final
+asyncWorker.abandon();
+try
+{
+asyncWorker.wait();
+}
+catch(...)
+{
+}
+
+const char *resultsFilePath = getenv(RESULTS_FILE_ENVIRONMENT_VARIABLE);
+if(resultsFilePath == NULL || resultsFilePath[0] == '\0')
+{
+return;
+}
+
+FILE *resultsFile = fopen(resultsFilePath, "w");
+if(resultsFile == NULL)
+{
+return; //Destructors can't throw, so the results are just lost
+}
+
+fprintf(resultsFile, "%llu %llu %llu\n", (unsigned long long) totalReward, (unsigned long long) numberOfRoundsPlayed, (unsigned long long) numberOfGamesFinished);
+fclose(resultsFile);
+}
+
+
+/*
+This function does the setup shared by the constructors.
+@param inputContext: The ZMQ context to create the sockets with
+@param inputGameEndpoint: The endpoint that the game binds to
+@param inputAIEndpoint: The endpoint that the AI binds to (only used by transports with a connection in each direction)
+@param inputSizeOfAIPerceptionInBits:  The number of bits (starting at offset 0) that the agent should use
+@param inputSizeOfExpectedActionsInBits: The number of action bits that the game will accept from the agent
+@param inputActionTimeoutInterval:  The number of milliseconds that the game will wait for an action before throwing an exception (negative values wait forever)
+@param inputTransportType: How to connect to the AI
+@param inputConnectionTimeoutInterval: The number of milliseconds that the game will wait for the AI to answer the connection handshake (negative values wait forever)
+@exceptions: This function can throw exceptions
+*/
+void gameEngineCommunicationInterface::initialize(zmq::context_t &inputContext, const std::string &inputGameEndpoint, const std::string &inputAIEndpoint, uint64_t inputSizeOfAIPerceptionsInBits, uint64_t inputSizeOfExpectedActionsInBits, int inputActionTimeoutInterval, transportType inputTransportType, int inputConnectionTimeoutInterval)
+{
+//Remember size of AI perceptions in bits and size of expected actions in bits
+sizeOfAIPerceptionsInBits = inputSizeOfAIPerceptionsInBits;
+sizeOfExpectedActionsInBits = inputSizeOfExpectedActionsInBits;
+sizeOfExpectedActionsInBytes = ((sizeOfExpectedActionsInBits+7)/8);
+perceptionSequenceCounter = 0;
+currentGameState = GAME_START;
+aiWantsToRestartGameFlag = false;
+aiWantsToEndSessionFlag = false;
+currentActionFlags = 0;
+totalReward = 0;
+numberOfRoundsPlayed = 0;
+numberOfGamesFinished = 0;
+pendingReward = 0;
+pendingEndGame = false;
+perceptSubmitted = false;
+stepInProgress = false;
+pendingPerceptGameState = GAME_START;
+helloSent = false;
+helloResendInterval = 1;
+instanceID = createInstanceID();
+AIInstanceID = 0;
+lastPerceptReward = 0;
+lastPerceptGameState = GAME_START;
+numberOfReconnections = 0;
+defaultAction.assign(sizeOfExpectedActionsInBytes, '\0');
+numberOfUnansweredPercepts = 0;
+currentPerceptSent = true;
+lastActionMissedDeadline = false;
+numberOfMissedDeadlines = 0;
+
+//Reconnection can be turned on for a whole run without changing the game
+heartbeatInterval = -1;
+const char *heartbeatIntervalString = getenv(HEARTBEAT_INTERVAL_ENVIRONMENT_VARIABLE);
+if(heartbeatIntervalString != NULL && heartbeatIntervalString[0] != '\0')
+{
+heartbeatInterval = std::max(atoi(heartbeatIntervalString), -1);
+}
+
+//So can an action deadline
+actionDeadline = -1;
+deadlinePolicy = DEFAULT_ACTION_ON_MISSED_DEADLINE;
+const char *actionDeadlineString = getenv(ACTION_DEADLINE_ENVIRONMENT_VARIABLE);
+if(actionDeadlineString != NULL && actionDeadlineString[0] != '\0')
+{
+actionDeadline = std::max(atoi(actionDeadlineString), -1);
+}
+
+actionTimeoutInterval = inputActionTimeoutInterval;
+if(actionTimeoutInterval < 0)
+{
+actionTimeoutInterval = -1;
+}
+
+connectedToAI = false;
+AIProtocolVersion = 0;
+preferredWireFormat = PROTOBUF_WIRE_FORMAT;
+usingFixedLayoutWireFormat = false;
+preferredPerceptEncoding = RAW_PERCEPT_ENCODING;
+usingDeltaPerceptEncoding = false;
+connectionTimeoutInterval = inputConnectionTimeoutInterval;
+if(connectionTimeoutInterval < 0)
+{
+connectionTimeoutInterval = -1;
+}
+
+//Initialize the connection to the AI
+SOM_TRY
+transport = createMessageTransport(inputTransportType, GAME_ENGINE_ROLE, inputContext, inputGameEndpoint, inputAIEndpoint);
+SOM_CATCH("Error initializing transport\n")
+
+//Late actions are told apart by counting the percepts that haven't been answered, which only works if every message arrives (see setActionDeadline)
+if(actionDeadline >= 0 && transport->canDropMessages())
+{
+throw SOMException("Error, " ACTION_DEADLINE_ENVIRONMENT_VARIABLE " can't be used with a transport that can drop messages\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+//Instrumentation can be turned on for a whole run without changing the game
+perceptSentTime = 0;
+SOM_TRY
+instrumentation.reset(createInstrumentationFromEnvironment("game"));
+SOM_CATCH("Error setting up instrumentation\n")
+transport->setInstrumentation(instrumentation.get());
+
+//So can recording
+SOM_TRY
+recorder.reset(createTrajectoryRecorderFromEnvironment(sizeOfAIPerceptionsInBits, sizeOfExpectedActionsInBits));
+SOM_CATCH("Error setting up trajectory recording\n")
+}
 
@@ -5,13 +5,41 @@
 #include<thread>
 #include<exception>
 #include<string>
+#include<chrono>
+#include<algorithm>
 #include<unistd.h> //For delay
 #include "zmq.hpp"
 
 #include "SOMException.hpp"
 #include "portLocations.hpp"
+#include "messageTransport.hpp"
+#include "fixedLayoutWireFormat.hpp"
+#include "deltaPerceptEncoding.hpp"
+#include "asyncStepWorker.hpp"
+#include "stepInstrumentation.hpp"
+#include "trajectoryRecorder.hpp"
 #include "perceptOrActionMessage.pb.h"
 
+//Environment variable naming a file that the results of the session (total reward, rounds played and games finished) are written to when the interface is destroyed
+#define RESULTS_FILE_ENVIRONMENT_VARIABLE "AIARENA_RESULTS_FILE"
+
+//Environment variable holding the heartbeat interval (in milliseconds) to turn reconnection on with for every game in a process (see enableReconnection)
+#define HEARTBEAT_INTERVAL_ENVIRONMENT_VARIABLE "AIARENA_HEARTBEAT_INTERVAL"
+
+//Environment variable holding the action deadline (in milliseconds) to use for every game in a process (see setActionDeadline)
+#define ACTION_DEADLINE_ENVIRONMENT_VARIABLE "AIARENA_ACTION_DEADLINE"
+
+/*
+What the game uses in place of the AI's action in a step that the AI doesn't answer before the action deadline (see setActionDeadline).
+DEFAULT_ACTION_ON_MISSED_DEADLINE: The default action (all zeros unless setDefaultAction was called)
+REPEAT_LAST_ACTION_ON_MISSED_DEADLINE: The last action the AI sent (the default action if it hasn't sent one yet)
+*/
+enum missedDeadlinePolicy
+{
+DEFAULT_ACTION_ON_MISSED_DEADLINE,
+REPEAT_LAST_ACTION_ON_MISSED_DEADLINE
+};
+
 /*
 This class makes it easy to write a game for AI Arena by abstracting away all of the communication details so that the programmer can just call a few simple functions.
 */
@@ -23,19 +51,111 @@ This function establishes the connections used to run the game interaction.
 @param inputSizeOfAIPerceptionInBits:  The number of bits (starting at offset 0) that the agent should use (since the data is spaced out to the nearest byte)
 @param inputSizeOfExpectedActionsInBits: The number of action bits that the game will accept from the agent (future versions may at some point allow this to change dynamically, but most AI architectures would have trouble supporting that).
 @param inputActionTimeoutInterval:  The number of milliseconds that the game will wait before throwing an exception (it defaults to infinite wait)
+@param inputTransportType: How to connect to the AI (the AI must use the same transport)
+@param inputConnectionTimeoutInterval: The number of milliseconds that the game will wait for the AI to answer the connection handshake (started by the first percept) before throwing an exception (negative values wait forever)
 @exceptions: This function can throw exceptions (especially if starting the connection to the AI times out)
 */
-gameEngineCommunicationInterface(uint64_t inputSizeOfAIPerceptionsInBits, uint64_t inputSizeOfExpectedActionsInBits, int inputActionTimeoutInterval = -1);
+gameEngineCommunicationInterface(uint64_t inputSizeOfAIPerceptionsInBits, uint64_t inputSizeOfExpectedActionsInBits, int inputActionTimeoutInterval = -1, transportType inputTransportType = PUB_SUB_TRANSPORT, int inputConnectionTimeoutInterval = 100000);
+
+/*
+This function establishes the connections used to run the game interaction using an existing ZMQ context and the given endpoint (such as "inproc://myGame" to run the game and the AI as threads sharing the context, or "ipc:///tmp/myGame").  The context must outlive this object.
+@param inputContext: The ZMQ context to create the sockets with
+@param inputGameEndpoint: The endpoint that the game binds to (and that the AI must connect to)
+@param inputSizeOfAIPerceptionInBits:  The number of bits (starting at offset 0) that the agent should use (since the data is spaced out to the nearest byte)
+@param inputSizeOfExpectedActionsInBits: The number of action bits that the game will accept from the agent
+@param inputActionTimeoutInterval:  The number of milliseconds that the game will wait before throwing an exception (it defaults to infinite wait)
+@param inputTransportType: How to connect to the AI (the AI must use the same transport)
+@param inputConnectionTimeoutInterval: The number of milliseconds that the game will wait for the AI to answer the connection handshake (started by the first percept) before throwing an exception (negative values wait forever)
+@param inputAIEndpoint: The endpoint that the AI binds to, which is only used (and required) by transports with a connection in each direction such as PUB_SUB_TRANSPORT
+@exceptions: This function can throw exceptions
+*/
+gameEngineCommunicationInterface(zmq::context_t &inputContext, const std::string &inputGameEndpoint, uint64_t inputSizeOfAIPerceptionsInBits, uint64_t inputSizeOfExpectedActionsInBits, int inputActionTimeoutInterval = -1, transportType inputTransportType = LOCKSTEP_TRANSPORT, int inputConnectionTimeoutInterval = 100000, const std::string &inputAIEndpoint = "");
 
 /*
 This function sends what the game decides the AI sees after its actions or initial starting state.  The class takes care of all of the details associated with sending AI perceptions and getting back the AI's actions.
 @param inputAIPerceptions: The data to send to the agent for it to act on (must have more bits than the sizeOfExpectedActionsInBits.
 @param inputReward: The reward that the game decides the AI is entitled to
 @param inputEndGame: True if this is the last percept in the AI's current game and the next percept will correspond to a new game
-@return: The actions submitted by the AI for the next round of the game
+@return: The actions submitted by the AI for the next round of the game (the reference stays valid until the next call, so assigning it to a string that is kept from round to round avoids allocating)
 @exceptions: This function can throw some exceptions (especially if the connection to the other side times out or the AI chooses to terminate the game session).
 */
-std::string sendPerceptionsAndGetActions(const std::string &inputAIPerceptions, uint64_t inputReward, bool inputEndGame = false);
+const std::string &sendPerceptionsAndGetActions(const std::string &inputAIPerceptions, uint64_t inputReward, bool inputEndGame = false);
+
+/*
+This function does the same as sendPerceptionsAndGetActions, but takes the percept as a pointer and size so that percepts that aren't in a std::string (such as ones read from a memory mapped trajectory file) don't have to be copied into one first.
+@param inputAIPerceptions: The percept bytes
+@param inputAIPerceptionsSize: The number of percept bytes
+@param inputReward: The reward that the game decides the AI is entitled to
+@param inputEndGame: True if this is the last percept in the AI's current game and the next percept will correspond to a new game
+@return: The actions submitted by the AI (the reference stays valid until the next call)
+@exceptions: This function can throw some exceptions (especially if the connection to the other side times out)
+*/
+const std::string &sendPerceptionBytesAndGetActions(const char *inputAIPerceptions, uint64_t inputAIPerceptionsSize, uint64_t inputReward, bool inputEndGame = false);
+
+/*
+This function sends a percept without waiting for the AI's answer, so that one thread can run many games by polling each of them with tryGetActions (which must return true before the next percept is sent).  If the AI hasn't connected yet, the handshake is started and the percept is sent once it finishes.
+@param inputAIPerceptions: The data to send to the agent for it to act on
+@param inputReward: The reward that the game decides the AI is entitled to
+@param inputEndGame: True if this is the last percept in the AI's current game and the next percept will correspond to a new game
+@exceptions: This function can throw exceptions (if the last step hasn't finished)
+*/
+void sendPerceptions(const std::string &inputAIPerceptions, uint64_t inputReward, bool inputEndGame = false);
+
+/*
+This function checks (without waiting) whether the AI has answered the percept given to sendPerceptions, continuing the connection handshake first if needed.  Once it returns true, getActions returns the AI's actions (or the ones the game used if the AI missed the action deadline) and AIWantsToRestartGame/AIWantsToEndSession reflect them.
+@return: True if the actions have arrived, false if the AI hasn't answered yet
+@exceptions: This function can throw exceptions (a TIME_OUT exception if the connection or action timeout has passed)
+*/
+bool tryGetActions();
+
+/*
+This function returns the actions the AI sent in answer to the last percept.
+@return: The actions (the reference stays valid until the next percept is sent)
+*/
+const std::string &getActions();
+
+/*
+This function fills in a zmq_poll item that becomes readable when a message from the AI arrives, so that one thread can wait on many sessions at once (see sessionPoller).
+@param outputPollItem: The poll item
+@return: False if the transport can't be polled (such as SHARED_MEMORY_TRANSPORT), in which case isMessageWaiting has to be checked instead
+*/
+bool getPollItem(zmq_pollitem_t &outputPollItem);
+
+/*
+This function returns a file descriptor that becomes readable when a message from the AI arrives, for event loops built on select/poll/epoll.  For the ZMQ transports this is ZMQ_FD, which is edge triggered, so tryGetActions has to be called until it returns false (or isMessageWaiting checked) before waiting on the descriptor again.
+@return: The file descriptor (-1 if the transport doesn't have one)
+@exceptions: This function can throw exceptions
+*/
+int getFileDescriptor();
+
+/*
+This function checks, without waiting or receiving anything, whether a message from the AI may have arrived.
+@return: True if a message may be waiting
+@exceptions: This function can throw exceptions
+*/
+bool isMessageWaiting();
+
+/*
+This function returns how long the game can wait for a message from the AI before tryGetActions has to be called anyway, such as to resend the connection handshake, to send a heartbeat or to notice that the action timeout or deadline has passed.
+@return: The number of milliseconds (-1 if tryGetActions only needs to be called once a message arrives)
+*/
+int getTimeUntilNextPoll();
+
+/*
+This function starts sending a percept and waiting for the AI's answer on a background I/O thread, so that the game can get on with other work (such as rendering or logging) while the AI decides what to do.  awaitAction must be called before the next percept is submitted, and the other functions of the interface must not be used in between.
+@param inputAIPerceptions: The data to send to the agent for it to act on (copied, so the string can be changed as soon as this returns)
+@param inputReward: The reward that the game decides the AI is entitled to
+@param inputEndGame: True if this is the last percept in the AI's current game and the next percept will correspond to a new game
+@exceptions: This function can throw exceptions (if the last percept's action hasn't been collected with awaitAction)
+*/
+void submitPercept(const std::string &inputAIPerceptions, uint64_t inputReward, bool inputEndGame = false);
+
+/*
+This function waits for the AI's answer to the percept given to submitPercept.  Once it returns, AIWantsToRestartGame and AIWantsToEndSession reflect the new action.
+@return: The actions submitted by the AI (the reference stays valid until the next percept is sent)
+@exceptions: This function can throw exceptions (anything sendPerceptionsAndGetActions could throw, or if no percept was submitted)
+*/
+const std::string &awaitAction();
 
 /*
 This function returns true if the AI has decided it would like to prematurely abort this game (with it being clear to all observers that it did) and start a new one.
@@ -49,36 +169,330 @@ This function returns true if the AI has indicated that it would like the game e
 */
 bool AIWantsToEndSession();
 
+/*
+This function sets which wire format the game asks the AI to use for percepts and actions.  The AI only switches to FIXED_LAYOUT_WIRE_FORMAT if it agrees during the connection handshake (AIs built with older versions of the library keep using PROTOBUF_WIRE_FORMAT, the default).  It must be called before the first percept is sent.
+@param inputWireFormat: The format to ask for
+@exceptions: This function can throw exceptions (if the handshake has already happened)
+*/
+void setPreferredWireFormat(wireFormat inputWireFormat);
+
+/*
+This function sets which percept encoding the game asks the AI to agree to.  With DELTA_PERCEPT_ENCODING, most percepts are sent as just the bytes that changed since the previous percept (see deltaPerceptEncoding.hpp), which cuts the bandwidth a lot for games whose percepts change a little at a time.  The AI only switches to it if it agrees during the connection handshake (AIs built with older versions of the library keep getting RAW_PERCEPT_ENCODING, the default).  The AI rejects decoded percepts longer than the percept size in the session description, so percepts sent with it can't be longer than the percept size given to the constructor.  Each encoded percept is decoded against the one before it, so DELTA_PERCEPT_ENCODING can't be used with a transport that can drop messages (such as PUB_SUB_TRANSPORT), where a lost percept would have the next one applied to the wrong percept.  It must be called before the first percept is sent.
+@param inputPerceptEncoding: The encoding to ask for
+@exceptions: This function can throw exceptions (if the handshake has already happened, or DELTA_PERCEPT_ENCODING is asked for with a transport that can drop messages)
+*/
+void setPreferredPerceptEncoding(perceptEncoding inputPerceptEncoding);
+
+/*
+This function sets the name of the game and a description of what its rewards mean, which are sent to the AI once in the session description during the connection handshake (along with the percept and action sizes).  It must be called before the first percept is sent.
+@param inputGameName: The name of the game
+@param inputRewardDescription: What the rewards mean (such as their range and when they are given)
+@exceptions: This function can throw exceptions (if the handshake has already happened)
+*/
+void setSessionDescription(const std::string &inputGameName, const std::string &inputRewardDescription);
+
+/*
+This function lets the session survive the AI process being restarted.  While the game waits for an action, it sends a heartbeat (the HELLO message again, carrying the sequence number of the percept it is waiting on) every inputHeartbeatIntervalInMilliseconds.  A restarted AI answers it with a READY message carrying a new instance ID, and the game then redoes the handshake with it and sends it the percept it is waiting on again, so the session carries on from the last step the old AI answered (the action timeout starts again for the new AI).  The last percept is kept for this, which costs a copy of it each step.  Reconnection can also be turned on for every game in a process with the AIARENA_HEARTBEAT_INTERVAL environment variable.  It must be called before the first percept is sent.
+@param inputHeartbeatIntervalInMilliseconds: How often to send a heartbeat while waiting for an action (negative values turn reconnection off)
+@exceptions: This function can throw exceptions (if the handshake has already happened)
+*/
+void enableReconnection(int inputHeartbeatIntervalInMilliseconds);
+
+/*
+This function returns how many times a restarted AI has taken over the session.
+@return: The number of reconnections
+*/
+uint64_t getNumberOfReconnections();
+
+/*
+This function gives each step a deadline, so that a slow AI costs the game a step rather than the session.  If the AI's action hasn't arrived inputDeadlineInMilliseconds after the percept was sent, the step finishes with an action the game picks (see missedDeadlinePolicy), the miss is counted and the game carries on.  The AI's action for that step is thrown away when it arrives (apart from being the last action the AI sent, for REPEAT_LAST_ACTION_ON_MISSED_DEADLINE), as is any request in it to restart the game or end the session, and the AI keeps getting the new percepts in the meantime, so it catches up by answering them in order.  Percepts are only waited on to be sent until the deadline too, so an AI that stops reading can't block the game once the transport is full: the step is missed, and the next percept takes the sequence number of the one that wasn't sent.  The action timeout still ends the session, but it is counted from the oldest percept the AI hasn't answered, so it only goes off if the AI stops answering altogether.  The deadline can also be set for every game in a process with the AIARENA_ACTION_DEADLINE environment variable.  Since actions don't carry a sequence number, late actions are told apart by counting the percepts that haven't been answered, so deadlines can't be used with a transport that can drop messages (such as PUB_SUB_TRANSPORT), where one lost percept or action would leave every later action counted as late (and a delta encoded percept applied to the wrong one).
+@param inputDeadlineInMilliseconds: How long to wait for each action (negative values wait until it arrives or the action timeout passes, which is the default)
+@param inputPolicy: What to use in place of the action when the AI misses the deadline
+@exceptions: This function can throw exceptions (if the transport can drop messages)
+*/
+void setActionDeadline(int inputDeadlineInMilliseconds, missedDeadlinePolicy inputPolicy = DEFAULT_ACTION_ON_MISSED_DEADLINE);
+
+/*
+This function sets the action that DEFAULT_ACTION_ON_MISSED_DEADLINE uses (all zeros unless this is called), which should be one that does nothing in the game.
+@param inputDefaultAction: The action, which must hold at least the expected number of action bits
+@exceptions: This function can throw exceptions (if the action is too short)
+*/
+void setDefaultAction(const std::string &inputDefaultAction);
+
+/*
+This function returns true if the AI didn't answer the last percept before the action deadline, so the actions returned for it are the ones the game picked.
+@return: True if the AI missed the last deadline
+*/
+bool actionMissedDeadline();
+
+/*
+This function returns how many steps the AI has missed the action deadline in.
+@return: The number of missed deadlines
+*/
+uint64_t getNumberOfMissedDeadlines();
+
+/*
+This function returns the version of the protocol that the AI follows (which is only known once the first percept has been sent).
+@return: The AI's protocol version (0 if the AI hasn't connected yet)
+*/
+uint32_t getAIProtocolVersion();
+
+/*
+This function returns the wire format that the percepts and actions are being sent in (which is only known once the first percept has been sent).
+@return: The wire format in use
+*/
+wireFormat getWireFormat();
+
+/*
+This function returns the encoding that the percepts are being sent in (which is only known once the first percept has been sent).
+@return: The percept encoding in use
+*/
+perceptEncoding getPerceptEncoding();
+
+/*
+This function returns the sum of the rewards in all of the percepts the AI has answered so far.
+@return: The total reward
+*/
+uint64_t getTotalReward();
+
+/*
+This function returns how many percepts the AI has answered so far.
+@return: The number of rounds played
+*/
+uint64_t getNumberOfRoundsPlayed();
+
+/*
+This function returns how many games have been ended (by percepts sent with inputEndGame set) so far.
+@return: The number of games finished
+*/
+uint64_t getNumberOfGamesFinished();
+
+/*
+This function starts recording every step (percept, reward, game state, sequence number and the AI's action) to a trajectory file, which trajectoryReader can read.  The file is written by a background thread so recording doesn't slow the steps down.  Recording can also be turned on for every game in a process with the AIARENA_TRAJECTORY_FILE environment variable.  If the interface was already recording, that file is finished first.
+@param inputFilePath: The file to write (replaced if it exists)
+@exceptions: This function can throw exceptions (if the file can't be created or the previous file couldn't be finished)
+*/
+void startRecording(const std::string &inputFilePath);
+
+/*
+This function stops recording and finishes the trajectory file (writing its episode index).  It is done automatically when the interface is destroyed.
+@exceptions: This function can throw exceptions (if the file couldn't be written)
+*/
+void stopRecording();
+
+/*
+This function turns on the per-step instrumentation of the interface (it is turned on automatically if the AIARENA_INSTRUMENTATION_FILE environment variable is set).  Once it is on, the time spent serializing, sending, waiting for the AI and parsing its actions is recorded each step, along with counts of steps, bytes, stale messages and handshake retries.
+*/
+void enableInstrumentation();
+
+/*
+This function returns the per-step instrumentation of the interface, so the measurements can be queried or written out.
+@return: The instrumentation or NULL if it hasn't been turned on
+*/
+stepInstrumentation *getInstrumentation();
+
+/*
+This function writes the session results to the file named in AIARENA_RESULTS_FILE (if it is set), so that whoever started the game can collect them.  A step submitted with submitPercept that is still waiting for the AI is abandoned first.
+*/
+~gameEngineCommunicationInterface();
+
 
 private:
 bool aiWantsToRestartGameFlag;
 bool aiWantsToEndSessionFlag;
 std::string currentAction;
+uint32_t currentActionFlags; //TRAJECTORY_ACTION_* bits for the current action, for the recording
 gameState currentGameState; //Start at the first percept of the new game, game over if the game is terminated, continue at any other time
 uint64_t sizeOfAIPerceptionsInBits;
 uint64_t sizeOfExpectedActionsInBits;
 uint64_t sizeOfExpectedActionsInBytes;
-std::unique_ptr<zmq::context_t> context;
-std::unique_ptr<zmq::socket_t> perceptionsPublishingSocket;
-std::unique_ptr<zmq::socket_t> actionReceptionSocket;
+int actionTimeoutInterval;
+int connectionTimeoutInterval;
+bool connectedToAI; //True once the AI has answered the connection handshake
+wireFormat preferredWireFormat; //The format to ask for in the HELLO message
+bool usingFixedLayoutWireFormat; //True if the AI agreed to the fixed layout wire format
+perceptEncoding preferredPerceptEncoding; //The percept encoding to ask for in the HELLO message
+bool usingDeltaPerceptEncoding; //True if the AI agreed to DELTA_PERCEPT_ENCODING
+std::string previousPercept; //The last percept sent, which the next one is encoded against (only kept if usingDeltaPerceptEncoding)
+std::string encodedPercept; //Reused for every encoded percept
+uint32_t AIProtocolVersion; //The protocol version in the AI's READY message (percepts only carry the sizes if it is 1)
+std::string gameName; //Sent in the session description
+std::string rewardDescription; //Sent in the session description
+std::unique_ptr<stepInstrumentation> instrumentation; //NULL unless instrumentation is turned on (declared before the transport, which records to it)
+std::unique_ptr<zmq::context_t> context; //Only used if the interface wasn't given a context to share
+std::unique_ptr<messageTransport> transport;
+uint64_t perceptSentTime; //When the last percept was sent (only kept if instrumentation is on)
+std::unique_ptr<trajectoryRecorder> recorder; //NULL unless the steps are being recorded
 
 uint64_t perceptionSequenceCounter;
+perceptOrActionMessage outgoingPerceptMessage; //Reused for every percept so that its buffers are only allocated once
+perceptOrActionMessage incomingActionMessage; //Reused for every action for the same reason
+uint64_t totalReward;
+uint64_t numberOfRoundsPlayed;
+uint64_t numberOfGamesFinished;
+
+std::string pendingPercept; //The percept for the step running on the I/O thread (or waiting for the handshake to finish)
+uint64_t pendingReward;
+bool pendingEndGame;
+bool perceptSubmitted; //True from submitPercept until awaitAction
+bool stepInProgress; //True from sendPerceptions until tryGetActions returns true
+std::chrono::steady_clock::time_point stepStartTime; //When the oldest percept the AI hasn't answered was sent (or, before the AI connects, when the handshake started), for the timeouts
+gameState pendingPerceptGameState; //The game state for the percept sent by sendPerceptions
+perceptOrActionMessage helloMessage;
+bool helloSent; //True once the HELLO message has been sent at least once
+std::chrono::steady_clock::time_point nextHelloTime; //When pollForAIToConnect resends HELLO (if the transport can drop messages)
+int helloResendInterval;
+uint64_t instanceID; //Sent in the HELLO messages, so the AI can tell a restarted game from the same one
+uint64_t AIInstanceID; //From the AI's READY message (0 if it didn't send one)
+int heartbeatInterval; //How often to send a heartbeat while waiting for an action (-1 if reconnection is off)
+std::chrono::steady_clock::time_point nextHeartbeatTime;
+std::string lastPercept; //The percept the game is waiting on an action for, to resend to a restarted AI (only kept if reconnection is on)
+uint64_t lastPerceptReward;
+gameState lastPerceptGameState;
+uint64_t numberOfReconnections;
+int actionDeadline; //How long to wait for each action before using one the game picks (-1 if there isn't a deadline)
+missedDeadlinePolicy deadlinePolicy;
+std::string defaultAction;
+std::chrono::steady_clock::time_point actionDeadlineTime; //When the deadline of the current step passes
+uint64_t numberOfUnansweredPercepts; //Percepts sent that no action has arrived for (more than one means the AI is behind because it missed deadlines)
+bool currentPerceptSent; //False if the current step's percept couldn't be sent before its deadline
+bool lastActionMissedDeadline;
+uint64_t numberOfMissedDeadlines;
+asyncStepWorker asyncWorker; //Declared last so the I/O thread is stopped (abandoning any step still in flight) before anything it uses is destroyed
 
 /*
-This function publishes the given message on the perceptionsPublishingSocket and then tries to recieve a message from actionReceptionSocket.
-@param inputMessage: The message to send
-@param inputBlock: True if the function should block until the recv function times out
-@return: The message received from actionReceptionSocket (or zero length on timeout)
+This function does the setup shared by the constructors.
+@param inputContext: The ZMQ context to create the sockets with
+@param inputGameEndpoint: The endpoint that the game binds to
+@param inputAIEndpoint: The endpoint that the AI binds to (only used by transports with a connection in each direction)
+@param inputSizeOfAIPerceptionInBits:  The number of bits (starting at offset 0) that the agent should use
+@param inputSizeOfExpectedActionsInBits: The number of action bits that the game will accept from the agent
+@param inputActionTimeoutInterval:  The number of milliseconds that the game will wait for an action before throwing an exception (negative values wait forever)
+@param inputTransportType: How to connect to the AI
+@param inputConnectionTimeoutInterval: The number of milliseconds that the game will wait for the AI to answer the connection handshake (negative values wait forever)
 @exceptions: This function can throw exceptions
 */
-std::string sendMessageAndGetBackResponse(const std::string &inputMessage, bool inputBlock = true);
+void initialize(zmq::context_t &inputContext, const std::string &inputGameEndpoint, const std::string &inputAIEndpoint, uint64_t inputSizeOfAIPerceptionsInBits, uint64_t inputSizeOfExpectedActionsInBits, int inputActionTimeoutInterval, transportType inputTransportType, int inputConnectionTimeoutInterval);
+
+/*
+This function waits for the next message from the AI, which is left in the transport (getReceivedMessageData/getReceivedMessageSize).  On the I/O thread the wait is cut into short pieces (returning false early, which the callers treat like any other timeout and wait again), so a step abandoned by the destructor gives up instead of waiting forever.
+@param inputTimeoutInMilliseconds: How long to wait for the message (-1 waits forever, 0 doesn't wait)
+@return: True if a message was received, false on timeout
+@exceptions: This function can throw exceptions (if the step has been abandoned)
+*/
+bool getNextMessage(int inputTimeoutInMilliseconds);
+
+/*
+This function sends HELLO messages to the AI until it answers with READY, so that both directions of the connection are known to work before the first percept is sent.  HELLO is only resent if the transport can drop messages, with the interval between resends growing from 1 millisecond so that a quick AI is picked up within a few milliseconds.
+@exceptions: This function can throw exceptions (a TIME_OUT exception if the AI doesn't answer within the connection timeout)
+*/
+void waitForAIToConnect();
+
+/*
+This function deserializes the action message (into a message object that is reused from step to step, so its buffers don't need to be reallocated) and updates the cached action values from it.
+@param inputMessage: The serialized message to extract the action bytes from
+@param inputMessageSize: The size of the serialized message
+@return: True if the message held an action, false if it was a leftover handshake message (which is ignored)
+@exceptions: This function can throw exceptions, especially if the message in invalid
+*/
+bool updateValuesFromMessage(const char *inputMessage, uint64_t inputMessageSize);
 
 /*
-This function deserializes the action message and updates the cached action values from it.
-@param inputMessage: The message to extract the action bytes from
+This function reads the action from the message left in the transport (with updateValuesFromMessage), recording the time the AI took to answer and the time taken to parse its message if instrumentation is on.  A handshake message from a restarted AI is handed to resumeWithRestartedAI.
+@return: True if the message held an action, false if it was a handshake message (which is ignored unless it came from a restarted AI)
 @exceptions: This function can throw exceptions, especially if the message in invalid
 */
-void updateValuesFromMessage(const std::string &inputMessage);
+bool readReceivedAction();
+
+/*
+This function works out the game state to send with the next percept and the state the percept after it will have.
+@param inputEndGame: True if the percept ends the current game
+@return: The game state for the percept
+*/
+gameState getNextPerceptGameState(bool inputEndGame);
+
+/*
+This function sends a percept to the AI in whichever wire format was agreed on.  With an action deadline, the percept has to be accepted for sending before the deadline passes, so an AI that has stopped reading (leaving the transport full) costs the game the step rather than blocking it.
+@param inputPercept: The percept bytes
+@param inputPerceptSize: The number of percept bytes
+@param inputReward: The reward to send with the percept
+@param inputGameState: The game state to send with the percept
+@return: False if the deadline passed before the percept could be sent (so the step has been missed)
+@exceptions: This function can throw exceptions
+*/
+bool sendPercept(const char *inputPercept, uint64_t inputPerceptSize, uint64_t inputReward, gameState inputGameState);
+
+/*
+This function does the sending for sendPercept, without recording the percept or keeping it for reconnection (so it is also used to resend the percept to a restarted AI).
+@param inputPercept: The percept bytes
+@param inputPerceptSize: The number of percept bytes
+@param inputReward: The reward to send with the percept
+@param inputGameState: The game state to send with the percept
+@param inputTimeoutInMilliseconds: How long to wait for the percept to be accepted for sending (-1 waits forever)
+@return: False if the percept couldn't be sent in time
+@exceptions: This function can throw exceptions
+*/
+bool sendPerceptMessage(const char *inputPercept, uint64_t inputPerceptSize, uint64_t inputReward, gameState inputGameState, int inputTimeoutInMilliseconds);
+
+/*
+This function does what sendPerceptMessage needs to once a percept has been sent (or has failed to be).
+@param inputPerceptSent: True if the percept was sent
+@return: inputPerceptSent
+*/
+bool finishSendingPercept(bool inputPerceptSent);
+
+/*
+This function returns how long the game can wait for the AI's action before it has to check whether the action timeout or deadline has passed or send a heartbeat.
+@return: The number of milliseconds (-1 if it can wait until the action arrives)
+*/
+int getTimeUntilActionCheck();
+
+/*
+This function sends a heartbeat to the AI if reconnection is on and one is due.  Heartbeats are sent without waiting, so one that doesn't fit in the transport is just skipped.
+@exceptions: This function can throw exceptions
+*/
+void sendHeartbeatIfDue();
+
+/*
+This function checks if a message from the AI that wasn't an action is the READY answer of a restarted AI to a heartbeat and, if it is, redoes the handshake with the new AI and sends it the percept the game is waiting on again.
+@param inputMessage: The serialized message
+@param inputMessageSize: The size of the serialized message
+@return: True if a restarted AI took over the session
+@exceptions: This function can throw exceptions
+*/
+bool resumeWithRestartedAI(const char *inputMessage, uint64_t inputMessageSize);
+
+/*
+This function finishes the current step without the AI's action once the action deadline has passed, using the action picked by the missed deadline policy.
+*/
+void useActionForMissedDeadline();
+
+/*
+This function updates the sequence number and the session totals once the AI has answered a percept (or missed the deadline for it).
+@param inputReward: The reward that was sent with the percept
+@param inputEndGame: True if the percept ended a game
+*/
+void recordFinishedStep(uint64_t inputReward, bool inputEndGame);
+
+/*
+This function does one round of the connection handshake without waiting: it sends (or resends, at the same growing intervals as waitForAIToConnect) the HELLO message and checks for the AI's READY.  The connection timeout is counted from when sendPerceptions started the step.
+@return: True if the AI has answered the handshake
+@exceptions: This function can throw exceptions (a TIME_OUT exception if the AI doesn't answer within the connection timeout)
+*/
+bool pollForAIToConnect();
+
+/*
+This function fills in the HELLO message with the session description and the preferred wire format.
+*/
+void buildHelloMessage();
+
+/*
+This function checks if a message from the AI is the READY answer to the HELLO message and, if it is, finishes the handshake (picking the wire format and whether percepts carry the sizes).
+@param inputMessage: The serialized message
+@param inputMessageSize: The size of the serialized message
+@return: True if the message was READY
+*/
+bool readReadyMessage(const char *inputMessage, uint64_t inputMessageSize);
 };
 
 
@@ -0,0 +1,386 @@
+#include "messageTransport.hpp"
+#include "zmqPublishSubscribeTransport.hpp"
+#include "zmqLockstepTransport.hpp"
+#include "sharedMemoryTransport.hpp"
+#include "portLocations.hpp"
+
+#include<cstdlib>
+#include<random>
+#include<chrono>
+#include<unistd.h>
+#include<cerrno>
+
+/*
+This function sets up the parts of the transport shared by every type (with no instrumentation).
+*/
+messageTransport::messageTransport() : instrumentation(NULL), reservedMessageTimeout(-1)
+{
+}
+
+/*
+This function cleans up the transport.
+*/
+messageTransport::~messageTransport()
+{
+}
+
+/*
+This function returns a buffer that the next message (of exactly the given size) can be written into, which commitMessage then sends.  Transports that can avoid a copy hand out their own storage, while the default implementation uses a reusable buffer and sendMessage.
+@param inputMessageSize: The size of the message in bytes
+@param inputTimeoutInMilliseconds: How long to wait for space for the message/for it to be sent (-1 waits forever, 0 doesn't wait)
+@return: The buffer to write the message into or NULL if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+char *messageTransport::reserveMessage(uint64_t inputMessageSize, int inputTimeoutInMilliseconds)
+{
+reservedMessageBuffer.resize(inputMessageSize);
+reservedMessageTimeout = inputTimeoutInMilliseconds;
+return &reservedMessageBuffer[0];
+}
+
+/*
+This function sends the message written into the buffer returned by the last reserveMessage call.
+@return: True if the message was sent, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+bool messageTransport::commitMessage()
+{
+SOM_TRY
+return sendMessage(reservedMessageBuffer.c_str(), reservedMessageBuffer.size(), reservedMessageTimeout);
+SOM_CATCH("Error sending reserved message\n")
+}
+
+/*
+This function serializes the given protobuf message straight into a buffer from reserveMessage and sends it.
+@param inputMessage: The message to send
+@param inputTimeoutInMilliseconds: How long to wait for the message to be sent (-1 waits forever, 0 doesn't wait)
+@return: True if the message was sent, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+bool messageTransport::sendProtobufMessage(const google::protobuf::MessageLite &inputMessage, int inputTimeoutInMilliseconds)
+{
+uint64_t startTime = instrumentation != NULL ? stepInstrumentation::getTime() : 0;
+uint64_t messageSize = inputMessage.ByteSizeLong();
+
+char *messageBuffer = NULL;
+SOM_TRY
+messageBuffer = reserveMessage(messageSize, inputTimeoutInMilliseconds);
+SOM_CATCH("Error reserving space for message\n")
+
+if(messageBuffer == NULL)
+{
+return false;
+}
+
+uint64_t serializeStartTime = instrumentation != NULL ? stepInstrumentation::getTime() : 0;
+inputMessage.SerializeWithCachedSizesToArray((uint8_t *) messageBuffer);
+uint64_t serializeEndTime = instrumentation != NULL ? stepInstrumentation::getTime() : 0;
+
+bool messageSent = false;
+SOM_TRY
+messageSent = commitMessage();
+SOM_CATCH("Error sending message\n")
+
+if(instrumentation != NULL)
+{
+//Reserving and committing the message are both part of sending it
+instrumentation->recordSerializeTime(serializeEndTime - serializeStartTime);
+instrumentation->recordSendTime((serializeStartTime - startTime) + (stepInstrumentation::getTime() - serializeEndTime));
+if(messageSent)
+{
+instrumentation->countSentMessage(messageSize);
+}
+}
+
+return messageSent;
+}
+
+/*
+This function fills in a zmq_poll item that becomes readable (ZMQ_POLLIN) when receiveMessage may have a message to return, so that many transports can be waited on at once.  Transports that can't be waited on this way return false, and have to be checked with isMessageWaiting instead.
+@param outputPollItem: The poll item (with events set to ZMQ_POLLIN)
+@return: True if the transport can be polled
+*/
+bool messageTransport::getPollItem(zmq_pollitem_t &outputPollItem)
+{
+return false;
+}
+
+/*
+This function returns a file descriptor that becomes readable when receiveMessage may have a message to return, for use with select/poll/epoll.  For ZMQ sockets this is ZMQ_FD, which is edge triggered: once it becomes readable, isMessageWaiting has to be checked (and messages received) until it returns false before waiting on the descriptor again.
+@return: The file descriptor (-1 if the transport doesn't have one)
+@exceptions: This function can throw exceptions
+*/
+int messageTransport::getFileDescriptor()
+{
+zmq_pollitem_t pollItem;
+if(!getPollItem(pollItem))
+{
+return -1;
+}
+
+if(pollItem.socket == NULL)
+{
+return pollItem.fd;
+}
+
+int fileDescriptor = -1;
+size_t fileDescriptorSize = sizeof(fileDescriptor);
+if(zmq_getsockopt(pollItem.socket, ZMQ_FD, &fileDescriptor, &fileDescriptorSize) != 0)
+{
+throw SOMException("Error getting ZMQ_FD of socket\n", ZMQ_ERROR, __FILE__, __LINE__);
+}
+
+return fileDescriptor;
+}
+
+/*
+This function checks, without waiting or receiving anything, whether receiveMessage(0) may return a message.
+@return: True if a message may be waiting (transports that can't tell always return true)
+@exceptions: This function can throw exceptions
+*/
+bool messageTransport::isMessageWaiting()
+{
+zmq_pollitem_t pollItem;
+if(!getPollItem(pollItem))
+{
+return true;
+}
+
+//This also rearms ZMQ_FD, since it reads ZMQ_EVENTS
+if(zmq_poll(&pollItem, 1, 0) < 0)
+{
+throw SOMException("Error polling socket\n", ZMQ_ERROR, __FILE__, __LINE__);
+}
+
+return (pollItem.revents & ZMQ_POLLIN) != 0;
+}
+
+/*
+This function sets where the time spent serializing and sending messages (with sendProtobufMessage or the fixed layout functions) is recorded.
+@param inputInstrumentation: The instrumentation to record to (NULL to stop recording), which must outlive the transport
+*/
+void messageTransport::setInstrumentation(stepInstrumentation *inputInstrumentation)
+{
+instrumentation = inputInstrumentation;
+}
+
+/*
+This function returns the instrumentation that sends are recorded to.
+@return: The instrumentation or NULL if sends aren't being recorded
+*/
+stepInstrumentation *messageTransport::getInstrumentation()
+{
+return instrumentation;
+}
+
+/*
+This function creates a transport of the given type.
+@param inputTransportType: Which kind of transport to create
+@param inputRole: Which side of the session the transport is for
+@param inputContext: The ZMQ context to create any sockets with
+@param inputGameEndpoint: The endpoint that the game binds to (and the AI connects to)
+@param inputAIEndpoint: The endpoint that the AI binds to (and the game connects to), which only transports with a connection in each direction use
+@param inputRoutingID: The routing ID an AI connects to a multi-agent game with (see getAgentRoutingID), which only LOCKSTEP_TRANSPORT uses
+@return: The new transport
+@exceptions: This function can throw exceptions
+*/
+std::unique_ptr<messageTransport> createMessageTransport(transportType inputTransportType, transportRole inputRole, zmq::context_t &inputContext, const std::string &inputGameEndpoint, const std::string &inputAIEndpoint, const std::string &inputRoutingID)
+{
+std::unique_ptr<messageTransport> transport;
+
+switch(inputTransportType)
+{
+case PUB_SUB_TRANSPORT:
+SOM_TRY
+transport.reset(new zmqPublishSubscribeTransport(inputRole, inputContext, inputGameEndpoint, inputAIEndpoint));
+SOM_CATCH("Error creating publish/subscribe transport\n")
+break;
+
+case LOCKSTEP_TRANSPORT:
+SOM_TRY
+transport.reset(new zmqLockstepTransport(inputRole, inputContext, inputGameEndpoint, inputRoutingID));
+SOM_CATCH("Error creating lockstep transport\n")
+break;
+
+case SHARED_MEMORY_TRANSPORT:
+SOM_TRY
+transport.reset(new sharedMemoryTransport(inputRole, inputGameEndpoint));
+SOM_CATCH("Error creating shared memory transport\n")
+break;
+
+default:
+throw SOMException("Error, unknown transport type\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+return transport;
+}
+
+/*
+This function returns the endpoint the game binds to when none is given.  AIARENA_GAME_ENDPOINT is used if it is set, otherwise the endpoint for the session in AIARENA_SESSION_ID (or session 0 if that isn't set either).
+@param inputTransportType: The transport the endpoint is for
+@return: The default game endpoint
+@exceptions: This function can throw exceptions (if AIARENA_SESSION_ID isn't a valid session ID)
+*/
+std::string getDefaultGameEndpoint(transportType inputTransportType)
+{
+const char *endpoint = getenv(GAME_ENDPOINT_ENVIRONMENT_VARIABLE);
+if(endpoint != NULL && endpoint[0] != '\0')
+{
+return endpoint;
+}
+
+SOM_TRY
+return getSessionGameEndpoint(inputTransportType, getSessionIDFromEnvironment());
+SOM_CATCH("Error getting game endpoint for session\n")
+}
+
+/*
+This function returns the endpoint the AI binds to when none is given.  AIARENA_AI_ENDPOINT is used if it is set, otherwise the endpoint for the session in AIARENA_SESSION_ID (or session 0 if that isn't set either).
+@param inputTransportType: The transport the endpoint is for
+@return: The default AI endpoint (empty if the transport doesn't use one)
+@exceptions: This function can throw exceptions (if AIARENA_SESSION_ID isn't a valid session ID)
+*/
+std::string getDefaultAIEndpoint(transportType inputTransportType)
+{
+const char *endpoint = getenv(AI_ENDPOINT_ENVIRONMENT_VARIABLE);
+if(endpoint != NULL && endpoint[0] != '\0')
+{
+return endpoint;
+}
+
+SOM_TRY
+return getSessionAIEndpoint(inputTransportType, getSessionIDFromEnvironment());
+SOM_CATCH("Error getting AI endpoint for session\n")
+}
+
+/*
+This function returns the TCP port the given base port moves to for the given session.
+@param inputBasePort: The port session 0 uses
+@param inputSessionID: The session to get the port for
+@return: The port for the session
+@exceptions: This function can throw exceptions (if the port would be past 65535)
+*/
+static uint32_t getSessionPort(uint32_t inputBasePort, uint32_t inputSessionID)
+{
+uint64_t port = inputBasePort + 2*((uint64_t) inputSessionID);
+if(port > 65535)
+{
+throw SOMException("Error, session ID " + std::to_string(inputSessionID) + " is too large to have a port\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+return port;
+}
+
+/*
+This function returns the endpoint the game binds to for the given session.  Session 0 uses GAMEPORT (or the matching shared memory segment) and each later session moves up by 2 ports, so that sessions never share an endpoint.
+@param inputTransportType: The transport the endpoint is for
+@param inputSessionID: The session to get the endpoint for
+@return: The game endpoint for the session
+@exceptions: This function can throw exceptions (if the session ID would need a port that doesn't exist)
+*/
+std::string getSessionGameEndpoint(transportType inputTransportType, uint32_t inputSessionID)
+{
+uint32_t port = 0;
+SOM_TRY
+port = getSessionPort(GAMEPORT, inputSessionID);
+SOM_CATCH("Error getting game port for session\n")
+
+if(inputTransportType == SHARED_MEMORY_TRANSPORT)
+{
+return "shm://AIArena" + std::to_string(port);
+}
+
+return "tcp://127.0.0.1:" + std::to_string(port);
+}
+
+/*
+This function returns the endpoint the AI binds to for the given session (AIPORT moved up by 2 ports for each session).
+@param inputTransportType: The transport the endpoint is for
+@param inputSessionID: The session to get the endpoint for
+@return: The AI endpoint for the session (empty if the transport doesn't use one)
+@exceptions: This function can throw exceptions (if the session ID would need a port that doesn't exist)
+*/
+std::string getSessionAIEndpoint(transportType inputTransportType, uint32_t inputSessionID)
+{
+if(inputTransportType != PUB_SUB_TRANSPORT)
+{
+return "";
+}
+
+SOM_TRY
+return "tcp://127.0.0.1:" + std::to_string(getSessionPort(AIPORT, inputSessionID));
+SOM_CATCH("Error getting AI port for session\n")
+}
+
+/*
+This function returns the agent index an AI plays when none is given, which is taken from AIARENA_AGENT_INDEX.
+@return: The agent index (-1 if AIARENA_AGENT_INDEX isn't set, for an ordinary single AI game)
+@exceptions: This function can throw exceptions (if AIARENA_AGENT_INDEX isn't a valid agent index)
+*/
+int getDefaultAgentIndex()
+{
+const char *agentIndexString = getenv(AGENT_INDEX_ENVIRONMENT_VARIABLE);
+if(agentIndexString == NULL || agentIndexString[0] == '\0')
+{
+return -1;
+}
+
+char *end = NULL;
+errno = 0;
+long agentIndex = strtol(agentIndexString, &end, 10);
+if(*end != '\0' || errno != 0 || agentIndex < 0 || agentIndex > INT32_MAX)
+{
+throw SOMException(std::string("Error, ") + AGENT_INDEX_ENVIRONMENT_VARIABLE + " is not a valid agent index\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+return agentIndex;
+}
+
+/*
+This function returns the routing ID that the AI playing the given agent of a multi-agent game connects with, which is how the game tells its agents apart.
+@param inputAgentIndex: The agent's index
+@return: The routing ID
+*/
+std::string getAgentRoutingID(uint32_t inputAgentIndex)
+{
+return "agent" + std::to_string(inputAgentIndex);
+}
+
+/*
+This function returns the session ID given in the AIARENA_SESSION_ID environment variable.
+@return: The session ID (0 if the variable isn't set)
+@exceptions: This function can throw exceptions (if the variable isn't a valid session ID)
+*/
+uint32_t getSessionIDFromEnvironment()
+{
+const char *sessionIDString = getenv(SESSION_ID_ENVIRONMENT_VARIABLE);
+if(sessionIDString == NULL || sessionIDString[0] == '\0')
+{
+return 0;
+}
+
+char *end = NULL;
+errno = 0;
+unsigned long long sessionID = strtoull(sessionIDString, &end, 10);
+if(*end != '\0' || errno != 0 || sessionIDString[0] == '-' || sessionID > UINT32_MAX)
+{
+throw SOMException(std::string("Error, ") + SESSION_ID_ENVIRONMENT_VARIABLE + " is not a valid session ID\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+return sessionID;
+}
+
+/*
+This function picks a random nonzero number for an interface to identify itself with in its handshake messages (the instance_id field), so that the other side can tell when it has been restarted.
+@return: The instance ID
+*/
+uint64_t createInstanceID()
+{
+//random_device alone may be deterministic on some platforms, so the time and process are mixed in too
+std::random_device randomDevice;
+uint64_t instanceID = (((uint64_t) randomDevice()) << 32) ^ randomDevice();
+instanceID ^= (uint64_t) std::chrono::steady_clock::now().time_since_epoch().count() * 0x9e3779b97f4a7c15ULL;
+instanceID ^= ((uint64_t) getpid()) << 17;
+
+return instanceID != 0 ? instanceID : 1;
+}
@@ -0,0 +1,236 @@
+#ifndef MESSAGETRANSPORTHPP
+#define MESSAGETRANSPORTHPP
+
+#include<memory>
+#include<string>
+#include<cstdint>
+#include "zmq.hpp"
+#include <google/protobuf/message_lite.h>
+
+#include "SOMException.hpp"
+#include "stepInstrumentation.hpp"
+
+/*
+The different ways that a game and an AI can be connected to each other.
+PUB_SUB_TRANSPORT: The original scheme.  Each side publishes on its own port, so messages sent before the other side has subscribed are lost and the AI has to use sequence numbers to skip stale percepts.
+LOCKSTEP_TRANSPORT: A single bidirectional connection that delivers every message exactly once and in order, so each step is one round trip with no retries or skipped messages.
+SHARED_MEMORY_TRANSPORT: A pair of single producer/single consumer rings in POSIX shared memory (game and AI on the same host only).  Messages are written straight into the ring by the sender and read in place by the receiver.  Endpoints look like "shm://sessionName".
+*/
+enum transportType
+{
+PUB_SUB_TRANSPORT,
+LOCKSTEP_TRANSPORT,
+SHARED_MEMORY_TRANSPORT
+};
+
+/*
+Which side of a session a transport is being created for.
+*/
+enum transportRole
+{
+GAME_ENGINE_ROLE,
+AI_ROLE
+};
+
+/*
+This class is the interface the communication interfaces use to move serialized messages between the game and the AI, so that they don't need to know which transport is being used underneath.
+*/
+class messageTransport
+{
+public:
+/*
+This function sets up the parts of the transport shared by every type (with no instrumentation).
+*/
+messageTransport();
+
+/*
+This function cleans up the transport.
+*/
+virtual ~messageTransport();
+
+/*
+This function sends the given message to the other side of the session.
+@param inputMessage: The serialized message to send
+@param inputMessageSize: The size of the message in bytes
+@param inputTimeoutInMilliseconds: How long to wait for the message to be accepted for sending (-1 waits forever, 0 returns immediately if it can't be sent)
+@return: True if the message was sent, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+virtual bool sendMessage(const char *inputMessage, uint64_t inputMessageSize, int inputTimeoutInMilliseconds) = 0;
+
+/*
+This function returns a buffer that the next message (of exactly the given size) can be written into, which commitMessage then sends.  Transports that can avoid a copy hand out their own storage, while the default implementation uses a reusable buffer and sendMessage.
+@param inputMessageSize: The size of the message in bytes
+@param inputTimeoutInMilliseconds: How long to wait for space for the message/for it to be sent (-1 waits forever, 0 doesn't wait)
+@return: The buffer to write the message into or NULL if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+virtual char *reserveMessage(uint64_t inputMessageSize, int inputTimeoutInMilliseconds);
+
+/*
+This function sends the message written into the buffer returned by the last reserveMessage call.
+@return: True if the message was sent, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+virtual bool commitMessage();
+
+/*
+This function serializes the given protobuf message straight into a buffer from reserveMessage and sends it.
+@param inputMessage: The message to send
+@param inputTimeoutInMilliseconds: How long to wait for the message to be sent (-1 waits forever, 0 doesn't wait)
+@return: True if the message was sent, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+bool sendProtobufMessage(const google::protobuf::MessageLite &inputMessage, int inputTimeoutInMilliseconds);
+
+/*
+This function waits for the next message from the other side of the session.  The message can be accessed with getReceivedMessageData/getReceivedMessageSize and stays valid until the next call to this function.
+@param inputTimeoutInMilliseconds: How long to wait for a message (-1 waits forever, 0 returns immediately if nothing is available)
+@return: True if a message was received, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+virtual bool receiveMessage(int inputTimeoutInMilliseconds) = 0;
+
+/*
+This function returns a pointer to the contents of the last received message.
+@return: The message bytes
+*/
+virtual const char *getReceivedMessageData() = 0;
+
+/*
+This function returns the size of the last received message.
+@return: The size of the message in bytes
+*/
+virtual uint64_t getReceivedMessageSize() = 0;
+
+/*
+This function returns true if messages sent on this transport can be lost or arrive more than once (so the receiver has to resend/filter using sequence numbers).
+@return: True if the transport can drop or repeat messages
+*/
+virtual bool canDropMessages() = 0;
+
+/*
+This function fills in a zmq_poll item that becomes readable (ZMQ_POLLIN) when receiveMessage may have a message to return, so that many transports can be waited on at once.  Transports that can't be waited on this way return false, and have to be checked with isMessageWaiting instead.
+@param outputPollItem: The poll item (with events set to ZMQ_POLLIN)
+@return: True if the transport can be polled
+*/
+virtual bool getPollItem(zmq_pollitem_t &outputPollItem);
+
+/*
+This function returns a file descriptor that becomes readable when receiveMessage may have a message to return, for use with select/poll/epoll.  For ZMQ sockets this is ZMQ_FD, which is edge triggered: once it becomes readable, isMessageWaiting has to be checked (and messages received) until it returns false before waiting on the descriptor again.
+@return: The file descriptor (-1 if the transport doesn't have one)
+@exceptions: This function can throw exceptions
+*/
+virtual int getFileDescriptor();
+
+/*
+This function checks, without waiting or receiving anything, whether receiveMessage(0) may return a message.
+@return: True if a message may be waiting (transports that can't tell always return true)
+@exceptions: This function can throw exceptions
+*/
+virtual bool isMessageWaiting();
+
+/*
+This function sets where the time spent serializing and sending messages (with sendProtobufMessage or the fixed layout functions) is recorded.
+@param inputInstrumentation: The instrumentation to record to (NULL to stop recording), which must outlive the transport
+*/
+void setInstrumentation(stepInstrumentation *inputInstrumentation);
+
+/*
+This function returns the instrumentation that sends are recorded to.
+@return: The instrumentation or NULL if sends aren't being recorded
+*/
+stepInstrumentation *getInstrumentation();
+
+private:
+stepInstrumentation *instrumentation;
+std::string reservedMessageBuffer; //Used by the default reserveMessage/commitMessage
+int reservedMessageTimeout;
+};
+
+/*
+This function creates a transport of the given type.
+@param inputTransportType: Which kind of transport to create
+@param inputRole: Which side of the session the transport is for
+@param inputContext: The ZMQ context to create any sockets with
+@param inputGameEndpoint: The endpoint that the game binds to (and the AI connects to)
+@param inputAIEndpoint: The endpoint that the AI binds to (and the game connects to), which only transports with a connection in each direction use
+@param inputRoutingID: The routing ID an AI connects to a multi-agent game with (see getAgentRoutingID), which only LOCKSTEP_TRANSPORT uses
+@return: The new transport
+@exceptions: This function can throw exceptions
+*/
+std::unique_ptr<messageTransport> createMessageTransport(transportType inputTransportType, transportRole inputRole, zmq::context_t &inputContext, const std::string &inputGameEndpoint, const std::string &inputAIEndpoint, const std::string &inputRoutingID = "");
+
+//Environment variables that override the endpoints used when none are given to the communication interfaces (so many game/AI pairs can run on the same host without being recompiled)
+#define GAME_ENDPOINT_ENVIRONMENT_VARIABLE "AIARENA_GAME_ENDPOINT"
+#define AI_ENDPOINT_ENVIRONMENT_VARIABLE "AIARENA_AI_ENDPOINT"
+#define SESSION_ID_ENVIRONMENT_VARIABLE "AIARENA_SESSION_ID"
+
+//Environment variable giving the index of the agent an AI plays in a multi-agent game (see multiAgentGameCommunicationInterface)
+#define AGENT_INDEX_ENVIRONMENT_VARIABLE "AIARENA_AGENT_INDEX"
+
+/*
+This function returns the endpoint the game binds to when none is given.  AIARENA_GAME_ENDPOINT is used if it is set, otherwise the endpoint for the session in AIARENA_SESSION_ID (or session 0 if that isn't set either).
+@param inputTransportType: The transport the endpoint is for
+@return: The default game endpoint
+@exceptions: This function can throw exceptions (if AIARENA_SESSION_ID isn't a valid session ID)
+*/
+std::string getDefaultGameEndpoint(transportType inputTransportType);
+
+/*
+This function returns the endpoint the AI binds to when none is given.  AIARENA_AI_ENDPOINT is used if it is set, otherwise the endpoint for the session in AIARENA_SESSION_ID (or session 0 if that isn't set either).
+@param inputTransportType: The transport the endpoint is for
+@return: The default AI endpoint (empty if the transport doesn't use one)
+@exceptions: This function can throw exceptions (if AIARENA_SESSION_ID isn't a valid session ID)
+*/
+std::string getDefaultAIEndpoint(transportType inputTransportType);
+
+/*
+This function returns the endpoint the game binds to for the given session.  Session 0 uses GAMEPORT (or the matching shared memory segment) and each later session moves up by 2 ports, so that sessions never share an endpoint.
+@param inputTransportType: The transport the endpoint is for
+@param inputSessionID: The session to get the endpoint for
+@return: The game endpoint for the session
+@exceptions: This function can throw exceptions (if the session ID would need a port that doesn't exist)
+*/
+std::string getSessionGameEndpoint(transportType inputTransportType, uint32_t inputSessionID);
+
+/*
+This function returns the endpoint the AI binds to for the given session (AIPORT moved up by 2 ports for each session).
+@param inputTransportType: The transport the endpoint is for
+@param inputSessionID: The session to get the endpoint for
+@return: The AI endpoint for the session (empty if the transport doesn't use one)
+@exceptions: This function can throw exceptions (if the session ID would need a port that doesn't exist)
+*/
+std::string getSessionAIEndpoint(transportType inputTransportType, uint32_t inputSessionID);
+
+/*
+This function returns the agent index an AI plays when none is given, which is taken from AIARENA_AGENT_INDEX.
+@return: The agent index (-1 if AIARENA_AGENT_INDEX isn't set, for an ordinary single AI game)
+@exceptions: This function can throw exceptions (if AIARENA_AGENT_INDEX isn't a valid agent index)
+*/
+int getDefaultAgentIndex();
+
+/*
+This function returns the routing ID that the AI playing the given agent of a multi-agent game connects with, which is how the game tells its agents apart.
+@param inputAgentIndex: The agent's index
+@return: The routing ID
+*/
+std::string getAgentRoutingID(uint32_t inputAgentIndex);
+
+/*
+This function returns the session ID given in the AIARENA_SESSION_ID environment variable.
+@return: The session ID (0 if the variable isn't set)
+@exceptions: This function can throw exceptions (if the variable isn't a valid session ID)
+*/
+uint32_t getSessionIDFromEnvironment();
+
+/*
+This function picks a random nonzero number for an interface to identify itself with in its handshake messages (the instance_id field), so that the other side can tell when it has been restarted.
+@return: The instance ID
+*/
+uint64_t createInstanceID();
+
+
+
+
+#endif
@@ -0,0 +1,593 @@
+#include "multiAgentGameCommunicationInterface.hpp"
+
+#include<algorithm>
+#include<cerrno>
+
+/*
+This function binds the game endpoint (the default LOCKSTEP_TRANSPORT endpoint, see getDefaultGameEndpoint) for the agents to connect to.  The agents' connection handshakes happen when the first percepts are sent.
+@param inputNumberOfAgents: How many AIs play in the world (their agent indices go from 0 to inputNumberOfAgents - 1)
+@param inputSizeOfAIPerceptionsInBits: The number of bits of each agent's percept that the AI should use
+@param inputSizeOfExpectedActionsInBits: The number of action bits the game will accept from each agent
+@param inputStepDeadline: The number of milliseconds that the game waits for the actions after sending the percepts before using the default action for the agents that haven't answered (negative values wait for every agent)
+@param inputConnectionTimeoutInterval: The number of milliseconds that the game will wait for every agent to answer the connection handshake before throwing an exception (negative values wait forever)
+@exceptions: This function can throw exceptions
+*/
+multiAgentGameCommunicationInterface::multiAgentGameCommunicationInterface(uint32_t inputNumberOfAgents, uint64_t inputSizeOfAIPerceptionsInBits, uint64_t inputSizeOfExpectedActionsInBits, int inputStepDeadline, int inputConnectionTimeoutInterval)
+{
+SOM_TRY
+context.reset(new zmq::context_t);
+SOM_CATCH("Error initializing ZMQ context\n")
+
+SOM_TRY
+initialize(*context, getDefaultGameEndpoint(LOCKSTEP_TRANSPORT), inputNumberOfAgents, inputSizeOfAIPerceptionsInBits, inputSizeOfExpectedActionsInBits, inputStepDeadline, inputConnectionTimeoutInterval);
+SOM_CATCH("Error initializing multi-agent game communication interface\n")
+}
+
+/*
+This function binds the given endpoint for the agents to connect to using an existing ZMQ context (such as "inproc://myWorld" to run the game and the AIs as threads sharing the context).  The context must outlive this object.
+@param inputContext: The ZMQ context to create the socket with
+@param inputGameEndpoint: The endpoint that the game binds to (and that the AIs must connect to)
+@param inputNumberOfAgents: How many AIs play in the world (their agent indices go from 0 to inputNumberOfAgents - 1)
+@param inputSizeOfAIPerceptionsInBits: The number of bits of each agent's percept that the AI should use
+@param inputSizeOfExpectedActionsInBits: The number of action bits the game will accept from each agent
+@param inputStepDeadline: The number of milliseconds that the game waits for the actions after sending the percepts before using the default action for the agents that haven't answered (negative values wait for every agent)
+@param inputConnectionTimeoutInterval: The number of milliseconds that the game will wait for every agent to answer the connection handshake before throwing an exception (negative values wait forever)
+@exceptions: This function can throw exceptions
+*/
+multiAgentGameCommunicationInterface::multiAgentGameCommunicationInterface(zmq::context_t &inputContext, const std::string &inputGameEndpoint, uint32_t inputNumberOfAgents, uint64_t inputSizeOfAIPerceptionsInBits, uint64_t inputSizeOfExpectedActionsInBits, int inputStepDeadline, int inputConnectionTimeoutInterval)
+{
+SOM_TRY
+initialize(inputContext, inputGameEndpoint, inputNumberOfAgents, inputSizeOfAIPerceptionsInBits, inputSizeOfExpectedActionsInBits, inputStepDeadline, inputConnectionTimeoutInterval);
+SOM_CATCH("Error initializing multi-agent game communication interface\n")
+}
+
+/*
+This function sends each agent its percept and gathers their actions, waiting until every agent has answered or the step deadline has passed.  The first call waits for every agent to connect first.
+@param inputAIPerceptions: The percept for each agent
+@param inputRewards: The reward for each agent
+@param inputEndGame: True if this is the last percept of the current game for every agent and the next percepts start a new game
+@return: The action of each agent (the default action for the agents that missed the deadline or sent an invalid action), which stays valid until the next call
+@exceptions: This function can throw exceptions (a TIME_OUT exception if the agents don't all connect within the connection timeout)
+*/
+const std::vector<std::string> &multiAgentGameCommunicationInterface::sendPerceptionsAndGetActions(const std::vector<std::string> &inputAIPerceptions, const std::vector<uint64_t> &inputRewards, bool inputEndGame)
+{
+if(inputAIPerceptions.size() != routingIDs.size() || inputRewards.size() != routingIDs.size())
+{
+throw SOMException("Error, there must be one percept and one reward for each agent\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+if(numberOfConnectedAgents < routingIDs.size())
+{
+SOM_TRY
+waitForAgentsToConnect();
+SOM_CATCH("Error connecting to the agents\n")
+}
+
+//Work out the game state of these percepts and of the next ones
+gameState perceptGameState = currentGameState;
+currentGameState = GAME_CONTINUE;
+if(inputEndGame)
+{
+perceptGameState = GAME_OVER;
+currentGameState = GAME_START;
+std::fill(restartGameFlags.begin(), restartGameFlags.end(), false);
+}
+
+//Send every percept before waiting for any action, so the agents all work on them at the same time
+numberOfActionsReceived = 0;
+uint32_t numberOfPerceptsSent = 0;
+for(uint32_t agentIndex = 0; agentIndex < routingIDs.size(); agentIndex++)
+{
+//An agent that missed the last step may have had its AI restarted, so it is sent HELLO again first (the AI it was talking to just answers with another READY)
+if(missedDeadline[agentIndex])
+{
+SOM_TRY
+sendHelloMessage(agentIndex);
+SOM_CATCH("Error sending HELLO message\n")
+}
+
+outgoingPerceptMessage.mutable_percept()->assign(inputAIPerceptions[agentIndex]);
+outgoingPerceptMessage.set_reward(inputRewards[agentIndex]);
+outgoingPerceptMessage.set_sequence_number(sequenceCounters[agentIndex]);
+outgoingPerceptMessage.set_game_state(perceptGameState);
+if(needsSizesInPercepts[agentIndex])
+{
+outgoingPerceptMessage.set_size_of_percept_in_bits(sizeOfAIPerceptionsInBits);
+outgoingPerceptMessage.set_size_of_expected_action(sizeOfExpectedActionsInBits);
+}
+else
+{
+outgoingPerceptMessage.clear_size_of_percept_in_bits();
+outgoingPerceptMessage.clear_size_of_expected_action();
+}
+
+if(!outgoingPerceptMessage.SerializeToString(&serializedMessage))
+{
+throw SOMException("Error serializing percept message\n", AN_ASSUMPTION_WAS_VIOLATED_ERROR, __FILE__, __LINE__);
+}
+
+//Percepts are sent without waiting, so an agent whose AI has gone away or stopped reading can't hold the world up (it just misses the step and keeps its sequence numbers for the AI that takes over from it)
+bool perceptSent = false;
+SOM_TRY
+perceptSent = sendToAgent(agentIndex, serializedMessage, ZMQ_DONTWAIT);
+SOM_CATCH("Error sending percept\n")
+
+actionReceived[agentIndex] = false;
+if(perceptSent)
+{
+sequenceCounters[agentIndex]++;
+numbersOfUnansweredPercepts[agentIndex]++;
+numberOfPerceptsSent++;
+}
+}
+
+//Gather the actions until they are all in or the deadline passes
+std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+while(numberOfActionsReceived < numberOfPerceptsSent)
+{
+int timeRemaining = -1;
+if(stepDeadline >= 0)
+{
+timeRemaining = std::max<int64_t>(stepDeadline - std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count(), 0);
+}
+
+SOM_TRY
+receiveAgentMessages(timeRemaining);
+SOM_CATCH("Error getting actions\n")
+
+if(timeRemaining == 0)
+{
+break;
+}
+}
+
+for(uint32_t agentIndex = 0; agentIndex < routingIDs.size(); agentIndex++)
+{
+missedDeadline[agentIndex] = !actionReceived[agentIndex];
+if(missedDeadline[agentIndex])
+{
+currentActions[agentIndex].assign(defaultAction);
+numbersOfMissedDeadlines[agentIndex]++;
+}
+}
+
+numberOfRoundsPlayed++;
+return currentActions;
+}
+
+/*
+This function returns the actions gathered by the last call to sendPerceptionsAndGetActions.
+@return: The action of each agent
+*/
+const std::vector<std::string> &multiAgentGameCommunicationInterface::getActions()
+{
+return currentActions;
+}
+
+/*
+This function returns how many agents are in the world.
+@return: The number of agents
+*/
+uint32_t multiAgentGameCommunicationInterface::getNumberOfAgents()
+{
+return routingIDs.size();
+}
+
+/*
+This function returns true if the agent didn't answer the last percept before the step deadline (so it was given the default action).
+@param inputAgentIndex: The agent to check
+@return: True if the agent missed the last deadline
+@exceptions: This function can throw exceptions (if there is no such agent)
+*/
+bool multiAgentGameCommunicationInterface::agentMissedDeadline(uint32_t inputAgentIndex)
+{
+checkAgentIndex(inputAgentIndex);
+return missedDeadline[inputAgentIndex];
+}
+
+/*
+This function returns how many steps the agent has been given the default action in because it missed the deadline.
+@param inputAgentIndex: The agent to check
+@return: The number of missed deadlines
+@exceptions: This function can throw exceptions (if there is no such agent)
+*/
+uint64_t multiAgentGameCommunicationInterface::getNumberOfMissedDeadlines(uint32_t inputAgentIndex)
+{
+checkAgentIndex(inputAgentIndex);
+return numbersOfMissedDeadlines[inputAgentIndex];
+}
+
+/*
+This function returns how many messages from the agent couldn't be read (messages that don't parse and actions that are too short).  Each one that answered a percept gave the agent the default action for that step.
+@param inputAgentIndex: The agent to check
+@return: The number of invalid messages
+@exceptions: This function can throw exceptions (if there is no such agent)
+*/
+uint64_t multiAgentGameCommunicationInterface::getNumberOfInvalidMessages(uint32_t inputAgentIndex)
+{
+checkAgentIndex(inputAgentIndex);
+return numbersOfInvalidMessages[inputAgentIndex];
+}
+
+/*
+This function returns true if the agent has said it would like the current game to be ended prematurely.  Whether the world does that is up to the game.
+@param inputAgentIndex: The agent to check
+@return: True if the agent has asked for a new game
+@exceptions: This function can throw exceptions (if there is no such agent)
+*/
+bool multiAgentGameCommunicationInterface::AIWantsToRestartGame(uint32_t inputAgentIndex)
+{
+checkAgentIndex(inputAgentIndex);
+return restartGameFlags[inputAgentIndex];
+}
+
+/*
+This function returns true if the agent has said it would like the game engine to shut down.
+@param inputAgentIndex: The agent to check
+@return: True if the agent has asked for the session to end
+@exceptions: This function can throw exceptions (if there is no such agent)
+*/
+bool multiAgentGameCommunicationInterface::AIWantsToEndSession(uint32_t inputAgentIndex)
+{
+checkAgentIndex(inputAgentIndex);
+return endSessionFlags[inputAgentIndex];
+}
+
+/*
+This function sets how long the game waits for the actions each step.
+@param inputStepDeadline: The number of milliseconds to wait after sending the percepts before using the default action for the agents that haven't answered (negative values wait for every agent)
+*/
+void multiAgentGameCommunicationInterface::setStepDeadline(int inputStepDeadline)
+{
+stepDeadline = inputStepDeadline < 0 ? -1 : inputStepDeadline;
+}
+
+/*
+This function sets the action that agents that miss the deadline are given (all zeros unless this is called).
+@param inputDefaultAction: The action, which must hold at least the expected number of action bits
+@exceptions: This function can throw exceptions (if the action is too short)
+*/
+void multiAgentGameCommunicationInterface::setDefaultAction(const std::string &inputDefaultAction)
+{
+if(inputDefaultAction.size() < sizeOfExpectedActionsInBytes)
+{
+throw SOMException("Error, the default action is too short\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+defaultAction = inputDefaultAction;
+}
+
+/*
+This function sets the name of the game and a description of what its rewards mean, which are sent to each agent in the session description during the connection handshake.  It must be called before the first percepts are sent.
+@param inputGameName: The name of the game
+@param inputRewardDescription: What the rewards mean
+@exceptions: This function can throw exceptions (if the handshake has already happened)
+*/
+void multiAgentGameCommunicationInterface::setSessionDescription(const std::string &inputGameName, const std::string &inputRewardDescription)
+{
+if(numberOfConnectedAgents > 0)
+{
+throw SOMException("Error, the session description can only be changed before the first percepts are sent\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+gameName = inputGameName;
+rewardDescription = inputRewardDescription;
+}
+
+/*
+This function returns how many steps have been played so far.
+@return: The number of rounds played
+*/
+uint64_t multiAgentGameCommunicationInterface::getNumberOfRoundsPlayed()
+{
+return numberOfRoundsPlayed;
+}
+
+/*
+This function does the setup shared by the constructors.
+@param inputContext: The ZMQ context to create the socket with
+@param inputGameEndpoint: The endpoint that the game binds to
+@param inputNumberOfAgents: How many AIs play in the world
+@param inputSizeOfAIPerceptionsInBits: The number of bits of each agent's percept that the AI should use
+@param inputSizeOfExpectedActionsInBits: The number of action bits the game will accept from each agent
+@param inputStepDeadline: The number of milliseconds to wait for the actions each step (negative values wait for every agent)
+@param inputConnectionTimeoutInterval: The number of milliseconds to wait for every agent to connect (negative values wait forever)
+@exceptions: This function can throw exceptions
+*/
+void multiAgentGameCommunicationInterface::initialize(zmq::context_t &inputContext, const std::string &inputGameEndpoint, uint32_t inputNumberOfAgents, uint64_t inputSizeOfAIPerceptionsInBits, uint64_t inputSizeOfExpectedActionsInBits, int inputStepDeadline, int inputConnectionTimeoutInterval)
+{
+if(inputNumberOfAgents == 0)
+{
+throw SOMException("Error, a multi-agent game needs at least one agent\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+sizeOfAIPerceptionsInBits = inputSizeOfAIPerceptionsInBits;
+sizeOfExpectedActionsInBits = inputSizeOfExpectedActionsInBits;
+sizeOfExpectedActionsInBytes = (sizeOfExpectedActionsInBits + 7)/8;
+setStepDeadline(inputStepDeadline);
+connectionTimeoutInterval = inputConnectionTimeoutInterval < 0 ? -1 : inputConnectionTimeoutInterval;
+currentGameState = GAME_START;
+numberOfRoundsPlayed = 0;
+instanceID = createInstanceID();
+defaultAction.assign(sizeOfExpectedActionsInBytes, '\0');
+numberOfConnectedAgents = 0;
+numberOfActionsReceived = 0;
+
+for(uint32_t agentIndex = 0; agentIndex < inputNumberOfAgents; agentIndex++)
+{
+routingIDs.push_back(getAgentRoutingID(agentIndex));
+agentIndices[routingIDs.back()] = agentIndex;
+}
+currentActions.resize(inputNumberOfAgents, defaultAction);
+helloSent.resize(inputNumberOfAgents, false);
+connected.resize(inputNumberOfAgents, false);
+AIInstanceIDs.resize(inputNumberOfAgents, 0);
+needsSizesInPercepts.resize(inputNumberOfAgents, false);
+sequenceCounters.resize(inputNumberOfAgents, 0);
+numbersOfUnansweredPercepts.resize(inputNumberOfAgents, 0);
+actionReceived.resize(inputNumberOfAgents, false);
+missedDeadline.resize(inputNumberOfAgents, false);
+numbersOfMissedDeadlines.resize(inputNumberOfAgents, 0);
+numbersOfInvalidMessages.resize(inputNumberOfAgents, 0);
+restartGameFlags.resize(inputNumberOfAgents, false);
+endSessionFlags.resize(inputNumberOfAgents, false);
+
+//Sends to agents whose AI isn't connected fail instead of being dropped, so the game knows who it is waiting for, and an AI that connects with an agent's routing ID takes the agent over (so a restarted AI doesn't have to wait for the connection of the one before it to be cleaned up)
+SOM_TRY
+socket.reset(new zmq::socket_t(inputContext, ZMQ_ROUTER));
+int mandatory = 1;
+socket->setsockopt(ZMQ_ROUTER_MANDATORY, &mandatory, sizeof(mandatory));
+int handover = 1;
+socket->setsockopt(ZMQ_ROUTER_HANDOVER, &handover, sizeof(handover));
+socket->bind(inputGameEndpoint.c_str());
+SOM_CATCH("Error initializing router socket\n")
+}
+
+/*
+This function sends HELLO to each agent as soon as its AI has connected and waits until every agent has answered with READY.
+@exceptions: This function can throw exceptions (a TIME_OUT exception if the agents don't all answer within the connection timeout)
+*/
+void multiAgentGameCommunicationInterface::waitForAgentsToConnect()
+{
+helloMessage.set_handshake(HELLO);
+helloMessage.set_protocol_version(AIARENA_PROTOCOL_VERSION);
+helloMessage.set_instance_id(instanceID);
+sessionDescription &description = *helloMessage.mutable_session_description();
+description.set_size_of_percept_in_bits(sizeOfAIPerceptionsInBits);
+description.set_size_of_expected_action(sizeOfExpectedActionsInBits);
+description.set_game_name(gameName);
+description.set_reward_description(rewardDescription);
+
+std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+int retryInterval = 1;
+while(numberOfConnectedAgents < routingIDs.size())
+{
+//The AIs connect in their own time, so HELLO is tried again for each one that isn't there yet
+for(uint32_t agentIndex = 0; agentIndex < routingIDs.size(); agentIndex++)
+{
+if(helloSent[agentIndex])
+{
+continue;
+}
+
+SOM_TRY
+helloSent[agentIndex] = sendHelloMessage(agentIndex);
+SOM_CATCH("Error sending HELLO message\n")
+}
+
+int timeRemaining = -1;
+if(connectionTimeoutInterval >= 0)
+{
+timeRemaining = std::max<int64_t>(connectionTimeoutInterval - std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count(), 0);
+}
+
+int waitTime = timeRemaining < 0 ? retryInterval : std::min(timeRemaining, retryInterval);
+retryInterval = std::min(retryInterval*2, 100);
+
+SOM_TRY
+receiveAgentMessages(waitTime);
+SOM_CATCH("Error waiting for READY messages\n")
+
+if(timeRemaining == 0 && numberOfConnectedAgents < routingIDs.size())
+{
+throw SOMException("Error, " + std::to_string(routingIDs.size() - numberOfConnectedAgents) + " of the agents did not answer the connection handshake\n", TIME_OUT, __FILE__, __LINE__);
+}
+}
+}
+
+/*
+This function sends the HELLO message (set up by waitForAgentsToConnect) to an agent without waiting, carrying the sequence number of the next percept the agent will be sent.
+@param inputAgentIndex: The agent to send to
+@return: False if the agent's AI isn't connected (or the message couldn't be sent without waiting)
+@exceptions: This function can throw exceptions
+*/
+bool multiAgentGameCommunicationInterface::sendHelloMessage(uint32_t inputAgentIndex)
+{
+helloMessage.set_sequence_number(sequenceCounters[inputAgentIndex]);
+if(!helloMessage.SerializeToString(&serializedMessage))
+{
+throw SOMException("Error serializing HELLO message\n", AN_ASSUMPTION_WAS_VIOLATED_ERROR, __FILE__, __LINE__);
+}
+
+bool helloMessageSent = false;
+SOM_TRY
+helloMessageSent = sendToAgent(inputAgentIndex, serializedMessage, ZMQ_DONTWAIT);
+SOM_CATCH("Error sending HELLO message\n")
+return helloMessageSent;
+}
+
+/*
+This function sends the serialized message to an agent.
+@param inputAgentIndex: The agent to send to
+@param inputMessage: The serialized message
+@param inputFlags: The flags to send with (such as ZMQ_DONTWAIT)
+@return: False if the agent's AI isn't connected (or the message couldn't be sent without waiting)
+@exceptions: This function can throw exceptions
+*/
+bool multiAgentGameCommunicationInterface::sendToAgent(uint32_t inputAgentIndex, const std::string &inputMessage, int inputFlags)
+{
+const std::string &routingID = routingIDs[inputAgentIndex];
+if(zmq_send((void *) (*socket), routingID.c_str(), routingID.size(), inputFlags | ZMQ_SNDMORE) < 0)
+{
+if(zmq_errno() == EHOSTUNREACH || zmq_errno() == EAGAIN)
+{
+return false;
+}
+throw SOMException(std::string("Error sending routing ID: ") + zmq_strerror(zmq_errno()) + "\n", ZMQ_ERROR, __FILE__, __LINE__);
+}
+
+//Once the routing ID is accepted, the rest of the message is too
+if(zmq_send((void *) (*socket), inputMessage.c_str(), inputMessage.size(), inputFlags) < 0)
+{
+throw SOMException(std::string("Error sending message: ") + zmq_strerror(zmq_errno()) + "\n", ZMQ_ERROR, __FILE__, __LINE__);
+}
+
+return true;
+}
+
+/*
+This function waits for messages from the agents and reads all of the ones that have arrived.
+@param inputTimeoutInMilliseconds: How long to wait for the first message (-1 waits forever, 0 doesn't wait)
+@exceptions: This function can throw exceptions
+*/
+void multiAgentGameCommunicationInterface::receiveAgentMessages(int inputTimeoutInMilliseconds)
+{
+zmq_pollitem_t pollItem;
+pollItem.socket = (void *) (*socket);
+pollItem.fd = 0;
+pollItem.events = ZMQ_POLLIN;
+pollItem.revents = 0;
+
+SOM_TRY
+if(zmq::poll(&pollItem, 1, inputTimeoutInMilliseconds) == 0)
+{
+return;
+}
+SOM_CATCH("Error waiting for messages\n")
+
+while(true)
+{
+bool messageReceived = false;
+SOM_TRY
+messageReceived = socket->recv(&receivedRoutingID, ZMQ_DONTWAIT);
+SOM_CATCH("Error receiving routing ID\n")
+
+if(!messageReceived)
+{
+return;
+}
+
+//The ROUTER socket puts the routing ID of the sender in front of each message
+if(!receivedRoutingID.more())
+{
+continue;
+}
+
+SOM_TRY
+socket->recv(&receivedMessage);
+SOM_CATCH("Error receiving message\n")
+
+std::map<std::string, uint32_t>::const_iterator agent = agentIndices.find(std::string((const char *) receivedRoutingID.data(), receivedRoutingID.size()));
+if(agent == agentIndices.end())
+{
+continue; //Not one of our agents
+}
+
+SOM_TRY
+readAgentMessage(agent->second, (const char *) receivedMessage.data(), receivedMessage.size());
+SOM_CATCH("Error reading message from agent " + std::to_string(agent->second) + "\n")
+}
+}
+
+/*
+This function reads a message from an agent: READY finishes the agent's handshake (or, if it carries a new instance ID, hands the agent over to its restarted AI) and an action answering the current percept becomes the agent's action (late actions and extra handshake messages are ignored).  A message that can't be parsed or an action that is too short only costs the agent that sent it: it is counted (see getNumberOfInvalidMessages) and taken as the agent's answer, with the default action in place of the action, so the other agents' step carries on.
+@param inputAgentIndex: The agent the message came from
+@param inputMessage: The serialized message
+@param inputMessageSize: The size of the serialized message
+*/
+void multiAgentGameCommunicationInterface::readAgentMessage(uint32_t inputAgentIndex, const char *inputMessage, uint64_t inputMessageSize)
+{
+perceptOrActionMessage &message = incomingActionMessage;
+bool messageParsed = message.ParseFromArray(inputMessage, inputMessageSize);
+
+if(messageParsed && message.has_handshake())
+{
+if(message.handshake() != READY)
+{
+return;
+}
+
+if(!connected[inputAgentIndex])
+{
+//AIs that only follow version 1 of the protocol still need the sizes in every percept
+connected[inputAgentIndex] = true;
+needsSizesInPercepts[inputAgentIndex] = message.protocol_version() < 2;
+AIInstanceIDs[inputAgentIndex] = message.instance_id();
+numberOfConnectedAgents++;
+return;
+}
+
+//A READY with a new instance ID is a restarted AI answering one of the HELLOs sent after the agent missed a step, so the agent is handed over to it.  It carries on from the sequence number in that HELLO, so the percepts sent since then are the ones it will answer.
+if(!message.has_instance_id() || message.instance_id() == AIInstanceIDs[inputAgentIndex] || message.sequence_number() > sequenceCounters[inputAgentIndex])
+{
+return; //A late answer from the AI the agent already has
+}
+
+needsSizesInPercepts[inputAgentIndex] = message.protocol_version() < 2;
+AIInstanceIDs[inputAgentIndex] = message.instance_id();
+numbersOfUnansweredPercepts[inputAgentIndex] = sequenceCounters[inputAgentIndex] - message.sequence_number();
+return;
+}
+
+//Anything else is taken to be an action, so a message that can't be read still answers the agent's percept (keeping the count of unanswered percepts right), just with the default action
+bool actionIsValid = messageParsed && message.has_action() && message.action().size() >= sizeOfExpectedActionsInBytes;
+if(!actionIsValid)
+{
+numbersOfInvalidMessages[inputAgentIndex]++;
+}
+
+if(numbersOfUnansweredPercepts[inputAgentIndex] == 0)
+{
+return; //Nothing was waiting for an action from this agent
+}
+
+//Lockstep delivers the actions in order, so an agent with more than one unanswered percept is answering one from an earlier step
+numbersOfUnansweredPercepts[inputAgentIndex]--;
+if(numbersOfUnansweredPercepts[inputAgentIndex] > 0 || actionReceived[inputAgentIndex])
+{
+return;
+}
+
+if(!actionIsValid)
+{
+currentActions[inputAgentIndex].assign(defaultAction);
+}
+else
+{
+currentActions[inputAgentIndex].assign(message.action()); //Reuses the action buffer
+if(message.has_game_state())
+{
+restartGameFlags[inputAgentIndex] = true;
+}
+if(message.has_terminate_game_session() && message.terminate_game_session())
+{
+endSessionFlags[inputAgentIndex] = true;
+}
+}
+
+actionReceived[inputAgentIndex] = true;
+numberOfActionsReceived++;
+}
+
+/*
+This function checks that the agent index refers to an agent.
+@param inputAgentIndex: The agent index
+@exceptions: This function throws an exception if there is no such agent
+*/
+void multiAgentGameCommunicationInterface::checkAgentIndex(uint32_t inputAgentIndex)
+{
+if(inputAgentIndex >= routingIDs.size())
+{
+throw SOMException("Error, there is no agent " + std::to_string(inputAgentIndex) + "\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+}
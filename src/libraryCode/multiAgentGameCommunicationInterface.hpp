@@ -0,0 +1,244 @@
+#ifndef MULTIAGENTGAMECOMMUNICATIONINTERFACEHPP
+#define MULTIAGENTGAMECOMMUNICATIONINTERFACEHPP
+
+#include<memory>
+#include<vector>
+#include<string>
+#include<map>
+#include<chrono>
+#include<cstdint>
+#include "zmq.hpp"
+
+#include "SOMException.hpp"
+#include "portLocations.hpp"
+#include "messageTransport.hpp"
+#include "perceptOrActionMessage.pb.h"
+
+/*
+This class lets one game engine run a world with several AIs in it (agents), each of which gets its own percept every step and sends back its own action.  The game binds a single ZMQ ROUTER socket and each AI connects an ordinary AICommunicationInterface to it with LOCKSTEP_TRANSPORT and its agent index (given to the constructor or in AIARENA_AGENT_INDEX), which becomes the routing ID the game addresses it by (see getAgentRoutingID).  Each AI sees an ordinary session: the same handshake, its own sequence numbers and one percept per step.
+
+Each step, the percepts are sent to every agent and then the actions are gathered until they have all arrived or the step deadline passes.  Agents that miss the deadline are given the default action for that step (and their late action is thrown away when it arrives), and percepts are sent without waiting, so a slow AI can't hold the world up.  An agent that misses a step is sent HELLO again before its next percept, so if its AI has been restarted (connecting with the same agent index) the new AI answers with READY and carries on playing the agent from there.  The percepts and actions are always sent as perceptOrActionMessages (the fixed layout wire format and delta percept encoding aren't offered).
+*/
+class multiAgentGameCommunicationInterface
+{
+public:
+/*
+This function binds the game endpoint (the default LOCKSTEP_TRANSPORT endpoint, see getDefaultGameEndpoint) for the agents to connect to.  The agents' connection handshakes happen when the first percepts are sent.
+@param inputNumberOfAgents: How many AIs play in the world (their agent indices go from 0 to inputNumberOfAgents - 1)
+@param inputSizeOfAIPerceptionsInBits: The number of bits of each agent's percept that the AI should use
+@param inputSizeOfExpectedActionsInBits: The number of action bits the game will accept from each agent
+@param inputStepDeadline: The number of milliseconds that the game waits for the actions after sending the percepts before using the default action for the agents that haven't answered (negative values wait for every agent)
+@param inputConnectionTimeoutInterval: The number of milliseconds that the game will wait for every agent to answer the connection handshake before throwing an exception (negative values wait forever)
+@exceptions: This function can throw exceptions
+*/
+multiAgentGameCommunicationInterface(uint32_t inputNumberOfAgents, uint64_t inputSizeOfAIPerceptionsInBits, uint64_t inputSizeOfExpectedActionsInBits, int inputStepDeadline = -1, int inputConnectionTimeoutInterval = 100000);
+
+/*
+This function binds the given endpoint for the agents to connect to using an existing ZMQ context (such as "inproc://myWorld" to run the game and the AIs as threads sharing the context).  The context must outlive this object.
+@param inputContext: The ZMQ context to create the socket with
+@param inputGameEndpoint: The endpoint that the game binds to (and that the AIs must connect to)
+@param inputNumberOfAgents: How many AIs play in the world (their agent indices go from 0 to inputNumberOfAgents - 1)
+@param inputSizeOfAIPerceptionsInBits: The number of bits of each agent's percept that the AI should use
+@param inputSizeOfExpectedActionsInBits: The number of action bits the game will accept from each agent
+@param inputStepDeadline: The number of milliseconds that the game waits for the actions after sending the percepts before using the default action for the agents that haven't answered (negative values wait for every agent)
+@param inputConnectionTimeoutInterval: The number of milliseconds that the game will wait for every agent to answer the connection handshake before throwing an exception (negative values wait forever)
+@exceptions: This function can throw exceptions
+*/
+multiAgentGameCommunicationInterface(zmq::context_t &inputContext, const std::string &inputGameEndpoint, uint32_t inputNumberOfAgents, uint64_t inputSizeOfAIPerceptionsInBits, uint64_t inputSizeOfExpectedActionsInBits, int inputStepDeadline = -1, int inputConnectionTimeoutInterval = 100000);
+
+/*
+This function sends each agent its percept and gathers their actions, waiting until every agent has answered or the step deadline has passed.  The first call waits for every agent to connect first.
+@param inputAIPerceptions: The percept for each agent
+@param inputRewards: The reward for each agent
+@param inputEndGame: True if this is the last percept of the current game for every agent and the next percepts start a new game
+@return: The action of each agent (the default action for the agents that missed the deadline or sent an invalid action), which stays valid until the next call
+@exceptions: This function can throw exceptions (a TIME_OUT exception if the agents don't all connect within the connection timeout)
+*/
+const std::vector<std::string> &sendPerceptionsAndGetActions(const std::vector<std::string> &inputAIPerceptions, const std::vector<uint64_t> &inputRewards, bool inputEndGame = false);
+
+/*
+This function returns the actions gathered by the last call to sendPerceptionsAndGetActions.
+@return: The action of each agent
+*/
+const std::vector<std::string> &getActions();
+
+/*
+This function returns how many agents are in the world.
+@return: The number of agents
+*/
+uint32_t getNumberOfAgents();
+
+/*
+This function returns true if the agent didn't answer the last percept before the step deadline (so it was given the default action).
+@param inputAgentIndex: The agent to check
+@return: True if the agent missed the last deadline
+@exceptions: This function can throw exceptions (if there is no such agent)
+*/
+bool agentMissedDeadline(uint32_t inputAgentIndex);
+
+/*
+This function returns how many steps the agent has been given the default action in because it missed the deadline.
+@param inputAgentIndex: The agent to check
+@return: The number of missed deadlines
+@exceptions: This function can throw exceptions (if there is no such agent)
+*/
+uint64_t getNumberOfMissedDeadlines(uint32_t inputAgentIndex);
+
+/*
+This function returns how many messages from the agent couldn't be read (messages that don't parse and actions that are too short).  Each one that answered a percept gave the agent the default action for that step.
+@param inputAgentIndex: The agent to check
+@return: The number of invalid messages
+@exceptions: This function can throw exceptions (if there is no such agent)
+*/
+uint64_t getNumberOfInvalidMessages(uint32_t inputAgentIndex);
+
+/*
+This function returns true if the agent has said it would like the current game to be ended prematurely.  Whether the world does that is up to the game.
+@param inputAgentIndex: The agent to check
+@return: True if the agent has asked for a new game
+@exceptions: This function can throw exceptions (if there is no such agent)
+*/
+bool AIWantsToRestartGame(uint32_t inputAgentIndex);
+
+/*
+This function returns true if the agent has said it would like the game engine to shut down.
+@param inputAgentIndex: The agent to check
+@return: True if the agent has asked for the session to end
+@exceptions: This function can throw exceptions (if there is no such agent)
+*/
+bool AIWantsToEndSession(uint32_t inputAgentIndex);
+
+/*
+This function sets how long the game waits for the actions each step.
+@param inputStepDeadline: The number of milliseconds to wait after sending the percepts before using the default action for the agents that haven't answered (negative values wait for every agent)
+*/
+void setStepDeadline(int inputStepDeadline);
+
+/*
+This function sets the action that agents that miss the deadline are given (all zeros unless this is called).
+@param inputDefaultAction: The action, which must hold at least the expected number of action bits
+@exceptions: This function can throw exceptions (if the action is too short)
+*/
+void setDefaultAction(const std::string &inputDefaultAction);
+
+/*
+This function sets the name of the game and a description of what its rewards mean, which are sent to each agent in the session description during the connection handshake.  It must be called before the first percepts are sent.
+@param inputGameName: The name of the game
+@param inputRewardDescription: What the rewards mean
+@exceptions: This function can throw exceptions (if the handshake has already happened)
+*/
+void setSessionDescription(const std::string &inputGameName, const std::string &inputRewardDescription);
+
+/*
+This function returns how many steps have been played so far.
+@return: The number of rounds played
+*/
+uint64_t getNumberOfRoundsPlayed();
+
+private:
+std::unique_ptr<zmq::context_t> context; //Only used if the interface wasn't given a context to share
+std::unique_ptr<zmq::socket_t> socket;
+zmq::message_t receivedRoutingID;
+zmq::message_t receivedMessage;
+std::map<std::string, uint32_t> agentIndices; //Routing ID to agent index
+
+uint64_t sizeOfAIPerceptionsInBits;
+uint64_t sizeOfExpectedActionsInBits;
+uint64_t sizeOfExpectedActionsInBytes;
+int stepDeadline;
+int connectionTimeoutInterval;
+gameState currentGameState; //The state the next percepts will have
+uint64_t numberOfRoundsPlayed;
+uint64_t instanceID; //Sent in the HELLO messages
+std::string gameName; //Sent in the session description
+std::string rewardDescription; //Sent in the session description
+std::string defaultAction;
+uint32_t numberOfConnectedAgents;
+uint32_t numberOfActionsReceived; //How many agents have answered the current percepts
+perceptOrActionMessage outgoingPerceptMessage; //Reused for every percept so that its buffers are only allocated once
+perceptOrActionMessage incomingActionMessage; //Reused for every action for the same reason
+perceptOrActionMessage helloMessage; //Set up once the session description can't change any more and reused for every HELLO
+std::string serializedMessage; //Reused for every message sent
+
+//One entry per agent
+std::vector<std::string> routingIDs;
+std::vector<std::string> currentActions;
+std::vector<bool> helloSent;
+std::vector<bool> connected;
+std::vector<uint64_t> AIInstanceIDs; //From the agent's last READY message (0 if it didn't send one)
+std::vector<bool> needsSizesInPercepts; //True if the agent's AI follows version 1 of the protocol
+std::vector<uint64_t> sequenceCounters; //The sequence number of the next percept sent to the agent
+std::vector<uint64_t> numbersOfUnansweredPercepts; //Percepts sent to the agent that no action has arrived for (more than one means it is late)
+std::vector<bool> actionReceived; //True once the agent has answered the current percepts
+std::vector<bool> missedDeadline;
+std::vector<uint64_t> numbersOfMissedDeadlines;
+std::vector<uint64_t> numbersOfInvalidMessages;
+std::vector<bool> restartGameFlags;
+std::vector<bool> endSessionFlags;
+
+/*
+This function does the setup shared by the constructors.
+@param inputContext: The ZMQ context to create the socket with
+@param inputGameEndpoint: The endpoint that the game binds to
+@param inputNumberOfAgents: How many AIs play in the world
+@param inputSizeOfAIPerceptionsInBits: The number of bits of each agent's percept that the AI should use
+@param inputSizeOfExpectedActionsInBits: The number of action bits the game will accept from each agent
+@param inputStepDeadline: The number of milliseconds to wait for the actions each step (negative values wait for every agent)
+@param inputConnectionTimeoutInterval: The number of milliseconds to wait for every agent to connect (negative values wait forever)
+@exceptions: This function can throw exceptions
+*/
+void initialize(zmq::context_t &inputContext, const std::string &inputGameEndpoint, uint32_t inputNumberOfAgents, uint64_t inputSizeOfAIPerceptionsInBits, uint64_t inputSizeOfExpectedActionsInBits, int inputStepDeadline, int inputConnectionTimeoutInterval);
+
+/*
+This function sends HELLO to each agent as soon as its AI has connected and waits until every agent has answered with READY.
+@exceptions: This function can throw exceptions (a TIME_OUT exception if the agents don't all answer within the connection timeout)
+*/
+void waitForAgentsToConnect();
+
+/*
+This function sends the HELLO message (set up by waitForAgentsToConnect) to an agent without waiting, carrying the sequence number of the next percept the agent will be sent.
+@param inputAgentIndex: The agent to send to
+@return: False if the agent's AI isn't connected (or the message couldn't be sent without waiting)
+@exceptions: This function can throw exceptions
+*/
+bool sendHelloMessage(uint32_t inputAgentIndex);
+
+/*
+This function sends the serialized message to an agent.
+@param inputAgentIndex: The agent to send to
+@param inputMessage: The serialized message
+@param inputFlags: The flags to send with (such as ZMQ_DONTWAIT)
+@return: False if the agent's AI isn't connected (or the message couldn't be sent without waiting)
+@exceptions: This function can throw exceptions
+*/
+bool sendToAgent(uint32_t inputAgentIndex, const std::string &inputMessage, int inputFlags);
+
+/*
+This function waits for messages from the agents and reads all of the ones that have arrived.
+@param inputTimeoutInMilliseconds: How long to wait for the first message (-1 waits forever, 0 doesn't wait)
+@exceptions: This function can throw exceptions
+*/
+void receiveAgentMessages(int inputTimeoutInMilliseconds);
+
+/*
+This function reads a message from an agent: READY finishes the agent's handshake (or, if it carries a new instance ID, hands the agent over to its restarted AI) and an action answering the current percept becomes the agent's action (late actions and extra handshake messages are ignored).  A message that can't be parsed or an action that is too short only costs the agent that sent it: it is counted (see getNumberOfInvalidMessages) and taken as the agent's answer, with the default action in place of the action, so the other agents' step carries on.
+@param inputAgentIndex: The agent the message came from
+@param inputMessage: The serialized message
+@param inputMessageSize: The size of the serialized message
+*/
+void readAgentMessage(uint32_t inputAgentIndex, const char *inputMessage, uint64_t inputMessageSize);
+
+/*
+This function checks that the agent index refers to an agent.
+@param inputAgentIndex: The agent index
+@exceptions: This function throws an exception if there is no such agent
+*/
+void checkAgentIndex(uint32_t inputAgentIndex);
+};
+
+
+
+
+
+
+#endif
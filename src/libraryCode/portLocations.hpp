@@ -1,2 +1,5 @@
 #define GAMEPORT 10001
 #define AIPORT   10002
+
+//Version of the AI Arena protocol that this library follows (sent in the protocol_version field of HELLO/READY).  Version 1 (leaving the field out) is the handshake as it was first added, and version 2 added the session description, which is sent once in HELLO instead of in every percept.  Peers from before the handshake existed aren't supported
+#define AIARENA_PROTOCOL_VERSION 2
@@ -0,0 +1,230 @@
+#include "sessionPoller.hpp"
+
+#include<cerrno>
+#include<chrono>
+#include<thread>
+#include<algorithm>
+
+/*
+This function creates a poller with no sessions.
+*/
+sessionPoller::sessionPoller() : pollItemsNeedUpdate(false)
+{
+}
+
+/*
+This function adds a game's session to the poller.
+@param inputSession: The game's communication interface
+@return: The index that wait uses for the session
+*/
+uint32_t sessionPoller::addSession(gameEngineCommunicationInterface &inputSession)
+{
+polledSession session;
+session.game = &inputSession;
+session.AI = NULL;
+sessions.push_back(session);
+pollItemsNeedUpdate = true;
+
+return sessions.size() - 1;
+}
+
+/*
+This function adds an AI's session to the poller.
+@param inputSession: The AI's communication interface
+@return: The index that wait uses for the session
+*/
+uint32_t sessionPoller::addSession(AICommunicationInterface &inputSession)
+{
+polledSession session;
+session.game = NULL;
+session.AI = &inputSession;
+sessions.push_back(session);
+pollItemsNeedUpdate = true;
+
+return sessions.size() - 1;
+}
+
+/*
+This function stops waiting on a session (the indexes of the other sessions don't change).
+@param inputSessionIndex: The index addSession returned for the session
+@exceptions: This function can throw exceptions (if there is no such session)
+*/
+void sessionPoller::removeSession(uint32_t inputSessionIndex)
+{
+if(inputSessionIndex >= sessions.size() || (sessions[inputSessionIndex].game == NULL && sessions[inputSessionIndex].AI == NULL))
+{
+throw SOMException("Error, session is not in the poller\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+sessions[inputSessionIndex].game = NULL;
+sessions[inputSessionIndex].AI = NULL;
+pollItemsNeedUpdate = true;
+}
+
+/*
+This function removes all of the sessions (the next session added gets index 0).
+*/
+void sessionPoller::clear()
+{
+sessions.clear();
+pollItemsNeedUpdate = true;
+}
+
+/*
+This function waits until at least one of the sessions has something to do.  The sessions that are returned should then be stepped with tryGetActions/tryUpdatePerceptions (with no timeout), which may still find that there is nothing to do (such as when the message was a stale percept).  Sessions that aren't waiting on their other side shouldn't be left in the poller, since messages that arrive for them keep wait returning.
+@param inputTimeoutInMilliseconds: How long to wait (-1 waits forever, 0 just checks)
+@param outputReadySessions: The indexes of the sessions that have something to do (empty if the wait timed out)
+@return: True if any sessions are ready, false if the wait timed out
+@exceptions: This function can throw exceptions (including if there are no sessions to wait on)
+*/
+bool sessionPoller::wait(int inputTimeoutInMilliseconds, std::vector<uint32_t> &outputReadySessions)
+{
+outputReadySessions.clear();
+if(pollItemsNeedUpdate)
+{
+updatePollItems();
+}
+
+if(pollItems.empty() && unpollableSessionIndexes.empty())
+{
+throw SOMException("Error, there are no sessions to wait on\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+uint32_t numberOfIdleChecks = 0;
+while(true)
+{
+//Work out how much of the timeout is left
+int pollTimeout = -1;
+if(inputTimeoutInMilliseconds >= 0)
+{
+int timeElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+pollTimeout = std::max(inputTimeoutInMilliseconds - timeElapsed, 0);
+}
+
+//Games that are connecting or have an action timeout need to be polled on time even if nothing arrives
+for(uint32_t sessionIndex : gameSessionIndexes)
+{
+int timeUntilNextPoll = sessions[sessionIndex].game->getTimeUntilNextPoll();
+if(timeUntilNextPoll == 0)
+{
+markSessionReady(sessionIndex, outputReadySessions);
+}
+else if(timeUntilNextPoll > 0)
+{
+pollTimeout = pollTimeout < 0 ? timeUntilNextPoll : std::min(pollTimeout, timeUntilNextPoll);
+}
+}
+
+SOM_TRY
+for(uint32_t sessionIndex : unpollableSessionIndexes)
+{
+const polledSession &session = sessions[sessionIndex];
+if(session.game != NULL ? session.game->isMessageWaiting() : session.AI->isMessageWaiting())
+{
+markSessionReady(sessionIndex, outputReadySessions);
+}
+}
+SOM_CATCH("Error checking shared memory session\n")
+
+if(!unpollableSessionIndexes.empty())
+{
+int checkInterval = numberOfIdleChecks < SESSION_POLLER_IDLE_CHECKS_BEFORE_SLEEPING ? 0 : 1;
+pollTimeout = pollTimeout < 0 ? checkInterval : std::min(pollTimeout, checkInterval);
+}
+
+if(!outputReadySessions.empty())
+{
+pollTimeout = 0; //Still pick up any sockets that are ready
+}
+
+int numberOfReadyItems = zmq_poll(pollItems.data(), pollItems.size(), pollTimeout);
+if(numberOfReadyItems < 0 && zmq_errno() != EINTR)
+{
+throw SOMException("Error polling sessions\n", ZMQ_ERROR, __FILE__, __LINE__);
+}
+
+for(uint32_t itemIndex = 0; numberOfReadyItems > 0 && itemIndex < pollItems.size(); itemIndex++)
+{
+if((pollItems[itemIndex].revents & ZMQ_POLLIN) != 0)
+{
+markSessionReady(pollItemSessionIndexes[itemIndex], outputReadySessions);
+}
+}
+
+if(!outputReadySessions.empty())
+{
+for(uint32_t sessionIndex : outputReadySessions)
+{
+sessionIsReady[sessionIndex] = false;
+}
+return true;
+}
+
+if(inputTimeoutInMilliseconds >= 0 && std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count() >= inputTimeoutInMilliseconds)
+{
+return false;
+}
+
+if(!unpollableSessionIndexes.empty() && numberOfIdleChecks < SESSION_POLLER_IDLE_CHECKS_BEFORE_SLEEPING)
+{
+std::this_thread::yield();
+}
+numberOfIdleChecks++;
+}
+}
+
+/*
+This function rebuilds the poll items (and the other lists of sessions) after sessions are added or removed.
+*/
+void sessionPoller::updatePollItems()
+{
+pollItems.clear();
+pollItemSessionIndexes.clear();
+unpollableSessionIndexes.clear();
+gameSessionIndexes.clear();
+sessionIsReady.assign(sessions.size(), false);
+
+for(uint32_t sessionIndex = 0; sessionIndex < sessions.size(); sessionIndex++)
+{
+const polledSession &session = sessions[sessionIndex];
+if(session.game == NULL && session.AI == NULL)
+{
+continue; //Removed
+}
+
+if(session.game != NULL)
+{
+gameSessionIndexes.push_back(sessionIndex);
+}
+
+zmq_pollitem_t pollItem;
+if(session.game != NULL ? session.game->getPollItem(pollItem) : session.AI->getPollItem(pollItem))
+{
+pollItems.push_back(pollItem);
+pollItemSessionIndexes.push_back(sessionIndex);
+}
+else
+{
+unpollableSessionIndexes.push_back(sessionIndex);
+}
+}
+
+pollItemsNeedUpdate = false;
+}
+
+/*
+This function adds a session to the list of ready sessions (if it isn't already in it).
+@param inputSessionIndex: The session
+@param inputOutputReadySessions: The list of ready sessions
+*/
+void sessionPoller::markSessionReady(uint32_t inputSessionIndex, std::vector<uint32_t> &inputOutputReadySessions)
+{
+if(sessionIsReady[inputSessionIndex])
+{
+return;
+}
+
+sessionIsReady[inputSessionIndex] = true;
+inputOutputReadySessions.push_back(inputSessionIndex);
+}
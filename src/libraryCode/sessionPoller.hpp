@@ -0,0 +1,94 @@
+#ifndef SESSIONPOLLERHPP
+#define SESSIONPOLLERHPP
+
+#include<vector>
+#include<cstdint>
+#include "zmq.hpp"
+
+#include "SOMException.hpp"
+#include "gameEngineCommunicationInterface.hpp"
+#include "AICommunicationInterface.hpp"
+
+//How many times wait checks sessions that can't be waited on with zmq_poll (SHARED_MEMORY_TRANSPORT) without sleeping (just yielding) before it starts checking them once a millisecond
+#define SESSION_POLLER_IDLE_CHECKS_BEFORE_SLEEPING 64
+
+/*
+This class waits on many sessions at once, so that a single thread can drive hundreds of games (with sendPerceptions/tryGetActions) or AIs (with sendActions/tryUpdatePerceptions) without a blocked thread for each one.  wait blocks in a single zmq_poll until any of the sessions has something to do, and returns which ones do.  Game sessions are also returned when tryGetActions needs to be called without a message arriving (to resend the connection handshake or notice a timeout).  Shared memory sessions have no socket to wait on, so they are checked in between (spinning briefly, then every millisecond).  The sessions must outlive the poller (or be removed first), and must not be stepped with the async functions while they are in it.
+*/
+class sessionPoller
+{
+public:
+/*
+This function creates a poller with no sessions.
+*/
+sessionPoller();
+
+/*
+This function adds a game's session to the poller.
+@param inputSession: The game's communication interface
+@return: The index that wait uses for the session
+*/
+uint32_t addSession(gameEngineCommunicationInterface &inputSession);
+
+/*
+This function adds an AI's session to the poller.
+@param inputSession: The AI's communication interface
+@return: The index that wait uses for the session
+*/
+uint32_t addSession(AICommunicationInterface &inputSession);
+
+/*
+This function stops waiting on a session (the indexes of the other sessions don't change).
+@param inputSessionIndex: The index addSession returned for the session
+@exceptions: This function can throw exceptions (if there is no such session)
+*/
+void removeSession(uint32_t inputSessionIndex);
+
+/*
+This function removes all of the sessions (the next session added gets index 0).
+*/
+void clear();
+
+/*
+This function waits until at least one of the sessions has something to do.  The sessions that are returned should then be stepped with tryGetActions/tryUpdatePerceptions (with no timeout), which may still find that there is nothing to do (such as when the message was a stale percept).  Sessions that aren't waiting on their other side shouldn't be left in the poller, since messages that arrive for them keep wait returning.
+@param inputTimeoutInMilliseconds: How long to wait (-1 waits forever, 0 just checks)
+@param outputReadySessions: The indexes of the sessions that have something to do (empty if the wait timed out)
+@return: True if any sessions are ready, false if the wait timed out
+@exceptions: This function can throw exceptions (including if there are no sessions to wait on)
+*/
+bool wait(int inputTimeoutInMilliseconds, std::vector<uint32_t> &outputReadySessions);
+
+private:
+/*
+One session in the poller (exactly one of the pointers is set unless the session has been removed).
+*/
+struct polledSession
+{
+gameEngineCommunicationInterface *game;
+AICommunicationInterface *AI;
+};
+
+std::vector<polledSession> sessions;
+std::vector<zmq_pollitem_t> pollItems; //One for each session that can be waited on with zmq_poll
+std::vector<uint32_t> pollItemSessionIndexes; //Which session each poll item is for
+std::vector<uint32_t> unpollableSessionIndexes; //Sessions that have to be checked with isMessageWaiting
+std::vector<uint32_t> gameSessionIndexes; //Sessions whose timers have to be checked
+std::vector<char> sessionIsReady; //Used by wait so a session is only returned once
+bool pollItemsNeedUpdate;
+
+/*
+This function rebuilds the poll items (and the other lists of sessions) after sessions are added or removed.
+*/
+void updatePollItems();
+
+/*
+This function adds a session to the list of ready sessions (if it isn't already in it).
+@param inputSessionIndex: The session
+@param inputOutputReadySessions: The list of ready sessions
+*/
+void markSessionReady(uint32_t inputSessionIndex, std::vector<uint32_t> &inputOutputReadySessions);
+};
+
+
+
+#endif
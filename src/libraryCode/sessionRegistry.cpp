@@ -0,0 +1,149 @@
+#include "sessionRegistry.hpp"
+#include "portLocations.hpp"
+
+#include<cstdlib>
+#include<cerrno>
+#include<algorithm>
+#include<cstring>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/file.h>
+#include<sys/socket.h>
+#include<netinet/in.h>
+#include<arpa/inet.h>
+
+/*
+This function checks if a TCP port on the loopback interface can currently be bound.
+@param inputPort: The port to check
+@return: True if the port is free
+*/
+static bool loopbackPortIsFree(uint32_t inputPort)
+{
+int socketDescriptor = socket(AF_INET, SOCK_STREAM, 0);
+if(socketDescriptor < 0)
+{
+return false;
+}
+
+int reuseAddress = 1;
+setsockopt(socketDescriptor, SOL_SOCKET, SO_REUSEADDR, &reuseAddress, sizeof(reuseAddress));
+
+sockaddr_in address;
+memset(&address, 0, sizeof(address));
+address.sin_family = AF_INET;
+address.sin_port = htons(inputPort);
+address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+bool portIsFree = bind(socketDescriptor, (sockaddr *) &address, sizeof(address)) == 0;
+close(socketDescriptor);
+return portIsFree;
+}
+
+/*
+This function claims the lowest free session ID.
+@param inputMaximumNumberOfSessions: How many session IDs to try
+@param inputRegistryDirectory: The directory to keep the lock files in (AIARENA_SESSION_DIRECTORY or /tmp if empty)
+@exceptions: This function can throw exceptions (if no session is free)
+*/
+sessionLease::sessionLease(uint32_t inputMaximumNumberOfSessions, const std::string &inputRegistryDirectory)
+{
+lockFileDescriptor = -1;
+
+std::string registryDirectory = inputRegistryDirectory;
+if(registryDirectory.size() == 0)
+{
+const char *environmentDirectory = getenv(SESSION_REGISTRY_DIRECTORY_ENVIRONMENT_VARIABLE);
+registryDirectory = (environmentDirectory != NULL && environmentDirectory[0] != '\0') ? environmentDirectory : "/tmp";
+}
+
+//Don't hand out IDs whose ports don't exist
+uint32_t maximumNumberOfSessions = std::min<uint64_t>(inputMaximumNumberOfSessions, (65535 - std::max(GAMEPORT, AIPORT))/2 + 1);
+
+for(uint32_t candidateID = 0; candidateID < maximumNumberOfSessions; candidateID++)
+{
+std::string lockFilePath = registryDirectory + "/AIArenaSession" + std::to_string(candidateID) + ".lock";
+
+int candidateDescriptor = open(lockFilePath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+if(candidateDescriptor < 0)
+{
+throw SOMException("Error opening session lock file " + lockFilePath + ": " + strerror(errno) + "\n", FILE_SYSTEM_ERROR, __FILE__, __LINE__);
+}
+
+if(flock(candidateDescriptor, LOCK_EX | LOCK_NB) != 0)
+{//Another lease holds this session
+close(candidateDescriptor);
+continue;
+}
+
+//Skip sessions whose ports are in use by a pair that was started without the registry
+if(!loopbackPortIsFree(GAMEPORT + 2*candidateID) || !loopbackPortIsFree(AIPORT + 2*candidateID))
+{
+close(candidateDescriptor);
+continue;
+}
+
+sessionID = candidateID;
+lockFileDescriptor = candidateDescriptor;
+return;
+}
+
+throw SOMException("Error, no free sessions in " + registryDirectory + "\n", SYSTEM_ERROR, __FILE__, __LINE__);
+}
+
+/*
+This function releases the session ID.
+*/
+sessionLease::~sessionLease()
+{
+if(lockFileDescriptor >= 0)
+{
+close(lockFileDescriptor); //Closing the file releases the lock
+}
+}
+
+/*
+This function returns the claimed session ID.
+@return: The session ID
+*/
+uint32_t sessionLease::getSessionID() const
+{
+return sessionID;
+}
+
+/*
+This function returns the endpoint the game should bind to for this session.
+@param inputTransportType: The transport the endpoint is for
+@return: The game endpoint
+@exceptions: This function can throw exceptions
+*/
+std::string sessionLease::getGameEndpoint(transportType inputTransportType) const
+{
+SOM_TRY
+return getSessionGameEndpoint(inputTransportType, sessionID);
+SOM_CATCH("Error getting game endpoint for session\n")
+}
+
+/*
+This function returns the endpoint the AI should bind to for this session.
+@param inputTransportType: The transport the endpoint is for
+@return: The AI endpoint (empty if the transport doesn't use one)
+@exceptions: This function can throw exceptions
+*/
+std::string sessionLease::getAIEndpoint(transportType inputTransportType) const
+{
+SOM_TRY
+return getSessionAIEndpoint(inputTransportType, sessionID);
+SOM_CATCH("Error getting AI endpoint for session\n")
+}
+
+/*
+This function sets AIARENA_SESSION_ID to this session's ID, so that processes started afterwards use this session's endpoints by default.
+@exceptions: This function can throw exceptions
+*/
+void sessionLease::exportToEnvironment() const
+{
+if(setenv(SESSION_ID_ENVIRONMENT_VARIABLE, std::to_string(sessionID).c_str(), 1) != 0)
+{
+throw SOMException(std::string("Error setting ") + SESSION_ID_ENVIRONMENT_VARIABLE + "\n", SYSTEM_ERROR, __FILE__, __LINE__);
+}
+}
@@ -0,0 +1,77 @@
+#ifndef SESSIONREGISTRYHPP
+#define SESSIONREGISTRYHPP
+
+#include<string>
+#include<cstdint>
+
+#include "SOMException.hpp"
+#include "messageTransport.hpp"
+
+//How many session IDs the registry tries before giving up
+#define SESSION_REGISTRY_DEFAULT_MAXIMUM_NUMBER_OF_SESSIONS 1000
+
+//Environment variable that overrides the directory the registry's lock files are kept in (/tmp by default)
+#define SESSION_REGISTRY_DIRECTORY_ENVIRONMENT_VARIABLE "AIARENA_SESSION_DIRECTORY"
+
+/*
+This class claims a session ID that no other game/AI pair on the host is using, so that many pairs can run at once without their endpoints colliding.  Each session ID has a lock file in the registry directory, which is held (with flock) for as long as the lease exists, so IDs are released automatically even if the holder crashes.  IDs whose TCP ports are already taken by something outside the registry are skipped.
+
+The usual pattern is for a launcher to create a lease, call exportToEnvironment and then start the game and the AI (which pick up AIARENA_SESSION_ID through the communication interface constructors that take no endpoints), keeping the lease until both have exited.
+*/
+class sessionLease
+{
+public:
+/*
+This function claims the lowest free session ID.
+@param inputMaximumNumberOfSessions: How many session IDs to try
+@param inputRegistryDirectory: The directory to keep the lock files in (AIARENA_SESSION_DIRECTORY or /tmp if empty)
+@exceptions: This function can throw exceptions (if no session is free)
+*/
+sessionLease(uint32_t inputMaximumNumberOfSessions = SESSION_REGISTRY_DEFAULT_MAXIMUM_NUMBER_OF_SESSIONS, const std::string &inputRegistryDirectory = "");
+
+/*
+This function releases the session ID.
+*/
+~sessionLease();
+
+sessionLease(const sessionLease &) = delete;
+sessionLease &operator=(const sessionLease &) = delete;
+
+/*
+This function returns the claimed session ID.
+@return: The session ID
+*/
+uint32_t getSessionID() const;
+
+/*
+This function returns the endpoint the game should bind to for this session.
+@param inputTransportType: The transport the endpoint is for
+@return: The game endpoint
+@exceptions: This function can throw exceptions
+*/
+std::string getGameEndpoint(transportType inputTransportType) const;
+
+/*
+This function returns the endpoint the AI should bind to for this session.
+@param inputTransportType: The transport the endpoint is for
+@return: The AI endpoint (empty if the transport doesn't use one)
+@exceptions: This function can throw exceptions
+*/
+std::string getAIEndpoint(transportType inputTransportType) const;
+
+/*
+This function sets AIARENA_SESSION_ID to this session's ID, so that processes started afterwards use this session's endpoints by default.
+@exceptions: This function can throw exceptions
+*/
+void exportToEnvironment() const;
+
+private:
+uint32_t sessionID;
+int lockFileDescriptor;
+};
+
+
+
+
+
+#endif
@@ -0,0 +1,502 @@
+#include "sharedMemoryTransport.hpp"
+
+#include<chrono>
+#include<thread>
+#include<cstring>
+#include<climits>
+#include<cerrno>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<sys/syscall.h>
+#include<linux/futex.h>
+
+//Written last by the game once the segment is initialized, so the AI doesn't attach to a half built segment
+#define SHARED_MEMORY_SEGMENT_MAGIC 0x41494172656e6131ULL
+
+//Record size value that tells the reader the rest of the ring is unused and the next record starts at offset 0
+#define SHARED_MEMORY_WRAP_MARKER UINT64_MAX
+
+//How many times to check for the peer before going to sleep on the futex
+#define SHARED_MEMORY_SPIN_COUNT 2000
+
+/*
+The start of the shared segment, followed by the control block and data for each direction.
+*/
+struct sharedMemorySegmentHeader
+{
+alignas(64) std::atomic<uint64_t> magic;
+uint64_t ringSize;
+};
+
+/*
+This function rounds a record size up to the next multiple of 8, so records stay aligned.
+@param inputSize: The size to round
+@return: The rounded size
+*/
+static uint64_t roundUpToMultipleOf8(uint64_t inputSize)
+{
+return (inputSize + 7) & ~((uint64_t) 7);
+}
+
+/*
+This function wakes anyone sleeping on the given futex word (in any process).
+@param inputFutexWord: The futex word to wake waiters on
+*/
+static void wakeFutex(std::atomic<uint32_t> &inputFutexWord)
+{
+syscall(SYS_futex, (uint32_t *) &inputFutexWord, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/*
+This function announces a change to the peer by bumping the futex word and waking the peer if it is asleep.
+@param inputFutexWord: The futex word the peer sleeps on
+@param inputPeerIsSleeping: The flag the peer sets before sleeping
+*/
+static void signalPeer(std::atomic<uint32_t> &inputFutexWord, std::atomic<uint32_t> &inputPeerIsSleeping)
+{
+inputFutexWord.fetch_add(1);
+if(inputPeerIsSleeping.load() != 0)
+{
+wakeFutex(inputFutexWord);
+}
+}
+
+/*
+This function waits until the given condition is true, spinning briefly before sleeping on the futex word that the peer bumps whenever it changes the ring.
+@param inputFutexWord: The futex word the peer bumps
+@param inputIsSleeping: The flag to set while sleeping, so the peer knows to wake us
+@param inputCondition: The condition to wait for
+@param inputTimeoutInMilliseconds: How long to wait (-1 waits forever, 0 only checks once)
+@return: True if the condition became true, false if the wait timed out
+*/
+template<class conditionType> static bool waitForCondition(std::atomic<uint32_t> &inputFutexWord, std::atomic<uint32_t> &inputIsSleeping, conditionType inputCondition, int inputTimeoutInMilliseconds)
+{
+if(inputCondition())
+{
+return true;
+}
+
+if(inputTimeoutInMilliseconds == 0)
+{
+return false;
+}
+
+//Spinning only helps if the peer can run at the same time
+static const int spinCount = std::thread::hardware_concurrency() > 1 ? SHARED_MEMORY_SPIN_COUNT : 0;
+for(int i=0; i<spinCount; i++)
+{
+#if defined(__x86_64__) || defined(__i386__)
+__builtin_ia32_pause();
+#endif
+if(inputCondition())
+{
+return true;
+}
+}
+
+std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(inputTimeoutInMilliseconds);
+while(true)
+{
+uint32_t futexValue = inputFutexWord.load();
+inputIsSleeping.store(1);
+
+//Check again after announcing that we are going to sleep, so a change made just before can't be missed
+if(inputCondition())
+{
+inputIsSleeping.store(0);
+return true;
+}
+
+timespec timeout;
+timespec *timeoutPointer = NULL;
+if(inputTimeoutInMilliseconds > 0)
+{
+int64_t nanosecondsRemaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now()).count();
+if(nanosecondsRemaining <= 0)
+{
+inputIsSleeping.store(0);
+return false;
+}
+timeout.tv_sec = nanosecondsRemaining / 1000000000;
+timeout.tv_nsec = nanosecondsRemaining % 1000000000;
+timeoutPointer = &timeout;
+}
+
+syscall(SYS_futex, (uint32_t *) &inputFutexWord, FUTEX_WAIT, futexValue, timeoutPointer, NULL, 0);
+inputIsSleeping.store(0);
+
+if(inputCondition())
+{
+return true;
+}
+}
+}
+
+/*
+This function creates the shared memory segment (game side) or remembers which segment to attach to (AI side).
+@param inputRole: Which side of the session the transport is for
+@param inputEndpoint: The name of the session, in the form "shm://sessionName"
+@param inputRingSize: The number of bytes in each direction's ring, which must be a multiple of 8 (only used by the game, the AI uses whatever size the game picked)
+@exceptions: This function can throw exceptions
+*/
+sharedMemoryTransport::sharedMemoryTransport(transportRole inputRole, const std::string &inputEndpoint, uint64_t inputRingSize)
+{
+role = inputRole;
+segment = NULL;
+segmentSize = 0;
+ringSize = 0;
+outgoingRing = NULL;
+outgoingRingData = NULL;
+incomingRing = NULL;
+incomingRingData = NULL;
+localWritePosition = 0;
+reservedRecordSize = 0;
+reservedMessageSize = 0;
+localReadPosition = 0;
+receivedRecordSize = 0;
+receivedMessageData = NULL;
+receivedMessageSize = 0;
+
+std::string prefix = "shm://";
+if(inputEndpoint.compare(0, prefix.size(), prefix) != 0 || inputEndpoint.size() == prefix.size() || inputEndpoint.find('/', prefix.size()) != std::string::npos)
+{
+throw SOMException("Error, shared memory endpoints must look like shm://sessionName\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+segmentName = "/" + inputEndpoint.substr(prefix.size());
+
+if(role == AI_ROLE)
+{
+return; //The AI attaches when it first sends or receives, since the game may not have created the segment yet
+}
+
+if(inputRingSize == 0 || (inputRingSize % 8) != 0)
+{
+throw SOMException("Error, shared memory ring size must be a positive multiple of 8\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+ringSize = inputRingSize;
+
+//Replace any segment left behind by a game that didn't shut down cleanly
+shm_unlink(segmentName.c_str());
+
+int fileDescriptor = shm_open(segmentName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+if(fileDescriptor < 0)
+{
+throw SOMException("Error, unable to create shared memory segment " + segmentName + ": " + strerror(errno) + "\n", SYSTEM_ERROR, __FILE__, __LINE__);
+}
+
+segmentSize = 64 + 2*sizeof(sharedMemoryRingControl) + 2*ringSize;
+if(ftruncate(fileDescriptor, segmentSize) != 0)
+{
+close(fileDescriptor);
+shm_unlink(segmentName.c_str());
+throw SOMException("Error, unable to size shared memory segment\n", SYSTEM_ERROR, __FILE__, __LINE__);
+}
+
+segment = mmap(NULL, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+close(fileDescriptor);
+if(segment == MAP_FAILED)
+{
+segment = NULL;
+shm_unlink(segmentName.c_str());
+throw SOMException("Error, unable to map shared memory segment\n", SYSTEM_ERROR, __FILE__, __LINE__);
+}
+
+//The new segment is zero filled, so the rings start out empty
+sharedMemorySegmentHeader *header = (sharedMemorySegmentHeader *) segment;
+header->ringSize = ringSize;
+setRingPointers();
+header->magic.store(SHARED_MEMORY_SEGMENT_MAGIC, std::memory_order_release);
+}
+
+/*
+This function unmaps the segment (and removes it if this is the game side).
+*/
+sharedMemoryTransport::~sharedMemoryTransport()
+{
+if(segment != NULL)
+{
+munmap(segment, segmentSize);
+}
+
+if(role == GAME_ENGINE_ROLE)
+{
+shm_unlink(segmentName.c_str());
+}
+}
+
+/*
+This function copies the given message into the outgoing ring.
+@param inputMessage: The serialized message to send
+@param inputMessageSize: The size of the message in bytes
+@param inputTimeoutInMilliseconds: How long to wait for space in the ring (-1 waits forever, 0 returns immediately if there is no space)
+@return: True if the message was sent, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+bool sharedMemoryTransport::sendMessage(const char *inputMessage, uint64_t inputMessageSize, int inputTimeoutInMilliseconds)
+{
+char *messageBuffer = NULL;
+SOM_TRY
+messageBuffer = reserveMessage(inputMessageSize, inputTimeoutInMilliseconds);
+SOM_CATCH("Error reserving space in shared memory ring\n")
+
+if(messageBuffer == NULL)
+{
+return false;
+}
+
+memcpy(messageBuffer, inputMessage, inputMessageSize);
+
+SOM_TRY
+return commitMessage();
+SOM_CATCH("Error committing message to shared memory ring\n")
+}
+
+/*
+This function returns space in the outgoing ring for a message of the given size, so that it can be written in place.
+@param inputMessageSize: The size of the message in bytes
+@param inputTimeoutInMilliseconds: How long to wait for space in the ring (-1 waits forever, 0 doesn't wait)
+@return: The buffer to write the message into or NULL if the wait timed out
+@exceptions: This function can throw exceptions (if the message can never fit in the ring)
+*/
+char *sharedMemoryTransport::reserveMessage(uint64_t inputMessageSize, int inputTimeoutInMilliseconds)
+{
+SOM_TRY
+if(!attachToSegment(inputTimeoutInMilliseconds))
+{
+return NULL;
+}
+SOM_CATCH("Error attaching to shared memory segment\n")
+
+uint64_t recordSize = roundUpToMultipleOf8(sizeof(uint64_t) + inputMessageSize);
+if(recordSize > ringSize/2)
+{
+throw SOMException("Error, message is too large for the shared memory ring\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+//Records are never split, so skip the end of the ring if the record doesn't fit there
+uint64_t offset = localWritePosition % ringSize;
+uint64_t skippedBytes = 0;
+if(offset + recordSize > ringSize)
+{
+skippedBytes = ringSize - offset;
+}
+
+uint64_t spaceNeeded = skippedBytes + recordSize;
+sharedMemoryRingControl *ring = outgoingRing;
+uint64_t writePosition = localWritePosition;
+uint64_t bufferSize = ringSize;
+if(!waitForCondition(ring->readFutex, ring->writerIsSleeping, [ring, writePosition, bufferSize, spaceNeeded]() { return bufferSize - (writePosition - ring->readPosition.load()) >= spaceNeeded; }, inputTimeoutInMilliseconds))
+{
+return NULL;
+}
+
+if(skippedBytes > 0)
+{
+uint64_t wrapMarker = SHARED_MEMORY_WRAP_MARKER;
+memcpy(outgoingRingData + offset, &wrapMarker, sizeof(wrapMarker));
+localWritePosition += skippedBytes;
+}
+
+reservedRecordSize = recordSize;
+reservedMessageSize = inputMessageSize;
+return outgoingRingData + (localWritePosition % ringSize) + sizeof(uint64_t);
+}
+
+/*
+This function publishes the message written into the space returned by reserveMessage to the other side.
+@return: True
+@exceptions: This function can throw exceptions
+*/
+bool sharedMemoryTransport::commitMessage()
+{
+if(reservedRecordSize == 0)
+{
+throw SOMException("Error, no message has been reserved\n", AN_ASSUMPTION_WAS_VIOLATED_ERROR, __FILE__, __LINE__);
+}
+
+memcpy(outgoingRingData + (localWritePosition % ringSize), &reservedMessageSize, sizeof(reservedMessageSize));
+localWritePosition += reservedRecordSize;
+reservedRecordSize = 0;
+
+outgoingRing->writePosition.store(localWritePosition);
+signalPeer(outgoingRing->writeFutex, outgoingRing->readerIsSleeping);
+return true;
+}
+
+/*
+This function releases the previously received message and waits for the next one in the incoming ring.
+@param inputTimeoutInMilliseconds: How long to wait for a message (-1 waits forever, 0 returns immediately if nothing is available)
+@return: True if a message was received, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+bool sharedMemoryTransport::receiveMessage(int inputTimeoutInMilliseconds)
+{
+SOM_TRY
+if(!attachToSegment(inputTimeoutInMilliseconds))
+{
+return false;
+}
+SOM_CATCH("Error attaching to shared memory segment\n")
+
+//Give the space used by the last message back to the sender
+if(receivedRecordSize > 0)
+{
+localReadPosition += receivedRecordSize;
+receivedRecordSize = 0;
+incomingRing->readPosition.store(localReadPosition);
+signalPeer(incomingRing->readFutex, incomingRing->writerIsSleeping);
+}
+
+while(true)
+{
+sharedMemoryRingControl *ring = incomingRing;
+uint64_t readPosition = localReadPosition;
+if(!waitForCondition(ring->writeFutex, ring->readerIsSleeping, [ring, readPosition]() { return ring->writePosition.load() != readPosition; }, inputTimeoutInMilliseconds))
+{
+return false;
+}
+
+uint64_t offset = localReadPosition % ringSize;
+uint64_t recordLength = 0;
+memcpy(&recordLength, incomingRingData + offset, sizeof(recordLength));
+
+if(recordLength == SHARED_MEMORY_WRAP_MARKER)
+{
+localReadPosition += ringSize - offset; //The next record starts at the beginning of the ring
+continue;
+}
+
+receivedMessageData = incomingRingData + offset + sizeof(uint64_t);
+receivedMessageSize = recordLength;
+receivedRecordSize = roundUpToMultipleOf8(sizeof(uint64_t) + recordLength);
+return true;
+}
+}
+
+/*
+This function returns a pointer to the last received message, which points straight into the shared ring.
+@return: The message bytes
+*/
+const char *sharedMemoryTransport::getReceivedMessageData()
+{
+return receivedMessageData;
+}
+
+/*
+This function returns the size of the last received message.
+@return: The size of the message in bytes
+*/
+uint64_t sharedMemoryTransport::getReceivedMessageSize()
+{
+return receivedMessageSize;
+}
+
+/*
+The rings never drop messages, so this always returns false.
+@return: False
+*/
+bool sharedMemoryTransport::canDropMessages()
+{
+return false;
+}
+
+/*
+This function checks, without waiting or receiving anything, whether receiveMessage(0) may return a message.  The rings have no file descriptor to wait on, so pollers check them with this instead.
+@return: True if the sender has written past the current message (or the segment hasn't been attached yet, which receiveMessage(0) tries to do)
+*/
+bool sharedMemoryTransport::isMessageWaiting()
+{
+if(incomingRing == NULL)
+{
+return true;
+}
+
+return incomingRing->writePosition.load() != localReadPosition + receivedRecordSize;
+}
+
+/*
+This function maps the segment created by the game (waiting for it to appear) if that hasn't happened yet.
+@param inputTimeoutInMilliseconds: How long to wait for the game to create the segment (-1 waits forever)
+@return: True if the segment is attached, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+bool sharedMemoryTransport::attachToSegment(int inputTimeoutInMilliseconds)
+{
+if(segment != NULL)
+{
+return true;
+}
+
+std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+while(true)
+{
+int fileDescriptor = shm_open(segmentName.c_str(), O_RDWR, 0600);
+if(fileDescriptor >= 0)
+{
+struct stat segmentStatus;
+if(fstat(fileDescriptor, &segmentStatus) == 0 && segmentStatus.st_size > (off_t) (64 + 2*sizeof(sharedMemoryRingControl)))
+{
+void *mappedSegment = mmap(NULL, segmentStatus.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+if(mappedSegment != MAP_FAILED)
+{
+sharedMemorySegmentHeader *header = (sharedMemorySegmentHeader *) mappedSegment;
+if(header->magic.load(std::memory_order_acquire) == SHARED_MEMORY_SEGMENT_MAGIC)
+{
+close(fileDescriptor);
+segment = mappedSegment;
+segmentSize = segmentStatus.st_size;
+ringSize = header->ringSize;
+setRingPointers();
+
+//An AI that was restarted carries on from wherever the last one left the rings
+localReadPosition = incomingRing->readPosition.load();
+localWritePosition = outgoingRing->writePosition.load();
+return true;
+}
+munmap(mappedSegment, segmentStatus.st_size);
+}
+}
+close(fileDescriptor);
+}
+else if(errno != ENOENT)
+{
+throw SOMException(std::string("Error, unable to open shared memory segment: ") + strerror(errno) + "\n", SYSTEM_ERROR, __FILE__, __LINE__);
+}
+
+//The game hasn't finished creating the segment yet
+if(inputTimeoutInMilliseconds >= 0 && std::chrono::steady_clock::now() - startTime >= std::chrono::milliseconds(inputTimeoutInMilliseconds))
+{
+return false;
+}
+std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+}
+
+/*
+This function sets the ring pointers once the segment is mapped.
+*/
+void sharedMemoryTransport::setRingPointers()
+{
+char *segmentBytes = (char *) segment;
+sharedMemoryRingControl *gameToAIRing = (sharedMemoryRingControl *) (segmentBytes + 64);
+sharedMemoryRingControl *AIToGameRing = gameToAIRing + 1;
+char *gameToAIRingData = (char *) (AIToGameRing + 1);
+char *AIToGameRingData = gameToAIRingData + ringSize;
+
+if(role == GAME_ENGINE_ROLE)
+{
+outgoingRing = gameToAIRing;
+outgoingRingData = gameToAIRingData;
+incomingRing = AIToGameRing;
+incomingRingData = AIToGameRingData;
+}
+else
+{
+outgoingRing = AIToGameRing;
+outgoingRingData = AIToGameRingData;
+incomingRing = gameToAIRing;
+incomingRingData = gameToAIRingData;
+}
+}
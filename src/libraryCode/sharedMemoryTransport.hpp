@@ -0,0 +1,145 @@
+#ifndef SHAREDMEMORYTRANSPORTHPP
+#define SHAREDMEMORYTRANSPORTHPP
+
+#include<atomic>
+#include<string>
+#include<cstdint>
+
+#include "SOMException.hpp"
+#include "messageTransport.hpp"
+
+//Default number of bytes in each direction's ring (a single message can use at most half of it)
+#define SHARED_MEMORY_TRANSPORT_DEFAULT_RING_SIZE (16*1024*1024)
+
+/*
+The control block for one direction of a shared memory session.  Positions count bytes since the session started (so they only ever increase) and are reduced modulo the ring capacity to find offsets.  The futex words are bumped after every write/release so a sleeping peer can be woken.
+*/
+struct sharedMemoryRingControl
+{
+alignas(64) std::atomic<uint64_t> writePosition;
+std::atomic<uint32_t> writeFutex;
+std::atomic<uint32_t> readerIsSleeping;
+alignas(64) std::atomic<uint64_t> readPosition;
+std::atomic<uint32_t> readFutex;
+std::atomic<uint32_t> writerIsSleeping;
+};
+
+/*
+This class implements a transport for a game and an AI on the same host using a POSIX shared memory segment (created with shm_open by the game) holding a single producer/single consumer ring in each direction.  Each message is stored as a 8 byte size followed by the message bytes, always contiguously, so a sender can serialize straight into the ring (reserveMessage/commitMessage) and a receiver can read it in place without copying.  Waiting uses futexes in the shared segment after a short spin, so no system calls are made while both sides keep up with each other.
+
+The game creates (replacing any stale segment left by a crashed game) and unlinks the segment, while the AI attaches to it whenever it first sends or receives, waiting for the game to create it if necessary.
+*/
+class sharedMemoryTransport : public messageTransport
+{
+public:
+/*
+This function creates the shared memory segment (game side) or remembers which segment to attach to (AI side).
+@param inputRole: Which side of the session the transport is for
+@param inputEndpoint: The name of the session, in the form "shm://sessionName"
+@param inputRingSize: The number of bytes in each direction's ring, which must be a multiple of 8 (only used by the game, the AI uses whatever size the game picked)
+@exceptions: This function can throw exceptions
+*/
+sharedMemoryTransport(transportRole inputRole, const std::string &inputEndpoint, uint64_t inputRingSize = SHARED_MEMORY_TRANSPORT_DEFAULT_RING_SIZE);
+
+/*
+This function unmaps the segment (and removes it if this is the game side).
+*/
+~sharedMemoryTransport();
+
+/*
+This function copies the given message into the outgoing ring.
+@param inputMessage: The serialized message to send
+@param inputMessageSize: The size of the message in bytes
+@param inputTimeoutInMilliseconds: How long to wait for space in the ring (-1 waits forever, 0 returns immediately if there is no space)
+@return: True if the message was sent, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+virtual bool sendMessage(const char *inputMessage, uint64_t inputMessageSize, int inputTimeoutInMilliseconds);
+
+/*
+This function returns space in the outgoing ring for a message of the given size, so that it can be written in place.
+@param inputMessageSize: The size of the message in bytes
+@param inputTimeoutInMilliseconds: How long to wait for space in the ring (-1 waits forever, 0 doesn't wait)
+@return: The buffer to write the message into or NULL if the wait timed out
+@exceptions: This function can throw exceptions (if the message can never fit in the ring)
+*/
+virtual char *reserveMessage(uint64_t inputMessageSize, int inputTimeoutInMilliseconds);
+
+/*
+This function publishes the message written into the space returned by reserveMessage to the other side.
+@return: True
+@exceptions: This function can throw exceptions
+*/
+virtual bool commitMessage();
+
+/*
+This function releases the previously received message and waits for the next one in the incoming ring.
+@param inputTimeoutInMilliseconds: How long to wait for a message (-1 waits forever, 0 returns immediately if nothing is available)
+@return: True if a message was received, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+virtual bool receiveMessage(int inputTimeoutInMilliseconds);
+
+/*
+This function returns a pointer to the last received message, which points straight into the shared ring.
+@return: The message bytes
+*/
+virtual const char *getReceivedMessageData();
+
+/*
+This function returns the size of the last received message.
+@return: The size of the message in bytes
+*/
+virtual uint64_t getReceivedMessageSize();
+
+/*
+The rings never drop messages, so this always returns false.
+@return: False
+*/
+virtual bool canDropMessages();
+
+/*
+This function checks, without waiting or receiving anything, whether receiveMessage(0) may return a message.  The rings have no file descriptor to wait on, so pollers check them with this instead.
+@return: True if the sender has written past the current message (or the segment hasn't been attached yet, which receiveMessage(0) tries to do)
+*/
+virtual bool isMessageWaiting();
+
+private:
+transportRole role;
+std::string segmentName;
+void *segment;
+uint64_t segmentSize;
+uint64_t ringSize;
+
+sharedMemoryRingControl *outgoingRing;
+char *outgoingRingData;
+sharedMemoryRingControl *incomingRing;
+char *incomingRingData;
+
+uint64_t localWritePosition; //Where the next outgoing message will be written
+uint64_t reservedRecordSize; //Size of the record reserved by reserveMessage (0 if none)
+uint64_t reservedMessageSize;
+uint64_t localReadPosition; //Where the next incoming message starts
+uint64_t receivedRecordSize; //Size of the record holding the last received message (released by the next receive)
+const char *receivedMessageData;
+uint64_t receivedMessageSize;
+
+/*
+This function maps the segment created by the game (waiting for it to appear) if that hasn't happened yet.
+@param inputTimeoutInMilliseconds: How long to wait for the game to create the segment (-1 waits forever)
+@return: True if the segment is attached, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+bool attachToSegment(int inputTimeoutInMilliseconds);
+
+/*
+This function sets the ring pointers once the segment is mapped.
+*/
+void setRingPointers();
+};
+
+
+
+
+
+#endif
@@ -0,0 +1,516 @@
+#include "stepInstrumentation.hpp"
+
+#include<cstdlib>
+#include<cmath>
+#include<atomic>
+#include<algorithm>
+
+/*
+This function creates an empty histogram.
+*/
+latencyHistogram::latencyHistogram()
+{
+reset();
+}
+
+/*
+This function adds a value to the histogram.
+@param inputValue: The value (normally in nanoseconds)
+*/
+void latencyHistogram::record(uint64_t inputValue)
+{
+counts[getBucketIndex(inputValue)]++;
+if(count == 0 || inputValue < minimum)
+{
+minimum = inputValue;
+}
+if(inputValue > maximum)
+{
+maximum = inputValue;
+}
+count++;
+sum += inputValue;
+}
+
+/*
+This function removes all of the recorded values.
+*/
+void latencyHistogram::reset()
+{
+std::fill(counts, counts + LATENCY_HISTOGRAM_BUCKET_COUNT, 0);
+count = 0;
+minimum = 0;
+maximum = 0;
+sum = 0.0;
+}
+
+/*
+This function returns how many values have been recorded.
+@return: The number of values
+*/
+uint64_t latencyHistogram::getCount() const
+{
+return count;
+}
+
+/*
+This function returns the smallest recorded value.
+@return: The smallest value (0 if nothing has been recorded)
+*/
+uint64_t latencyHistogram::getMinimum() const
+{
+return minimum;
+}
+
+/*
+This function returns the largest recorded value.
+@return: The largest value (0 if nothing has been recorded)
+*/
+uint64_t latencyHistogram::getMaximum() const
+{
+return maximum;
+}
+
+/*
+This function returns the mean of the recorded values.
+@return: The mean (0 if nothing has been recorded)
+*/
+double latencyHistogram::getMean() const
+{
+if(count == 0)
+{
+return 0.0;
+}
+
+return sum/count;
+}
+
+/*
+This function returns the value that the given percentage of the recorded values are at or below (to the precision of the buckets).
+@param inputPercentile: The percentile (0 to 100)
+@return: The value (0 if nothing has been recorded)
+*/
+uint64_t latencyHistogram::getValueAtPercentile(double inputPercentile) const
+{
+if(count == 0)
+{
+return 0;
+}
+
+//Find the bucket holding the value with this rank (rounding up, so the 100th percentile is the largest value)
+double clampedPercentile = std::min(std::max(inputPercentile, 0.0), 100.0);
+uint64_t rank = std::max<uint64_t>((uint64_t) ceil(clampedPercentile/100.0*count), 1);
+uint64_t countSoFar = 0;
+for(uint32_t bucketIndex = 0; bucketIndex < LATENCY_HISTOGRAM_BUCKET_COUNT; bucketIndex++)
+{
+countSoFar += counts[bucketIndex];
+if(countSoFar >= rank)
+{
+return std::min(std::max(getBucketUpperBound(bucketIndex), minimum), maximum);
+}
+}
+
+return maximum;
+}
+
+/*
+This function returns the bucket that a value is counted in.
+@param inputValue: The value
+@return: The index of the bucket
+*/
+uint32_t latencyHistogram::getBucketIndex(uint64_t inputValue)
+{
+//Values below LATENCY_HISTOGRAM_SUB_BUCKET_COUNT get a bucket each
+if(inputValue < LATENCY_HISTOGRAM_SUB_BUCKET_COUNT)
+{
+return inputValue;
+}
+
+//Above that, each power of two is split into LATENCY_HISTOGRAM_SUB_BUCKET_COUNT equal buckets
+uint32_t magnitude = 63 - __builtin_clzll(inputValue);
+if(magnitude > LATENCY_HISTOGRAM_MAXIMUM_MAGNITUDE)
+{
+return LATENCY_HISTOGRAM_BUCKET_COUNT - 1;
+}
+
+uint32_t subBucket = (inputValue >> (magnitude - LATENCY_HISTOGRAM_SUB_BUCKET_BITS)) - LATENCY_HISTOGRAM_SUB_BUCKET_COUNT;
+return LATENCY_HISTOGRAM_SUB_BUCKET_COUNT*(magnitude - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1) + subBucket;
+}
+
+/*
+This function returns the largest value counted in the given bucket.
+@param inputBucketIndex: The index of the bucket
+@return: The largest value of the bucket
+*/
+uint64_t latencyHistogram::getBucketUpperBound(uint32_t inputBucketIndex)
+{
+if(inputBucketIndex < LATENCY_HISTOGRAM_SUB_BUCKET_COUNT)
+{
+return inputBucketIndex;
+}
+
+uint32_t magnitude = inputBucketIndex/LATENCY_HISTOGRAM_SUB_BUCKET_COUNT + LATENCY_HISTOGRAM_SUB_BUCKET_BITS - 1;
+uint64_t subBucket = inputBucketIndex % LATENCY_HISTOGRAM_SUB_BUCKET_COUNT;
+uint32_t shift = magnitude - LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+return ((LATENCY_HISTOGRAM_SUB_BUCKET_COUNT + subBucket + 1) << shift) - 1;
+}
+
+/*
+This function creates an empty set of measurements.
+@param inputName: The name to put at the top of reports (such as "game" or "AI")
+*/
+stepInstrumentation::stepInstrumentation(const std::string &inputName) : name(inputName), periodicReportInterval(0), nextPeriodicReportTime(0)
+{
+reset();
+}
+
+/*
+This function writes a final report if periodic reports were set up.
+*/
+stepInstrumentation::~stepInstrumentation()
+{
+if(periodicReportFilePath.size() == 0)
+{
+return;
+}
+
+try
+{
+writeReportToFile(periodicReportFilePath);
+}
+catch(const std::exception &inputException)
+{
+//Destructors can't throw, so the final report is just lost
+}
+}
+
+/*
+This function returns the current time for the measurements.
+@return: The time in nanoseconds (from an arbitrary starting point)
+*/
+uint64_t stepInstrumentation::getTime()
+{
+return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+This function records how long serializing a message took.
+@param inputDuration: The time taken in nanoseconds
+*/
+void stepInstrumentation::recordSerializeTime(uint64_t inputDuration)
+{
+serializeTimes.record(inputDuration);
+}
+
+/*
+This function records how long handing a message to the transport to send took.
+@param inputDuration: The time taken in nanoseconds
+*/
+void stepInstrumentation::recordSendTime(uint64_t inputDuration)
+{
+sendTimes.record(inputDuration);
+}
+
+/*
+This function records how long waiting for the other side to answer took.
+@param inputDuration: The time taken in nanoseconds
+*/
+void stepInstrumentation::recordPeerWaitTime(uint64_t inputDuration)
+{
+peerWaitTimes.record(inputDuration);
+}
+
+/*
+This function records how long parsing a received message took.
+@param inputDuration: The time taken in nanoseconds
+*/
+void stepInstrumentation::recordParseTime(uint64_t inputDuration)
+{
+parseTimes.record(inputDuration);
+}
+
+/*
+This function counts a message being sent.
+@param inputMessageSize: The size of the message in bytes
+*/
+void stepInstrumentation::countSentMessage(uint64_t inputMessageSize)
+{
+numberOfMessagesSent++;
+numberOfBytesSent += inputMessageSize;
+}
+
+/*
+This function counts a message being received.
+@param inputMessageSize: The size of the message in bytes
+*/
+void stepInstrumentation::countReceivedMessage(uint64_t inputMessageSize)
+{
+numberOfMessagesReceived++;
+numberOfBytesReceived += inputMessageSize;
+}
+
+/*
+This function counts a finished step (a percept sent and answered for the game, a percept received for the AI) and writes the periodic report if it is due.
+*/
+void stepInstrumentation::countStep()
+{
+numberOfSteps++;
+
+if(periodicReportInterval == 0)
+{
+return;
+}
+
+uint64_t currentTime = getTime();
+if(currentTime < nextPeriodicReportTime)
+{
+return;
+}
+nextPeriodicReportTime = currentTime + periodicReportInterval;
+
+try
+{
+writeReportToFile(periodicReportFilePath);
+}
+catch(const std::exception &inputException)
+{
+//A report that can't be written shouldn't stop the session, so just try again next time
+}
+}
+
+/*
+This function counts a message that was skipped because it was stale (out of sequence, or a leftover handshake message).
+*/
+void stepInstrumentation::countStaleMessage()
+{
+numberOfStaleMessages++;
+}
+
+/*
+This function counts a handshake message that had to be sent (or answered) again.
+*/
+void stepInstrumentation::countHandshakeRetry()
+{
+numberOfHandshakeRetries++;
+}
+
+/*
+This function counts a step that the AI didn't answer before the action deadline, so the game used an action of its own.
+*/
+void stepInstrumentation::countMissedDeadline()
+{
+numberOfMissedDeadlines++;
+}
+
+/*
+This function returns the times (in nanoseconds) spent serializing messages.
+@return: The histogram of the times
+*/
+const latencyHistogram &stepInstrumentation::getSerializeTimes() const
+{
+return serializeTimes;
+}
+
+/*
+This function returns the times (in nanoseconds) spent handing messages to the transport.
+@return: The histogram of the times
+*/
+const latencyHistogram &stepInstrumentation::getSendTimes() const
+{
+return sendTimes;
+}
+
+/*
+This function returns the times (in nanoseconds) spent waiting for the other side.
+@return: The histogram of the times
+*/
+const latencyHistogram &stepInstrumentation::getPeerWaitTimes() const
+{
+return peerWaitTimes;
+}
+
+/*
+This function returns the times (in nanoseconds) spent parsing messages.
+@return: The histogram of the times
+*/
+const latencyHistogram &stepInstrumentation::getParseTimes() const
+{
+return parseTimes;
+}
+
+/*
+This function returns how many steps have finished.
+@return: The count
+*/
+uint64_t stepInstrumentation::getNumberOfSteps() const
+{
+return numberOfSteps;
+}
+
+/*
+This function returns how many messages have been sent.
+@return: The count
+*/
+uint64_t stepInstrumentation::getNumberOfMessagesSent() const
+{
+return numberOfMessagesSent;
+}
+
+/*
+This function returns how many bytes have been sent.
+@return: The count
+*/
+uint64_t stepInstrumentation::getNumberOfBytesSent() const
+{
+return numberOfBytesSent;
+}
+
+/*
+This function returns how many messages have been received.
+@return: The count
+*/
+uint64_t stepInstrumentation::getNumberOfMessagesReceived() const
+{
+return numberOfMessagesReceived;
+}
+
+/*
+This function returns how many bytes have been received.
+@return: The count
+*/
+uint64_t stepInstrumentation::getNumberOfBytesReceived() const
+{
+return numberOfBytesReceived;
+}
+
+/*
+This function returns how many stale messages have been skipped.
+@return: The count
+*/
+uint64_t stepInstrumentation::getNumberOfStaleMessages() const
+{
+return numberOfStaleMessages;
+}
+
+/*
+This function returns how many handshake messages had to be sent or answered again.
+@return: The count
+*/
+uint64_t stepInstrumentation::getNumberOfHandshakeRetries() const
+{
+return numberOfHandshakeRetries;
+}
+
+/*
+This function returns how many steps the AI missed the action deadline in.
+@return: The count
+*/
+uint64_t stepInstrumentation::getNumberOfMissedDeadlines() const
+{
+return numberOfMissedDeadlines;
+}
+
+/*
+This function removes all of the measurements.
+*/
+void stepInstrumentation::reset()
+{
+serializeTimes.reset();
+sendTimes.reset();
+peerWaitTimes.reset();
+parseTimes.reset();
+numberOfSteps = 0;
+numberOfMessagesSent = 0;
+numberOfBytesSent = 0;
+numberOfMessagesReceived = 0;
+numberOfBytesReceived = 0;
+numberOfStaleMessages = 0;
+numberOfHandshakeRetries = 0;
+numberOfMissedDeadlines = 0;
+}
+
+/*
+This function writes a text report of the measurements (the counters, then the count, mean, percentiles and maximum of each latency in microseconds).
+@param inputFile: The file to write to
+*/
+void stepInstrumentation::writeReport(FILE *inputFile) const
+{
+fprintf(inputFile, "%s\n", name.c_str());
+fprintf(inputFile, "steps %llu\n", (unsigned long long) numberOfSteps);
+fprintf(inputFile, "messages_sent %llu bytes_sent %llu\n", (unsigned long long) numberOfMessagesSent, (unsigned long long) numberOfBytesSent);
+fprintf(inputFile, "messages_received %llu bytes_received %llu\n", (unsigned long long) numberOfMessagesReceived, (unsigned long long) numberOfBytesReceived);
+fprintf(inputFile, "stale_messages %llu handshake_retries %llu missed_deadlines %llu\n", (unsigned long long) numberOfStaleMessages, (unsigned long long) numberOfHandshakeRetries, (unsigned long long) numberOfMissedDeadlines);
+
+fprintf(inputFile, "%-10s %12s %10s %10s %10s %10s %10s %10s\n", "latency_us", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+const char *histogramNames[] = {"serialize", "send", "peer_wait", "parse"};
+const latencyHistogram *histograms[] = {&serializeTimes, &sendTimes, &peerWaitTimes, &parseTimes};
+for(int histogramIndex = 0; histogramIndex < 4; histogramIndex++)
+{
+const latencyHistogram &histogram = *histograms[histogramIndex];
+fprintf(inputFile, "%-10s %12llu %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n", histogramNames[histogramIndex], (unsigned long long) histogram.getCount(), histogram.getMean()/1000.0, histogram.getValueAtPercentile(50.0)/1000.0, histogram.getValueAtPercentile(90.0)/1000.0, histogram.getValueAtPercentile(99.0)/1000.0, histogram.getValueAtPercentile(99.9)/1000.0, histogram.getMaximum()/1000.0);
+}
+}
+
+/*
+This function writes the report to the given file, replacing it (the report is written to a temporary file first and renamed, so readers never see half a report).
+@param inputFilePath: The file to write
+@exceptions: This function can throw exceptions (if the file can't be written)
+*/
+void stepInstrumentation::writeReportToFile(const std::string &inputFilePath) const
+{
+std::string temporaryFilePath = inputFilePath + ".tmp";
+FILE *reportFile = fopen(temporaryFilePath.c_str(), "w");
+if(reportFile == NULL)
+{
+throw SOMException("Error, unable to open instrumentation report file " + temporaryFilePath + "\n", FILE_SYSTEM_ERROR, __FILE__, __LINE__);
+}
+
+writeReport(reportFile);
+
+if(fclose(reportFile) != 0 || rename(temporaryFilePath.c_str(), inputFilePath.c_str()) != 0)
+{
+throw SOMException("Error, unable to write instrumentation report file " + inputFilePath + "\n", FILE_SYSTEM_ERROR, __FILE__, __LINE__);
+}
+}
+
+/*
+This function makes the report be rewritten to the given file every so often (checked at the end of each step) and when this object is destroyed.
+@param inputFilePath: The file to write (empty to stop the periodic reports)
+@param inputIntervalInMilliseconds: How often to rewrite the report
+*/
+void stepInstrumentation::setPeriodicReportFile(const std::string &inputFilePath, uint32_t inputIntervalInMilliseconds)
+{
+periodicReportFilePath = inputFilePath;
+periodicReportInterval = inputFilePath.size() == 0 ? 0 : std::max<uint64_t>(inputIntervalInMilliseconds, 1)*1000000ULL;
+nextPeriodicReportTime = getTime() + periodicReportInterval;
+}
+
+/*
+This function creates instrumentation for a new interface if the AIARENA_INSTRUMENTATION_FILE environment variable is set, with periodic reports going to that path followed by the role and a number that counts the interfaces of that role in this process.
+@param inputRoleName: The role of the interface ("game" or "AI")
+@return: The instrumentation or NULL if the environment variable isn't set
+*/
+stepInstrumentation *createInstrumentationFromEnvironment(const std::string &inputRoleName)
+{
+const char *reportFilePrefix = getenv(INSTRUMENTATION_FILE_ENVIRONMENT_VARIABLE);
+if(reportFilePrefix == NULL || reportFilePrefix[0] == '\0')
+{
+return NULL;
+}
+
+uint32_t reportInterval = INSTRUMENTATION_DEFAULT_REPORT_INTERVAL;
+const char *reportIntervalString = getenv(INSTRUMENTATION_INTERVAL_ENVIRONMENT_VARIABLE);
+if(reportIntervalString != NULL && atoi(reportIntervalString) > 0)
+{
+reportInterval = atoi(reportIntervalString);
+}
+
+//Number the interfaces of each role so that several in one process (such as a batched AI) get their own reports
+static std::atomic<uint32_t> numberOfGameInterfaces(0);
+static std::atomic<uint32_t> numberOfAIInterfaces(0);
+uint32_t interfaceNumber = inputRoleName == "game" ? numberOfGameInterfaces++ : numberOfAIInterfaces++;
+
+stepInstrumentation *instrumentation = new stepInstrumentation(inputRoleName);
+instrumentation->setPeriodicReportFile(std::string(reportFilePrefix) + "." + inputRoleName + std::to_string(interfaceNumber), reportInterval);
+return instrumentation;
+}
@@ -0,0 +1,310 @@
+#ifndef STEPINSTRUMENTATIONHPP
+#define STEPINSTRUMENTATIONHPP
+
+#include<cstdint>
+#include<cstdio>
+#include<string>
+#include<chrono>
+
+#include "SOMException.hpp"
+
+//Environment variable that turns instrumentation on for every interface in the process, with reports written periodically to files starting with its value (".game<N>" or ".AI<N>" is added to the end)
+#define INSTRUMENTATION_FILE_ENVIRONMENT_VARIABLE "AIARENA_INSTRUMENTATION_FILE"
+
+//Environment variable giving how often (in milliseconds) those reports are rewritten
+#define INSTRUMENTATION_INTERVAL_ENVIRONMENT_VARIABLE "AIARENA_INSTRUMENTATION_INTERVAL"
+
+//Report interval used if INSTRUMENTATION_INTERVAL_ENVIRONMENT_VARIABLE isn't set
+#define INSTRUMENTATION_DEFAULT_REPORT_INTERVAL 1000
+
+//Each power of two range of a latencyHistogram is split into 2^LATENCY_HISTOGRAM_SUB_BUCKET_BITS buckets (so values are recorded to within about 3%)
+#define LATENCY_HISTOGRAM_SUB_BUCKET_BITS 5
+#define LATENCY_HISTOGRAM_SUB_BUCKET_COUNT (1 << LATENCY_HISTOGRAM_SUB_BUCKET_BITS)
+
+//Largest power of two range the histogram covers (larger values are recorded as the largest value it can hold, about 78 hours in nanoseconds)
+#define LATENCY_HISTOGRAM_MAXIMUM_MAGNITUDE 47
+#define LATENCY_HISTOGRAM_BUCKET_COUNT (LATENCY_HISTOGRAM_SUB_BUCKET_COUNT*(LATENCY_HISTOGRAM_MAXIMUM_MAGNITUDE - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 2))
+
+/*
+This class is a histogram of latencies in the style of HdrHistogram: values are counted in buckets whose width grows with the value (linearly within each power of two), so recording is a few instructions into a fixed array with no allocation and percentiles are accurate to a few percent over the whole range.
+*/
+class latencyHistogram
+{
+public:
+/*
+This function creates an empty histogram.
+*/
+latencyHistogram();
+
+/*
+This function adds a value to the histogram.
+@param inputValue: The value (normally in nanoseconds)
+*/
+void record(uint64_t inputValue);
+
+/*
+This function removes all of the recorded values.
+*/
+void reset();
+
+/*
+This function returns how many values have been recorded.
+@return: The number of values
+*/
+uint64_t getCount() const;
+
+/*
+This function returns the smallest recorded value.
+@return: The smallest value (0 if nothing has been recorded)
+*/
+uint64_t getMinimum() const;
+
+/*
+This function returns the largest recorded value.
+@return: The largest value (0 if nothing has been recorded)
+*/
+uint64_t getMaximum() const;
+
+/*
+This function returns the mean of the recorded values.
+@return: The mean (0 if nothing has been recorded)
+*/
+double getMean() const;
+
+/*
+This function returns the value that the given percentage of the recorded values are at or below (to the precision of the buckets).
+@param inputPercentile: The percentile (0 to 100)
+@return: The value (0 if nothing has been recorded)
+*/
+uint64_t getValueAtPercentile(double inputPercentile) const;
+
+private:
+uint64_t counts[LATENCY_HISTOGRAM_BUCKET_COUNT];
+uint64_t count;
+uint64_t minimum;
+uint64_t maximum;
+double sum;
+
+/*
+This function returns the bucket that a value is counted in.
+@param inputValue: The value
+@return: The index of the bucket
+*/
+static uint32_t getBucketIndex(uint64_t inputValue);
+
+/*
+This function returns the largest value counted in the given bucket.
+@param inputBucketIndex: The index of the bucket
+@return: The largest value of the bucket
+*/
+static uint64_t getBucketUpperBound(uint32_t inputBucketIndex);
+};
+
+/*
+This class records where the time goes in the steps of one session (serializing a message, sending it, waiting for the other side and parsing its answer), along with counts of steps, bytes, stale messages that were skipped, handshake retries and missed action deadlines.  It is filled in by the communication interfaces and their transport when instrumentation is enabled and can be queried directly or written out as a text report, either on demand or periodically (and once more when it is destroyed).
+*/
+class stepInstrumentation
+{
+public:
+/*
+This function creates an empty set of measurements.
+@param inputName: The name to put at the top of reports (such as "game" or "AI")
+*/
+stepInstrumentation(const std::string &inputName);
+
+/*
+This function writes a final report if periodic reports were set up.
+*/
+~stepInstrumentation();
+
+/*
+This function returns the current time for the measurements.
+@return: The time in nanoseconds (from an arbitrary starting point)
+*/
+static uint64_t getTime();
+
+/*
+This function records how long serializing a message took.
+@param inputDuration: The time taken in nanoseconds
+*/
+void recordSerializeTime(uint64_t inputDuration);
+
+/*
+This function records how long handing a message to the transport to send took.
+@param inputDuration: The time taken in nanoseconds
+*/
+void recordSendTime(uint64_t inputDuration);
+
+/*
+This function records how long waiting for the other side to answer took.
+@param inputDuration: The time taken in nanoseconds
+*/
+void recordPeerWaitTime(uint64_t inputDuration);
+
+/*
+This function records how long parsing a received message took.
+@param inputDuration: The time taken in nanoseconds
+*/
+void recordParseTime(uint64_t inputDuration);
+
+/*
+This function counts a message being sent.
+@param inputMessageSize: The size of the message in bytes
+*/
+void countSentMessage(uint64_t inputMessageSize);
+
+/*
+This function counts a message being received.
+@param inputMessageSize: The size of the message in bytes
+*/
+void countReceivedMessage(uint64_t inputMessageSize);
+
+/*
+This function counts a finished step (a percept sent and answered for the game, a percept received for the AI) and writes the periodic report if it is due.
+*/
+void countStep();
+
+/*
+This function counts a message that was skipped because it was stale (out of sequence, or a leftover handshake message).
+*/
+void countStaleMessage();
+
+/*
+This function counts a handshake message that had to be sent (or answered) again.
+*/
+void countHandshakeRetry();
+
+/*
+This function counts a step that the AI didn't answer before the action deadline, so the game used an action of its own.
+*/
+void countMissedDeadline();
+
+/*
+This function returns the times (in nanoseconds) spent serializing messages.
+@return: The histogram of the times
+*/
+const latencyHistogram &getSerializeTimes() const;
+
+/*
+This function returns the times (in nanoseconds) spent handing messages to the transport.
+@return: The histogram of the times
+*/
+const latencyHistogram &getSendTimes() const;
+
+/*
+This function returns the times (in nanoseconds) spent waiting for the other side.
+@return: The histogram of the times
+*/
+const latencyHistogram &getPeerWaitTimes() const;
+
+/*
+This function returns the times (in nanoseconds) spent parsing messages.
+@return: The histogram of the times
+*/
+const latencyHistogram &getParseTimes() const;
+
+/*
+This function returns how many steps have finished.
+@return: The count
+*/
+uint64_t getNumberOfSteps() const;
+
+/*
+This function returns how many messages have been sent.
+@return: The count
+*/
+uint64_t getNumberOfMessagesSent() const;
+
+/*
+This function returns how many bytes have been sent.
+@return: The count
+*/
+uint64_t getNumberOfBytesSent() const;
+
+/*
+This function returns how many messages have been received.
+@return: The count
+*/
+uint64_t getNumberOfMessagesReceived() const;
+
+/*
+This function returns how many bytes have been received.
+@return: The count
+*/
+uint64_t getNumberOfBytesReceived() const;
+
+/*
+This function returns how many stale messages have been skipped.
+@return: The count
+*/
+uint64_t getNumberOfStaleMessages() const;
+
+/*
+This function returns how many handshake messages had to be sent or answered again.
+@return: The count
+*/
+uint64_t getNumberOfHandshakeRetries() const;
+
+/*
+This function returns how many steps the AI missed the action deadline in.
+@return: The count
+*/
+uint64_t getNumberOfMissedDeadlines() const;
+
+/*
+This function removes all of the measurements.
+*/
+void reset();
+
+/*
+This function writes a text report of the measurements (the counters, then the count, mean, percentiles and maximum of each latency in microseconds).
+@param inputFile: The file to write to
+*/
+void writeReport(FILE *inputFile) const;
+
+/*
+This function writes the report to the given file, replacing it (the report is written to a temporary file first and renamed, so readers never see half a report).
+@param inputFilePath: The file to write
+@exceptions: This function can throw exceptions (if the file can't be written)
+*/
+void writeReportToFile(const std::string &inputFilePath) const;
+
+/*
+This function makes the report be rewritten to the given file every so often (checked at the end of each step) and when this object is destroyed.
+@param inputFilePath: The file to write (empty to stop the periodic reports)
+@param inputIntervalInMilliseconds: How often to rewrite the report
+*/
+void setPeriodicReportFile(const std::string &inputFilePath, uint32_t inputIntervalInMilliseconds = INSTRUMENTATION_DEFAULT_REPORT_INTERVAL);
+
+private:
+std::string name;
+latencyHistogram serializeTimes;
+latencyHistogram sendTimes;
+latencyHistogram peerWaitTimes;
+latencyHistogram parseTimes;
+uint64_t numberOfSteps;
+uint64_t numberOfMessagesSent;
+uint64_t numberOfBytesSent;
+uint64_t numberOfMessagesReceived;
+uint64_t numberOfBytesReceived;
+uint64_t numberOfStaleMessages;
+uint64_t numberOfHandshakeRetries;
+uint64_t numberOfMissedDeadlines;
+
+std::string periodicReportFilePath;
+uint64_t periodicReportInterval; //In nanoseconds
+uint64_t nextPeriodicReportTime;
+};
+
+/*
+This function creates instrumentation for a new interface if the AIARENA_INSTRUMENTATION_FILE environment variable is set, with periodic reports going to that path followed by the role and a number that counts the interfaces of that role in this process.
+@param inputRoleName: The role of the interface ("game" or "AI")
+@return: The instrumentation or NULL if the environment variable isn't set
+*/
+stepInstrumentation *createInstrumentationFromEnvironment(const std::string &inputRoleName);
+
+
+
+
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef TRAJECTORYFILEHPP
+#define TRAJECTORYFILEHPP
+
+#include<cstdint>
+
+/*
+A trajectory file holds every step of a session as the game saw it: each percept (with its reward, game state and sequence number) followed by the action the AI answered it with.  It is written append-only by trajectoryRecorder and read in place through a memory map by trajectoryReader.
+
+Layout (in the byte order of the host that wrote it, like the fixed layout wire format, with every part starting on an 8 byte boundary):
+trajectoryFileHeader
+A trajectoryStepHeader for each step, followed by the percept bytes, then the action bytes, then padding to the next multiple of 8
+A trajectoryEpisodeIndexEntry for each episode
+trajectoryFileTrailer
+
+The index and trailer are only written when recording is stopped, so a file from a process that crashed has neither.  Readers then rebuild the index by walking the step records, stopping at the first incomplete one.
+*/
+
+#define TRAJECTORY_FILE_MAGIC 0x314a415254414941ULL //"AIATRAJ1" in memory
+#define TRAJECTORY_FILE_TRAILER_MAGIC 0x31444e4554414941ULL //"AIATEND1" in memory
+#define TRAJECTORY_STEP_MAGIC 0x50455453U //"STEP" in memory
+#define TRAJECTORY_FILE_FORMAT_VERSION 1
+
+//Bits in trajectoryStepHeader::actionFlags (the first two match the FIXED_LAYOUT_ACTION_* bits)
+#define TRAJECTORY_ACTION_RESET_GAME 1U
+#define TRAJECTORY_ACTION_TERMINATE_GAME_SESSION 2U
+#define TRAJECTORY_ACTION_UNANSWERED 4U //Recording stopped before the AI answered the percept, so there are no action bytes
+#define TRAJECTORY_ACTION_MISSED_DEADLINE 8U //The AI didn't answer before the action deadline, so the action is the one the game used in its place
+
+/*
+The start of the file.
+*/
+struct trajectoryFileHeader
+{
+uint64_t magic; //TRAJECTORY_FILE_MAGIC
+uint32_t formatVersion; //TRAJECTORY_FILE_FORMAT_VERSION
+uint32_t headerSize; //sizeof(trajectoryFileHeader), so later versions can add fields
+uint64_t sizeOfPerceptInBits;
+uint64_t sizeOfActionInBits;
+};
+
+/*
+The header in front of each step's percept and action bytes.
+*/
+struct trajectoryStepHeader
+{
+uint32_t magic; //TRAJECTORY_STEP_MAGIC
+uint32_t gameState; //The gameState sent with the percept
+uint64_t sequenceNumber;
+uint64_t reward;
+uint64_t perceptSize; //Number of percept bytes following the header
+uint64_t actionSize; //Number of action bytes following the percept
+uint32_t actionFlags; //TRAJECTORY_ACTION_* bits
+uint32_t reserved;
+};
+
+/*
+Where an episode (the steps from a GAME_START percept to the GAME_OVER percept that ends it) is in the file.
+*/
+struct trajectoryEpisodeIndexEntry
+{
+uint64_t offset; //File offset of the episode's first trajectoryStepHeader
+uint64_t numberOfSteps;
+uint64_t firstSequenceNumber;
+uint64_t totalReward;
+};
+
+/*
+The end of a file whose recording was stopped cleanly.
+*/
+struct trajectoryFileTrailer
+{
+uint64_t magic; //TRAJECTORY_FILE_TRAILER_MAGIC
+uint64_t indexOffset; //File offset of the first trajectoryEpisodeIndexEntry (which is also where the step records end)
+uint64_t numberOfEpisodes;
+uint64_t numberOfSteps;
+};
+
+static_assert(sizeof(trajectoryFileHeader) == 32, "Trajectory file header must not contain padding");
+static_assert(sizeof(trajectoryStepHeader) == 48, "Trajectory step header must not contain padding");
+static_assert(sizeof(trajectoryEpisodeIndexEntry) == 32, "Trajectory index entry must not contain padding");
+static_assert(sizeof(trajectoryFileTrailer) == 32, "Trajectory file trailer must not contain padding");
+
+/*
+This function returns how many bytes a step record takes up in the file.
+@param inputPerceptSize: The number of percept bytes
+@param inputActionSize: The number of action bytes
+@return: The size of the header, percept and action rounded up to a multiple of 8
+*/
+inline uint64_t getTrajectoryStepRecordSize(uint64_t inputPerceptSize, uint64_t inputActionSize)
+{
+return (sizeof(trajectoryStepHeader) + inputPerceptSize + inputActionSize + 7) & ~((uint64_t) 7);
+}
+
+
+
+
+
+#endif
@@ -0,0 +1,277 @@
+#include "trajectoryReader.hpp"
+
+#include<cstring>
+#include<cerrno>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+
+/*
+This function maps the file and loads its episode index.
+@param inputFilePath: The file to read
+@exceptions: This function can throw exceptions (if the file can't be mapped or isn't a trajectory file)
+*/
+trajectoryReader::trajectoryReader(const std::string &inputFilePath) : filePath(inputFilePath), mappedFile(NULL), mappedFileSize(0), complete(false), endOfSteps(0), numberOfSteps(0)
+{
+int fileDescriptor = open(filePath.c_str(), O_RDONLY);
+if(fileDescriptor < 0)
+{
+throw SOMException("Error opening trajectory file " + filePath + ": " + strerror(errno) + "\n", FILE_SYSTEM_ERROR, __FILE__, __LINE__);
+}
+
+struct stat fileStatus;
+if(fstat(fileDescriptor, &fileStatus) != 0 || fileStatus.st_size < (off_t) sizeof(trajectoryFileHeader))
+{
+close(fileDescriptor);
+throw SOMException("Error, " + filePath + " is too small to be a trajectory file\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+mappedFileSize = fileStatus.st_size;
+
+void *mapping = mmap(NULL, mappedFileSize, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+close(fileDescriptor); //The mapping keeps the file open
+if(mapping == MAP_FAILED)
+{
+throw SOMException("Error mapping trajectory file " + filePath + ": " + strerror(errno) + "\n", FILE_SYSTEM_ERROR, __FILE__, __LINE__);
+}
+mappedFile = (const char *) mapping;
+
+memcpy(&header, mappedFile, sizeof(header));
+if(header.magic != TRAJECTORY_FILE_MAGIC || header.formatVersion != TRAJECTORY_FILE_FORMAT_VERSION || header.headerSize != sizeof(header))
+{
+munmap((void *) mappedFile, mappedFileSize);
+throw SOMException("Error, " + filePath + " is not a trajectory file this library can read\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+//Use the index at the end of the file if the recording was stopped cleanly
+if(mappedFileSize >= sizeof(header) + sizeof(trajectoryFileTrailer))
+{
+trajectoryFileTrailer trailer;
+memcpy(&trailer, mappedFile + mappedFileSize - sizeof(trailer), sizeof(trailer));
+
+uint64_t indexSize = trailer.numberOfEpisodes*sizeof(trajectoryEpisodeIndexEntry);
+if(trailer.magic == TRAJECTORY_FILE_TRAILER_MAGIC && trailer.indexOffset >= sizeof(header) && trailer.numberOfEpisodes <= mappedFileSize/sizeof(trajectoryEpisodeIndexEntry) && trailer.indexOffset + indexSize + sizeof(trailer) == mappedFileSize)
+{
+episodes.resize(trailer.numberOfEpisodes);
+if(indexSize > 0)
+{
+memcpy(episodes.data(), mappedFile + trailer.indexOffset, indexSize);
+}
+endOfSteps = trailer.indexOffset;
+numberOfSteps = trailer.numberOfSteps;
+complete = true;
+return;
+}
+}
+
+rebuildIndex();
+}
+
+/*
+This function unmaps the file.
+*/
+trajectoryReader::~trajectoryReader()
+{
+munmap((void *) mappedFile, mappedFileSize);
+}
+
+/*
+This function returns the percept size from the file header.
+@return: The size of a percept in bits
+*/
+uint64_t trajectoryReader::getSizeOfPerceptInBits() const
+{
+return header.sizeOfPerceptInBits;
+}
+
+/*
+This function returns the action size from the file header.
+@return: The size of an action in bits
+*/
+uint64_t trajectoryReader::getSizeOfActionInBits() const
+{
+return header.sizeOfActionInBits;
+}
+
+/*
+This function returns true if the file was finished cleanly (so its index was read from the file rather than rebuilt).
+@return: True if the file has a trailer
+*/
+bool trajectoryReader::isComplete() const
+{
+return complete;
+}
+
+/*
+This function returns how many steps the file holds.
+@return: The number of steps
+*/
+uint64_t trajectoryReader::getNumberOfSteps() const
+{
+return numberOfSteps;
+}
+
+/*
+This function returns how many episodes the file holds.
+@return: The number of episodes
+*/
+uint64_t trajectoryReader::getNumberOfEpisodes() const
+{
+return episodes.size();
+}
+
+/*
+This function returns where an episode is in the file and its totals.
+@param inputEpisodeIndex: The episode (0 to getNumberOfEpisodes() - 1)
+@return: The index entry for the episode
+@exceptions: This function can throw exceptions (if the episode doesn't exist)
+*/
+const trajectoryEpisodeIndexEntry &trajectoryReader::getEpisode(uint64_t inputEpisodeIndex) const
+{
+if(inputEpisodeIndex >= episodes.size())
+{
+throw SOMException("Error, trajectory episode " + std::to_string(inputEpisodeIndex) + " doesn't exist\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+return episodes[inputEpisodeIndex];
+}
+
+/*
+This function gets all of the steps of an episode.
+@param inputEpisodeIndex: The episode (0 to getNumberOfEpisodes() - 1)
+@param outputSteps: The steps, in order (the vector is cleared first, so it can be reused to avoid allocations)
+@exceptions: This function can throw exceptions (if the episode doesn't exist or its records are invalid)
+*/
+void trajectoryReader::getEpisodeSteps(uint64_t inputEpisodeIndex, std::vector<trajectoryStep> &outputSteps) const
+{
+outputSteps.clear();
+
+const trajectoryEpisodeIndexEntry *episode = NULL;
+SOM_TRY
+episode = &getEpisode(inputEpisodeIndex);
+SOM_CATCH("Error getting episode\n")
+
+uint64_t offset = episode->offset;
+outputSteps.resize(episode->numberOfSteps);
+for(trajectoryStep &step : outputSteps)
+{
+SOM_TRY
+offset = readStep(offset, step);
+SOM_CATCH("Error reading episode step\n")
+}
+}
+
+/*
+This function reads the step record at the given offset, so steps can be walked one at a time (starting from an episode's offset) without building a vector.
+@param inputOffset: The file offset of the step's record
+@param outputStep: The step
+@return: The offset of the next step's record (equal to the end of the steps if this was the last one)
+@exceptions: This function can throw exceptions (if there isn't a valid step record at the offset)
+*/
+uint64_t trajectoryReader::readStep(uint64_t inputOffset, trajectoryStep &outputStep) const
+{
+uint64_t recordSize = getValidStepRecordSize(inputOffset, endOfSteps);
+if(recordSize == 0)
+{
+throw SOMException("Error, no valid trajectory step at offset " + std::to_string(inputOffset) + " of " + filePath + "\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+trajectoryStepHeader stepHeader;
+memcpy(&stepHeader, mappedFile + inputOffset, sizeof(stepHeader));
+
+outputStep.sequenceNumber = stepHeader.sequenceNumber;
+outputStep.state = (gameState) stepHeader.gameState;
+outputStep.reward = stepHeader.reward;
+outputStep.percept = mappedFile + inputOffset + sizeof(stepHeader);
+outputStep.perceptSize = stepHeader.perceptSize;
+outputStep.action = outputStep.percept + stepHeader.perceptSize;
+outputStep.actionSize = stepHeader.actionSize;
+outputStep.actionFlags = stepHeader.actionFlags;
+outputStep.offset = inputOffset;
+
+return inputOffset + recordSize;
+}
+
+/*
+This function returns the offset just past the last step record.
+@return: The offset
+*/
+uint64_t trajectoryReader::getEndOfSteps() const
+{
+return endOfSteps;
+}
+
+/*
+This function checks if there is a complete, valid step record at the given offset.
+@param inputOffset: The offset to check
+@param inputEndOffset: Where the records end
+@return: The size of the record, or 0 if there isn't a valid one
+*/
+uint64_t trajectoryReader::getValidStepRecordSize(uint64_t inputOffset, uint64_t inputEndOffset) const
+{
+if(inputOffset < sizeof(header) || inputOffset > inputEndOffset || inputEndOffset - inputOffset < sizeof(trajectoryStepHeader))
+{
+return 0;
+}
+
+trajectoryStepHeader stepHeader;
+memcpy(&stepHeader, mappedFile + inputOffset, sizeof(stepHeader));
+
+//Check the sizes separately first so a corrupt header can't overflow the sum
+uint64_t spaceLeft = inputEndOffset - inputOffset;
+if(stepHeader.magic != TRAJECTORY_STEP_MAGIC || !gameState_IsValid(stepHeader.gameState) || stepHeader.perceptSize > spaceLeft || stepHeader.actionSize > spaceLeft)
+{
+return 0;
+}
+
+uint64_t recordSize = getTrajectoryStepRecordSize(stepHeader.perceptSize, stepHeader.actionSize);
+if(recordSize > spaceLeft)
+{
+return 0;
+}
+
+return recordSize;
+}
+
+/*
+This function rebuilds the episode index by walking the step records, for files without a trailer.
+*/
+void trajectoryReader::rebuildIndex()
+{
+//Episodes are split the same way trajectoryRecorder splits them
+bool episodeOpen = false;
+uint64_t offset = sizeof(header);
+while(true)
+{
+uint64_t recordSize = getValidStepRecordSize(offset, mappedFileSize);
+if(recordSize == 0)
+{
+break; //The end of the file, or a record the recording process didn't finish writing
+}
+
+trajectoryStepHeader stepHeader;
+memcpy(&stepHeader, mappedFile + offset, sizeof(stepHeader));
+
+if(!episodeOpen || stepHeader.gameState == GAME_START)
+{
+trajectoryEpisodeIndexEntry episode;
+episode.offset = offset;
+episode.numberOfSteps = 0;
+episode.firstSequenceNumber = stepHeader.sequenceNumber;
+episode.totalReward = 0;
+episodes.push_back(episode);
+episodeOpen = true;
+}
+episodes.back().numberOfSteps++;
+episodes.back().totalReward += stepHeader.reward;
+if(stepHeader.gameState == GAME_OVER)
+{
+episodeOpen = false;
+}
+
+numberOfSteps++;
+offset += recordSize;
+}
+
+endOfSteps = offset;
+}
@@ -0,0 +1,138 @@
+#ifndef TRAJECTORYREADERHPP
+#define TRAJECTORYREADERHPP
+
+#include<cstdint>
+#include<string>
+#include<vector>
+
+#include "SOMException.hpp"
+#include "trajectoryFile.hpp"
+#include "perceptOrActionMessage.pb.h"
+
+/*
+One recorded step.  The percept and action point into the reader's memory map, so they stay valid for as long as the reader exists.
+*/
+struct trajectoryStep
+{
+uint64_t sequenceNumber;
+gameState state; //The game state sent with the percept
+uint64_t reward;
+const char *percept;
+uint64_t perceptSize;
+const char *action;
+uint64_t actionSize;
+uint32_t actionFlags; //TRAJECTORY_ACTION_* bits
+uint64_t offset; //File offset of the step's record
+};
+
+/*
+This class reads a trajectory file written by trajectoryRecorder (see trajectoryFile.hpp) through a read-only memory map, so nothing is copied and only the parts of the file that are used are paged in, however large the file is.  Files that were never finished (because the recording process died) are read up to their last complete step, with the episode index rebuilt by walking the steps.
+*/
+class trajectoryReader
+{
+public:
+/*
+This function maps the file and loads its episode index.
+@param inputFilePath: The file to read
+@exceptions: This function can throw exceptions (if the file can't be mapped or isn't a trajectory file)
+*/
+trajectoryReader(const std::string &inputFilePath);
+
+/*
+This function unmaps the file.
+*/
+~trajectoryReader();
+
+trajectoryReader(const trajectoryReader &) = delete;
+trajectoryReader &operator=(const trajectoryReader &) = delete;
+
+/*
+This function returns the percept size from the file header.
+@return: The size of a percept in bits
+*/
+uint64_t getSizeOfPerceptInBits() const;
+
+/*
+This function returns the action size from the file header.
+@return: The size of an action in bits
+*/
+uint64_t getSizeOfActionInBits() const;
+
+/*
+This function returns true if the file was finished cleanly (so its index was read from the file rather than rebuilt).
+@return: True if the file has a trailer
+*/
+bool isComplete() const;
+
+/*
+This function returns how many steps the file holds.
+@return: The number of steps
+*/
+uint64_t getNumberOfSteps() const;
+
+/*
+This function returns how many episodes the file holds.
+@return: The number of episodes
+*/
+uint64_t getNumberOfEpisodes() const;
+
+/*
+This function returns where an episode is in the file and its totals.
+@param inputEpisodeIndex: The episode (0 to getNumberOfEpisodes() - 1)
+@return: The index entry for the episode
+@exceptions: This function can throw exceptions (if the episode doesn't exist)
+*/
+const trajectoryEpisodeIndexEntry &getEpisode(uint64_t inputEpisodeIndex) const;
+
+/*
+This function gets all of the steps of an episode.
+@param inputEpisodeIndex: The episode (0 to getNumberOfEpisodes() - 1)
+@param outputSteps: The steps, in order (the vector is cleared first, so it can be reused to avoid allocations)
+@exceptions: This function can throw exceptions (if the episode doesn't exist or its records are invalid)
+*/
+void getEpisodeSteps(uint64_t inputEpisodeIndex, std::vector<trajectoryStep> &outputSteps) const;
+
+/*
+This function reads the step record at the given offset, so steps can be walked one at a time (starting from an episode's offset) without building a vector.
+@param inputOffset: The file offset of the step's record
+@param outputStep: The step
+@return: The offset of the next step's record (equal to the end of the steps if this was the last one)
+@exceptions: This function can throw exceptions (if there isn't a valid step record at the offset)
+*/
+uint64_t readStep(uint64_t inputOffset, trajectoryStep &outputStep) const;
+
+/*
+This function returns the offset just past the last step record.
+@return: The offset
+*/
+uint64_t getEndOfSteps() const;
+
+private:
+std::string filePath;
+const char *mappedFile;
+uint64_t mappedFileSize;
+trajectoryFileHeader header;
+bool complete;
+uint64_t endOfSteps;
+uint64_t numberOfSteps;
+std::vector<trajectoryEpisodeIndexEntry> episodes;
+
+/*
+This function checks if there is a complete, valid step record at the given offset.
+@param inputOffset: The offset to check
+@param inputEndOffset: Where the records end
+@return: The size of the record, or 0 if there isn't a valid one
+*/
+uint64_t getValidStepRecordSize(uint64_t inputOffset, uint64_t inputEndOffset) const;
+
+/*
+This function rebuilds the episode index by walking the step records, for files without a trailer.
+*/
+void rebuildIndex();
+};
+
+
+
+
+
+#endif
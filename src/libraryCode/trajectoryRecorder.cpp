@@ -0,0 +1,291 @@
+#include "trajectoryRecorder.hpp"
+
+#include<cstring>
+#include<cstdlib>
+#include<atomic>
+
+/*
+This function creates the file (replacing any file already there), writes its header and starts the writer thread.
+@param inputFilePath: The file to write
+@param inputSizeOfPerceptInBits: The percept size to record in the header
+@param inputSizeOfActionInBits: The action size to record in the header
+@exceptions: This function can throw exceptions (if the file can't be created)
+*/
+trajectoryRecorder::trajectoryRecorder(const std::string &inputFilePath, uint64_t inputSizeOfPerceptInBits, uint64_t inputSizeOfActionInBits) : filePath(inputFilePath), file(NULL), stopped(false), unfinishedStepOffset(0), stepUnfinished(false), fileSize(0), numberOfSteps(0), episodeOpen(false), numberOfBuffers(1), writerStopping(false), writeFailed(false)
+{
+file = fopen(filePath.c_str(), "wb");
+if(file == NULL)
+{
+throw SOMException("Error, unable to create trajectory file " + filePath + "\n", FILE_SYSTEM_ERROR, __FILE__, __LINE__);
+}
+
+activeBuffer.reserve(TRAJECTORY_RECORDER_BUFFER_SIZE + sizeof(trajectoryStepHeader));
+
+//The header goes through the writer thread like everything else, so the file is only ever written from one place
+trajectoryFileHeader header;
+header.magic = TRAJECTORY_FILE_MAGIC;
+header.formatVersion = TRAJECTORY_FILE_FORMAT_VERSION;
+header.headerSize = sizeof(header);
+header.sizeOfPerceptInBits = inputSizeOfPerceptInBits;
+header.sizeOfActionInBits = inputSizeOfActionInBits;
+activeBuffer.append((const char *) &header, sizeof(header));
+fileSize = sizeof(header);
+
+try
+{
+writerThread = std::thread(&trajectoryRecorder::runWriter, this);
+}
+catch(const std::exception &)
+{
+fclose(file);
+throw SOMException("Error, unable to start trajectory writer thread\n", SYSTEM_ERROR, __FILE__, __LINE__);
+}
+}
+
+/*
+This function stops recording (see stop), ignoring any errors since destructors can't throw.
+*/
+trajectoryRecorder::~trajectoryRecorder()
+{
+try
+{
+stop();
+}
+catch(...)
+{
+}
+}
+
+/*
+This function records a percept being sent.  The step is finished by finishStep once the AI answers.  A GAME_START percept (or the first percept after a GAME_OVER one) starts a new episode.
+@param inputSequenceNumber: The sequence number of the percept
+@param inputGameState: The game state sent with the percept
+@param inputReward: The reward sent with the percept
+@param inputPercept: The percept bytes (copied)
+@param inputPerceptSize: The number of percept bytes
+@exceptions: This function can throw exceptions (if the last step wasn't finished or recording has stopped)
+*/
+void trajectoryRecorder::beginStep(uint64_t inputSequenceNumber, gameState inputGameState, uint64_t inputReward, const char *inputPercept, uint64_t inputPerceptSize)
+{
+if(stopped || stepUnfinished)
+{
+throw SOMException("Error, trajectory step can't be started (recording stopped or the last step wasn't finished)\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+if(!episodeOpen || inputGameState == GAME_START)
+{
+trajectoryEpisodeIndexEntry episode;
+episode.offset = fileSize;
+episode.numberOfSteps = 0;
+episode.firstSequenceNumber = inputSequenceNumber;
+episode.totalReward = 0;
+episodes.push_back(episode);
+episodeOpen = true;
+}
+episodes.back().numberOfSteps++;
+episodes.back().totalReward += inputReward;
+if(inputGameState == GAME_OVER)
+{
+episodeOpen = false;
+}
+
+//The action size and flags are filled in by finishStep
+trajectoryStepHeader header;
+header.magic = TRAJECTORY_STEP_MAGIC;
+header.gameState = inputGameState;
+header.sequenceNumber = inputSequenceNumber;
+header.reward = inputReward;
+header.perceptSize = inputPerceptSize;
+header.actionSize = 0;
+header.actionFlags = 0;
+header.reserved = 0;
+
+unfinishedStepOffset = activeBuffer.size();
+activeBuffer.append((const char *) &header, sizeof(header));
+activeBuffer.append(inputPercept, inputPerceptSize);
+stepUnfinished = true;
+numberOfSteps++;
+}
+
+/*
+This function records the AI's answer to the percept given to beginStep.
+@param inputAction: The action bytes (copied)
+@param inputActionSize: The number of action bytes
+@param inputActionFlags: The TRAJECTORY_ACTION_* bits for the action
+@exceptions: This function can throw exceptions (if no step was begun)
+*/
+void trajectoryRecorder::finishStep(const char *inputAction, uint64_t inputActionSize, uint32_t inputActionFlags)
+{
+if(!stepUnfinished)
+{
+throw SOMException("Error, no trajectory step has been started\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+trajectoryStepHeader header;
+memcpy(&header, activeBuffer.data() + unfinishedStepOffset, sizeof(header));
+header.actionSize = inputActionSize;
+header.actionFlags = inputActionFlags;
+memcpy(&activeBuffer[unfinishedStepOffset], &header, sizeof(header));
+
+if(inputActionSize > 0)
+{
+activeBuffer.append(inputAction, inputActionSize);
+}
+uint64_t recordSize = getTrajectoryStepRecordSize(header.perceptSize, header.actionSize);
+activeBuffer.append(recordSize - (activeBuffer.size() - unfinishedStepOffset), '\0'); //Pad to a multiple of 8
+fileSize += recordSize;
+stepUnfinished = false;
+
+if(activeBuffer.size() >= TRAJECTORY_RECORDER_BUFFER_SIZE)
+{
+handOffActiveBuffer();
+}
+}
+
+/*
+This function finishes the file: a step that is still waiting for its action is recorded as unanswered, the episode index and trailer are written, and the writer thread is stopped once everything is on disk.  Later calls do nothing.
+@exceptions: This function can throw exceptions (if any of the file couldn't be written)
+*/
+void trajectoryRecorder::stop()
+{
+if(stopped)
+{
+return;
+}
+
+if(stepUnfinished)
+{
+finishStep(NULL, 0, TRAJECTORY_ACTION_UNANSWERED);
+}
+stopped = true;
+
+trajectoryFileTrailer trailer;
+trailer.magic = TRAJECTORY_FILE_TRAILER_MAGIC;
+trailer.indexOffset = fileSize;
+trailer.numberOfEpisodes = episodes.size();
+trailer.numberOfSteps = numberOfSteps;
+if(!episodes.empty())
+{
+activeBuffer.append((const char *) episodes.data(), episodes.size()*sizeof(trajectoryEpisodeIndexEntry));
+}
+activeBuffer.append((const char *) &trailer, sizeof(trailer));
+handOffActiveBuffer();
+
+{
+std::lock_guard<std::mutex> lock(bufferMutex);
+writerStopping = true;
+}
+bufferCondition.notify_one();
+writerThread.join();
+
+bool fileWritten = !writeFailed;
+if(fclose(file) != 0)
+{
+fileWritten = false;
+}
+file = NULL;
+
+if(!fileWritten)
+{
+throw SOMException("Error, unable to write trajectory file " + filePath + "\n", FILE_SYSTEM_ERROR, __FILE__, __LINE__);
+}
+}
+
+/*
+This function returns how many steps have been recorded (including one waiting for its action).
+@return: The number of steps
+*/
+uint64_t trajectoryRecorder::getNumberOfSteps()
+{
+return numberOfSteps;
+}
+
+/*
+This function returns how many episodes have been started.
+@return: The number of episodes
+*/
+uint64_t trajectoryRecorder::getNumberOfEpisodes()
+{
+return episodes.size();
+}
+
+/*
+This function hands activeBuffer to the writer thread and replaces it with a free buffer (allocating a new one if there isn't one and the limit hasn't been reached, and otherwise waiting for the writer to free one).
+*/
+void trajectoryRecorder::handOffActiveBuffer()
+{
+{
+std::unique_lock<std::mutex> lock(bufferMutex);
+fullBuffers.push_back(std::move(activeBuffer));
+bufferCondition.notify_one();
+
+if(freeBuffers.empty() && numberOfBuffers < TRAJECTORY_RECORDER_MAXIMUM_NUMBER_OF_BUFFERS)
+{
+activeBuffer = std::string(); //The writer is behind (or this is the first hand off), so start a new buffer rather than wait
+numberOfBuffers++;
+}
+else
+{
+freeBufferCondition.wait(lock, [this]() { return !freeBuffers.empty(); });
+activeBuffer = std::move(freeBuffers.back());
+freeBuffers.pop_back();
+}
+}
+
+activeBuffer.clear();
+activeBuffer.reserve(TRAJECTORY_RECORDER_BUFFER_SIZE + sizeof(trajectoryStepHeader));
+}
+
+/*
+This function is run by the writer thread: it appends full buffers to the file until it is told to stop and has written everything.
+*/
+void trajectoryRecorder::runWriter()
+{
+std::unique_lock<std::mutex> lock(bufferMutex);
+while(true)
+{
+bufferCondition.wait(lock, [this]() { return !fullBuffers.empty() || writerStopping; });
+if(fullBuffers.empty())
+{
+return; //Stopping and everything has been written
+}
+
+std::string buffer = std::move(fullBuffers.front());
+fullBuffers.pop_front();
+
+//Write without holding the lock so the step loop can keep handing off buffers
+lock.unlock();
+bool bufferWritten = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+lock.lock();
+
+if(!bufferWritten)
+{
+writeFailed = true;
+}
+freeBuffers.push_back(std::move(buffer));
+freeBufferCondition.notify_one();
+}
+}
+
+/*
+This function creates a recorder for a new game interface if the AIARENA_TRAJECTORY_FILE environment variable is set, writing to that path followed by a number that counts the recorders created this way in this process.
+@param inputSizeOfPerceptInBits: The percept size to record
+@param inputSizeOfActionInBits: The action size to record
+@return: The recorder or NULL if the environment variable isn't set
+@exceptions: This function can throw exceptions (if the file can't be created)
+*/
+trajectoryRecorder *createTrajectoryRecorderFromEnvironment(uint64_t inputSizeOfPerceptInBits, uint64_t inputSizeOfActionInBits)
+{
+const char *trajectoryFilePrefix = getenv(TRAJECTORY_FILE_ENVIRONMENT_VARIABLE);
+if(trajectoryFilePrefix == NULL || trajectoryFilePrefix[0] == '\0')
+{
+return NULL;
+}
+
+static std::atomic<uint32_t> numberOfRecorders(0);
+uint32_t recorderNumber = numberOfRecorders++;
+
+SOM_TRY
+return new trajectoryRecorder(std::string(trajectoryFilePrefix) + "." + std::to_string(recorderNumber), inputSizeOfPerceptInBits, inputSizeOfActionInBits);
+SOM_CATCH("Error creating trajectory recorder\n")
+}
@@ -0,0 +1,136 @@
+#ifndef TRAJECTORYRECORDERHPP
+#define TRAJECTORYRECORDERHPP
+
+#include<cstdint>
+#include<cstdio>
+#include<string>
+#include<vector>
+#include<deque>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+
+#include "SOMException.hpp"
+#include "trajectoryFile.hpp"
+#include "perceptOrActionMessage.pb.h"
+
+//Environment variable that turns on recording for every game interface in the process, with the trajectories written to files starting with its value (".<N>" is added to the end)
+#define TRAJECTORY_FILE_ENVIRONMENT_VARIABLE "AIARENA_TRAJECTORY_FILE"
+
+//How many bytes of steps are collected before they are handed to the writer thread
+#define TRAJECTORY_RECORDER_BUFFER_SIZE (1024*1024)
+
+//How many buffers a recorder can have at once (the one being filled, the ones waiting to be written and the free ones), which bounds its memory use
+#define TRAJECTORY_RECORDER_MAXIMUM_NUMBER_OF_BUFFERS 8
+
+/*
+This class writes a trajectory file (see trajectoryFile.hpp) without slowing down the step loop.  Steps are copied into an in-memory buffer, and full buffers are handed to a background thread that appends them to the file and gives them back to be reused.  If the writer falls behind, more buffers are allocated rather than waiting for one to be written, up to TRAJECTORY_RECORDER_MAXIMUM_NUMBER_OF_BUFFERS.  Once that many exist, no more are allocated and they are reused, and the step loop only waits for the disk if all of the others are still waiting to be written.  The episode index is kept in memory and written at the end of the file when recording stops.
+*/
+class trajectoryRecorder
+{
+public:
+/*
+This function creates the file (replacing any file already there), writes its header and starts the writer thread.
+@param inputFilePath: The file to write
+@param inputSizeOfPerceptInBits: The percept size to record in the header
+@param inputSizeOfActionInBits: The action size to record in the header
+@exceptions: This function can throw exceptions (if the file can't be created)
+*/
+trajectoryRecorder(const std::string &inputFilePath, uint64_t inputSizeOfPerceptInBits, uint64_t inputSizeOfActionInBits);
+
+/*
+This function stops recording (see stop), ignoring any errors since destructors can't throw.
+*/
+~trajectoryRecorder();
+
+trajectoryRecorder(const trajectoryRecorder &) = delete;
+trajectoryRecorder &operator=(const trajectoryRecorder &) = delete;
+
+/*
+This function records a percept being sent.  The step is finished by finishStep once the AI answers.  A GAME_START percept (or the first percept after a GAME_OVER one) starts a new episode.
+@param inputSequenceNumber: The sequence number of the percept
+@param inputGameState: The game state sent with the percept
+@param inputReward: The reward sent with the percept
+@param inputPercept: The percept bytes (copied)
+@param inputPerceptSize: The number of percept bytes
+@exceptions: This function can throw exceptions (if the last step wasn't finished or recording has stopped)
+*/
+void beginStep(uint64_t inputSequenceNumber, gameState inputGameState, uint64_t inputReward, const char *inputPercept, uint64_t inputPerceptSize);
+
+/*
+This function records the AI's answer to the percept given to beginStep.
+@param inputAction: The action bytes (copied)
+@param inputActionSize: The number of action bytes
+@param inputActionFlags: The TRAJECTORY_ACTION_* bits for the action
+@exceptions: This function can throw exceptions (if no step was begun)
+*/
+void finishStep(const char *inputAction, uint64_t inputActionSize, uint32_t inputActionFlags);
+
+/*
+This function finishes the file: a step that is still waiting for its action is recorded as unanswered, the episode index and trailer are written, and the writer thread is stopped once everything is on disk.  Later calls do nothing.
+@exceptions: This function can throw exceptions (if any of the file couldn't be written)
+*/
+void stop();
+
+/*
+This function returns how many steps have been recorded (including one waiting for its action).
+@return: The number of steps
+*/
+uint64_t getNumberOfSteps();
+
+/*
+This function returns how many episodes have been started.
+@return: The number of episodes
+*/
+uint64_t getNumberOfEpisodes();
+
+private:
+std::string filePath;
+FILE *file;
+bool stopped;
+
+//Only used by the thread doing the steps
+std::string activeBuffer; //Steps that haven't been handed to the writer thread yet
+uint64_t unfinishedStepOffset; //Where the header of the step waiting for finishStep is in activeBuffer
+bool stepUnfinished;
+uint64_t fileSize; //Bytes recorded so far, including those still in activeBuffer
+uint64_t numberOfSteps;
+std::vector<trajectoryEpisodeIndexEntry> episodes;
+bool episodeOpen; //False before the first step and after a GAME_OVER percept
+
+//Shared with the writer thread
+std::mutex bufferMutex;
+std::condition_variable bufferCondition;
+std::deque<std::string> fullBuffers; //Waiting to be written, in order
+std::vector<std::string> freeBuffers; //Written and ready to be reused
+uint32_t numberOfBuffers; //Buffers allocated so far, including activeBuffer
+std::condition_variable freeBufferCondition; //Signalled when a buffer is added to freeBuffers
+bool writerStopping;
+bool writeFailed;
+std::thread writerThread;
+
+/*
+This function hands activeBuffer to the writer thread and replaces it with a free buffer (allocating a new one if there isn't one and the limit hasn't been reached, and otherwise waiting for the writer to free one).
+*/
+void handOffActiveBuffer();
+
+/*
+This function is run by the writer thread: it appends full buffers to the file until it is told to stop and has written everything.
+*/
+void runWriter();
+};
+
+/*
+This function creates a recorder for a new game interface if the AIARENA_TRAJECTORY_FILE environment variable is set, writing to that path followed by a number that counts the recorders created this way in this process.
+@param inputSizeOfPerceptInBits: The percept size to record
+@param inputSizeOfActionInBits: The action size to record
+@return: The recorder or NULL if the environment variable isn't set
+@exceptions: This function can throw exceptions (if the file can't be created)
+*/
+trajectoryRecorder *createTrajectoryRecorderFromEnvironment(uint64_t inputSizeOfPerceptInBits, uint64_t inputSizeOfActionInBits);
+
+
+
+
+
+#endif
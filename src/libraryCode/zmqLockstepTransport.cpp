@@ -0,0 +1,186 @@
+#include "zmqLockstepTransport.hpp"
+
+/*
+This function creates the socket for the given side of the session and binds or connects it.
+@param inputRole: Which side of the session the transport is for
+@param inputContext: The ZMQ context to create the socket with
+@param inputGameEndpoint: The endpoint that the game binds to and the AI connects to
+@param inputRoutingID: The routing ID the AI's socket connects with, so a multi-agent game can tell its agents apart (empty lets ZMQ pick one)
+@exceptions: This function can throw exceptions
+*/
+zmqLockstepTransport::zmqLockstepTransport(transportRole inputRole, zmq::context_t &inputContext, const std::string &inputGameEndpoint, const std::string &inputRoutingID)
+{
+currentReceiveTimeout = -1;
+currentSendTimeout = -1;
+outgoingMessageTimeout = -1;
+
+SOM_TRY
+socket.reset(new zmq::socket_t(inputContext, ZMQ_DEALER));
+SOM_CATCH("Error initializing lockstep socket\n")
+
+if(inputRole == GAME_ENGINE_ROLE)
+{
+SOM_TRY
+socket->bind(inputGameEndpoint.c_str());
+SOM_CATCH("Error binding socket\n")
+}
+else
+{
+if(inputRoutingID.size() > 0)
+{
+SOM_TRY
+socket->setsockopt(ZMQ_ROUTING_ID, inputRoutingID.c_str(), inputRoutingID.size());
+SOM_CATCH("Error setting routing ID\n")
+}
+
+SOM_TRY
+socket->connect(inputGameEndpoint.c_str());
+SOM_CATCH("Error connecting to game\n")
+}
+}
+
+/*
+This function sends the given message to the other side (which blocks until the other side has connected).
+@param inputMessage: The serialized message to send
+@param inputMessageSize: The size of the message in bytes
+@param inputTimeoutInMilliseconds: How long to wait for the message to be accepted for sending (-1 waits forever, 0 returns immediately if it can't be sent)
+@return: True if the message was sent, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+bool zmqLockstepTransport::sendMessage(const char *inputMessage, uint64_t inputMessageSize, int inputTimeoutInMilliseconds)
+{
+int flags = 0;
+SOM_TRY
+flags = prepareToSend(inputTimeoutInMilliseconds);
+SOM_CATCH("Error preparing to send\n")
+
+//Messages are never empty, so zero bytes sent means the send timed out
+SOM_TRY
+return socket->send(inputMessage, inputMessageSize, flags) != 0;
+SOM_CATCH("Error sending message\n")
+}
+
+/*
+This function returns the data of a new ZMQ message of the given size, so the message can be serialized straight into the frame that is sent.  ZMQ allocates the frame of any message over 33 bytes (smaller ones are kept inside the message object), so unlike with the shared memory transport, large messages cost an allocation each.
+@param inputMessageSize: The size of the message in bytes
+@param inputTimeoutInMilliseconds: How long commitMessage should wait for the message to be accepted for sending (-1 waits forever, 0 doesn't wait)
+@return: The buffer to write the message into
+@exceptions: This function can throw exceptions
+*/
+char *zmqLockstepTransport::reserveMessage(uint64_t inputMessageSize, int inputTimeoutInMilliseconds)
+{
+SOM_TRY
+outgoingMessage.rebuild(inputMessageSize);
+SOM_CATCH("Error creating message\n")
+
+outgoingMessageTimeout = inputTimeoutInMilliseconds;
+return (char *) outgoingMessage.data();
+}
+
+/*
+This function sends the message returned by reserveMessage (handing the frame to ZMQ rather than copying it).
+@return: True if the message was sent, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+bool zmqLockstepTransport::commitMessage()
+{
+int flags = 0;
+SOM_TRY
+flags = prepareToSend(outgoingMessageTimeout);
+SOM_CATCH("Error preparing to send\n")
+
+SOM_TRY
+return socket->send(outgoingMessage, flags);
+SOM_CATCH("Error sending message\n")
+}
+
+/*
+This function sets the send timeout of the socket (if it has changed) and returns the flags to send with.
+@param inputTimeoutInMilliseconds: How long to wait for the message to be accepted for sending (-1 waits forever, 0 doesn't wait)
+@return: The flags to pass to send
+@exceptions: This function can throw exceptions
+*/
+int zmqLockstepTransport::prepareToSend(int inputTimeoutInMilliseconds)
+{
+int flags = 0;
+if(inputTimeoutInMilliseconds == 0)
+{
+flags = ZMQ_DONTWAIT;
+}
+else if(inputTimeoutInMilliseconds != currentSendTimeout)
+{
+SOM_TRY
+socket->setsockopt(ZMQ_SNDTIMEO, &inputTimeoutInMilliseconds, sizeof(inputTimeoutInMilliseconds));
+SOM_CATCH("Error setting send timeout interval for lockstep socket\n")
+currentSendTimeout = inputTimeoutInMilliseconds;
+}
+
+return flags;
+}
+
+/*
+This function waits for the next message from the other side.
+@param inputTimeoutInMilliseconds: How long to wait for a message (-1 waits forever, 0 returns immediately if nothing is available)
+@return: True if a message was received, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+bool zmqLockstepTransport::receiveMessage(int inputTimeoutInMilliseconds)
+{
+int flags = 0;
+if(inputTimeoutInMilliseconds == 0)
+{
+flags = ZMQ_DONTWAIT;  //Set nonblocking if we are not suppose to wait
+}
+else if(inputTimeoutInMilliseconds != currentReceiveTimeout)
+{
+SOM_TRY
+socket->setsockopt(ZMQ_RCVTIMEO, &inputTimeoutInMilliseconds, sizeof(inputTimeoutInMilliseconds));
+SOM_CATCH("Error setting timeout interval for lockstep socket\n")
+currentReceiveTimeout = inputTimeoutInMilliseconds;
+}
+
+SOM_TRY
+return socket->recv(&receivedMessage, flags);
+SOM_CATCH("Error receiving message\n")
+}
+
+/*
+This function returns a pointer to the contents of the last received message.
+@return: The message bytes
+*/
+const char *zmqLockstepTransport::getReceivedMessageData()
+{
+return (const char *) receivedMessage.data();
+}
+
+/*
+This function returns the size of the last received message.
+@return: The size of the message in bytes
+*/
+uint64_t zmqLockstepTransport::getReceivedMessageSize()
+{
+return receivedMessage.size();
+}
+
+/*
+Messages are queued until they can be delivered, so this always returns false.
+@return: False
+*/
+bool zmqLockstepTransport::canDropMessages()
+{
+return false;
+}
+
+/*
+This function fills in a zmq_poll item for the socket, which becomes readable when a message arrives.
+@param outputPollItem: The poll item
+@return: True
+*/
+bool zmqLockstepTransport::getPollItem(zmq_pollitem_t &outputPollItem)
+{
+outputPollItem.socket = (void *) (*socket);
+outputPollItem.fd = 0;
+outputPollItem.events = ZMQ_POLLIN;
+outputPollItem.revents = 0;
+return true;
+}
@@ -0,0 +1,107 @@
+#ifndef ZMQLOCKSTEPTRANSPORTHPP
+#define ZMQLOCKSTEPTRANSPORTHPP
+
+#include<memory>
+#include<string>
+#include "zmq.hpp"
+
+#include "SOMException.hpp"
+#include "messageTransport.hpp"
+
+/*
+This class implements a lockstep transport using a single pair of ZMQ dealer sockets (the game binds, the AI connects).  Messages sent before the other side has connected are queued rather than dropped and every message is delivered once and in order, so a step is exactly one percept/action round trip.  Dealer sockets are used instead of ZMQ_PAIR because they reconnect automatically over TCP.
+*/
+class zmqLockstepTransport : public messageTransport
+{
+public:
+/*
+This function creates the socket for the given side of the session and binds or connects it.
+@param inputRole: Which side of the session the transport is for
+@param inputContext: The ZMQ context to create the socket with
+@param inputGameEndpoint: The endpoint that the game binds to and the AI connects to
+@param inputRoutingID: The routing ID the AI's socket connects with, so a multi-agent game can tell its agents apart (empty lets ZMQ pick one)
+@exceptions: This function can throw exceptions
+*/
+zmqLockstepTransport(transportRole inputRole, zmq::context_t &inputContext, const std::string &inputGameEndpoint, const std::string &inputRoutingID = "");
+
+/*
+This function sends the given message to the other side (which blocks until the other side has connected).
+@param inputMessage: The serialized message to send
+@param inputMessageSize: The size of the message in bytes
+@param inputTimeoutInMilliseconds: How long to wait for the message to be accepted for sending (-1 waits forever, 0 returns immediately if it can't be sent)
+@return: True if the message was sent, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+virtual bool sendMessage(const char *inputMessage, uint64_t inputMessageSize, int inputTimeoutInMilliseconds);
+
+/*
+This function returns the data of a new ZMQ message of the given size, so the message can be serialized straight into the frame that is sent.  ZMQ allocates the frame of any message over 33 bytes (smaller ones are kept inside the message object), so unlike with the shared memory transport, large messages cost an allocation each.
+@param inputMessageSize: The size of the message in bytes
+@param inputTimeoutInMilliseconds: How long commitMessage should wait for the message to be accepted for sending (-1 waits forever, 0 doesn't wait)
+@return: The buffer to write the message into
+@exceptions: This function can throw exceptions
+*/
+virtual char *reserveMessage(uint64_t inputMessageSize, int inputTimeoutInMilliseconds);
+
+/*
+This function sends the message returned by reserveMessage (handing the frame to ZMQ rather than copying it).
+@return: True if the message was sent, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+virtual bool commitMessage();
+
+/*
+This function waits for the next message from the other side.
+@param inputTimeoutInMilliseconds: How long to wait for a message (-1 waits forever, 0 returns immediately if nothing is available)
+@return: True if a message was received, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+virtual bool receiveMessage(int inputTimeoutInMilliseconds);
+
+/*
+This function returns a pointer to the contents of the last received message.
+@return: The message bytes
+*/
+virtual const char *getReceivedMessageData();
+
+/*
+This function returns the size of the last received message.
+@return: The size of the message in bytes
+*/
+virtual uint64_t getReceivedMessageSize();
+
+/*
+Messages are queued until they can be delivered, so this always returns false.
+@return: False
+*/
+virtual bool canDropMessages();
+
+/*
+This function fills in a zmq_poll item for the socket, which becomes readable when a message arrives.
+@param outputPollItem: The poll item
+@return: True
+*/
+virtual bool getPollItem(zmq_pollitem_t &outputPollItem);
+
+private:
+std::unique_ptr<zmq::socket_t> socket;
+zmq::message_t receivedMessage;
+int currentReceiveTimeout; //The ZMQ_RCVTIMEO value the socket currently has
+int currentSendTimeout; //The ZMQ_SNDTIMEO value the socket currently has
+zmq::message_t outgoingMessage; //Message being written between reserveMessage and commitMessage
+int outgoingMessageTimeout;
+
+/*
+This function sets the send timeout of the socket (if it has changed) and returns the flags to send with.
+@param inputTimeoutInMilliseconds: How long to wait for the message to be accepted for sending (-1 waits forever, 0 doesn't wait)
+@return: The flags to pass to send
+@exceptions: This function can throw exceptions
+*/
+int prepareToSend(int inputTimeoutInMilliseconds);
+};
+
+
+
+
+
+#endif
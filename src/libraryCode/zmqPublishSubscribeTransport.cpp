@@ -0,0 +1,197 @@
+#include "zmqPublishSubscribeTransport.hpp"
+
+/*
+This function creates the publishing and subscription sockets for the given side of the session.
+@param inputRole: Which side of the session the transport is for
+@param inputContext: The ZMQ context to create the sockets with
+@param inputGameEndpoint: The endpoint that the game publishes percepts on
+@param inputAIEndpoint: The endpoint that the AI publishes actions on
+@exceptions: This function can throw exceptions
+*/
+zmqPublishSubscribeTransport::zmqPublishSubscribeTransport(transportRole inputRole, zmq::context_t &inputContext, const std::string &inputGameEndpoint, const std::string &inputAIEndpoint)
+{
+currentReceiveTimeout = -1;
+currentSendTimeout = -1;
+outgoingMessageTimeout = -1;
+
+if(inputAIEndpoint.size() == 0)
+{
+throw SOMException("Error, the publish/subscribe transport needs an AI endpoint\n", INVALID_FUNCTION_INPUT, __FILE__, __LINE__);
+}
+
+//Each side publishes on its own endpoint and subscribes to the other side's
+std::string publishingEndpoint = inputGameEndpoint;
+std::string subscriptionEndpoint = inputAIEndpoint;
+if(inputRole == AI_ROLE)
+{
+publishingEndpoint = inputAIEndpoint;
+subscriptionEndpoint = inputGameEndpoint;
+}
+
+SOM_TRY
+publishingSocket.reset(new zmq::socket_t(inputContext, ZMQ_PUB));
+SOM_CATCH("Error initializing publishing socket\n")
+
+//Now bind the socket
+SOM_TRY
+publishingSocket->bind(publishingEndpoint.c_str());
+SOM_CATCH("Error binding socket\n")
+
+SOM_TRY
+subscriptionSocket.reset(new zmq::socket_t(inputContext, ZMQ_SUB));
+SOM_CATCH("Error initializing subscription socket\n")
+
+SOM_TRY
+subscriptionSocket->connect(subscriptionEndpoint.c_str());
+SOM_CATCH("Error connecting to publisher\n")
+
+SOM_TRY
+subscriptionSocket->setsockopt(ZMQ_SUBSCRIBE, "", 0);
+SOM_CATCH("Error setting filter for subscription\n")
+}
+
+/*
+This function publishes the given message.
+@param inputMessage: The serialized message to send
+@param inputMessageSize: The size of the message in bytes
+@param inputTimeoutInMilliseconds: How long to wait for the message to be accepted for sending (-1 waits forever, 0 returns immediately if it can't be sent)
+@return: True if the message was sent, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+bool zmqPublishSubscribeTransport::sendMessage(const char *inputMessage, uint64_t inputMessageSize, int inputTimeoutInMilliseconds)
+{
+int flags = 0;
+SOM_TRY
+flags = prepareToSend(inputTimeoutInMilliseconds);
+SOM_CATCH("Error preparing to send\n")
+
+//Messages are never empty, so zero bytes sent means the send timed out
+SOM_TRY
+return publishingSocket->send(inputMessage, inputMessageSize, flags) != 0;
+SOM_CATCH("Error sending message\n")
+}
+
+/*
+This function returns the data of a new ZMQ message of the given size, so the message can be serialized straight into the frame that is sent.
+@param inputMessageSize: The size of the message in bytes
+@param inputTimeoutInMilliseconds: How long commitMessage should wait for the message to be accepted for sending (-1 waits forever, 0 doesn't wait)
+@return: The buffer to write the message into
+@exceptions: This function can throw exceptions
+*/
+char *zmqPublishSubscribeTransport::reserveMessage(uint64_t inputMessageSize, int inputTimeoutInMilliseconds)
+{
+SOM_TRY
+outgoingMessage.rebuild(inputMessageSize);
+SOM_CATCH("Error creating message\n")
+
+outgoingMessageTimeout = inputTimeoutInMilliseconds;
+return (char *) outgoingMessage.data();
+}
+
+/*
+This function sends the message returned by reserveMessage (handing the frame to ZMQ rather than copying it).
+@return: True if the message was sent, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+bool zmqPublishSubscribeTransport::commitMessage()
+{
+int flags = 0;
+SOM_TRY
+flags = prepareToSend(outgoingMessageTimeout);
+SOM_CATCH("Error preparing to send\n")
+
+SOM_TRY
+return publishingSocket->send(outgoingMessage, flags);
+SOM_CATCH("Error sending message\n")
+}
+
+/*
+This function sets the send timeout of the socket (if it has changed) and returns the flags to send with.
+@param inputTimeoutInMilliseconds: How long to wait for the message to be accepted for sending (-1 waits forever, 0 doesn't wait)
+@return: The flags to pass to send
+@exceptions: This function can throw exceptions
+*/
+int zmqPublishSubscribeTransport::prepareToSend(int inputTimeoutInMilliseconds)
+{
+int flags = 0;
+if(inputTimeoutInMilliseconds == 0)
+{
+flags = ZMQ_DONTWAIT;
+}
+else if(inputTimeoutInMilliseconds != currentSendTimeout)
+{
+SOM_TRY
+publishingSocket->setsockopt(ZMQ_SNDTIMEO, &inputTimeoutInMilliseconds, sizeof(inputTimeoutInMilliseconds));
+SOM_CATCH("Error setting send timeout interval for publishing socket\n")
+currentSendTimeout = inputTimeoutInMilliseconds;
+}
+
+return flags;
+}
+
+/*
+This function waits for the next message from the subscription socket.
+@param inputTimeoutInMilliseconds: How long to wait for a message (-1 waits forever, 0 returns immediately if nothing is available)
+@return: True if a message was received, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+bool zmqPublishSubscribeTransport::receiveMessage(int inputTimeoutInMilliseconds)
+{
+int flags = 0;
+if(inputTimeoutInMilliseconds == 0)
+{
+flags = ZMQ_DONTWAIT;  //Set nonblocking if we are not suppose to wait
+}
+else if(inputTimeoutInMilliseconds != currentReceiveTimeout)
+{
+SOM_TRY
+subscriptionSocket->setsockopt(ZMQ_RCVTIMEO, &inputTimeoutInMilliseconds, sizeof(inputTimeoutInMilliseconds));
+SOM_CATCH("Error setting timeout interval for subscription socket\n")
+currentReceiveTimeout = inputTimeoutInMilliseconds;
+}
+
+SOM_TRY
+return subscriptionSocket->recv(&receivedMessage, flags);
+SOM_CATCH("Error receiving message\n")
+}
+
+/*
+This function returns a pointer to the contents of the last received message.
+@return: The message bytes
+*/
+const char *zmqPublishSubscribeTransport::getReceivedMessageData()
+{
+return (const char *) receivedMessage.data();
+}
+
+/*
+This function returns the size of the last received message.
+@return: The size of the message in bytes
+*/
+uint64_t zmqPublishSubscribeTransport::getReceivedMessageSize()
+{
+return receivedMessage.size();
+}
+
+/*
+Published messages are lost if nobody has subscribed yet, so this always returns true.
+@return: True
+*/
+bool zmqPublishSubscribeTransport::canDropMessages()
+{
+return true;
+}
+
+/*
+This function fills in a zmq_poll item for the subscription socket, which becomes readable when a message arrives.
+@param outputPollItem: The poll item
+@return: True
+*/
+bool zmqPublishSubscribeTransport::getPollItem(zmq_pollitem_t &outputPollItem)
+{
+outputPollItem.socket = (void *) (*subscriptionSocket);
+outputPollItem.fd = 0;
+outputPollItem.events = ZMQ_POLLIN;
+outputPollItem.revents = 0;
+return true;
+}
@@ -0,0 +1,108 @@
+#ifndef ZMQPUBLISHSUBSCRIBETRANSPORTHPP
+#define ZMQPUBLISHSUBSCRIBETRANSPORTHPP
+
+#include<memory>
+#include<string>
+#include "zmq.hpp"
+
+#include "SOMException.hpp"
+#include "messageTransport.hpp"
+
+/*
+This class implements the original AI Arena transport, where the game and the AI each bind a ZMQ publisher and subscribe to the other side's publisher.  Messages published before the other side has subscribed are silently dropped, so users of this transport have to resend and filter by sequence number.
+*/
+class zmqPublishSubscribeTransport : public messageTransport
+{
+public:
+/*
+This function creates the publishing and subscription sockets for the given side of the session.
+@param inputRole: Which side of the session the transport is for
+@param inputContext: The ZMQ context to create the sockets with
+@param inputGameEndpoint: The endpoint that the game publishes percepts on
+@param inputAIEndpoint: The endpoint that the AI publishes actions on
+@exceptions: This function can throw exceptions
+*/
+zmqPublishSubscribeTransport(transportRole inputRole, zmq::context_t &inputContext, const std::string &inputGameEndpoint, const std::string &inputAIEndpoint);
+
+/*
+This function publishes the given message.
+@param inputMessage: The serialized message to send
+@param inputMessageSize: The size of the message in bytes
+@param inputTimeoutInMilliseconds: How long to wait for the message to be accepted for sending (-1 waits forever, 0 returns immediately if it can't be sent)
+@return: True if the message was sent, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+virtual bool sendMessage(const char *inputMessage, uint64_t inputMessageSize, int inputTimeoutInMilliseconds);
+
+/*
+This function returns the data of a new ZMQ message of the given size, so the message can be serialized straight into the frame that is sent.
+@param inputMessageSize: The size of the message in bytes
+@param inputTimeoutInMilliseconds: How long commitMessage should wait for the message to be accepted for sending (-1 waits forever, 0 doesn't wait)
+@return: The buffer to write the message into
+@exceptions: This function can throw exceptions
+*/
+virtual char *reserveMessage(uint64_t inputMessageSize, int inputTimeoutInMilliseconds);
+
+/*
+This function sends the message returned by reserveMessage (handing the frame to ZMQ rather than copying it).
+@return: True if the message was sent, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+virtual bool commitMessage();
+
+/*
+This function waits for the next message from the subscription socket.
+@param inputTimeoutInMilliseconds: How long to wait for a message (-1 waits forever, 0 returns immediately if nothing is available)
+@return: True if a message was received, false if the wait timed out
+@exceptions: This function can throw exceptions
+*/
+virtual bool receiveMessage(int inputTimeoutInMilliseconds);
+
+/*
+This function returns a pointer to the contents of the last received message.
+@return: The message bytes
+*/
+virtual const char *getReceivedMessageData();
+
+/*
+This function returns the size of the last received message.
+@return: The size of the message in bytes
+*/
+virtual uint64_t getReceivedMessageSize();
+
+/*
+Published messages are lost if nobody has subscribed yet, so this always returns true.
+@return: True
+*/
+virtual bool canDropMessages();
+
+/*
+This function fills in a zmq_poll item for the subscription socket, which becomes readable when a message arrives.
+@param outputPollItem: The poll item
+@return: True
+*/
+virtual bool getPollItem(zmq_pollitem_t &outputPollItem);
+
+private:
+std::unique_ptr<zmq::socket_t> publishingSocket;
+std::unique_ptr<zmq::socket_t> subscriptionSocket;
+zmq::message_t receivedMessage;
+int currentReceiveTimeout; //The ZMQ_RCVTIMEO value the subscription socket currently has
+int currentSendTimeout; //The ZMQ_SNDTIMEO value the publishing socket currently has
+zmq::message_t outgoingMessage; //Message being written between reserveMessage and commitMessage
+int outgoingMessageTimeout;
+
+/*
+This function sets the send timeout of the socket (if it has changed) and returns the flags to send with.
+@param inputTimeoutInMilliseconds: How long to wait for the message to be accepted for sending (-1 waits forever, 0 doesn't wait)
+@return: The flags to pass to send
+@exceptions: This function can throw exceptions
+*/
+int prepareToSend(int inputTimeoutInMilliseconds);
+};
+
+
+
+
+
+#endif
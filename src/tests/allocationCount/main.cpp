@@ -0,0 +1,176 @@
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<future>
+#include<string>
+#include<exception>
+#include<unistd.h>
+
+#include "gameEngineCommunicationInterface.hpp"
+#include "AICommunicationInterface.hpp"
+
+//Steps played before counting starts (so the buffers have grown to their steady state size) and steps counted
+#define ALLOCATION_COUNT_WARM_UP_STEPS 500
+#define ALLOCATION_COUNT_COUNTED_STEPS 1500
+
+//glibc's own allocator, which the functions below forward to
+extern "C" void *__libc_malloc(std::size_t inputSize);
+extern "C" void *__libc_calloc(std::size_t inputNumberOfElements, std::size_t inputElementSize);
+extern "C" void *__libc_realloc(void *inputMemory, std::size_t inputSize);
+extern "C" void __libc_free(void *inputMemory);
+
+//Only the game thread counts, so the AI thread (and ZMQ's I/O threads) can allocate freely
+static thread_local bool countingAllocations = false;
+static thread_local uint64_t numberOfAllocations = 0;
+
+/*
+malloc, calloc and realloc are replaced for the whole process (operator new and libzmq both end up here), so allocations made inside the libraries are counted as well as the ones made with new.
+*/
+extern "C" void *malloc(std::size_t inputSize)
+{
+if(countingAllocations)
+{
+numberOfAllocations++;
+}
+return __libc_malloc(inputSize);
+}
+
+extern "C" void *calloc(std::size_t inputNumberOfElements, std::size_t inputElementSize)
+{
+if(countingAllocations)
+{
+numberOfAllocations++;
+}
+return __libc_calloc(inputNumberOfElements, inputElementSize);
+}
+
+extern "C" void *realloc(void *inputMemory, std::size_t inputSize)
+{
+if(countingAllocations && inputSize != 0)
+{
+numberOfAllocations++;
+}
+return __libc_realloc(inputMemory, inputSize);
+}
+
+extern "C" void free(void *inputMemory)
+{
+__libc_free(inputMemory);
+}
+
+/*
+This function plays a session between a game and an AI thread and counts the allocations the game thread makes (with operator new or malloc, including the ones made inside ZMQ and protobuf) during the steady state steps.
+@param inputTransportType: The transport to use
+@param inputEndpoint: The endpoint the game binds to
+@param inputPerceptSize: The number of bytes in each percept and action
+@return: The number of allocations the game thread made
+@exceptions: This function can throw exceptions
+*/
+uint64_t countSteadyStateAllocations(transportType inputTransportType, const std::string &inputEndpoint, uint64_t inputPerceptSize)
+{
+zmq::context_t context;
+int numberOfSteps = ALLOCATION_COUNT_WARM_UP_STEPS + ALLOCATION_COUNT_COUNTED_STEPS;
+
+std::future<uint64_t> gameResult = std::async(std::launch::async, [&]()
+{
+gameEngineCommunicationInterface gameCom(context, inputEndpoint, inputPerceptSize*8, inputPerceptSize*8, 10000, inputTransportType);
+std::string percept(inputPerceptSize, 'p');
+std::string action; //Kept from step to step, so assigning the action to it doesn't allocate once it is big enough
+
+for(int step = 0; step < numberOfSteps; step++)
+{
+countingAllocations = step >= ALLOCATION_COUNT_WARM_UP_STEPS;
+percept[0] = (char) step;
+action = gameCom.sendPerceptionsAndGetActions(percept, step);
+}
+countingAllocations = false;
+
+return numberOfAllocations;
+});
+
+AICommunicationInterface AICom(context, inputEndpoint, inputTransportType, 10000);
+std::string action(inputPerceptSize, 'a');
+for(int step = 0; step < numberOfSteps; step++)
+{
+AICom.getCurrentPerceptions();
+if(step + 1 < numberOfSteps)
+{
+AICom.sendActionsAndUpdatePerceptions(action);
+}
+else
+{
+AICom.sendActions(action.c_str(), action.size());
+}
+}
+
+return gameResult.get();
+}
+
+//The exit code ctest treats as a skipped test (see SKIP_RETURN_CODE in CMakeLists.txt)
+#define ALLOCATION_COUNT_SKIPPED 77
+
+/*
+This program checks that the steady state steps of a game allocate nothing on the game thread, for small and large percepts over the lockstep and shared memory transports.  Given the name of a case, it only runs that one.  It returns a nonzero value if any of them allocate, except for cases that are known to allocate, which are still run and reported but only count as skipped (ALLOCATION_COUNT_SKIPPED when that case is run on its own).
+*/
+int main(int argc, char **argv)
+{
+struct allocationCountCase
+{
+std::string name;
+transportType transport;
+std::string endpoint;
+uint64_t perceptSize;
+const char *reasonItAllocates; //NULL unless the case is known to allocate
+};
+
+//ZMQ keeps messages of up to 33 bytes inside the message object, but mallocs the frame of every bigger message it is given to send (and handing it a buffer of our own instead allocates its reference count), so large lockstep percepts allocate once per step
+std::string sharedMemoryName = "shm://AIArenaAllocationCount" + std::to_string(getpid());
+allocationCountCase cases[] = {{"lockstep16", LOCKSTEP_TRANSPORT, "inproc://allocationCount16", 16, NULL}, {"lockstep4096", LOCKSTEP_TRANSPORT, "inproc://allocationCount4096", 4096, "ZMQ allocates the frame of each message over 33 bytes"}, {"sharedMemory16", SHARED_MEMORY_TRANSPORT, sharedMemoryName + "_16", 16, NULL}, {"sharedMemory4096", SHARED_MEMORY_TRANSPORT, sharedMemoryName + "_4096", 4096, NULL}};
+
+int returnValue = 0;
+bool caseFound = false;
+for(const allocationCountCase &testCase : cases)
+{
+if(argc > 1 && testCase.name != argv[1])
+{
+continue;
+}
+caseFound = true;
+
+uint64_t allocations = 0;
+try
+{
+allocations = countSteadyStateAllocations(testCase.transport, testCase.endpoint, testCase.perceptSize);
+}
+catch(const std::exception &inputException)
+{
+fprintf(stderr, "%s: %s\n", testCase.name.c_str(), inputException.what());
+returnValue = 1;
+continue;
+}
+
+printf("%s (%llu byte percepts): %llu allocations in %d steps\n", testCase.name.c_str(), (unsigned long long) testCase.perceptSize, (unsigned long long) allocations, ALLOCATION_COUNT_COUNTED_STEPS);
+if(testCase.reasonItAllocates != NULL)
+{
+printf("%s skipped: %s\n", testCase.name.c_str(), testCase.reasonItAllocates);
+if(argc > 1 && returnValue == 0)
+{
+returnValue = ALLOCATION_COUNT_SKIPPED;
+}
+continue;
+}
+
+if(allocations != 0)
+{
+returnValue = 1;
+}
+}
+
+if(!caseFound)
+{
+fprintf(stderr, "There is no case called %s\n", argv[1]);
+return 1;
+}
+
+return returnValue;
+}
@@ -0,0 +1,150 @@
+#include <cstdio>
+#include<random>
+#include<string>
+
+#include "deltaPerceptEncoding.hpp"
+
+//How many percepts each run encodes and decodes, and how many corrupt copies of each encoded percept are decoded
+#define DELTA_FUZZ_NUMBER_OF_RUNS 200
+#define DELTA_FUZZ_STEPS_PER_RUN 50
+#define DELTA_FUZZ_CORRUPTIONS_PER_STEP 20
+
+//The largest percept the decoder is told to accept
+#define DELTA_FUZZ_MAXIMUM_PERCEPT_SIZE 4096
+
+/*
+This function changes some of the bytes of a percept, the way a game's percept changes from step to step (sometimes a few scattered bytes, sometimes a run, occasionally the whole percept or its size).
+@param inputOutputPercept: The percept to change
+@param inputGenerator: The random number generator to use
+*/
+static void changePercept(std::string &inputOutputPercept, std::mt19937 &inputGenerator)
+{
+uint32_t kindOfChange = inputGenerator() % 10;
+if(kindOfChange == 0 || inputOutputPercept.empty())
+{
+inputOutputPercept.resize(inputGenerator() % (DELTA_FUZZ_MAXIMUM_PERCEPT_SIZE + 1));
+for(char &byte : inputOutputPercept)
+{
+byte = (inputGenerator() % 4 == 0) ? (char) inputGenerator() : 0; //Mostly zeros, so NONZERO spans are used
+}
+return;
+}
+
+if(kindOfChange < 6)
+{
+uint32_t numberOfChanges = inputGenerator() % 16;
+for(uint32_t change = 0; change < numberOfChanges; change++)
+{
+inputOutputPercept[inputGenerator() % inputOutputPercept.size()] = (char) inputGenerator();
+}
+return;
+}
+
+uint64_t runStart = inputGenerator() % inputOutputPercept.size();
+uint64_t runSize = inputGenerator() % (inputOutputPercept.size() - runStart + 1);
+for(uint64_t position = runStart; position < runStart + runSize; position++)
+{
+inputOutputPercept[position] = (char) inputGenerator();
+}
+}
+
+/*
+This function corrupts an encoded percept by flipping bytes, cutting it short or replacing it with random bytes (including sizes far larger than any percept).
+@param inputOutputEncodedPercept: The encoded percept to corrupt
+@param inputGenerator: The random number generator to use
+*/
+static void corruptEncodedPercept(std::string &inputOutputEncodedPercept, std::mt19937 &inputGenerator)
+{
+uint32_t kindOfCorruption = inputGenerator() % 4;
+if(kindOfCorruption == 0 && !inputOutputEncodedPercept.empty())
+{
+inputOutputEncodedPercept.resize(inputGenerator() % inputOutputEncodedPercept.size());
+}
+else if(kindOfCorruption == 1)
+{
+inputOutputEncodedPercept.resize(inputGenerator() % 32);
+for(char &byte : inputOutputEncodedPercept)
+{
+byte = (char) inputGenerator();
+}
+}
+else if(kindOfCorruption == 2)
+{
+//A NONZERO or CHANGES record claiming a huge percept
+inputOutputEncodedPercept.assign(1, (char) (1 + inputGenerator() % 2));
+inputOutputEncodedPercept.append(9, (char) 0xff);
+inputOutputEncodedPercept.push_back((char) 0x01);
+}
+else
+{
+uint32_t numberOfFlips = 1 + inputGenerator() % 4;
+for(uint32_t flip = 0; flip < numberOfFlips && !inputOutputEncodedPercept.empty(); flip++)
+{
+inputOutputEncodedPercept[inputGenerator() % inputOutputEncodedPercept.size()] ^= (char) (1 + inputGenerator() % 255);
+}
+}
+}
+
+/*
+This program checks that delta encoded percepts decode back to the percepts they were made from, and that corrupt encoded percepts are either rejected or decoded into a percept no larger than the decoder allows (without crashing).  It returns a nonzero value if either check fails.
+*/
+int main(int argc, char **argv)
+{
+std::mt19937 generator(12345); //Fixed seed so failures can be reproduced
+uint64_t numberOfRoundTrips = 0;
+uint64_t numberOfBadRoundTrips = 0;
+uint64_t numberOfCorruptPercepts = 0;
+uint64_t numberOfRejectedCorruptPercepts = 0;
+uint64_t numberOfOversizedPercepts = 0;
+
+std::string encodedPercept;
+std::string corruptPercept;
+std::string corruptDecodedPercept;
+for(int run = 0; run < DELTA_FUZZ_NUMBER_OF_RUNS; run++)
+{
+std::string percept;
+std::string encoderPreviousPercept;
+std::string decodedPercept;
+for(int step = 0; step < DELTA_FUZZ_STEPS_PER_RUN; step++)
+{
+changePercept(percept, generator);
+encodeDeltaPercept(percept.data(), percept.size(), encoderPreviousPercept, encodedPercept);
+
+numberOfRoundTrips++;
+if(!decodeDeltaPercept(encodedPercept.data(), encodedPercept.size(), decodedPercept, DELTA_FUZZ_MAXIMUM_PERCEPT_SIZE) || decodedPercept != percept)
+{
+numberOfBadRoundTrips++;
+decodedPercept.clear(); //Start again from the next percept encoded against zeros
+encoderPreviousPercept.clear();
+continue;
+}
+
+for(int corruption = 0; corruption < DELTA_FUZZ_CORRUPTIONS_PER_STEP; corruption++)
+{
+corruptPercept = encodedPercept;
+corruptEncodedPercept(corruptPercept, generator);
+corruptDecodedPercept = decodedPercept;
+
+numberOfCorruptPercepts++;
+if(!decodeDeltaPercept(corruptPercept.data(), corruptPercept.size(), corruptDecodedPercept, DELTA_FUZZ_MAXIMUM_PERCEPT_SIZE))
+{
+numberOfRejectedCorruptPercepts++;
+}
+
+if(corruptDecodedPercept.size() > DELTA_FUZZ_MAXIMUM_PERCEPT_SIZE)
+{
+numberOfOversizedPercepts++;
+}
+}
+}
+}
+
+printf("%llu round trips (%llu bad), %llu corrupt percepts (%llu rejected, %llu oversized)\n", (unsigned long long) numberOfRoundTrips, (unsigned long long) numberOfBadRoundTrips, (unsigned long long) numberOfCorruptPercepts, (unsigned long long) numberOfRejectedCorruptPercepts, (unsigned long long) numberOfOversizedPercepts);
+
+if(numberOfBadRoundTrips != 0 || numberOfOversizedPercepts != 0)
+{
+return 1;
+}
+
+return 0;
+}
@@ -0,0 +1,224 @@
+#include<cstdio>
+#include<string>
+#include<vector>
+#include<thread>
+#include<chrono>
+#include<atomic>
+#include<exception>
+
+#include "multiAgentGameCommunicationInterface.hpp"
+#include "AICommunicationInterface.hpp"
+#include "perceptOrActionMessage.pb.h"
+
+//Each step, agent 0 answers straight away, agent 1 stalls once for several step deadlines (so it misses some steps and then answers them late) and agent 2 sends one message that isn't a valid action
+#define MULTI_AGENT_TEST_NUMBER_OF_AGENTS 3
+#define MULTI_AGENT_TEST_NUMBER_OF_STEPS 40
+#define MULTI_AGENT_TEST_STEP_DEADLINE 100
+#define MULTI_AGENT_TEST_STALLING_AGENT 1
+#define MULTI_AGENT_TEST_STALL_STEP 3
+#define MULTI_AGENT_TEST_STALL_TIME 450
+#define MULTI_AGENT_TEST_INVALID_AGENT 2
+#define MULTI_AGENT_TEST_INVALID_STEP 5
+
+//Percepts and actions are two bytes: the agent's index and the step, so the game can tell which percept an action answers
+#define MULTI_AGENT_TEST_MESSAGE_SIZE_IN_BITS 16
+
+static std::atomic<int> numberOfAgentErrors(0);
+
+/*
+This function plays an agent with the AI communication interface, echoing each percept back as its action (after stalling once if it is the stalling agent).
+@param inputContext: The ZMQ context to use
+@param inputEndpoint: The endpoint of the game
+@param inputAgentIndex: The agent to play
+*/
+static void playEchoAgent(zmq::context_t &inputContext, const std::string &inputEndpoint, int inputAgentIndex)
+{
+try
+{
+AICommunicationInterface AICom(inputContext, inputEndpoint, LOCKSTEP_TRANSPORT, 10000, "", inputAgentIndex);
+while(true)
+{
+std::string percept = AICom.getCurrentPerceptions();
+int step = (unsigned char) percept[1];
+if(inputAgentIndex == MULTI_AGENT_TEST_STALLING_AGENT && step == MULTI_AGENT_TEST_STALL_STEP)
+{
+std::this_thread::sleep_for(std::chrono::milliseconds(MULTI_AGENT_TEST_STALL_TIME));
+}
+
+if(step + 1 == MULTI_AGENT_TEST_NUMBER_OF_STEPS)
+{
+AICom.sendActions(percept.c_str(), percept.size());
+return;
+}
+AICom.sendActionsAndUpdatePerceptions(percept);
+}
+}
+catch(const std::exception &inputException)
+{
+fprintf(stderr, "Agent %d: %s\n", inputAgentIndex, inputException.what());
+numberOfAgentErrors++;
+}
+}
+
+/*
+This function plays an agent directly over a ZMQ socket (so it can send something the AI communication interface never would), answering HELLO with READY and echoing each percept back as its action, except for one step where it sends bytes that aren't a message.
+@param inputContext: The ZMQ context to use
+@param inputEndpoint: The endpoint of the game
+@param inputAgentIndex: The agent to play
+*/
+static void playInvalidMessageAgent(zmq::context_t &inputContext, const std::string &inputEndpoint, int inputAgentIndex)
+{
+try
+{
+zmq::socket_t socket(inputContext, ZMQ_DEALER);
+std::string routingID = getAgentRoutingID(inputAgentIndex);
+socket.setsockopt(ZMQ_ROUTING_ID, routingID.c_str(), routingID.size());
+int timeout = 10000;
+socket.setsockopt(ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+socket.connect(inputEndpoint.c_str());
+
+perceptOrActionMessage message;
+std::string serializedMessage;
+while(true)
+{
+zmq::message_t receivedMessage;
+if(!socket.recv(&receivedMessage) || !message.ParseFromArray(receivedMessage.data(), receivedMessage.size()))
+{
+throw SOMException("Error, no valid message from the game\n", INCORRECT_SERVER_RESPONSE, __FILE__, __LINE__);
+}
+
+if(message.has_handshake())
+{
+uint64_t sequenceNumber = message.sequence_number();
+message.Clear();
+message.set_handshake(READY);
+message.set_protocol_version(2);
+message.set_instance_id(1);
+message.set_sequence_number(sequenceNumber);
+}
+else
+{
+int step = (unsigned char) message.percept()[1];
+if(step == MULTI_AGENT_TEST_INVALID_STEP)
+{
+socket.send("not a message", 13);
+continue;
+}
+
+std::string percept = message.percept();
+message.Clear();
+message.set_action(percept);
+if(step + 1 == MULTI_AGENT_TEST_NUMBER_OF_STEPS)
+{
+message.SerializeToString(&serializedMessage);
+socket.send(serializedMessage.c_str(), serializedMessage.size());
+return;
+}
+}
+
+message.SerializeToString(&serializedMessage);
+socket.send(serializedMessage.c_str(), serializedMessage.size());
+}
+}
+catch(const std::exception &inputException)
+{
+fprintf(stderr, "Agent %d: %s\n", inputAgentIndex, inputException.what());
+numberOfAgentErrors++;
+}
+}
+
+/*
+This program plays a world with several agents and a step deadline, where one agent misses the deadline for a few steps and then answers them late and another sends a message that isn't an action.  It checks that every action the game hands back is either the one answering that step's percept or the default action (for a missed deadline or the invalid message), that the late answers are thrown away, and that the other agents' steps are unaffected.  It returns a nonzero value if any of that doesn't hold.
+*/
+int main()
+{
+zmq::context_t context;
+std::string endpoint = "inproc://multiAgentDeadline";
+std::string defaultAction("\xff\xff", 2);
+int numberOfFailures = 0;
+std::vector<std::thread> agents;
+
+try
+{
+multiAgentGameCommunicationInterface world(context, endpoint, MULTI_AGENT_TEST_NUMBER_OF_AGENTS, MULTI_AGENT_TEST_MESSAGE_SIZE_IN_BITS, MULTI_AGENT_TEST_MESSAGE_SIZE_IN_BITS, MULTI_AGENT_TEST_STEP_DEADLINE, 10000);
+world.setDefaultAction(defaultAction);
+
+for(int agentIndex = 0; agentIndex < MULTI_AGENT_TEST_NUMBER_OF_AGENTS; agentIndex++)
+{
+if(agentIndex == MULTI_AGENT_TEST_INVALID_AGENT)
+{
+agents.emplace_back(playInvalidMessageAgent, std::ref(context), endpoint, agentIndex);
+}
+else
+{
+agents.emplace_back(playEchoAgent, std::ref(context), endpoint, agentIndex);
+}
+}
+
+std::vector<std::string> percepts(MULTI_AGENT_TEST_NUMBER_OF_AGENTS, std::string(2, '\0'));
+std::vector<uint64_t> rewards(MULTI_AGENT_TEST_NUMBER_OF_AGENTS, 0);
+for(int step = 0; step < MULTI_AGENT_TEST_NUMBER_OF_STEPS; step++)
+{
+for(int agentIndex = 0; agentIndex < MULTI_AGENT_TEST_NUMBER_OF_AGENTS; agentIndex++)
+{
+percepts[agentIndex][0] = (char) agentIndex;
+percepts[agentIndex][1] = (char) step;
+}
+
+const std::vector<std::string> &actions = world.sendPerceptionsAndGetActions(percepts, rewards);
+for(int agentIndex = 0; agentIndex < MULTI_AGENT_TEST_NUMBER_OF_AGENTS; agentIndex++)
+{
+bool invalidAction = agentIndex == MULTI_AGENT_TEST_INVALID_AGENT && step == MULTI_AGENT_TEST_INVALID_STEP;
+const std::string &expectedAction = (world.agentMissedDeadline(agentIndex) || invalidAction) ? defaultAction : percepts[agentIndex];
+if(actions[agentIndex] != expectedAction)
+{
+fprintf(stderr, "Step %d: agent %d got the wrong action (%s)\n", step, agentIndex, world.agentMissedDeadline(agentIndex) ? "missed the deadline" : "answered");
+numberOfFailures++;
+}
+}
+}
+
+//The stalling agent must have missed steps and then caught up (so its late answers arrived while the game was running), and only the invalid message is counted
+if(world.getNumberOfMissedDeadlines(MULTI_AGENT_TEST_STALLING_AGENT) == 0 || world.agentMissedDeadline(MULTI_AGENT_TEST_STALLING_AGENT))
+{
+fprintf(stderr, "Agent %d missed %llu deadlines and %s the last step\n", MULTI_AGENT_TEST_STALLING_AGENT, (unsigned long long) world.getNumberOfMissedDeadlines(MULTI_AGENT_TEST_STALLING_AGENT), world.agentMissedDeadline(MULTI_AGENT_TEST_STALLING_AGENT) ? "missed" : "answered");
+numberOfFailures++;
+}
+
+for(int agentIndex = 0; agentIndex < MULTI_AGENT_TEST_NUMBER_OF_AGENTS; agentIndex++)
+{
+uint64_t expectedInvalidMessages = agentIndex == MULTI_AGENT_TEST_INVALID_AGENT ? 1 : 0;
+if(world.getNumberOfInvalidMessages(agentIndex) != expectedInvalidMessages)
+{
+fprintf(stderr, "Agent %d sent %llu invalid messages\n", agentIndex, (unsigned long long) world.getNumberOfInvalidMessages(agentIndex));
+numberOfFailures++;
+}
+}
+
+for(int agentIndex = 0; agentIndex < MULTI_AGENT_TEST_NUMBER_OF_AGENTS; agentIndex++)
+{
+printf("Agent %d missed %llu deadlines\n", agentIndex, (unsigned long long) world.getNumberOfMissedDeadlines(agentIndex));
+}
+
+for(std::thread &agent : agents)
+{
+agent.join();
+}
+}
+catch(const std::exception &inputException)
+{
+fprintf(stderr, "%s\n", inputException.what());
+for(std::thread &agent : agents)
+{
+agent.join();
+}
+return 1;
+}
+
+if(numberOfAgentErrors > 0)
+{
+numberOfFailures++;
+}
+
+return numberOfFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,243 @@
+#include<cstdio>
+#include<cstring>
+#include<string>
+#include<vector>
+#include<exception>
+#include<unistd.h>
+
+#include "trajectoryRecorder.hpp"
+#include "trajectoryReader.hpp"
+
+//The lengths of the recorded episodes (the last one is left open, with its last step unanswered).  There are enough steps with large enough percepts to fill more buffers than the recorder can have at once.
+static const uint64_t episodeLengths[] = {1, 7, 300, 1, 12000, 50};
+
+//Percepts are between 1 and this many bytes, so the records need different amounts of padding
+#define TRAJECTORY_TEST_MAXIMUM_PERCEPT_SIZE 1500
+
+//The sequence number of the first step (so sequence numbers can't be confused with step indices)
+#define TRAJECTORY_TEST_FIRST_SEQUENCE_NUMBER 1000
+
+/*
+One step as it was given to the recorder.
+*/
+struct expectedStep
+{
+uint64_t sequenceNumber;
+gameState state;
+uint64_t reward;
+std::string percept;
+std::string action;
+uint32_t actionFlags;
+};
+
+/*
+This function makes up the steps to record, with every field depending on the step's index.
+@return: The steps
+*/
+static std::vector<expectedStep> createSteps()
+{
+std::vector<expectedStep> steps;
+for(uint64_t episodeLength : episodeLengths)
+{
+for(uint64_t stepInEpisode = 0; stepInEpisode < episodeLength; stepInEpisode++)
+{
+uint64_t stepIndex = steps.size();
+expectedStep step;
+step.sequenceNumber = TRAJECTORY_TEST_FIRST_SEQUENCE_NUMBER + stepIndex;
+step.state = stepInEpisode == 0 ? GAME_START : (stepInEpisode + 1 == episodeLength ? GAME_OVER : GAME_CONTINUE);
+step.reward = stepIndex*3;
+step.percept.resize(1 + (stepIndex*7) % TRAJECTORY_TEST_MAXIMUM_PERCEPT_SIZE);
+for(uint64_t byteIndex = 0; byteIndex < step.percept.size(); byteIndex++)
+{
+step.percept[byteIndex] = (char) (stepIndex*31 + byteIndex);
+}
+step.action.resize(1 + stepIndex % 5);
+for(uint64_t byteIndex = 0; byteIndex < step.action.size(); byteIndex++)
+{
+step.action[byteIndex] = (char) (stepIndex + byteIndex*3);
+}
+step.actionFlags = (stepIndex % 11 == 0) ? TRAJECTORY_ACTION_MISSED_DEADLINE : 0;
+steps.push_back(step);
+}
+}
+
+//The last episode is still going when recording stops
+steps.back().state = GAME_CONTINUE;
+steps.back().action.clear();
+steps.back().actionFlags = TRAJECTORY_ACTION_UNANSWERED;
+return steps;
+}
+
+/*
+This function checks that a reader holds the first inputNumberOfSteps steps and the episodes they make up.
+@param inputReader: The reader to check
+@param inputSteps: The steps that were recorded
+@param inputNumberOfSteps: How many of them the reader should have
+@return: The number of differences found
+*/
+static int checkReader(const trajectoryReader &inputReader, const std::vector<expectedStep> &inputSteps, uint64_t inputNumberOfSteps)
+{
+int numberOfFailures = 0;
+if(inputReader.getNumberOfSteps() != inputNumberOfSteps)
+{
+fprintf(stderr, "Expected %llu steps, read %llu\n", (unsigned long long) inputNumberOfSteps, (unsigned long long) inputReader.getNumberOfSteps());
+return 1;
+}
+
+//Split the expected steps into episodes the way the recorder does
+std::vector<trajectoryEpisodeIndexEntry> expectedEpisodes;
+bool episodeOpen = false;
+for(uint64_t stepIndex = 0; stepIndex < inputNumberOfSteps; stepIndex++)
+{
+if(!episodeOpen || inputSteps[stepIndex].state == GAME_START)
+{
+trajectoryEpisodeIndexEntry episode;
+episode.offset = 0;
+episode.numberOfSteps = 0;
+episode.firstSequenceNumber = inputSteps[stepIndex].sequenceNumber;
+episode.totalReward = 0;
+expectedEpisodes.push_back(episode);
+episodeOpen = true;
+}
+expectedEpisodes.back().numberOfSteps++;
+expectedEpisodes.back().totalReward += inputSteps[stepIndex].reward;
+episodeOpen = inputSteps[stepIndex].state != GAME_OVER;
+}
+
+if(inputReader.getNumberOfEpisodes() != expectedEpisodes.size())
+{
+fprintf(stderr, "Expected %llu episodes, read %llu\n", (unsigned long long) expectedEpisodes.size(), (unsigned long long) inputReader.getNumberOfEpisodes());
+return 1;
+}
+
+uint64_t stepIndex = 0;
+uint64_t expectedOffset = sizeof(trajectoryFileHeader);
+std::vector<trajectoryStep> steps;
+for(uint64_t episodeIndex = 0; episodeIndex < expectedEpisodes.size(); episodeIndex++)
+{
+const trajectoryEpisodeIndexEntry &episode = inputReader.getEpisode(episodeIndex);
+if(episode.offset != expectedOffset || episode.numberOfSteps != expectedEpisodes[episodeIndex].numberOfSteps || episode.firstSequenceNumber != expectedEpisodes[episodeIndex].firstSequenceNumber || episode.totalReward != expectedEpisodes[episodeIndex].totalReward)
+{
+fprintf(stderr, "Episode %llu has the wrong index entry\n", (unsigned long long) episodeIndex);
+numberOfFailures++;
+}
+
+inputReader.getEpisodeSteps(episodeIndex, steps);
+for(const trajectoryStep &step : steps)
+{
+const expectedStep &expected = inputSteps[stepIndex];
+if(step.offset != expectedOffset || step.sequenceNumber != expected.sequenceNumber || step.state != expected.state || step.reward != expected.reward || step.actionFlags != expected.actionFlags || std::string(step.percept, step.perceptSize) != expected.percept || std::string(step.action, step.actionSize) != expected.action)
+{
+fprintf(stderr, "Step %llu was read back differently\n", (unsigned long long) stepIndex);
+numberOfFailures++;
+}
+expectedOffset += getTrajectoryStepRecordSize(expected.percept.size(), expected.action.size());
+stepIndex++;
+}
+}
+
+if(inputReader.getEndOfSteps() != expectedOffset)
+{
+fprintf(stderr, "The steps end at %llu rather than %llu\n", (unsigned long long) inputReader.getEndOfSteps(), (unsigned long long) expectedOffset);
+numberOfFailures++;
+}
+
+return numberOfFailures;
+}
+
+/*
+This function writes the first inputSize bytes of a file to another file, the way a recording process that died part way through a write would leave it.
+@param inputFilePath: The file to copy
+@param inputTruncatedFilePath: The file to write
+@param inputSize: How many bytes to keep
+@exceptions: This function can throw exceptions (if a file can't be read or written)
+*/
+static void writeTruncatedCopy(const std::string &inputFilePath, const std::string &inputTruncatedFilePath, uint64_t inputSize)
+{
+std::string contents(inputSize, '\0');
+FILE *file = fopen(inputFilePath.c_str(), "rb");
+bool fileRead = file != NULL && fread(&contents[0], 1, inputSize, file) == inputSize;
+if(file != NULL)
+{
+fclose(file);
+}
+
+FILE *truncatedFile = fopen(inputTruncatedFilePath.c_str(), "wb");
+bool fileWritten = truncatedFile != NULL && fwrite(contents.data(), 1, inputSize, truncatedFile) == inputSize;
+if(truncatedFile != NULL && fclose(truncatedFile) != 0)
+{
+fileWritten = false;
+}
+
+if(!fileRead || !fileWritten)
+{
+throw SOMException("Error, unable to write truncated copy of trajectory file\n", FILE_SYSTEM_ERROR, __FILE__, __LINE__);
+}
+}
+
+/*
+This program records a trajectory of several episodes, reads it back through the memory mapped reader and checks every field of every step and episode.  It then cuts copies of the file off part way through a step (in its header and in its percept) and checks that the rebuilt index stops at the last complete step.  It returns a nonzero value if anything doesn't match.
+*/
+int main()
+{
+std::string filePath = "/tmp/AIArenaTrajectoryRoundTrip" + std::to_string(getpid());
+std::string truncatedFilePath = filePath + ".truncated";
+std::vector<expectedStep> steps = createSteps();
+int numberOfFailures = 0;
+
+try
+{
+{
+trajectoryRecorder recorder(filePath, TRAJECTORY_TEST_MAXIMUM_PERCEPT_SIZE*8, 40);
+for(uint64_t stepIndex = 0; stepIndex < steps.size(); stepIndex++)
+{
+const expectedStep &step = steps[stepIndex];
+recorder.beginStep(step.sequenceNumber, step.state, step.reward, step.percept.c_str(), step.percept.size());
+if(stepIndex + 1 < steps.size())
+{
+recorder.finishStep(step.action.c_str(), step.action.size(), step.actionFlags);
+}
+}
+recorder.stop(); //Records the last step as unanswered
+}
+
+trajectoryReader reader(filePath);
+if(!reader.isComplete() || reader.getSizeOfPerceptInBits() != TRAJECTORY_TEST_MAXIMUM_PERCEPT_SIZE*8 || reader.getSizeOfActionInBits() != 40)
+{
+fprintf(stderr, "The file header or trailer was read back differently\n");
+numberOfFailures++;
+}
+numberOfFailures += checkReader(reader, steps, steps.size());
+
+//Cut the file off inside a step's header and inside its percept, in the middle of the episode that spans many buffers
+uint64_t truncatedStepIndex = 4321;
+uint64_t truncatedStepOffset = sizeof(trajectoryFileHeader);
+for(uint64_t stepIndex = 0; stepIndex < truncatedStepIndex; stepIndex++)
+{
+truncatedStepOffset += getTrajectoryStepRecordSize(steps[stepIndex].percept.size(), steps[stepIndex].action.size());
+}
+
+for(uint64_t bytesOfStepKept : {(uint64_t) 0, (uint64_t) sizeof(trajectoryStepHeader)/2, (uint64_t) sizeof(trajectoryStepHeader) + steps[truncatedStepIndex].percept.size()/2})
+{
+writeTruncatedCopy(filePath, truncatedFilePath, truncatedStepOffset + bytesOfStepKept);
+trajectoryReader truncatedReader(truncatedFilePath);
+if(truncatedReader.isComplete())
+{
+fprintf(stderr, "A truncated file was read as complete\n");
+numberOfFailures++;
+}
+numberOfFailures += checkReader(truncatedReader, steps, truncatedStepIndex);
+}
+}
+catch(const std::exception &inputException)
+{
+fprintf(stderr, "%s\n", inputException.what());
+numberOfFailures++;
+}
+
+unlink(filePath.c_str());
+unlink(truncatedFilePath.c_str());
+
+printf("%llu steps in %llu episodes: %d failures\n", (unsigned long long) steps.size(), (unsigned long long) (sizeof(episodeLengths)/sizeof(episodeLengths[0])), numberOfFailures);
+return numberOfFailures == 0 ? 0 : 1;
+}